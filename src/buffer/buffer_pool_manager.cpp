@@ -12,6 +12,7 @@
 
 #include "buffer/buffer_pool_manager.h"
 
+#include <cstring>
 #include <list>
 #include <unordered_map>
 
@@ -30,6 +31,14 @@ BufferPoolManager::BufferPoolManager(size_t pool_size, DiskManager *disk_manager
 }
 
 BufferPoolManager::~BufferPoolManager() {
+  {
+    std::scoped_lock<std::mutex> lock(prefetch_latch_);
+    shutdown_ = true;
+  }
+  prefetch_cv_.notify_all();
+  if (prefetch_thread_.joinable()) {
+    prefetch_thread_.join();
+  }
   delete[] pages_;
   delete replacer_;
 }
@@ -57,6 +66,7 @@ Page *BufferPoolManager::FetchPageImpl(page_id_t page_id) {
     // }
     page->pin_count_++;
     replacer_->Pin(frame_id);
+    TrackRecLSN(page);
     // std::cout << "Got from page table\n";
     return page;
   }
@@ -81,7 +91,7 @@ Page *BufferPoolManager::FetchPageImpl(page_id_t page_id) {
   Page *page = pages_ + frame_id;
   // 2.     If R is dirty, write it back to the disk.
   if (page->IsDirty()) {
-    disk_manager_->WritePage(page->GetPageId(), page->GetData());
+    WritePageToDisk(page);
   }
   // 3.     Delete R from the page table and insert P.
   // std::cout << "Got a new page\n";
@@ -90,10 +100,19 @@ Page *BufferPoolManager::FetchPageImpl(page_id_t page_id) {
   // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
   page->page_id_ = page_id;
   page->is_dirty_ = false;
+  page->rec_lsn_ = INVALID_LSN;
   page->ResetMemory();
   disk_manager_->ReadPage(page_id, page->data_);
+  if (on_page_read_) {
+    lsn_t first_lsn = on_page_read_(page);
+    if (first_lsn != INVALID_LSN) {
+      page->is_dirty_ = true;
+      page->rec_lsn_ = first_lsn;
+    }
+  }
   page->pin_count_ = 1;
   replacer_->Pin(frame_id);
+  TrackRecLSN(page);
   // std::cout << "Got a new page\n";
   return page;
 }
@@ -115,6 +134,10 @@ bool BufferPoolManager::UnpinPageImpl(page_id_t page_id, bool is_dirty) {
     page->pin_count_--;
     if (page->pin_count_ == 0) {
       replacer_->Unpin(frame_id);
+      if (!page->is_dirty_) {
+        // nobody can change it until the next pin
+        page->rec_lsn_ = INVALID_LSN;
+      }
     }
   } else {
     return false;
@@ -135,8 +158,7 @@ bool BufferPoolManager::FlushPageImpl(page_id_t page_id) {
   }
   frame_id_t frame_id = p->second;
   Page *page = pages_ + frame_id;
-  disk_manager_->WritePage(page_id, page->GetData());
-  page->is_dirty_ = false;
+  WritePageToDisk(page);
   return true;
 }
 
@@ -157,8 +179,7 @@ Page *BufferPoolManager::NewPageImpl(page_id_t *page_id) {
       delete f;
       Page *page = pages_ + frame_id;
       if (page->is_dirty_) {
-        disk_manager_->WritePage(page->page_id_, page->data_);
-        page->is_dirty_ = false;
+        WritePageToDisk(page);
       }
       page_table_.erase(page->page_id_);
       // std::cout << "erased page_id: " << page->page_id_ << std::endl;
@@ -170,12 +191,15 @@ Page *BufferPoolManager::NewPageImpl(page_id_t *page_id) {
   }
   // 3.   Update P's metadata, zero out memory and add P to the page table.
   *page_id = disk_manager_->AllocatePage();
+  disk_epoch_++;
   page_table_[*page_id] = frame_id;
   Page *page = pages_ + frame_id;
   page->ResetMemory();
   page->page_id_ = *page_id;
   page->pin_count_ = 1;
+  page->rec_lsn_ = INVALID_LSN;
   replacer_->Pin(frame_id);
+  TrackRecLSN(page);
   // disk_manager_->ReadPage(*page_id, page->data_); //此时不要读盘，盘里没有东西
   // 4.   Set the page ID output parameter. Return a pointer to P.
   // std::cout << "new page_id: " << *page_id << " with frame id: " << frame_id << std::endl;
@@ -199,10 +223,12 @@ bool BufferPoolManager::DeletePageImpl(page_id_t page_id) {
   }
   // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
   disk_manager_->DeallocatePage(page_id);
+  disk_epoch_++;
   page_table_.erase(page_id);
   page->page_id_ = INVALID_PAGE_ID;
   page->ResetMemory();
   page->is_dirty_ = false;
+  page->rec_lsn_ = INVALID_LSN;
   replacer_->Pin(frame_id);
   free_list_.emplace_back(frame_id);
   return true;
@@ -212,8 +238,179 @@ void BufferPoolManager::FlushAllPagesImpl() {
   std::scoped_lock<std::mutex> lock{latch_};
   // You can do it!
   for (auto p : page_table_) {
-    FlushPageImpl(p.first);
+    WritePageToDisk(pages_ + p.second);
+  }
+}
+
+void BufferPoolManager::WritePageToDisk(Page *page) {
+  if (enable_logging && log_manager_ != nullptr) {
+    log_manager_->WaitForFlush(page->GetLSN());
+  }
+  disk_manager_->WritePage(page->page_id_, page->GetData());
+  disk_epoch_++;
+  page->is_dirty_ = false;
+  // changes from here on are not on disk, the ones before are
+  page->rec_lsn_ = INVALID_LSN;
+  if (page->pin_count_ > 0) {
+    TrackRecLSN(page);
+  }
+}
+
+void BufferPoolManager::TrackRecLSN(Page *page) {
+  if (page->rec_lsn_ == INVALID_LSN && enable_logging && log_manager_ != nullptr) {
+    page->rec_lsn_ = log_manager_->GetNextLSN();
+  }
+}
+
+size_t BufferPoolManager::GetUnpinnedFrameCount() {
+  std::scoped_lock<std::mutex> lock{latch_};
+  size_t count = 0;
+  for (size_t i = 0; i < pool_size_; i++) {
+    if (pages_[i].pin_count_ == 0) {
+      count++;
+    }
+  }
+  return count;
+}
+
+std::unordered_map<page_id_t, lsn_t> BufferPoolManager::GetDirtyPageTable() {
+  std::scoped_lock<std::mutex> lock{latch_};
+  std::unordered_map<page_id_t, lsn_t> dirty_page_table;
+  for (auto p : page_table_) {
+    Page *page = pages_ + p.second;
+    if (page->is_dirty_) {
+      // a page dirtied before logging was enabled has no bound, it has to be redone from the start
+      dirty_page_table[p.first] = page->rec_lsn_ == INVALID_LSN ? 0 : page->rec_lsn_;
+    } else if (page->pin_count_ > 0 && page->rec_lsn_ != INVALID_LSN) {
+      // a pinned page may have been changed already and only be marked dirty when it is unpinned
+      dirty_page_table[p.first] = page->rec_lsn_;
+    }
+  }
+  return dirty_page_table;
+}
+
+bool BufferPoolManager::WriteBackPage(page_id_t page_id) {
+  Page *page;
+  {
+    std::scoped_lock<std::mutex> lock{latch_};
+    auto p = page_table_.find(page_id);
+    if (p == page_table_.end() || !pages_[p->second].is_dirty_) {
+      return false;
+    }
+    page = pages_ + p->second;
+    page->pin_count_++;
+    replacer_->Pin(p->second);
+    // the write starts after this, a read ahead of the page running meanwhile must not be used
+    disk_epoch_++;
+  }
+
+  // writers change the page under its write latch, so the image on disk is a consistent one
+  page->RLatch();
+  if (enable_logging && log_manager_ != nullptr) {
+    log_manager_->WaitForFlush(page->GetLSN());
+  }
+  disk_manager_->WritePage(page_id, page->GetData());
+  {
+    // still under the read latch, nothing changed since the write
+    std::scoped_lock<std::mutex> lock{latch_};
+    page->is_dirty_ = false;
+    page->rec_lsn_ = INVALID_LSN;
+    TrackRecLSN(page);
+  }
+  page->RUnlatch();
+  UnpinPageImpl(page_id, false);
+  return true;
+}
+
+void BufferPoolManager::PrefetchPage(page_id_t page_id) {
+  if (page_id == INVALID_PAGE_ID) {
+    return;
+  }
+  {
+    // most pages asked for are there already, that needs no trip to the thread
+    std::scoped_lock<std::mutex> lock{latch_};
+    if (page_table_.find(page_id) != page_table_.end()) {
+      return;
+    }
+  }
+  std::scoped_lock<std::mutex> lock(prefetch_latch_);
+  // a full buffer pool worth of pages ahead would evict the first ones again before they are used
+  if (prefetch_queue_.size() >= pool_size_) {
+    return;
+  }
+  prefetch_queue_.push_back(page_id);
+  if (!prefetch_thread_.joinable()) {
+    prefetch_thread_ = std::thread(&BufferPoolManager::PrefetchPages, this);
+  }
+  prefetch_cv_.notify_all();
+}
+
+void BufferPoolManager::WaitForPrefetch() {
+  std::unique_lock<std::mutex> lock(prefetch_latch_);
+  prefetch_cv_.wait(lock, [this] { return prefetch_queue_.empty() && !prefetching_; });
+}
+
+void BufferPoolManager::PrefetchPages() {
+  std::unique_lock<std::mutex> lock(prefetch_latch_);
+  while (true) {
+    prefetch_cv_.wait(lock, [this] { return shutdown_ || !prefetch_queue_.empty(); });
+    if (shutdown_) {
+      return;
+    }
+    page_id_t page_id = prefetch_queue_.front();
+    prefetch_queue_.pop_front();
+    prefetching_ = true;
+    lock.unlock();
+    ReadAhead(page_id);
+    lock.lock();
+    prefetching_ = false;
+    prefetch_cv_.notify_all();
+  }
+}
+
+void BufferPoolManager::ReadAhead(page_id_t page_id) {
+  uint64_t epoch;
+  {
+    std::scoped_lock<std::mutex> lock{latch_};
+    if (page_table_.find(page_id) != page_table_.end()) {
+      return;
+    }
+    epoch = disk_epoch_;
+  }
+  char data[PAGE_SIZE];
+  disk_manager_->ReadPage(page_id, data);
+
+  std::scoped_lock<std::mutex> lock{latch_};
+  // fetched meanwhile, or written since and what was read may be stale
+  if (page_table_.find(page_id) != page_table_.end() || epoch != disk_epoch_) {
+    return;
+  }
+  frame_id_t frame_id;
+  if (!free_list_.empty()) {
+    frame_id = free_list_.front();
+    free_list_.pop_front();
+  } else if (!replacer_->Victim(&frame_id)) {
+    return;
+  }
+  Page *page = pages_ + frame_id;
+  if (page->IsDirty()) {
+    WritePageToDisk(page);
+  }
+  page_table_.erase(page->GetPageId());
+  page_table_[page_id] = frame_id;
+  page->page_id_ = page_id;
+  page->is_dirty_ = false;
+  page->rec_lsn_ = INVALID_LSN;
+  memcpy(page->data_, data, PAGE_SIZE);
+  if (on_page_read_) {
+    lsn_t first_lsn = on_page_read_(page);
+    if (first_lsn != INVALID_LSN) {
+      page->is_dirty_ = true;
+      page->rec_lsn_ = first_lsn;
+    }
   }
+  page->pin_count_ = 0;
+  replacer_->Unpin(frame_id);
 }
 
 }  // namespace bustub
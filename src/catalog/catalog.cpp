@@ -0,0 +1,269 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// catalog.cpp
+//
+// Identification: src/catalog/catalog.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "catalog/catalog.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "storage/page/catalog_page.h"
+#include "storage/page/header_page.h"
+
+namespace bustub {
+
+namespace {
+
+/**
+ * Table record:
+ * | kind (1) | oid (4) | name | first_page_id (4) | column_count (4) | name_1 | type_1 (1) | length_1 (4) | ... |
+ * Index record:
+ * | kind (1) | oid (4) | name | table_name | key_size (4) | attr_count (4) | attr_1 (4) | ... | unique (1) |
+ * Strings are stored as | length (4) | bytes |.
+ */
+enum class RecordKind : char { TABLE = 0, INDEX = 1 };
+
+void PutInt(std::vector<char> *record, uint32_t value) {
+  const auto *bytes = reinterpret_cast<const char *>(&value);
+  record->insert(record->end(), bytes, bytes + sizeof(uint32_t));
+}
+
+void PutString(std::vector<char> *record, const std::string &value) {
+  PutInt(record, static_cast<uint32_t>(value.size()));
+  record->insert(record->end(), value.begin(), value.end());
+}
+
+uint32_t GetInt(const std::vector<char> &record, size_t *pos) {
+  uint32_t value;
+  memcpy(&value, record.data() + *pos, sizeof(uint32_t));
+  *pos += sizeof(uint32_t);
+  return value;
+}
+
+std::string GetString(const std::vector<char> &record, size_t *pos) {
+  uint32_t size = GetInt(record, pos);
+  std::string value(record.data() + *pos, size);
+  *pos += size;
+  return value;
+}
+
+/** Open the B+ tree index an earlier catalog created with GenericKey<KeySize> keys. */
+template <size_t KeySize>
+Index *OpenBPlusTreeIndex(IndexMetadata *metadata, BufferPoolManager *bpm, LogManager *log_manager) {
+  auto *index = new BPlusTreeIndex<GenericKey<KeySize>, RID, GenericComparator<KeySize>>(metadata, bpm, log_manager);
+  index->Open();
+  return index;
+}
+
+}  // namespace
+
+Catalog::Catalog(BufferPoolManager *bpm, LockManager *lock_manager, LogManager *log_manager,
+                 page_id_t header_page_id)
+    : bpm_{bpm}, lock_manager_{lock_manager}, log_manager_{log_manager} {
+  auto *header_page = static_cast<HeaderPage *>(bpm_->FetchPage(header_page_id));
+  header_page->WLatch();
+  if (!header_page->GetRootId(CATALOG_RECORD_NAME, &first_catalog_page_id_)) {
+    auto *catalog_page = static_cast<CatalogPage *>(bpm_->NewPage(&first_catalog_page_id_));
+    catalog_page->Init(first_catalog_page_id_);
+    header_page->InsertRecord(CATALOG_RECORD_NAME, first_catalog_page_id_);
+    bpm_->UnpinPage(first_catalog_page_id_, true);
+    bpm_->FlushPage(first_catalog_page_id_);
+    header_page->WUnlatch();
+    bpm_->UnpinPage(header_page_id, true);
+    bpm_->FlushPage(header_page_id);
+    last_catalog_page_id_ = first_catalog_page_id_;
+    return;
+  }
+  header_page->WUnlatch();
+  bpm_->UnpinPage(header_page_id, false);
+  LoadDefinitions();
+}
+
+void Catalog::LoadDefinitions() {
+  table_oid_t next_table_oid = 0;
+  index_oid_t next_index_oid = 0;
+  std::vector<std::vector<char>> records;
+  for (page_id_t page_id = first_catalog_page_id_; page_id != INVALID_PAGE_ID;) {
+    auto *catalog_page = static_cast<CatalogPage *>(bpm_->FetchPage(page_id));
+    catalog_page->GetRecords(&records);
+    last_catalog_page_id_ = page_id;
+    page_id = catalog_page->GetNextPageId();
+    bpm_->UnpinPage(last_catalog_page_id_, false);
+  }
+
+  // only the names are decoded here, the rest waits until the table or index is looked up
+  for (auto &record : records) {
+    size_t pos = 1;
+    uint32_t oid = GetInt(record, &pos);
+    std::string name = GetString(record, &pos);
+    if (static_cast<RecordKind>(record[0]) == RecordKind::TABLE) {
+      names_[name] = oid;
+      next_table_oid = std::max(next_table_oid, oid + 1);
+      unopened_tables_[oid] = std::move(record);
+    } else {
+      std::string table_name = GetString(record, &pos);
+      index_names_[table_name][name] = oid;
+      next_index_oid = std::max(next_index_oid, oid + 1);
+      unopened_indexes_[oid] = std::move(record);
+    }
+  }
+  next_table_oid_ = next_table_oid;
+  next_index_oid_ = next_index_oid;
+}
+
+void Catalog::AppendRecord(const std::vector<char> &record) {
+  if (record.size() > CatalogPage::MaxRecordSize()) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "catalog record does not fit in a page");
+  }
+  auto *catalog_page = static_cast<CatalogPage *>(bpm_->FetchPage(last_catalog_page_id_));
+  if (!catalog_page->InsertRecord(record)) {
+    page_id_t new_page_id;
+    auto *new_page = static_cast<CatalogPage *>(bpm_->NewPage(&new_page_id));
+    if (new_page == nullptr) {
+      bpm_->UnpinPage(last_catalog_page_id_, false);
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "out of memory when growing the catalog");
+    }
+    new_page->Init(new_page_id);
+    new_page->InsertRecord(record);
+    catalog_page->SetNextPageId(new_page_id);
+    bpm_->UnpinPage(new_page_id, true);
+    bpm_->FlushPage(new_page_id);
+    bpm_->UnpinPage(last_catalog_page_id_, true);
+    bpm_->FlushPage(last_catalog_page_id_);
+    last_catalog_page_id_ = new_page_id;
+    return;
+  }
+  // definitions change rarely, so they go to disk right away instead of being logged
+  bpm_->UnpinPage(last_catalog_page_id_, true);
+  bpm_->FlushPage(last_catalog_page_id_);
+}
+
+void Catalog::PersistTable(const TableMetadata &table) {
+  std::vector<char> record{static_cast<char>(RecordKind::TABLE)};
+  PutInt(&record, table.oid_);
+  PutString(&record, table.name_);
+  PutInt(&record, static_cast<uint32_t>(table.table_->GetFirstPageId()));
+  PutInt(&record, table.schema_.GetColumnCount());
+  for (const Column &column : table.schema_.GetColumns()) {
+    PutString(&record, column.GetName());
+    record.push_back(static_cast<char>(column.GetType()));
+    PutInt(&record, column.GetLength());
+  }
+  AppendRecord(record);
+}
+
+void Catalog::PersistIndex(const IndexInfo &index, const std::vector<uint32_t> &key_attrs, bool unique) {
+  std::vector<char> record{static_cast<char>(RecordKind::INDEX)};
+  PutInt(&record, index.index_oid_);
+  PutString(&record, index.name_);
+  PutString(&record, index.table_name_);
+  PutInt(&record, static_cast<uint32_t>(index.key_size_));
+  PutInt(&record, static_cast<uint32_t>(key_attrs.size()));
+  for (uint32_t attr : key_attrs) {
+    PutInt(&record, attr);
+  }
+  record.push_back(static_cast<char>(unique));
+  AppendRecord(record);
+}
+
+bool Catalog::OpenTable(table_oid_t table_oid) {
+  auto it = unopened_tables_.find(table_oid);
+  if (it == unopened_tables_.end()) {
+    return false;
+  }
+  const std::vector<char> &record = it->second;
+  size_t pos = 1 + sizeof(uint32_t);
+  std::string name = GetString(record, &pos);
+  auto first_page_id = static_cast<page_id_t>(GetInt(record, &pos));
+  uint32_t column_count = GetInt(record, &pos);
+  std::vector<Column> columns;
+  columns.reserve(column_count);
+  for (uint32_t i = 0; i < column_count; i++) {
+    std::string column_name = GetString(record, &pos);
+    auto type = static_cast<TypeId>(record[pos++]);
+    uint32_t length = GetInt(record, &pos);
+    if (type == TypeId::VARCHAR) {
+      columns.emplace_back(column_name, type, length);
+    } else {
+      columns.emplace_back(column_name, type);
+    }
+  }
+
+  auto *table_heap = new TableHeap(bpm_, lock_manager_, log_manager_, first_page_id);
+  tables_.insert({table_oid, std::make_unique<TableMetadata>(Schema(columns), name,
+                                                             std::unique_ptr<TableHeap>(table_heap), table_oid)});
+  unopened_tables_.erase(it);
+  return true;
+}
+
+bool Catalog::OpenIndex(index_oid_t index_oid) {
+  auto it = unopened_indexes_.find(index_oid);
+  if (it == unopened_indexes_.end()) {
+    return false;
+  }
+  const std::vector<char> &record = it->second;
+  size_t pos = 1 + sizeof(uint32_t);
+  std::string name = GetString(record, &pos);
+  std::string table_name = GetString(record, &pos);
+  uint32_t key_size = GetInt(record, &pos);
+  uint32_t attr_count = GetInt(record, &pos);
+  std::vector<uint32_t> key_attrs;
+  key_attrs.reserve(attr_count);
+  for (uint32_t i = 0; i < attr_count; i++) {
+    key_attrs.push_back(GetInt(record, &pos));
+  }
+  // records written before indexes could be non-unique end here
+  bool unique = pos == record.size() || record[pos] != 0;
+
+  table_oid_t table_oid = names_.at(table_name);
+  if (tables_.find(table_oid) == tables_.end()) {
+    OpenTable(table_oid);
+  }
+  const Schema &schema = tables_.at(table_oid)->schema_;
+  auto *metadata = new IndexMetadata(name, table_name, &schema, key_attrs);
+  Schema key_schema = *metadata->GetKeySchema();
+  Index *index;
+  switch (key_size) {
+    case 0: {
+      // the tree left on disk may not match the table after a crash, build a new one instead of attaching to it
+      auto *var_index = new VarBPlusTreeIndex(metadata, bpm_, log_manager_, unique);
+      LoadIndex<VarKey, RID, VarKeyComparator>(nullptr, var_index, tables_.at(table_oid)->table_.get(), schema,
+                                               key_schema, key_attrs);
+      index = var_index;
+      break;
+    }
+    case 4:
+      index = OpenBPlusTreeIndex<4>(metadata, bpm_, log_manager_);
+      break;
+    case 8:
+      index = OpenBPlusTreeIndex<8>(metadata, bpm_, log_manager_);
+      break;
+    case 16:
+      index = OpenBPlusTreeIndex<16>(metadata, bpm_, log_manager_);
+      break;
+    case 32:
+      index = OpenBPlusTreeIndex<32>(metadata, bpm_, log_manager_);
+      break;
+    case 64:
+      index = OpenBPlusTreeIndex<64>(metadata, bpm_, log_manager_);
+      break;
+    default:
+      delete metadata;
+      throw Exception(ExceptionType::MISMATCH_TYPE, "unsupported index key size " + std::to_string(key_size));
+  }
+  indexes_.insert({index_oid, std::make_unique<IndexInfo>(key_schema, name, std::unique_ptr<Index>(index),
+                                                          index_oid, table_name, key_size)});
+  unopened_indexes_.erase(it);
+  return true;
+}
+
+}  // namespace bustub
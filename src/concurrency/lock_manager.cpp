@@ -24,6 +24,7 @@ bool LockManager::LockShared(Transaction *txn, const RID &rid) {
     throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
     return false;
   }
+  WaitForRecoveryLock(rid);
   std::unique_lock<std::mutex> waitlock(latch_);
   LockRequestQueue &lock_queue = lock_table_[rid];
   auto ToBeBlocked = [&]() {
@@ -62,6 +63,7 @@ bool LockManager::LockExclusive(Transaction *txn, const RID &rid) {
     throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
     return false;
   }
+  WaitForRecoveryLock(rid);
   std::unique_lock<std::mutex> waitlock(latch_);
   LockRequestQueue &lock_queue = lock_table_[rid];
   auto ToBeBlocked = [&]() {
@@ -97,6 +99,7 @@ bool LockManager::LockUpgrade(Transaction *txn, const RID &rid) {
     throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
     return false;
   }
+  WaitForRecoveryLock(rid);
   std::unique_lock<std::mutex> waitlock(latch_);
   LockRequestQueue &lock_queue = lock_table_[rid];
   lock_queue.upgrading_ = true;
@@ -174,6 +177,56 @@ bool LockManager::Unlock(Transaction *txn, const RID &rid) {
   return true;
 }
 
+void LockManager::SetRecoveryUndo(std::function<void(txn_id_t)> undo_loser) {
+  std::unique_lock<std::mutex> l(latch_);
+  recovery_undo_ = std::move(undo_loser);
+}
+
+void LockManager::LockForRecovery(txn_id_t txn_id, const RID &rid) {
+  std::unique_lock<std::mutex> l(latch_);
+  recovery_locks_[rid] = txn_id;
+  has_recovery_locks_ = true;
+}
+
+void LockManager::ReleaseRecoveryLocks(txn_id_t txn_id) {
+  {
+    std::unique_lock<std::mutex> l(latch_);
+    for (auto iter = recovery_locks_.begin(); iter != recovery_locks_.end();) {
+      if (iter->second == txn_id) {
+        iter = recovery_locks_.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+    has_recovery_locks_ = !recovery_locks_.empty();
+  }
+  recovery_cv_.notify_all();
+}
+
+bool LockManager::IsRecoveryLocked(const RID &rid) {
+  if (!has_recovery_locks_) {
+    return false;
+  }
+  std::unique_lock<std::mutex> l(latch_);
+  return recovery_locks_.count(rid) != 0;
+}
+
+void LockManager::WaitForRecoveryLock(const RID &rid) {
+  if (!has_recovery_locks_) {
+    return;
+  }
+  std::unique_lock<std::mutex> l(latch_);
+  auto iter = recovery_locks_.find(rid);
+  if (iter == recovery_locks_.end()) {
+    return;
+  }
+  // only ask, the undo runs on the recovery thread and latches the pages of the loser
+  if (recovery_undo_) {
+    recovery_undo_(iter->second);
+  }
+  recovery_cv_.wait(l, [&] { return recovery_locks_.count(rid) == 0; });
+}
+
 void LockManager::AddEdge(txn_id_t t1, txn_id_t t2) {
   for(const auto &tid : waits_for_[t1]) {
     if(tid == t2) {
@@ -28,6 +28,19 @@ Transaction *TransactionManager::Begin(Transaction *txn, IsolationLevel isolatio
 
   if (txn == nullptr) {
     txn = new Transaction(next_txn_id_++, isolation_level);
+    txn->SetDurabilityLevel(durability_level_);
+  }
+
+  {
+    // registered before it logs anything, so a checkpoint that does not see it also does not miss any of its records
+    std::scoped_lock<std::mutex> lock(running_txns_latch_);
+    lsn_t first_lsn = log_manager_ == nullptr ? INVALID_LSN : log_manager_->GetNextLSN();
+    running_txns_[txn->GetTransactionId()] = {txn, first_lsn};
+  }
+
+  if (enable_logging) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::BEGIN);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
   }
 
   txn_map[txn->GetTransactionId()] = txn;
@@ -50,6 +63,22 @@ void TransactionManager::Commit(Transaction *txn) {
   }
   write_set->clear();
 
+  if (enable_logging) {
+    // The commit record is flushed together with the other commits that arrive in the meantime (group commit).
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::COMMIT);
+    lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
+    txn->SetPrevLSN(lsn);
+    if (txn->GetDurabilityLevel() == DurabilityLevel::SYNC) {
+      log_manager_->WaitForFlush(lsn);
+    } else {
+      log_manager_->NotifyAsyncCommit();
+    }
+  }
+  {
+    std::scoped_lock<std::mutex> lock(running_txns_latch_);
+    running_txns_.erase(txn->GetTransactionId());
+  }
+
   // Release all the locks.
   ReleaseLocks(txn);
   // Release the global transaction latch.
@@ -100,12 +129,38 @@ void TransactionManager::Abort(Transaction *txn) {
   table_write_set->clear();
   index_write_set->clear();
 
+  if (enable_logging) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ABORT);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+  }
+  {
+    std::scoped_lock<std::mutex> lock(running_txns_latch_);
+    running_txns_.erase(txn->GetTransactionId());
+  }
+
   // Release all the locks.
   ReleaseLocks(txn);
   // Release the global transaction latch.
   global_txn_latch_.RUnlock();
 }
 
+std::vector<std::pair<txn_id_t, lsn_t>> TransactionManager::GetActiveTransactionTable(lsn_t *oldest_lsn) {
+  std::scoped_lock<std::mutex> lock(running_txns_latch_);
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns;
+  *oldest_lsn = INVALID_LSN;
+  for (const auto &txn : running_txns_) {
+    lsn_t last_lsn = txn.second.first->GetPrevLSN();
+    if (last_lsn != INVALID_LSN) {
+      active_txns.emplace_back(txn.first, last_lsn);
+    }
+    lsn_t first_lsn = txn.second.second;
+    if (first_lsn != INVALID_LSN && (*oldest_lsn == INVALID_LSN || first_lsn < *oldest_lsn)) {
+      *oldest_lsn = first_lsn;
+    }
+  }
+  return active_txns;
+}
+
 void TransactionManager::BlockAllTransactions() { global_txn_latch_.WLock(); }
 
 void TransactionManager::ResumeTransactions() { global_txn_latch_.WUnlock(); }
@@ -12,9 +12,14 @@
 
 #pragma once
 
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
 #include <list>
-#include <mutex>  // NOLINT
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <utility>
 
 #include "buffer/lru_replacer.h"
 #include "recovery/log_manager.h"
@@ -97,6 +102,43 @@ class BufferPoolManager {
   /** @return size of the buffer pool */
   size_t GetPoolSize() { return pool_size_; }
 
+  /** @return number of frames that are not pinned, the pages a caller can fetch at once */
+  size_t GetUnpinnedFrameCount();
+
+  /** @return the dirty page table: the dirty pages in the buffer pool and their recLSN */
+  std::unordered_map<page_id_t, lsn_t> GetDirtyPageTable();
+
+  /**
+   * Writes a dirty page back to disk without holding the buffer pool latch during the I/O, so that other threads keep
+   * using the buffer pool meanwhile. The page is read latched while it is written.
+   * @param page_id id of the page to be written
+   * @return true if the page was dirty and got written, false if it was clean or not in the buffer pool
+   */
+  bool WriteBackPage(page_id_t page_id);
+
+  /**
+   * Reads a page into the buffer pool on a background thread, so that a FetchPage of it shortly after does not wait for
+   * the disk. The page comes in unpinned, like a page that was fetched and unpinned again. Nothing happens if the page
+   * is in the buffer pool already, and the read is dropped if the page may have changed on disk while it was read or
+   * if every frame is pinned.
+   * @param page_id id of the page to be read ahead
+   */
+  void PrefetchPage(page_id_t page_id);
+
+  /** Blocks until the background thread went through every page passed to PrefetchPage. */
+  void WaitForPrefetch();
+
+  /**
+   * Installs a function that sees every page read from disk before the page is handed out, with the buffer pool latch
+   * held. Instant restart uses it to redo a page the first time it is fetched (see LogRecovery::RecoverOnDemand).
+   * @param on_page_read returns the LSN of the first change it made to the page, or INVALID_LSN if it changed nothing;
+   * nullptr removes the function
+   */
+  void SetPageReadHook(std::function<lsn_t(Page *)> on_page_read) {
+    std::scoped_lock<std::mutex> lock{latch_};
+    on_page_read_ = std::move(on_page_read);
+  }
+
  protected:
   /**
    * Grading function. Do not modify!
@@ -152,6 +194,29 @@ class BufferPoolManager {
    */
   void FlushAllPagesImpl();
 
+  /**
+   * Writes the page out and marks it clean. The log records up to the page's LSN are flushed first (write-ahead
+   * logging). The caller must hold latch_.
+   * @param page the page to be written
+   */
+  void WritePageToDisk(Page *page);
+
+  /**
+   * Called when a page gets pinned. While logging is enabled, any change made through this pin gets an LSN at least
+   * as large as the next LSN right now, so that is a valid recLSN for the page if it does not have one yet.
+   * @param page the page that was pinned
+   */
+  void TrackRecLSN(Page *page);
+
+  /** Body of prefetch_thread_, reads the pages of prefetch_queue_ until shutdown. */
+  void PrefetchPages();
+
+  /**
+   * Reads page_id into a frame of its own unless it is in the buffer pool, see PrefetchPage. The disk read happens
+   * without latch_ held.
+   */
+  void ReadAhead(page_id_t page_id);
+
   /** Number of pages in the buffer pool. */
   size_t pool_size_;
   /** Array of buffer pool pages. */
@@ -159,14 +224,30 @@ class BufferPoolManager {
   /** Pointer to the disk manager. */
   DiskManager *disk_manager_ __attribute__((__unused__));
   /** Pointer to the log manager. */
-  LogManager *log_manager_ __attribute__((__unused__));
+  LogManager *log_manager_;
   /** Page table for keeping track of buffer pool pages. */
   std::unordered_map<page_id_t, frame_id_t> page_table_;
   /** Replacer to find unpinned pages for replacement. */
   Replacer *replacer_;
   /** List of free pages. */
   std::list<frame_id_t> free_list_;
+  /** Called on every page read from disk, see SetPageReadHook. */
+  std::function<lsn_t(Page *)> on_page_read_;
+  /**
+   * Counts the page writes, allocations and deallocations. ReadAhead drops a page if the count changed during its
+   * read, the bytes it read may be older than the page.
+   */
+  uint64_t disk_epoch_{0};
   /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
   std::mutex latch_;
+
+  /** Pages waiting for prefetch_thread_, and whether it is reading one. Protected by prefetch_latch_. */
+  std::deque<page_id_t> prefetch_queue_;
+  bool prefetching_{false};
+  bool shutdown_{false};
+  /** Started by the first PrefetchPage. */
+  std::thread prefetch_thread_;
+  std::mutex prefetch_latch_;
+  std::condition_variable prefetch_cv_;
 };
 }  // namespace bustub
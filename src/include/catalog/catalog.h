@@ -1,7 +1,9 @@
 #pragma once
 
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -9,7 +11,9 @@
 #include "buffer/buffer_pool_manager.h"
 #include "catalog/schema.h"
 #include "storage/index/b_plus_tree_index.h"
+#include "storage/index/external_sort.h"
 #include "storage/index/index.h"
+#include "storage/index/var_b_plus_tree_index.h"
 #include "storage/table/table_heap.h"
 
 namespace bustub {
@@ -33,6 +37,19 @@ struct TableMetadata {
   table_oid_t oid_;
 };
 
+/**
+ * The index CreateIndex builds for a key type: a BPlusTreeIndex, or a VarBPlusTreeIndex for variable-length keys.
+ */
+template <class KeyType, class ValueType, class KeyComparator>
+struct BPlusTreeIndexOf {
+  using type = BPlusTreeIndex<KeyType, ValueType, KeyComparator>;
+};
+
+template <>
+struct BPlusTreeIndexOf<VarKey, RID, VarKeyComparator> {
+  using type = VarBPlusTreeIndex;
+};
+
 /**
  * Metadata about a index
  */
@@ -54,8 +71,13 @@ struct IndexInfo {
 };
 
 /**
- * Catalog is a non-persistent catalog that is designed for the executor to use.
+ * Catalog is a catalog that is designed for the executor to use.
  * It handles table creation and table lookup.
+ *
+ * A catalog opened on a database's header page is persistent: every table and index definition is appended to a
+ * chain of CatalogPages, and a reopened catalog only reads those definitions back. A table or index is opened the
+ * first time it is looked up, so opening a database does not depend on how many tables it has. Indexes on VarKey are
+ * the exception: their trees are not logged, so they are built again from their tables when they are opened.
  */
 class Catalog {
  public:
@@ -68,6 +90,15 @@ class Catalog {
   Catalog(BufferPoolManager *bpm, LockManager *lock_manager, LogManager *log_manager)
       : bpm_{bpm}, lock_manager_{lock_manager}, log_manager_{log_manager} {}
 
+  /**
+   * Opens the persistent catalog of a database, or starts an empty one if the database has none yet.
+   * @param bpm the buffer pool manager backing tables created by this catalog
+   * @param lock_manager the lock manager in use by the system
+   * @param log_manager the log manager in use by the system
+   * @param header_page_id the header page of the database, which must already exist
+   */
+  Catalog(BufferPoolManager *bpm, LockManager *lock_manager, LogManager *log_manager, page_id_t header_page_id);
+
   /**
    * Create a new table and return its metadata.
    * @param txn the transaction in which the table is being created
@@ -76,6 +107,7 @@ class Catalog {
    * @return a pointer to the metadata of the new table
    */
   TableMetadata *CreateTable(Transaction *txn, const std::string &table_name, const Schema &schema) {
+    std::scoped_lock lock(latch_);
     BUSTUB_ASSERT(names_.count(table_name) == 0, "Table names should be unique!");
     // page_id_t page_id;
     // Page *page = bpm_->NewPage(&page_id);
@@ -87,6 +119,9 @@ class Catalog {
     TableMetadata *tmdp = new TableMetadata(schema, table_name, std::unique_ptr<TableHeap>(tableheap), table_id);
     tables_.insert({table_id, std::unique_ptr<TableMetadata>(tmdp)});
     names_.insert({tmdp->name_, table_id});
+    if (IsPersistent()) {
+      PersistTable(*tmdp);
+    }
     return tmdp;
   }
 
@@ -94,15 +129,14 @@ class Catalog {
   TableMetadata *GetTable(const std::string &table_name) {
     // table_oid_t table_oid = names_.at(table_name);
     // return tables_.at(table_oid);
-    return GetTable(names_.at(table_name));
+    std::scoped_lock lock(latch_);
+    return FindTable(names_.at(table_name));
   }
 
   /** @return table metadata by oid */
   TableMetadata *GetTable(table_oid_t table_oid) {
-    if (tables_.find(table_oid) == tables_.end()) {
-      return nullptr;
-    }
-    return tables_[table_oid].get();
+    std::scoped_lock lock(latch_);
+    return FindTable(table_oid);
   }
 
   /**
@@ -113,52 +147,123 @@ class Catalog {
    * @param schema the schema of the table
    * @param key_schema the schema of the key
    * @param key_attrs key attributes
-   * @param keysize size of the key
+   * @param keysize size of the key, ignored for VarKey whose indexes record 0
+   * @param unique false for an index of duplicate keys, which needs VarKey
    * @return a pointer to the metadata of the new table
    */
   template <class KeyType, class ValueType, class KeyComparator>
   IndexInfo *CreateIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
                          const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs,
-                         size_t keysize) {
-    auto index_oid = next_index_oid_++;
-    IndexMetadata *metadata = new IndexMetadata(index_name, table_name, &schema, key_attrs);
-    Index *bptindex = new BPlusTreeIndex<KeyType, ValueType, KeyComparator>(metadata, bpm_);
-    IndexInfo *indexinfo =
-        new IndexInfo(key_schema, index_name, std::unique_ptr<Index>(bptindex), index_oid, table_name, keysize);
-    indexes_.insert({index_oid, std::unique_ptr<IndexInfo>(indexinfo)});
-    index_names_[table_name].insert(std::pair(index_name, index_oid));
-    auto table = GetTable(table_name)->table_.get();
-    auto iter = table->Begin(txn);
-    while (iter != table->End()) {
-      bptindex->InsertEntry(iter->KeyFromTuple(schema, key_schema, key_attrs), iter->GetRid(), txn);
-      ++iter;
+                         size_t keysize, bool unique = true) {
+    using IndexType = typename BPlusTreeIndexOf<KeyType, ValueType, KeyComparator>::type;
+    IndexType *bptindex;
+    if constexpr (std::is_same_v<KeyType, VarKey>) {
+      keysize = 0;
+      bptindex = new IndexType(new IndexMetadata(index_name, table_name, &schema, key_attrs), bpm_, log_manager_,
+                               unique);
+    } else {
+      if (!unique) {
+        throw NotImplementedException("only VarKey indexes support duplicate keys");
+      }
+      bptindex = new IndexType(new IndexMetadata(index_name, table_name, &schema, key_attrs), bpm_, log_manager_);
     }
+    IndexInfo *indexinfo;
+    TableHeap *table;
+    {
+      std::scoped_lock lock(latch_);
+      auto index_oid = next_index_oid_++;
+      indexinfo =
+          new IndexInfo(key_schema, index_name, std::unique_ptr<Index>(bptindex), index_oid, table_name, keysize);
+      indexes_.insert({index_oid, std::unique_ptr<IndexInfo>(indexinfo)});
+      index_names_[table_name].insert(std::pair(index_name, index_oid));
+      if (IsPersistent()) {
+        PersistIndex(*indexinfo, key_attrs, unique);
+      }
+      table = FindTable(names_.at(table_name))->table_.get();
+    }
+    LoadIndex<KeyType, ValueType, KeyComparator>(txn, bptindex, table, schema, key_schema, key_attrs);
     return indexinfo;
   }
 
   IndexInfo *GetIndex(const std::string &index_name, const std::string &table_name) {
-    return GetIndex(index_names_.at(table_name).at(index_name));
+    std::scoped_lock lock(latch_);
+    return FindIndex(index_names_.at(table_name).at(index_name));
   }
 
   IndexInfo *GetIndex(index_oid_t index_oid) {
-    if (indexes_.find(index_oid) == indexes_.end()) {
-      return nullptr;
-    }
-    return indexes_.at(index_oid).get();
+    std::scoped_lock lock(latch_);
+    return FindIndex(index_oid);
   }
 
   std::vector<IndexInfo *> GetTableIndexes(const std::string &table_name) {
+    std::scoped_lock lock(latch_);
     std::unordered_map<std::string, index_oid_t> index_names_oids_ = index_names_[table_name];
     std::vector<IndexInfo *> indexinfos_;
     auto iter = index_names_oids_.begin();
     while (iter != index_names_oids_.end()) {
-      indexinfos_.push_back(GetIndex(iter->second));
+      indexinfos_.push_back(FindIndex(iter->second));
       iter++;
     }
     return indexinfos_;
   }
 
  private:
+  /** Name of the header page record that points at the first catalog page. */
+  static constexpr const char *CATALOG_RECORD_NAME = "__catalog";
+
+  bool IsPersistent() const { return first_catalog_page_id_ != INVALID_PAGE_ID; }
+
+  /** Read every definition in the catalog pages, without opening any table or index. */
+  void LoadDefinitions();
+
+  /** Append a serialized definition to the last catalog page, chaining a new page when it is full. */
+  void AppendRecord(const std::vector<char> &record);
+
+  void PersistTable(const TableMetadata &table);
+  void PersistIndex(const IndexInfo &index, const std::vector<uint32_t> &key_attrs, bool unique);
+
+  /** @return the table of an oid, opened if it was only a definition, or nullptr. Requires latch_. */
+  TableMetadata *FindTable(table_oid_t table_oid) {
+    if (tables_.find(table_oid) == tables_.end() && !OpenTable(table_oid)) {
+      return nullptr;
+    }
+    return tables_[table_oid].get();
+  }
+
+  /** @return the index of an oid, opened if it was only a definition, or nullptr. Requires latch_. */
+  IndexInfo *FindIndex(index_oid_t index_oid) {
+    if (indexes_.find(index_oid) == indexes_.end() && !OpenIndex(index_oid)) {
+      return nullptr;
+    }
+    return indexes_.at(index_oid).get();
+  }
+
+  /** Open a table that was only loaded as a definition. Requires latch_. @return false if there is no such table */
+  bool OpenTable(table_oid_t table_oid);
+
+  /**
+   * Open an index that was only loaded as a definition. Requires latch_. A VarKey index is not reopened but built
+   * again from its table, as its tree writes no log records and recovery can not bring it back in line with the table.
+   * @return false if there is no such index
+   */
+  bool OpenIndex(index_oid_t index_oid);
+
+  /** Build an empty index from the tuples of its table */
+  template <class KeyType, class ValueType, class KeyComparator, class IndexType>
+  void LoadIndex(Transaction *txn, IndexType *index, TableHeap *table, const Schema &schema, const Schema &key_schema,
+                 const std::vector<uint32_t> &key_attrs) {
+    // sort the entries of the table and build the tree bottom-up instead of inserting them one by one
+    ExternalSort<KeyType, ValueType, KeyComparator> sorter(KeyComparator(index->GetKeySchema()));
+    auto iter = table->Begin(txn);
+    while (iter != table->End()) {
+      KeyType index_key;
+      index_key.SetFromKey(iter->KeyFromTuple(schema, key_schema, key_attrs), index->GetKeySchema());
+      sorter.Add(index_key, iter->GetRid());
+      ++iter;
+    }
+    index->BulkLoad([&sorter](std::pair<KeyType, ValueType> *entry) { return sorter.Next(entry); });
+  }
+
   [[maybe_unused]] BufferPoolManager *bpm_;
   [[maybe_unused]] LockManager *lock_manager_;
   [[maybe_unused]] LogManager *log_manager_;
@@ -175,5 +280,14 @@ class Catalog {
   std::unordered_map<std::string, std::unordered_map<std::string, index_oid_t>> index_names_;
   /** The next index identifier to be used */
   std::atomic<index_oid_t> next_index_oid_{0};
+
+  /** The first and the last page of the catalog, or INVALID_PAGE_ID if the catalog is not persistent */
+  page_id_t first_catalog_page_id_{INVALID_PAGE_ID};
+  page_id_t last_catalog_page_id_{INVALID_PAGE_ID};
+  /** Serialized definitions of the tables and indexes that have not been opened yet */
+  std::unordered_map<table_oid_t, std::vector<char>> unopened_tables_;
+  std::unordered_map<index_oid_t, std::vector<char>> unopened_indexes_;
+  /** Protects the maps above, which lookups change when they open a table or index */
+  std::mutex latch_;
 };
 }  // namespace bustub
@@ -27,6 +27,9 @@ extern std::atomic<bool> enable_logging;
 /** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
 extern std::chrono::duration<int64_t> log_timeout;
 
+/** Commits of ASYNC durability transactions are flushed to disk at most ASYNC_COMMIT_WINDOW after they return. */
+extern std::chrono::milliseconds async_commit_window;
+
 static constexpr int INVALID_PAGE_ID = -1;                                    // invalid page id
 static constexpr int INVALID_TXN_ID = -1;                                     // invalid transaction id
 static constexpr int INVALID_LSN = -1;                                        // invalid log sequence number
@@ -35,6 +38,9 @@ static constexpr int PAGE_SIZE = 4096;                                        //
 static constexpr int BUFFER_POOL_SIZE = 10;                                   // size of buffer pool
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE);  // size of a log buffer in byte
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+static constexpr int PREALLOCATE_CHUNK_SIZE = 256 * PAGE_SIZE;                // size of a db file extent preallocated
+static constexpr int LOG_SEGMENT_SIZE = 16 << 20;                             // size of a log segment file in byte
+static constexpr int CHECKPOINT_WRITE_RATE = 2560;                            // fuzzy checkpoint write-back, pages/s
 
 using frame_id_t = int32_t;    // frame id type
 using page_id_t = int32_t;     // page id type
@@ -57,6 +57,19 @@ class ReaderWriterLatch {
     reader_.notify_all();
   }
 
+  /**
+   * Acquire a write latch if nobody holds the latch, without waiting.
+   * @return true if the write latch was acquired
+   */
+  bool TryWLock() {
+    std::lock_guard<mutex_t> guard(mutex_);
+    if (writer_entered_ || reader_count_ > 0) {
+      return false;
+    }
+    writer_entered_ = true;
+    return true;
+  }
+
   /**
    * Acquire a read latch.
    */
@@ -13,7 +13,9 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <condition_variable>  // NOLINT
+#include <functional>
 #include <list>
 #include <memory>
 #include <mutex>  // NOLINT
@@ -108,6 +110,30 @@ class LockManager {
    */
   bool Unlock(Transaction *txn, const RID &rid);
 
+  /*** Recovery API ***/
+  /**
+   * Lets instant restart undo losers lazily. A loser keeps the RIDs it changed locked, and a transaction that asks for
+   * a lock on one of them has the loser's undo moved up through undo_loser and waits until it is done.
+   * @param undo_loser asks for a loser to be undone soon, on another thread, which then calls ReleaseRecoveryLocks for
+   * it; called under the lock manager latch, so it must not block, and may be called more than once for a loser
+   */
+  void SetRecoveryUndo(std::function<void(txn_id_t)> undo_loser);
+
+  /** Lock a RID on behalf of a transaction that was active at the crash. */
+  void LockForRecovery(txn_id_t txn_id, const RID &rid);
+
+  /** Release every RID locked by LockForRecovery for this transaction. */
+  void ReleaseRecoveryLocks(txn_id_t txn_id);
+
+  /** @return true if a loser of the last crash still holds rid, e.g. a slot it emptied that undo fills again */
+  bool IsRecoveryLocked(const RID &rid);
+
+  /**
+   * Block until no loser of the last crash holds rid. Lock requests do this first; a caller that latches the page of
+   * rid has to do it before, because the undo latches that page.
+   */
+  void WaitForRecoveryLock(const RID &rid);
+
   /*** Graph API ***/
   /**
    * Adds edge t1->t2
@@ -146,6 +172,13 @@ class LockManager {
   std::unordered_map<RID, bool> rid_exclusive_;
   /** who are waiting on the rid */
   std::unordered_map<txn_id_t , RID> tid_to_rid_;
+  /** RIDs locked for losers of the last crash, see LockForRecovery. They never wait, so they stay out of lock_table_. */
+  std::unordered_map<RID, txn_id_t> recovery_locks_;
+  /** Set while recovery_locks_ is not empty, so that lock requests after recovery do not take latch_ to check it. */
+  std::atomic<bool> has_recovery_locks_{false};
+  /** Notified when the recovery locks of a loser are released. */
+  std::condition_variable recovery_cv_;
+  std::function<void(txn_id_t)> recovery_undo_;
 };
 
 }  // namespace bustub
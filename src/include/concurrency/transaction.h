@@ -48,6 +48,13 @@ enum class TransactionState { GROWING, SHRINKING, COMMITTED, ABORTED };
  */
 enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED };
 
+/**
+ * Transaction durability level.
+ * SYNC: Commit returns once the COMMIT record is on disk.
+ * ASYNC: Commit returns once the COMMIT record is in the log buffer, it reaches disk within ASYNC_COMMIT_WINDOW.
+ */
+enum class DurabilityLevel { SYNC, ASYNC };
+
 /**
  * Type of write operation.
  */
@@ -176,6 +183,15 @@ class Transaction {
   /** @return the isolation level of this transaction */
   inline IsolationLevel GetIsolationLevel() const { return isolation_level_; }
 
+  /** @return the durability level of this transaction */
+  inline DurabilityLevel GetDurabilityLevel() const { return durability_level_; }
+
+  /**
+   * Set the durability level, it takes effect when the transaction commits.
+   * @param durability_level new durability level
+   */
+  inline void SetDurabilityLevel(DurabilityLevel durability_level) { durability_level_ = durability_level; }
+
   /** @return the list of table write records of this transaction */
   inline std::shared_ptr<std::deque<TableWriteRecord>> GetWriteSet() { return table_write_set_; }
 
@@ -251,6 +267,8 @@ class Transaction {
   TransactionState state_;
   /** The isolation level of the transaction. */
   IsolationLevel isolation_level_;
+  /** The durability level of the transaction. */
+  DurabilityLevel durability_level_{DurabilityLevel::SYNC};
   /** The thread ID, used in single-threaded transactions. */
   std::thread::id thread_id_;
   /** The ID of this transaction. */
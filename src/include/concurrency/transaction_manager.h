@@ -13,8 +13,11 @@
 #pragma once
 
 #include <atomic>
+#include <mutex>  // NOLINT
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
@@ -42,6 +45,9 @@ class TransactionManager {
    */
   Transaction *Begin(Transaction *txn = nullptr, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ);
 
+  /** Continue the transaction ids of an existing log (see LogRecovery::RecoverOnDemand). Only valid before Begin. */
+  void SetNextTxnId(txn_id_t txn_id) { next_txn_id_ = txn_id; }
+
   /**
    * Commits a transaction.
    * @param txn the transaction to commit
@@ -73,6 +79,22 @@ class TransactionManager {
     return res;
   }
 
+  /**
+   * Set the durability level of the transactions created by Begin from now on. A transaction can still change its own
+   * level before it commits.
+   * @param durability_level the new default durability level
+   */
+  void SetDurabilityLevel(DurabilityLevel durability_level) { durability_level_ = durability_level; }
+
+  /**
+   * The active transaction table of a fuzzy checkpoint, taken without stopping anyone.
+   * @param[out] oldest_lsn a bound on the lsns the running transactions have logged or will log, INVALID_LSN if
+   * there are none. The lsn of a record appended right before the table was taken may not be in the table yet, but
+   * it is not below oldest_lsn.
+   * @return every running transaction that has logged something, with the lsn of its last log record
+   */
+  std::vector<std::pair<txn_id_t, lsn_t>> GetActiveTransactionTable(lsn_t *oldest_lsn);
+
   /** Prevents all transactions from performing operations, used for checkpointing. */
   void BlockAllTransactions();
 
@@ -98,11 +120,19 @@ class TransactionManager {
   }
 
   std::atomic<txn_id_t> next_txn_id_{0};
+  std::atomic<DurabilityLevel> durability_level_{DurabilityLevel::SYNC};
   LockManager *lock_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
+  LogManager *log_manager_;
 
   /** The global transaction latch is used for checkpointing. */
   ReaderWriterLatch global_txn_latch_;
+
+  /**
+   * The transactions between Begin and Commit/Abort, unlike txn_map which keeps finished ones around, with the next
+   * lsn at the time they began. None of their records has a smaller lsn.
+   */
+  std::unordered_map<txn_id_t, std::pair<Transaction *, lsn_t>> running_txns_;
+  std::mutex running_txns_latch_;
 };
 
 }  // namespace bustub
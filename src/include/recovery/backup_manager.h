@@ -0,0 +1,106 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// backup_manager.h
+//
+// Identification: src/include/recovery/backup_manager.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "recovery/log_manager.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/** What a backup holds, see BackupManager. */
+struct BackupInfo {
+  /** Pages whose LSN is below since_lsn_ were left out, INVALID_LSN for a full backup. */
+  lsn_t since_lsn_{INVALID_LSN};
+  /** The oldest log record restoring this backup needs, the start of the archived log range. */
+  lsn_t start_lsn_{INVALID_LSN};
+  /** The end of the archived log range. Replaying the log up to here makes the pages consistent. */
+  lsn_t end_lsn_{INVALID_LSN};
+  int page_count_{0};
+};
+
+/**
+ * BackupManager copies the db file into backup files while transactions keep running, and restores it from them.
+ *
+ * A full backup copies every page, an incremental backup only the pages whose page LSN says they changed since an
+ * earlier backup. Pages are read from the db file as they are, so a backup is fuzzy like a checkpoint: a page may
+ * miss the changes that were still in the buffer pool. The backup therefore also archives the log from the smallest
+ * recLSN of the buffer pool (or the first record of the oldest running transaction, if that is older) to the end of
+ * the log once the pages are copied, and records that range.
+ *
+ * Restoring means writing the pages of the full backup and then those of every incremental backup taken after it, in
+ * order, and replaying the log from the start_lsn_ of the last one with LogRecovery::RestoreFrom. The log is the one
+ * that survived, or the archived range of the last backup if the log was lost too.
+ *
+ * Pages without an LSN, like the header page and the catalog pages, are in every backup.
+ *
+ * Backup file format (size in byte):
+ *  -------------------------------------------------------------------------------------------------------------
+ * | Magic (4) | SinceLSN (4) | StartLSN (4) | EndLSN (4) | PageCount (4) | LogSize (4) | PageId_1 (4) | Page_1 |
+ *  -------------------------------------------------------------------------------------------------------------
+ *  | ... | PageId_n (4) | Page_n | Log (LogSize) |
+ *  -------------------------------------------------
+ */
+class BackupManager {
+ public:
+  BackupManager(TransactionManager *transaction_manager, LogManager *log_manager,
+                BufferPoolManager *buffer_pool_manager, DiskManager *disk_manager)
+      : transaction_manager_(transaction_manager),
+        log_manager_(log_manager),
+        buffer_pool_manager_(buffer_pool_manager),
+        disk_manager_(disk_manager) {}
+
+  /**
+   * Take a backup.
+   * @param file_name the backup file, overwritten if it exists
+   * @param since_lsn copy only pages whose LSN is at least since_lsn, INVALID_LSN for a full backup. Taking the
+   * start_lsn_ of the previous backup as since_lsn makes the new backup apply on top of it.
+   * @return what the backup holds
+   */
+  BackupInfo Backup(const std::string &file_name, lsn_t since_lsn = INVALID_LSN);
+
+  /**
+   * Write the pages of a full backup and the incremental backups taken after it into the db file of disk_manager. If
+   * the log of disk_manager is empty, the archived log of the last backup is written into it.
+   * @param file_names the full backup first, then the incremental backups in the order they were taken
+   * @param disk_manager the disk manager of the db to restore, nothing may have the db open through a buffer pool
+   * @return the last backup, recovery has to replay the log from its start_lsn_
+   */
+  static BackupInfo Restore(const std::vector<std::string> &file_names, DiskManager *disk_manager);
+
+  /**
+   * Read the description of a backup.
+   * @param file_name the backup file
+   * @return what the backup holds
+   */
+  static BackupInfo ReadBackupInfo(const std::string &file_name);
+
+ private:
+  static constexpr uint32_t BACKUP_MAGIC = 0x42424b31;  // "BBK1"
+  static constexpr size_t BACKUP_HEADER_SIZE = 24;
+
+  /** Read the header of a backup file and check its magic. */
+  static void ReadHeader(std::ifstream *in, const std::string &file_name, BackupInfo *info, uint32_t *log_size);
+
+  TransactionManager *transaction_manager_;
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  DiskManager *disk_manager_;
+};
+
+}  // namespace bustub
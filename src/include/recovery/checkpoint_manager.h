@@ -12,6 +12,13 @@
 
 #pragma once
 
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/transaction_manager.h"
 #include "recovery/log_manager.h"
@@ -19,7 +26,16 @@
 namespace bustub {
 
 /**
- * CheckpointManager creates consistent checkpoints by blocking all other transactions temporarily.
+ * CheckpointManager creates consistent checkpoints by blocking all other transactions temporarily, or fuzzy
+ * checkpoints that let them run.
+ *
+ * A fuzzy checkpoint only logs the active transaction table and the dirty page table between a BEGIN_CHECKPOINT and
+ * an END_CHECKPOINT record. The pages in the dirty page table are then written back by a background thread at a pace
+ * of write_rate pages per second, so the checkpoint does not compete with transactions for the disk in one burst.
+ * Writing them back moves the recLSNs forward, which is what shortens redo after the next checkpoint.
+ *
+ * Once the END_CHECKPOINT record is on disk, the checkpoint goes into the log master record, and the log segments
+ * older than both the smallest recLSN and the oldest running transaction are recycled.
  */
 class CheckpointManager {
  public:
@@ -29,15 +45,41 @@ class CheckpointManager {
         log_manager_(log_manager),
         buffer_pool_manager_(buffer_pool_manager) {}
 
-  ~CheckpointManager() = default;
+  ~CheckpointManager();
 
   void BeginCheckpoint();
   void EndCheckpoint();
 
+  /** Take a fuzzy checkpoint. Returns once its records are on disk, the dirty pages are written in the background. */
+  void FuzzyCheckpoint();
+
+  /**
+   * Set the pace of the background writes.
+   * @param pages_per_second pages written back per second, 0 means as fast as possible
+   */
+  void SetWriteRate(size_t pages_per_second);
+
+  /** Block until the background writer has gone through every page handed to it. */
+  void WaitForWriteBack();
+
  private:
-  TransactionManager *transaction_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /** @return the smallest recLSN in dirty_pages, or lsn if that is smaller */
+  static lsn_t OldestRecLSN(const std::vector<std::pair<page_id_t, lsn_t>> &dirty_pages, lsn_t lsn);
+  /** Write back the queued pages, sleeping between them to stay at write_rate_. */
+  void WriteBackPages();
+
+  TransactionManager *transaction_manager_;
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+
+  /** The pages left to write back from the last fuzzy checkpoints. */
+  std::deque<page_id_t> write_back_queue_;
+  size_t write_rate_{CHECKPOINT_WRITE_RATE};
+  bool writing_{false};
+  bool shutdown_{false};
+  std::thread write_back_thread_;
+  std::mutex latch_;
+  std::condition_variable cv_;
 };
 
 }  // namespace bustub
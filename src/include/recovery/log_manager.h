@@ -16,6 +16,7 @@
 #include <condition_variable>  // NOLINT
 #include <future>              // NOLINT
 #include <mutex>               // NOLINT
+#include <thread>              // NOLINT
 
 #include "recovery/log_record.h"
 #include "storage/disk/disk_manager.h"
@@ -25,16 +26,29 @@ namespace bustub {
 /**
  * LogManager maintains a separate thread that is awakened whenever the log buffer is full or whenever a timeout
  * happens. When the thread is awakened, the log buffer's content is written into the disk log file.
+ *
+ * Records are appended into log_buffer_ while the flush thread writes flush_buffer_ out; the two are swapped at the
+ * start of every flush. A committing transaction asks for a flush and waits until persistent_lsn_ covers its commit
+ * record, so all the commits that arrive while a write is in progress go out together in the next one (group commit).
+ *
+ * Appends do not take latch_. The next lsn and the end of log_buffer_ live in one atomic word, so a compare-and-swap
+ * on it hands out an lsn and a region of the buffer together; the record is then serialized into that region in
+ * parallel with the other appenders. Before a swap the flusher seals the word, which stops new reservations, and waits
+ * until the bytes copied into the buffer add up to the reserved end, i.e. until the buffer is a contiguous filled
+ * prefix.
  */
 class LogManager {
  public:
   explicit LogManager(DiskManager *disk_manager)
-      : next_lsn_(0), persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
+      : buffer_state_(0), persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
     log_buffer_ = new char[LOG_BUFFER_SIZE];
     flush_buffer_ = new char[LOG_BUFFER_SIZE];
   }
 
   ~LogManager() {
+    if (flush_thread_ != nullptr) {
+      StopFlushThread();
+    }
     delete[] log_buffer_;
     delete[] flush_buffer_;
     log_buffer_ = nullptr;
@@ -46,29 +60,77 @@ class LogManager {
 
   lsn_t AppendLogRecord(LogRecord *log_record);
 
-  inline lsn_t GetNextLSN() { return next_lsn_; }
+  /**
+   * Block until every log record up to and including lsn is on disk, triggering a flush if needed.
+   * @param lsn the log sequence number that has to be persistent, e.g. that of a commit record or of a page that is
+   * about to be written out
+   */
+  void WaitForFlush(lsn_t lsn);
+
+  /**
+   * Tell the flush thread that an asynchronous commit is in the log buffer. The buffer is then flushed within
+   * async_commit_window instead of log_timeout. The caller's COMMIT record must already be appended. Without a flush
+   * thread the buffer is flushed before this returns, as in WaitForFlush.
+   */
+  void NotifyAsyncCommit();
+
+  /**
+   * Make a checkpoint the one recovery starts from and let go of the log that recovery from it does not need.
+   * @param checkpoint_lsn lsn of the BEGIN_CHECKPOINT record, its END_CHECKPOINT record has to be on disk
+   * @param analysis_lsn the oldest lsn analysis has to read, at or before checkpoint_lsn
+   * @param keep_lsn the oldest lsn redo or undo may need, at or before analysis_lsn
+   */
+  void SetCheckpoint(lsn_t checkpoint_lsn, lsn_t analysis_lsn, lsn_t keep_lsn);
+
+  inline lsn_t GetNextLSN() { return LsnOf(buffer_state_); }
+  /** Continue the lsn sequence of an existing log (see LogRecovery::GetNextLSN). Only valid before logging starts. */
+  inline void SetNextLSN(lsn_t lsn) { buffer_state_ = MakeState(lsn, 0); }
   inline lsn_t GetPersistentLSN() { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
-  inline char *GetLogBuffer() { return log_buffer_; }
+  inline char *GetLogBuffer() { return log_buffer_.load(); }
 
  private:
-  // TODO(students): you may add your own member variables
+  /** Write the log buffer out and advance persistent_lsn_. The caller holds latch_ through lock. */
+  void FlushLogBuffer(std::unique_lock<std::mutex> *lock);
+  /** Add the records of flush_buffer_ that start a log segment to the LSN to segment index. */
+  void IndexSegments(int flush_size);
+  /** Serialize the log record into dest, which must have log_record->size_ bytes of room. */
+  static void SerializeLogRecord(const LogRecord &log_record, char *dest);
+
+  /** Set in the offset half of buffer_state_ while the flusher is swapping the buffers. */
+  static constexpr uint64_t BUFFER_SEALED = 1ULL << 31;
+  static inline lsn_t LsnOf(uint64_t state) { return static_cast<lsn_t>(state >> 32); }
+  static inline int OffsetOf(uint64_t state) { return static_cast<int>(state & (BUFFER_SEALED - 1)); }
+  static inline uint64_t MakeState(lsn_t lsn, int offset) {
+    return (static_cast<uint64_t>(lsn) << 32) | static_cast<uint64_t>(offset);
+  }
 
-  /** The atomic counter which records the next log sequence number. */
-  std::atomic<lsn_t> next_lsn_;
+  /** The next log sequence number (high 32 bits) and the number of bytes reserved in log_buffer_ (low 32 bits). */
+  std::atomic<uint64_t> buffer_state_;
   /** The log records before and including the persistent lsn have been written to disk. */
   std::atomic<lsn_t> persistent_lsn_;
 
-  char *log_buffer_;
+  std::atomic<char *> log_buffer_;
   char *flush_buffer_;
+  /** Number of bytes already serialized into log_buffer_. */
+  std::atomic<int> log_buffer_filled_{0};
+  /** True while the flush thread is writing flush_buffer_ out with latch_ released. */
+  bool flushing_{false};
+  /** Set when someone is waiting on a flush, i.e. a full buffer, a commit or an evicted page. */
+  bool flush_requested_{false};
+  /** Set when an asynchronous commit is waiting in the log buffer. */
+  std::atomic<bool> async_commit_pending_{false};
 
   std::mutex latch_;
 
-  std::thread *flush_thread_ __attribute__((__unused__));
+  std::thread *flush_thread_{nullptr};
 
+  /** Wakes up the flush thread. */
   std::condition_variable cv_;
+  /** Wakes up the appenders and committers waiting for a flush to finish. */
+  std::condition_variable flushed_cv_;
 
-  DiskManager *disk_manager_ __attribute__((__unused__));
+  DiskManager *disk_manager_;
 };
 
 }  // namespace bustub
@@ -14,6 +14,8 @@
 
 #include <cassert>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "storage/table/tuple.h"
@@ -32,6 +34,18 @@ enum class LogRecordType {
   ABORT,
   /** Creating a new page in the table heap. */
   NEWPAGE,
+  /** The start of a checkpoint. Transactions keep logging between it and its END_CHECKPOINT. */
+  BEGIN_CHECKPOINT,
+  /** The end of a checkpoint, carrying the active transaction table and the dirty page table. */
+  END_CHECKPOINT,
+  /** Inserting an entry into a b+ tree leaf. Redone on the page, undone logically through the index. */
+  BTREEINSERT,
+  /** Removing an entry from a b+ tree leaf. Redone on the page, undone logically through the index. */
+  BTREEDELETE,
+  /** Writing bytes of a b+ tree page or the header page in a split, merge or root change. Never undone. */
+  BTREEWRITE,
+  /** An update that only logs the bytes of the tuple that changed. */
+  DELTAUPDATE,
 };
 
 /**
@@ -53,10 +67,38 @@ enum class LogRecordType {
  *-----------------------------------------------------------------------------------
  * | HEADER | tuple_rid | tuple_size | old_tuple_data | tuple_size | new_tuple_data |
  *-----------------------------------------------------------------------------------
+ * For delta update type log record
+ *-------------------------------------------------
+ * | HEADER | tuple_rid | delta_size | delta_data |
+ *-------------------------------------------------
+ * where delta_data is
+ *---------------------------------------------------------------------------------------------------------------
+ * | old_size (2) | new_size (2) | range_count (2) | (skip, old_len, new_len (2 each), old bytes, new bytes) ... |
+ *---------------------------------------------------------------------------------------------------------------
+ * Each range skips the given number of unchanged bytes after the previous one and then replaces old_len bytes of the
+ * old tuple with new_len bytes of the new one. The bytes after the last range are unchanged.
  * For new page type log record
- *--------------------------
- * | HEADER | prev_page_id |
- *--------------------------
+ *------------------------------------
+ * | HEADER | prev_page_id | page_id |
+ *------------------------------------
+ * For begin checkpoint type log record
+ *------------
+ * | HEADER |
+ *------------
+ * For end checkpoint type log record, prevLSN is the LSN of its begin checkpoint record
+ *-------------------------------------------------------------------------------------------------
+ * | HEADER | txn_count | (txn_id, last_lsn) ... | page_count | (page_id, rec_lsn) ... |
+ *-------------------------------------------------------------------------------------------------
+ * For b+ tree insert and delete type log record, the entry is the key followed by the value. A leaf keeps its keys
+ * and its values in two arrays of max size slots, the keys first: offset is where the key of the entry starts in
+ * the page, and the first key_size bytes of the entry are the key.
+ *-----------------------------------------------------------------------------------------------------------------
+ * | HEADER | page_id | slot | offset | key_size | name_size | index_name | entry_size | entry_data(char[] array) |
+ *-----------------------------------------------------------------------------------------------------------------
+ * For b+ tree write type log record
+ *----------------------------------------------------------------
+ * | HEADER | page_id | offset | data_size | data(char[] array) |
+ *----------------------------------------------------------------
  */
 class LogRecord {
   friend class LogManager;
@@ -65,7 +107,7 @@ class LogRecord {
  public:
   LogRecord() = default;
 
-  // constructor for Transaction type(BEGIN/COMMIT/ABORT)
+  // constructor for Transaction type(BEGIN/COMMIT/ABORT) and BEGIN_CHECKPOINT
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type)
       : size_(HEADER_SIZE), txn_id_(txn_id), prev_lsn_(prev_lsn), log_record_type_(log_record_type) {}
 
@@ -85,17 +127,24 @@ class LogRecord {
     size_ = HEADER_SIZE + sizeof(RID) + sizeof(int32_t) + tuple.GetLength();
   }
 
-  // constructor for UPDATE type
+  // constructor for UPDATE type, DELTAUPDATE is turned into UPDATE if the delta is not smaller than both tuples
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, const RID &update_rid,
             const Tuple &old_tuple, const Tuple &new_tuple)
-      : txn_id_(txn_id),
-        prev_lsn_(prev_lsn),
-        log_record_type_(log_record_type),
-        update_rid_(update_rid),
-        old_tuple_(old_tuple),
-        new_tuple_(new_tuple) {
+      : txn_id_(txn_id), prev_lsn_(prev_lsn), log_record_type_(log_record_type), update_rid_(update_rid) {
     // calculate log record size
     size_ = HEADER_SIZE + sizeof(RID) + old_tuple.GetLength() + new_tuple.GetLength() + 2 * sizeof(int32_t);
+    if (log_record_type == LogRecordType::DELTAUPDATE) {
+      delta_ = EncodeDelta(old_tuple, new_tuple);
+      int32_t delta_record_size = HEADER_SIZE + sizeof(RID) + sizeof(int32_t) + delta_.size();
+      if (delta_record_size < size_) {
+        size_ = delta_record_size;
+        return;
+      }
+      log_record_type_ = LogRecordType::UPDATE;
+      delta_.clear();
+    }
+    old_tuple_ = old_tuple;
+    new_tuple_ = new_tuple;
   }
 
   // constructor for NEWPAGE type
@@ -110,6 +159,48 @@ class LogRecord {
     size_ = HEADER_SIZE + sizeof(page_id_t) * 2;
   }
 
+  // constructor for END_CHECKPOINT type
+  LogRecord(lsn_t begin_lsn, std::vector<std::pair<txn_id_t, lsn_t>> active_txns,
+            std::vector<std::pair<page_id_t, lsn_t>> dirty_pages)
+      : txn_id_(INVALID_TXN_ID),
+        prev_lsn_(begin_lsn),
+        log_record_type_(LogRecordType::END_CHECKPOINT),
+        active_txns_(std::move(active_txns)),
+        dirty_pages_(std::move(dirty_pages)) {
+    // calculate log record size, header size + two counts + the table entries
+    size_ = HEADER_SIZE + 2 * sizeof(int32_t) + active_txns_.size() * (sizeof(txn_id_t) + sizeof(lsn_t)) +
+            dirty_pages_.size() * (sizeof(page_id_t) + sizeof(lsn_t));
+  }
+
+  // constructor for BTREEINSERT/BTREEDELETE type
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, std::string index_name,
+            page_id_t page_id, int32_t slot, int32_t offset, int32_t key_size, const char *entry, int32_t entry_size)
+      : txn_id_(txn_id),
+        prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type),
+        page_id_(page_id),
+        index_name_(std::move(index_name)),
+        index_slot_(slot),
+        index_offset_(offset),
+        index_key_size_(key_size),
+        index_data_(entry, entry + entry_size) {
+    assert(log_record_type == LogRecordType::BTREEINSERT || log_record_type == LogRecordType::BTREEDELETE);
+    // calculate log record size, header size + page_id, slot, offset, key size and the two sizes + name and entry
+    size_ = HEADER_SIZE + 6 * sizeof(int32_t) + index_name_.size() + entry_size;
+  }
+
+  // constructor for BTREEWRITE type
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, page_id_t page_id, int32_t offset, const char *data, int32_t data_size)
+      : txn_id_(txn_id),
+        prev_lsn_(prev_lsn),
+        log_record_type_(LogRecordType::BTREEWRITE),
+        page_id_(page_id),
+        index_offset_(offset),
+        index_data_(data, data + data_size) {
+    // calculate log record size, header size + page_id, offset and size + data
+    size_ = HEADER_SIZE + 3 * sizeof(int32_t) + data_size;
+  }
+
   ~LogRecord() = default;
 
   inline Tuple &GetDeleteTuple() { return delete_tuple_; }
@@ -126,8 +217,26 @@ class LogRecord {
 
   inline RID &GetUpdateRID() { return update_rid_; }
 
+  /**
+   * Rebuild one side of a DELTAUPDATE from the other.
+   * @param tuple the old tuple, or the new one if undo is set
+   * @param[out] result the new tuple, or the old one if undo is set
+   * @param undo true to go from the new tuple back to the old one
+   * @return false if the delta does not fit tuple
+   */
+  bool ApplyDelta(const Tuple &tuple, Tuple *result, bool undo) const;
+
   inline page_id_t GetNewPageRecord() { return prev_page_id_; }
 
+  inline const std::string &GetIndexName() { return index_name_; }
+
+  /** @return the leaf entry of a BTREEINSERT/BTREEDELETE, the bytes written by a BTREEWRITE */
+  inline std::vector<char> &GetIndexData() { return index_data_; }
+
+  inline std::vector<std::pair<txn_id_t, lsn_t>> &GetActiveTxns() { return active_txns_; }
+
+  inline std::vector<std::pair<page_id_t, lsn_t>> &GetDirtyPages() { return dirty_pages_; }
+
   inline int32_t GetSize() { return size_; }
 
   inline lsn_t GetLSN() { return lsn_; }
@@ -173,10 +282,29 @@ class LogRecord {
   Tuple old_tuple_;
   Tuple new_tuple_;
 
+  // case3b: for delta update operation, see EncodeDelta
+  std::vector<char> delta_;
+
   // case4: for new page operation
   page_id_t prev_page_id_{INVALID_PAGE_ID};
   page_id_t page_id_{INVALID_PAGE_ID};
+
+  // case5: for checkpoint
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns_;
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages_;
+
+  // case6: for b+ tree operations, page_id_ is the page they change
+  std::string index_name_;
+  int32_t index_slot_{0};
+  int32_t index_offset_{0};
+  int32_t index_key_size_{0};
+  std::vector<char> index_data_;
   static const int HEADER_SIZE = 20;
+  static constexpr uint32_t DELTA_HEADER_SIZE = 6;
+  static constexpr uint32_t DELTA_RANGE_HEADER_SIZE = 6;
+
+  /** @return the delta_data of a DELTAUPDATE from old_tuple to new_tuple */
+  static std::vector<char> EncodeDelta(const Tuple &old_tuple, const Tuple &new_tuple);
 };  // namespace bustub
 
 }  // namespace bustub
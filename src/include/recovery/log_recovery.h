@@ -13,45 +13,209 @@
 #pragma once
 
 #include <algorithm>
+#include <functional>
 #include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
 #include "recovery/log_record.h"
+#include "storage/page/table_page.h"
 
 namespace bustub {
 
+class TransactionManager;
+
 /**
- * Read log file from disk, redo and undo.
+ * Read log file from disk, analyze, redo and undo.
+ *
+ * Recovery starts from the checkpoint in the log master record and looks older lsns up in the LSN to segment index
+ * (see DiskManager), so it only reads the end of the log.
+ *
+ * Analysis rebuilds the active transaction table and the dirty page table (page -> recLSN, the first record that may
+ * not be on disk) as of the end of the log, starting from the tables saved in the last complete checkpoint. Redo then
+ * starts at the smallest recLSN and only replays a record if its page is in the dirty page table with a recLSN at or
+ * below the record.
+ *
+ * Redo reads the log front to back in chunks of REDO_READ_SIZE bytes and hands the records to worker threads. A
+ * record goes to the worker page_id % num_workers, so the records of one page are replayed in log order by a single
+ * worker while different pages are replayed in parallel.
+ *
+ * B+ tree pages are redone like table pages. Splits, merges and root changes are logged as the bytes they wrote and
+ * are never undone, while the leaf entries of losers are undone logically through the index they belong to, which has
+ * to be registered with RegisterIndex before Undo.
+ *
+ * Instead of Redo and Undo, RecoverOnDemand recovers while new transactions already run, see there.
  */
 class LogRecovery {
  public:
   LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager)
       : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), offset_(0) {
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
+    log_buffer_ = new char[REDO_READ_SIZE];
   }
 
   ~LogRecovery() {
+    WaitForRecovery();
     delete[] log_buffer_;
     log_buffer_ = nullptr;
   }
 
-  void Redo();
+  /** Rebuild the active transaction table and the dirty page table. Redo runs it first if it has not run yet. */
+  void Analysis();
+
+  /**
+   * Recover a db file that was restored from a backup (see BackupManager::Restore). Analysis then reads the log from
+   * start_lsn instead of the last checkpoint, and every page the log touches from there on is redone. Call it before
+   * Analysis or Redo.
+   * @param start_lsn the start_lsn_ of the last backup that was restored
+   */
+  void RestoreFrom(lsn_t start_lsn) { restore_lsn_ = start_lsn; }
+
+  /**
+   * Replay the log onto the pages.
+   * @param num_workers number of threads applying records, 0 means one per hardware thread. There are never more
+   * workers than unpinned frames in the buffer pool.
+   */
+  void Redo(size_t num_workers = 0);
   void Undo();
-  bool DeserializeLogRecord(const char *data, LogRecord *log_record);
+
+  /**
+   * Instant restart: run analysis and return, so that new transactions can start right away.
+   *
+   * The records redo would replay are kept in memory by page, and the buffer pool redoes a page the first time it
+   * reads the page from disk. Every loser keeps the RIDs it changed locked in lock_manager, and a transaction asking
+   * for one of those locks waits until the loser is undone. A background thread redoes the pages and undoes the
+   * losers, those that transactions wait for first.
+   *
+   * Logging is running when this returns. The undo of a loser is logged under the loser's id and closed with an ABORT
+   * record, so a crash before recovery finished does not undo it twice.
+   *
+   * The buffer pool must not hold any page yet, as after a crash, and indexes must be registered before, as for Undo.
+   * @param txn_manager the transaction manager of the new transactions, their ids continue after those in the log
+   * @param lock_manager the lock manager the new transactions use
+   * @param log_manager the log manager the new transactions use, it must not run yet
+   */
+  void RecoverOnDemand(TransactionManager *txn_manager, LockManager *lock_manager, LogManager *log_manager);
+
+  /** Block until the background thread of RecoverOnDemand has finished redo and undo. */
+  void WaitForRecovery();
+
+  /** @return the number of pages that RecoverOnDemand has not redone yet */
+  size_t GetPendingPageCount() {
+    std::scoped_lock lock(pending_latch_);
+    return pending_redo_.size();
+  }
+
+  /**
+   * Let Undo take back the b+ tree entries of losers in an index. Entries of indexes that are not registered stay.
+   * @param index_name the name the index logs its records with, i.e. its name in the header page
+   * @param undo called with every BTREEINSERT or BTREEDELETE of a loser in that index, newest first
+   */
+  void RegisterIndex(const std::string &index_name, std::function<void(LogRecord *)> undo) {
+    index_undo_[index_name] = std::move(undo);
+  }
+
+  /**
+   * Deserialize one log record.
+   * @param data start of the serialized record
+   * @param size number of bytes available at data
+   * @param[out] log_record the deserialized record
+   * @return true on success, false if the record is incomplete or there is no valid record at data
+   */
+  bool DeserializeLogRecord(const char *data, int size, LogRecord *log_record);
+
+  /** @return the lsn that follows the last record of the log, valid after Analysis */
+  lsn_t GetNextLSN() const { return next_lsn_; }
+
+  /** @return the dirty page table built by Analysis */
+  const std::unordered_map<page_id_t, lsn_t> &GetDirtyPageTable() const { return dirty_page_table_; }
+
+  /** @return the active transaction table built by Analysis: the losers and their last lsn */
+  const std::unordered_map<txn_id_t, lsn_t> &GetActiveTxnTable() const { return active_txn_; }
 
  private:
-  DiskManager *disk_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /** Size of the sequential reads of the log during redo. */
+  static constexpr int REDO_READ_SIZE = 1 << 20;
+
+  /** Apply a record to one page unless the page LSN shows it already happened. NEWPAGE touches two pages. */
+  void RedoLogRecord(LogRecord *log_record, page_id_t page_id);
+  /** RedoLogRecord on a page that is already pinned. @return true if the page changed */
+  static bool RedoOnPage(Page *page, LogRecord *log_record, page_id_t page_id);
+  /** Find where redo has to start reading. @return false if there is nothing to redo */
+  bool FindRedoStart(int *redo_offset);
+  /** Read the record with this lsn. @return false if analysis did not see it or it can not be read */
+  bool ReadLogRecord(lsn_t lsn, LogRecord *log_record);
+  /** @return the RID a table record changed, or an invalid RID */
+  static RID GetRecordRid(const LogRecord &log_record);
+  /** The buffer pool hook of RecoverOnDemand: redo a page that was just read. @return the first lsn redone */
+  lsn_t RedoPendingPage(Page *page);
+  /** Undo a loser of RecoverOnDemand unless that already happened, and release its locks. Runs on finisher_. */
+  void UndoLoser(txn_id_t txn_id);
+  /** The background thread of RecoverOnDemand. */
+  void FinishRecovery();
+  /**
+   * Apply the inverse of a record of a transaction that did not finish.
+   * @param txn the loser, holding the lock on the record's RID, only needed when logging is enabled
+   * @param log_manager where the inverse is logged, only needed when logging is enabled
+   */
+  void UndoLogRecord(LogRecord *log_record, Transaction *txn = nullptr, LogManager *log_manager = nullptr);
+  /** Apply a DELTAUPDATE to the tuple on the page, forward for redo or backward for undo. */
+  static void ApplyDeltaUpdate(TablePage *table_page, const LogRecord &log_record, bool undo,
+                               Transaction *txn = nullptr, LogManager *log_manager = nullptr);
+  /** Apply a BTREEINSERT, BTREEDELETE or BTREEWRITE to the page. */
+  static void ApplyIndexRecord(Page *page, const LogRecord &log_record);
+  /** @return the page a record has to be redone on, INVALID_PAGE_ID for BEGIN/COMMIT/ABORT */
+  static page_id_t GetRecordPageId(const LogRecord &log_record);
+  /** @return true if redo has to look at the record for this page according to the dirty page table */
+  bool NeedsRedo(const LogRecord &log_record, page_id_t page_id) const;
+  /**
+   * Read the log sequentially in chunks of REDO_READ_SIZE bytes, starting at offset, and call visit with every
+   * complete record and its offset in the log file.
+   */
+  void ScanLog(int offset, const std::function<void(LogRecord *, int)> &visit);
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *buffer_pool_manager_;
 
   /** Maintain active transactions and its corresponding latest lsn. */
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
   /** Mapping the log sequence number to log file offset for undos. */
   std::unordered_map<lsn_t, int> lsn_mapping_;
+  /** The logical undo of b+ tree entries, by index name. */
+  std::unordered_map<std::string, std::function<void(LogRecord *)>> index_undo_;
+  /** Dirty pages at the time of the crash and their recLSN. */
+  std::unordered_map<page_id_t, lsn_t> dirty_page_table_;
+  bool analyzed_{false};
+  /** The first lsn analysis read. */
+  lsn_t first_lsn_{INVALID_LSN};
+  /** The largest page id in the log. */
+  page_id_t max_page_id_{INVALID_PAGE_ID};
 
-  int offset_ __attribute__((__unused__));
+  /** Offset in the log file of the next chunk to read during a scan. */
+  int offset_;
   char *log_buffer_;
+  lsn_t next_lsn_{0};
+  /** Where analysis starts after a restore from a backup, INVALID_LSN after a crash. */
+  lsn_t restore_lsn_{INVALID_LSN};
+  /** One more than the largest transaction id analysis read. */
+  txn_id_t next_txn_id_{0};
+
+  /** Records RecoverOnDemand still has to redo, by page, in log order. */
+  std::unordered_map<page_id_t, std::vector<LogRecord>> pending_redo_;
+  std::mutex pending_latch_;
+  /** Losers that transactions wait for, undone before the next page is redone. Protected by pending_latch_. */
+  std::vector<txn_id_t> requested_undo_;
+  /** Records of the losers RecoverOnDemand still has to undo, newest first. */
+  std::unordered_map<txn_id_t, std::vector<LogRecord>> pending_undo_;
+  /** Serializes undoing losers, taken before the buffer pool latch. */
+  std::mutex undo_latch_;
+  LockManager *lock_manager_{nullptr};
+  LogManager *log_manager_{nullptr};
+  std::thread finisher_;
 };
 
 }  // namespace bustub
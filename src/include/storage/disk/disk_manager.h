@@ -15,7 +15,11 @@
 #include <atomic>
 #include <fstream>
 #include <future>  // NOLINT
+#include <map>
+#include <mutex>  // NOLINT
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "common/config.h"
 
@@ -30,10 +34,11 @@ class DiskManager {
   /**
    * Creates a new disk manager that writes to the specified database file.
    * @param db_file the file name of the database file to write to
+   * @param enable_compression true if pages should be compressed on their way to disk (see WritePage)
    */
-  explicit DiskManager(const std::string &db_file);
+  explicit DiskManager(const std::string &db_file, bool enable_compression = false);
 
-  ~DiskManager() = default;
+  ~DiskManager();
 
   /**
    * Shut down the disk manager and close all the file resources.
@@ -65,17 +70,75 @@ class DiskManager {
    * Read a log entry from the log file.
    * @param[out] log_data output buffer
    * @param size size of the log entry
-   * @param offset offset of the log entry in the file
+   * @param offset offset of the log entry in the log
    * @return true if the read was successful, false otherwise
    */
   bool ReadLog(char *log_data, int size, int offset);
 
+  /**
+   * Note where a log record starts. Only the first record that starts in each segment is kept, in the LSN to segment
+   * index; the records have to be reported in log order.
+   * @param lsn lsn of the record
+   * @param offset offset of the record in the log
+   */
+  void IndexLogRecord(lsn_t lsn, int offset);
+
+  /**
+   * Look lsn up in the LSN to segment index.
+   * @param lsn a log sequence number
+   * @return the offset of a record at or before lsn to start reading from, the start of the first segment that has a
+   * record that starts in it if lsn is older than that
+   */
+  int FindLogOffset(lsn_t lsn);
+
+  /**
+   * Record in the log master record that recovery starts from a checkpoint whose records are on disk, then recycle
+   * the log segments that only hold records before keep_lsn.
+   * @param checkpoint_lsn lsn of the BEGIN_CHECKPOINT record
+   * @param analysis_lsn the oldest lsn analysis has to read, at or before checkpoint_lsn
+   * @param keep_lsn the oldest lsn recovery from this checkpoint may need, at or before analysis_lsn
+   */
+  void SetLogCheckpoint(lsn_t checkpoint_lsn, lsn_t analysis_lsn, lsn_t keep_lsn);
+
+  /**
+   * Read the checkpoint out of the log master record.
+   * @param[out] checkpoint_lsn lsn of the BEGIN_CHECKPOINT record
+   * @param[out] analysis_lsn the oldest lsn analysis has to read
+   * @return false if no checkpoint was recorded
+   */
+  bool GetLogCheckpoint(lsn_t *checkpoint_lsn, lsn_t *analysis_lsn);
+
+  /**
+   * Set the size of the log segment files. Only possible while the log is empty.
+   * @param segment_size size of a segment in bytes
+   */
+  void SetLogSegmentSize(int segment_size);
+
+  /** @return the size of a log segment file in bytes */
+  int GetLogSegmentSize() const { return log_segment_size_; }
+
+  /** @return the offset of the oldest byte of the log that has not been recycled */
+  int GetLogStart();
+
+  /** @return the number of log segment files */
+  int GetNumLogSegments();
+
   /**
    * Allocate a page on disk.
    * @return the id of the allocated page
    */
   page_id_t AllocatePage();
 
+  /**
+   * Make sure AllocatePage never hands out an id below next_page_id, e.g. for pages that recovery found in the log
+   * but that never made it into the db file.
+   * @param next_page_id the lowest page id that may still be allocated
+   */
+  void ReservePageIds(page_id_t next_page_id);
+
+  /** @return the number of page ids handed out so far, every page id below it may be in the db file */
+  page_id_t GetNumPages() const { return next_page_id_; }
+
   /**
    * Deallocate a page on disk.
    * @param page_id id of the page to deallocate
@@ -91,6 +154,26 @@ class DiskManager {
   /** @return the number of disk writes */
   int GetNumWrites() const;
 
+  /** @return the size of the log in bytes, including the segments that were recycled */
+  int GetLogSize();
+
+  /** @return true if pages are stored compressed */
+  bool IsCompressionEnabled() const { return enable_compression_; }
+
+  /** @return logical bytes of the pages currently on disk divided by the bytes they occupy, 1.0 if uncompressed */
+  double GetCompressionRatio() const;
+
+  /**
+   * Set how far ahead of the allocated pages the db file is preallocated. Space is reserved with fallocate in chunks of
+   * this size once the allocated end of the file comes within a quarter chunk of the preallocated end. Preallocation
+   * needs fallocate with FALLOC_FL_KEEP_SIZE, on other systems than Linux this does nothing.
+   * @param chunk_size size of a preallocated extent in bytes, 0 to disable preallocation
+   */
+  void SetPreallocateChunkSize(size_t chunk_size);
+
+  /** @return bytes preallocated beyond the end of the allocated pages */
+  size_t GetPreallocatedHeadroom();
+
   /**
    * Sets the future which is used to check for non-blocking flushes.
    * @param f the non-blocking flush check
@@ -101,18 +184,99 @@ class DiskManager {
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
  private:
+  /**
+   * With compression enabled the db file is a sequence of variable-size slots, each holding one compressed page:
+   *  ----------------------------------------------------------------------------------------------
+   * | Magic (4) | PageId (4) | Seq (4) | DataSize (2) | Capacity (2) | data ... padding to Capacity |
+   *  ----------------------------------------------------------------------------------------------
+   * Capacity is counted in SLOT_UNIT bytes and never changes once a slot is carved out of the file, so the slots can
+   * be walked front to back on startup. DataSize == PAGE_SIZE means the page was stored raw. Seq orders the copies of
+   * a page that moved between slots; the highest one is live and the others are free.
+   */
+  struct PageSlot {
+    size_t offset_;
+    uint16_t capacity_;
+    uint16_t data_size_;
+  };
+  static constexpr uint32_t SLOT_MAGIC = 0x42505331;  // "BPS1"
+  static constexpr size_t SLOT_HEADER_SIZE = 16;
+  static constexpr size_t SLOT_UNIT = 512;
+
   int GetFileSize(const std::string &file_name);
-  // stream to write log file
+  /** Rebuild page_slots_ and free_slots_ by walking the slots of an existing compressed db file. */
+  void LoadSlots();
+  /** @return a slot of at least units * SLOT_UNIT bytes, reusing a free slot when possible */
+  PageSlot AllocateSlot(uint16_t units);
+  void WriteCompressedPage(page_id_t page_id, const char *page_data);
+  void ReadCompressedPage(page_id_t page_id, char *page_data);
+  /** Make sure the db file has space reserved at least up to end, extending the preallocated extent if it is close. */
+  void EnsurePreallocated(size_t end);
+  /** @return the end of the space in use by allocated pages */
+  size_t AllocatedEnd() const;
+  /**
+   * The log is a byte stream cut into segment files of log_segment_size_ bytes: the log offset o is in the file
+   * log_name_.N with N = o / log_segment_size_. Segments that recovery does not need any more are deleted, the
+   * offsets of the others do not change. The file log_name_ itself holds the log master record:
+   *  ----------------------------------------------------------------------------------------------------------
+   * | Magic (4) | SegmentSize (4) | FirstSegment (4) | CheckpointLSN (4) | AnalysisLSN (4) | Count (4) | ... |
+   *  ----------------------------------------------------------------------------------------------------------
+   * followed by Count (FirstLSN (4), Offset (4)) entries of the LSN to segment index. It is written at every
+   * checkpoint; the index entries of the segments written since then are added back by recovery as it reads them.
+   */
+  static constexpr uint32_t LOG_MASTER_MAGIC = 0x424c4d31;  // "BLM1"
+  std::string LogSegmentName(int segment) const;
+  /** Load the log master record, false if there is none. */
+  bool LoadLogMaster();
+  /** Write the log master record out. The caller holds log_latch_. */
+  void WriteLogMaster();
+  /** Delete segment files that are left over from an earlier log with the same name. */
+  void RemoveLogSegments();
+
+  // stream to append to the last log segment
   std::fstream log_io_;
+  int log_write_segment_{-1};
+  // stream to read log segments
+  std::ifstream log_read_io_;
+  int log_read_segment_{-1};
   std::string log_name_;
+  std::mutex log_latch_;
+  int log_segment_size_{LOG_SEGMENT_SIZE};
+  int first_log_segment_{0};
+  /** offset of the end of the log */
+  int log_end_{0};
+  lsn_t checkpoint_lsn_{INVALID_LSN};
+  lsn_t analysis_lsn_{INVALID_LSN};
+  /** first lsn of a segment -> offset of that record, for every segment that has a record starting in it */
+  std::map<lsn_t, int> log_segment_index_;
+  int last_indexed_segment_{-1};
   // stream to write db file
   std::fstream db_io_;
+  // the buffer pool writes pages back from more than one thread
+  std::mutex db_io_latch_;
   std::string file_name_;
   std::atomic<page_id_t> next_page_id_;
   int num_flushes_;
   int num_writes_;
   bool flush_log_;
   std::future<void> *flush_log_f_;
+
+  bool enable_compression_;
+  /** page id -> location of its live slot */
+  std::unordered_map<page_id_t, PageSlot> page_slots_;
+  /** capacity in units -> offsets of free slots with that capacity */
+  std::map<uint16_t, std::vector<size_t>> free_slots_;
+  /** end of the slot area, where new slots are carved out */
+  size_t slot_end_{0};
+  uint32_t next_slot_seq_{0};
+  /** bytes occupied by live slots */
+  size_t live_slot_bytes_{0};
+
+  /** raw descriptor of the db file, used for fallocate which fstream does not expose */
+  int db_fd_{-1};
+  std::mutex prealloc_latch_;
+  size_t prealloc_chunk_size_{PREALLOCATE_CHUNK_SIZE};
+  /** end of the space reserved in the db file */
+  size_t prealloc_end_{0};
 };
 
 }  // namespace bustub
@@ -0,0 +1,58 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_codec.h
+//
+// Identification: src/include/storage/disk/page_codec.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+
+namespace bustub {
+
+/**
+ * PageCodec is a small, dependency-free LZ77 codec used by the DiskManager to compress pages on their way to disk.
+ *
+ * The encoded stream is a sequence of (literals, match) pairs in the spirit of LZ4's block format:
+ *  ---------------------------------------------------------------------------------------------
+ * | token (1) | [literal length ext] | literals | match offset (2) | [match length ext] | ... |
+ *  ---------------------------------------------------------------------------------------------
+ * The high nibble of the token is the literal count and the low nibble is the match length minus MIN_MATCH; a nibble
+ * of 15 is followed by extension bytes that are added to it until a byte smaller than 255 is read. The last sequence
+ * carries literals only.
+ */
+class PageCodec {
+ public:
+  /**
+   * Compress src into dst.
+   * @param src input buffer
+   * @param src_size number of bytes in src
+   * @param[out] dst output buffer
+   * @param dst_capacity size of dst in bytes
+   * @return the compressed size, or 0 if the data does not fit into dst_capacity (i.e. it is not worth compressing)
+   */
+  static size_t Compress(const char *src, size_t src_size, char *dst, size_t dst_capacity);
+
+  /**
+   * Decompress src into dst.
+   * @param src compressed buffer
+   * @param src_size number of bytes in src
+   * @param[out] dst output buffer
+   * @param dst_size expected number of decompressed bytes
+   * @return true iff the stream was well formed and decompressed to exactly dst_size bytes
+   */
+  static bool Decompress(const char *src, size_t src_size, char *dst, size_t dst_size);
+
+ private:
+  static constexpr size_t MIN_MATCH = 4;
+  static constexpr size_t MAX_OFFSET = 65535;
+  static constexpr size_t HASH_LOG = 12;
+};
+
+}  // namespace bustub
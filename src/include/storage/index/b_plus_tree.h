@@ -10,12 +10,17 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
-// #include <mutex>
+#include <atomic>
+#include <functional>
+#include <mutex>  // NOLINT
 #include <queue>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "concurrency/transaction.h"
+#include "recovery/log_manager.h"
 #include "storage/index/index_iterator.h"
 #include "storage/page/b_plus_tree_internal_page.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
@@ -35,6 +40,25 @@ enum class Operation { READ = 0, INSERT, DELETE };
  * (2) support insert & remove
  * (3) The structure should shrink and grow dynamically
  * (4) Implement index iterator for range scan
+ *
+ * With a log manager and logging enabled, every change is written ahead to the log: leaf inserts and deletes as
+ * BTREEINSERT/BTREEDELETE records that recovery redoes on the page and undoes through UndoLogRecord, and the pages a
+ * split, merge or root change wrote as BTREEWRITE records that are only redone. A tree is then usable right after
+ * recovery without being rebuilt.
+ *
+ * The tree is a B-link tree: every page has a right-link to its sibling and fence keys bounding the keys it may hold.
+ * Readers hold one read latch at a time and follow the right-link of a page that split under them, without coupling
+ * latches, see FindLeafPageBLink. Writers still couple write latches.
+ *
+ * Leaves also link to their left sibling, for reverse scans. A split or merge updates the left link of the leaf right
+ * of it, which may sit under another parent: waiting for that leaf while holding the path could deadlock with a merge
+ * one level up, so there it is only latched if free and the link is otherwise left stale. A reverse iterator checks a
+ * left link before it follows it and descends from the root instead if it is stale, see FindLeafPageBefore.
+ *
+ * Inserts and deletes first descend optimistically: read latches down the inner pages, a write latch on the leaf only.
+ * Most of them change nothing but the leaf, and concurrent writers then share the upper levels the way readers do. If
+ * the leaf may split or underflow, they release it and restart with pessimistic crabbing, which write-latches the path
+ * and releases the ancestors of a safe page.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTree {
@@ -43,7 +67,11 @@ class BPlusTree {
 
  public:
   explicit BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE);
+                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE,
+                     LogManager *log_manager = nullptr);
+
+  // Attach to the tree recorded under this index name in the header page, returns false if there is none.
+  bool Open();
 
   // Returns true if this B+ tree has no keys and values.
   bool IsEmpty() const;
@@ -51,9 +79,30 @@ class BPlusTree {
   // Insert a key-value pair into this B+ tree.
   bool Insert(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
 
+  // Build this empty B+ tree bottom-up from the entries next returns in ascending key order, false at the end.
+  bool BulkLoad(const std::function<bool(MappingType *)> &next, double fill_factor = 0.9);
+
+  // Build this empty B+ tree bottom-up from a sorted range of entries.
+  template <typename Iterator>
+  bool BulkLoad(Iterator begin, Iterator end, double fill_factor = 0.9) {
+    return BulkLoad(
+        [&begin, &end](MappingType *entry) {
+          if (begin == end) {
+            return false;
+          }
+          *entry = *begin;
+          ++begin;
+          return true;
+        },
+        fill_factor);
+  }
+
   // Remove a key and its value from this B+ tree.
   void Remove(const KeyType &key, Transaction *transaction = nullptr);
 
+  // undo a BTREEINSERT or BTREEDELETE of this tree during recovery, see LogRecovery::RegisterIndex
+  void UndoLogRecord(LogRecord *log_record);
+
   // return the value associated with a given key
   bool GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction = nullptr);
 
@@ -61,6 +110,13 @@ class BPlusTree {
   INDEXITERATOR_TYPE begin();
   INDEXITERATOR_TYPE Begin(const KeyType &key);
   INDEXITERATOR_TYPE end();
+  // the entries from lower to upper, a nullptr bound leaves that end open. The iterator is at end() past upper.
+  INDEXITERATOR_TYPE Scan(const KeyType *lower, const KeyType *upper,
+                          ScanInclusivity inclusivity = ScanInclusivity::BOTH);
+  // reverse iterators from the last entry of the tree, or the last one at or below key, towards the first; ++ moves
+  // to the next smaller key and they end at end()
+  INDEXITERATOR_TYPE rbegin();
+  INDEXITERATOR_TYPE RBegin(const KeyType &key);
 
   void Print(BufferPoolManager *bpm = nullptr) {
     if (bpm == nullptr) {
@@ -82,6 +138,14 @@ class BPlusTree {
 
   // read data from file and remove one by one
   void RemoveFromFile(const std::string &file_name, Transaction *transaction = nullptr);
+
+  // turn the optimistic descent of inserts and deletes on or off, it is on by default
+  void SetOptimisticLatching(bool optimistic) { optimistic_latching_ = optimistic; }
+
+  // inserts and deletes that descended optimistically, and those of them that restarted pessimistically
+  size_t GetOptimisticCount() const { return optimistic_count_; }
+  size_t GetRestartCount() const { return restart_count_; }
+
   // expose for test purpose
   Page *FindLeafPage(const KeyType &key, bool leftMost = false, Operation op = Operation::READ,
                      Transaction *transaction = nullptr);
@@ -90,7 +154,45 @@ class BPlusTree {
   void UnpinAndUnLatch(Operation op = Operation::READ, Transaction *transaction = nullptr);
 
  private:
-  void StartNewTree(const KeyType &key, const ValueType &value);
+  bool IsRoot(page_id_t page_id);
+
+  Page *FindLeafPageOptimistic(const KeyType &key, Operation op, Transaction *transaction);
+
+  Page *FindLeafPageBLink(const KeyType &key, bool leftMost);
+
+  std::function<Page *(const KeyType &)> MakeLeafFinder();
+
+  // the leaf holding the keys right below key, the last leaf if key is nullptr, read latched
+  Page *FindLeafPageBefore(const KeyType *key);
+
+  std::function<Page *(const KeyType &)> MakePrevLeafFinder();
+
+  template <typename N>
+  int CheckFences(N *node, const KeyType &key, bool leftMost) const;
+
+  template <typename N>
+  int CheckFencesBefore(N *node, const KeyType *key) const;
+
+  template <typename N>
+  void LinkSplit(N *node, N *new_node, const KeyType &separator);
+
+  template <typename N>
+  void LinkRedistribute(N *left, N *right, const KeyType &separator);
+
+  void SetPrevLink(page_id_t page_id, page_id_t prev_page_id, page_id_t parent_page_id, page_id_t stale_page_id,
+                   Transaction *transaction);
+
+  void WritePrevLink(Page *page, page_id_t prev_page_id);
+
+  void FixStaleLinks();
+
+  bool RetireLeaf(page_id_t page_id, page_id_t heir_page_id);
+
+  std::vector<page_id_t> DropStaleLinks(page_id_t page_id);
+
+  bool IsStaleLinked(page_id_t page_id) const;
+
+  void StartNewTree(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
 
   bool InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr,
                       bool notfull = true);
@@ -104,17 +206,34 @@ class BPlusTree {
   template <typename N>
   bool CoalesceOrRedistribute(N *node, Transaction *transaction = nullptr);
 
+  bool CanCoalesce(LeafPage *left, LeafPage *right, const KeyType &middle_key) const;
+
+  bool CanCoalesce(InternalPage *left, InternalPage *right, const KeyType &middle_key) const;
+
   template <typename N>
   bool Coalesce(N **neighbor_node, N **node, BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> **parent,
                 int index, Transaction *transaction = nullptr, bool ToLeft = true);
 
   template <typename N>
-  void Redistribute(N *neighbor_node, N *node, int index);
+  void Redistribute(N *neighbor_node, N *node, int index, Transaction *transaction = nullptr);
 
   bool AdjustRoot(BPlusTreePage *node, Transaction *transaction = nullptr);
 
   void UpdateRootPageId(int insert_record = 0);
 
+  void FinishBulkPage(page_id_t page_id, page_id_t parent_page_id);
+
+  /* Write ahead logging */
+  bool IsLogging() const { return enable_logging && log_manager_ != nullptr; }
+
+  void LogLeafEntry(LogRecordType type, LeafPage *leaf, int index, const MappingType &entry, Transaction *transaction);
+
+  void LogPage(BPlusTreePage *node);
+
+  void LogChildHeader(page_id_t page_id, Transaction *transaction);
+
+  void LogChildren(InternalPage *node, int begin, int end, Transaction *transaction);
+
   /* Debug Routines for FREE!! */
   void ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::ofstream &out) const;
 
@@ -128,7 +247,16 @@ class BPlusTree {
   KeyComparator comparator_;
   int leaf_max_size_;
   int internal_max_size_;
+  LogManager *log_manager_;
   std::mutex root_latch_;
+  // leaves whose left link SetPrevLink could not fix, each with a page the link may point at
+  std::unordered_multimap<page_id_t, page_id_t> stale_links_;
+  // merged away leaves a stale link points at, not freed yet
+  std::unordered_set<page_id_t> stale_pages_;
+  std::mutex stale_latch_;
+  bool optimistic_latching_{true};
+  std::atomic<size_t> optimistic_count_{0};
+  std::atomic<size_t> restart_count_{0};
 };
 
 }  // namespace bustub
@@ -11,8 +11,10 @@
 
 #pragma once
 
+#include <functional>
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "storage/index/b_plus_tree.h"
@@ -25,10 +27,16 @@ namespace bustub {
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeIndex : public Index {
  public:
-  BPlusTreeIndex(IndexMetadata *metadata, BufferPoolManager *buffer_pool_manager);
+  BPlusTreeIndex(IndexMetadata *metadata, BufferPoolManager *buffer_pool_manager, LogManager *log_manager = nullptr);
+
+  // attach to the tree this index left on disk, see BPlusTree::Open
+  bool Open() { return container_.Open(); }
 
   void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
+  // build the empty index from entries in key order, see BPlusTree::BulkLoad
+  bool BulkLoad(const std::function<bool(std::pair<KeyType, ValueType> *)> &next) { return container_.BulkLoad(next); }
+
   void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
@@ -39,6 +47,15 @@ class BPlusTreeIndex : public Index {
 
   INDEXITERATOR_TYPE GetEndIterator();
 
+  // reverse iterators from the last entry, or the last one at or below key, see BPlusTree::rbegin
+  INDEXITERATOR_TYPE GetReverseBeginIterator();
+
+  INDEXITERATOR_TYPE GetReverseBeginIterator(const KeyType &key);
+
+  // the entries between two keys, see BPlusTree::Scan
+  INDEXITERATOR_TYPE GetScanIterator(const KeyType *lower, const KeyType *upper,
+                                     ScanInclusivity inclusivity = ScanInclusivity::BOTH);
+
  protected:
   // comparator for key
   KeyComparator comparator_;
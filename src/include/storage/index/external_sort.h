@@ -0,0 +1,78 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// external_sort.h
+//
+// Identification: src/include/storage/index/external_sort.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#include "storage/index/generic_key.h"
+#include "storage/page/b_plus_tree_page.h"
+
+namespace bustub {
+
+/**
+ * ExternalSort sorts (key, value) entries that need not fit in memory, to feed BPlusTree::BulkLoad.
+ *
+ * Entries are collected into a run of at most run_size entries. A full run is sorted and spilled to a temporary file.
+ * Next() sorts the last run and, if runs were spilled, merges all of them with a heap over the head of every run.
+ * The sort is stable: entries with equal keys come out in the order they were added.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class ExternalSort {
+ public:
+  explicit ExternalSort(const KeyComparator &comparator, size_t run_size = 64 * 1024)
+      : comparator_(comparator), run_size_(run_size) {}
+  ~ExternalSort();
+
+  ExternalSort(const ExternalSort &) = delete;
+  ExternalSort &operator=(const ExternalSort &) = delete;
+
+  /** Add an entry. Entries can not be added once Next() was called. */
+  void Add(const KeyType &key, const ValueType &value);
+
+  /**
+   * Get the next entry in key order.
+   * @return false if there are no more entries
+   */
+  bool Next(MappingType *entry);
+
+  /** @return the number of runs that were spilled to temporary files */
+  size_t GetRunCount() const { return runs_.size(); }
+
+ private:
+  /** The head of a spilled run while it is merged. */
+  struct RunHead {
+    MappingType entry_;
+    size_t run_;
+  };
+
+  /** Sort the collected entries, stable. */
+  void SortBuffer();
+  /** Sort the collected entries and write them to a new temporary file. */
+  void SpillRun();
+  /** Read the next entry of a spilled run into the merge heap. */
+  void ReadRun(size_t run);
+  /** Order of the merge heap: the smallest key, then the earliest run, on top. */
+  bool HeapLess(const RunHead &a, const RunHead &b) const;
+
+  KeyComparator comparator_;
+  size_t run_size_;
+  std::vector<MappingType> buffer_;
+  std::vector<FILE *> runs_;
+  std::vector<RunHead> heap_;
+  bool sorted_{false};
+  size_t next_{0};
+};
+
+}  // namespace bustub
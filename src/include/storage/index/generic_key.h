@@ -12,8 +12,11 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstring>
+#include <string>
 
+#include "common/exception.h"
 #include "storage/table/tuple.h"
 #include "type/value.h"
 
@@ -25,42 +28,65 @@ namespace bustub {
  * This key type uses an fixed length array to hold data for indexing
  * purposes, the actual size of which is specified and instantiated
  * with a template argument.
+ *
+ * The columns are stored normalized, one after the other, so that comparing two keys of the same schema is a single
+ * memcmp over the whole array:
+ *  - integers and booleans big-endian with the sign bit flipped, so the null sentinel (the smallest value) sorts first
+ *  - decimals big-endian with the sign bit flipped if positive and every bit flipped if negative
+ *  - timestamps big-endian, plus one so the null sentinel wraps around to sort first
+ *  - varchars as 0x00 if null, else 0x01, the bytes with every 0x00 escaped as 0x00 0x01, and 0x00 0x00 at the end
+ * Unused bytes are zero. A key whose encoding does not fit is truncated, keys that share the kept prefix compare equal.
  */
 template <size_t KeySize>
 class GenericKey {
  public:
-  inline void SetFromKey(const Tuple &tuple) {
+  inline void SetFromKey(const Tuple &tuple, const Schema *key_schema) {
     // intialize to 0
     memset(data_, 0, KeySize);
-    memcpy(data_, tuple.GetData(), tuple.GetLength());
+    size_t pos = 0;
+    for (uint32_t i = 0; i < key_schema->GetColumnCount(); i++) {
+      pos = Encode(tuple.GetValue(key_schema, i), pos);
+    }
   }
 
   // NOTE: for test purpose only
+  // set the key of a single bigint column
   inline void SetFromInteger(int64_t key) {
     memset(data_, 0, KeySize);
-    memcpy(data_, &key, sizeof(int64_t));
+    PutBigEndian(static_cast<uint64_t>(key) ^ SIGN_BIT, sizeof(int64_t), 0);
   }
 
   inline Value ToValue(Schema *schema, uint32_t column_idx) const {
-    const char *data_ptr;
-    const auto &col = schema->GetColumn(column_idx);
-    const TypeId column_type = col.GetType();
-    const bool is_inlined = col.IsInlined();
-    if (is_inlined) {
-      data_ptr = (data_ + col.GetOffset());
-    } else {
-      int32_t offset = *reinterpret_cast<int32_t *>(const_cast<char *>(data_ + col.GetOffset()));
-      data_ptr = (data_ + offset);
+    size_t pos = 0;
+    for (uint32_t i = 0; i < column_idx; i++) {
+      Decode(schema->GetColumn(i).GetType(), &pos);
     }
-    return Value::DeserializeFrom(data_ptr, column_type);
+    return Decode(schema->GetColumn(column_idx).GetType(), &pos);
   }
 
   // NOTE: for test purpose only
-  // interpret the first 8 bytes as int64_t from data vector
-  inline int64_t ToString() const { return *reinterpret_cast<int64_t *>(const_cast<char *>(data_)); }
+  // interpret the key as a single bigint column
+  inline int64_t ToString() const {
+    return static_cast<int64_t>(GetBigEndian(sizeof(int64_t), 0) ^ SIGN_BIT);
+  }
+
+  /**
+   * The shortest key that separates lower < upper: upper cut after the first byte it differs from lower in, zero
+   * padded. lower < separator <= upper, so the separator can stand for upper in an internal page of a B+ tree.
+   */
+  static GenericKey Separator(const GenericKey &lower, const GenericKey &upper) {
+    GenericKey separator;
+    memset(separator.data_, 0, KeySize);
+    size_t size = 0;
+    while (size < KeySize && lower.data_[size] == upper.data_[size]) {
+      size++;
+    }
+    memcpy(separator.data_, upper.data_, std::min(size + 1, KeySize));
+    return separator;
+  }
 
   // NOTE: for test purpose only
-  // interpret the first 8 bytes as int64_t from data vector
+  // interpret the key as a single bigint column
   friend std::ostream &operator<<(std::ostream &os, const GenericKey &key) {
     os << key.ToString();
     return os;
@@ -68,39 +94,180 @@ class GenericKey {
 
   // actual location of data, extends past the end.
   char data_[KeySize];
+
+ private:
+  static constexpr uint64_t SIGN_BIT = uint64_t{1} << 63;
+
+  /** Write the width low bytes of value at pos, most significant first, dropping what does not fit. */
+  inline void PutBigEndian(uint64_t value, size_t width, size_t pos) {
+    for (size_t i = 0; i < width && pos + i < KeySize; i++) {
+      data_[pos + i] = static_cast<char>(value >> (8 * (width - 1 - i)));
+    }
+  }
+
+  inline uint64_t GetBigEndian(size_t width, size_t pos) const {
+    uint64_t value = 0;
+    for (size_t i = 0; i < width; i++) {
+      value = (value << 8) | (pos + i < KeySize ? static_cast<uint8_t>(data_[pos + i]) : 0);
+    }
+    return value;
+  }
+
+  /** Encode a value at pos. @return the position after it */
+  size_t Encode(const Value &value, size_t pos) {
+    switch (value.GetTypeId()) {
+      case TypeId::BOOLEAN:
+      case TypeId::TINYINT:
+        PutBigEndian(static_cast<uint8_t>(value.GetAs<int8_t>()) ^ 0x80, 1, pos);
+        return pos + 1;
+      case TypeId::SMALLINT:
+        PutBigEndian(static_cast<uint16_t>(value.GetAs<int16_t>()) ^ 0x8000, 2, pos);
+        return pos + 2;
+      case TypeId::INTEGER:
+        PutBigEndian(static_cast<uint32_t>(value.GetAs<int32_t>()) ^ 0x80000000, 4, pos);
+        return pos + 4;
+      case TypeId::BIGINT:
+        PutBigEndian(static_cast<uint64_t>(value.GetAs<int64_t>()) ^ SIGN_BIT, 8, pos);
+        return pos + 8;
+      case TypeId::DECIMAL: {
+        double d = value.GetAs<double>();
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        PutBigEndian((bits & SIGN_BIT) != 0 ? ~bits : bits ^ SIGN_BIT, 8, pos);
+        return pos + 8;
+      }
+      case TypeId::TIMESTAMP:
+        PutBigEndian(value.GetAs<uint64_t>() + 1, 8, pos);
+        return pos + 8;
+      case TypeId::VARCHAR: {
+        if (value.IsNull()) {
+          return pos + 1;
+        }
+        PutBigEndian(1, 1, pos++);
+        const char *data = value.GetData();
+        for (uint32_t i = 0; i < value.GetLength(); i++) {
+          PutBigEndian(static_cast<uint8_t>(data[i]), 1, pos++);
+          if (data[i] == '\0') {
+            PutBigEndian(1, 1, pos++);
+          }
+        }
+        return pos + 2;
+      }
+      default:
+        throw Exception(ExceptionType::INCOMPATIBLE_TYPE, "type can not be part of an index key");
+    }
+  }
+
+  /** Decode a value of type at *pos and move *pos after it. */
+  Value Decode(TypeId type, size_t *pos) const {
+    size_t at = *pos;
+    switch (type) {
+      case TypeId::BOOLEAN:
+      case TypeId::TINYINT:
+        *pos += 1;
+        return Value(type, static_cast<int8_t>(GetBigEndian(1, at) ^ 0x80));
+      case TypeId::SMALLINT:
+        *pos += 2;
+        return Value(type, static_cast<int16_t>(GetBigEndian(2, at) ^ 0x8000));
+      case TypeId::INTEGER:
+        *pos += 4;
+        return Value(type, static_cast<int32_t>(GetBigEndian(4, at) ^ 0x80000000));
+      case TypeId::BIGINT:
+        *pos += 8;
+        return Value(type, static_cast<int64_t>(GetBigEndian(8, at) ^ SIGN_BIT));
+      case TypeId::DECIMAL: {
+        *pos += 8;
+        uint64_t bits = GetBigEndian(8, at);
+        bits = (bits & SIGN_BIT) != 0 ? bits ^ SIGN_BIT : ~bits;
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        return Value(type, d);
+      }
+      case TypeId::TIMESTAMP:
+        *pos += 8;
+        return Value(type, GetBigEndian(8, at) - 1);
+      case TypeId::VARCHAR: {
+        *pos += 1;
+        if (GetBigEndian(1, at) == 0) {
+          return Value(type, nullptr, BUSTUB_VALUE_NULL, false);
+        }
+        std::string str;
+        while (*pos < KeySize) {
+          char c = data_[(*pos)++];
+          if (c == '\0' && GetBigEndian(1, (*pos)++) == 0) {
+            break;
+          }
+          str.push_back(c);
+        }
+        // the terminator the value was stored with is part of its length
+        if (str.empty() || str.back() != '\0') {
+          str.push_back('\0');
+        }
+        return Value(type, str.data(), static_cast<uint32_t>(str.size()), true);
+      }
+      default:
+        throw Exception(ExceptionType::INCOMPATIBLE_TYPE, "type can not be part of an index key");
+    }
+  }
 };
 
 /**
  * Function object returns true if lhs < rhs, used for trees
+ *
+ * Keys are normalized (see GenericKey), so a comparison is a memcmp. A key of a single integer column is compared as
+ * one big-endian load of its width instead.
  */
 template <size_t KeySize>
 class GenericComparator {
  public:
   inline int operator()(const GenericKey<KeySize> &lhs, const GenericKey<KeySize> &rhs) const {
-    uint32_t column_count = key_schema_->GetColumnCount();
-
-    for (uint32_t i = 0; i < column_count; i++) {
-      Value lhs_value = (lhs.ToValue(key_schema_, i));
-      Value rhs_value = (rhs.ToValue(key_schema_, i));
-
-      if (lhs_value.CompareLessThan(rhs_value) == CmpBool::CmpTrue) {
-        return -1;
-      }
-      if (lhs_value.CompareGreaterThan(rhs_value) == CmpBool::CmpTrue) {
-        return 1;
+    if constexpr (KeySize >= sizeof(uint64_t)) {
+      if (integer_width_ == sizeof(uint64_t)) {
+        return Compare(Load<uint64_t>(lhs), Load<uint64_t>(rhs));
       }
     }
-    // equals
-    return 0;
+    if (integer_width_ == sizeof(uint32_t)) {
+      return Compare(Load<uint32_t>(lhs), Load<uint32_t>(rhs));
+    }
+    return Compare(memcmp(lhs.data_, rhs.data_, KeySize), 0);
   }
 
-  GenericComparator(const GenericComparator &other) : key_schema_{other.key_schema_} {}
+  GenericComparator(const GenericComparator &other)
+      : key_schema_{other.key_schema_}, integer_width_{other.integer_width_} {}
 
   // constructor
-  explicit GenericComparator(Schema *key_schema) : key_schema_(key_schema) {}
+  explicit GenericComparator(Schema *key_schema) : key_schema_(key_schema) {
+    if (key_schema->GetColumnCount() == 1) {
+      TypeId type = key_schema->GetColumn(0).GetType();
+      size_t width = type == TypeId::BIGINT ? sizeof(uint64_t) : type == TypeId::INTEGER ? sizeof(uint32_t) : 0;
+      // the bytes after the column are zero in every key, the column decides alone
+      integer_width_ = width <= KeySize ? width : 0;
+    }
+  }
+
+  Schema *GetKeySchema() const { return key_schema_; }
 
  private:
+  template <typename T>
+  static inline int Compare(T lhs, T rhs) {
+    return (lhs > rhs) - (lhs < rhs);
+  }
+
+  /** Load the leading bytes of a key as an unsigned big-endian integer. */
+  template <typename T>
+  static inline T Load(const GenericKey<KeySize> &key) {
+    T value;
+    memcpy(&value, key.data_, sizeof(T));
+    if constexpr (sizeof(T) == sizeof(uint64_t)) {
+      return __builtin_bswap64(value);
+    } else {
+      return __builtin_bswap32(value);
+    }
+  }
+
   Schema *key_schema_;
+  // the width of the single integer column of the key, 0 to compare with memcmp
+  size_t integer_width_{0};
 };
 
 }  // namespace bustub
@@ -13,6 +13,7 @@
  * For range scan of b+ tree
  */
 #pragma once
+#include <functional>
 #include <list>
 #include "storage/page/b_plus_tree_leaf_page.h"
 
@@ -20,12 +21,41 @@ namespace bustub {
 
 #define INDEXITERATOR_TYPE IndexIterator<KeyType, ValueType, KeyComparator>
 
+/** Which ends of a range scan from lower to upper belong to the range. */
+enum class ScanInclusivity { BOTH, LOWER, UPPER, NEITHER };
+
+/**
+ * Walks the leaves of a B-link tree along their right-links. The iterator keeps its leaf pinned but latches it only
+ * while it moves, and moves by key: it continues after the last key it returned, so splits and merges of the leaf in
+ * between neither skip nor repeat entries. If the leaf was merged away, it finds the leaf of that key from the root.
+ *
+ * A range scan ends at the first entry past its upper bound rather than at the end of the tree. Whenever the iterator
+ * arrives at a leaf whose entries the range may continue past, it asks the buffer pool to read the next leaf in the
+ * background (see BufferPoolManager::PrefetchPage), so the read overlaps with consuming this one.
+ *
+ * A reverse iterator walks towards smaller keys along the left links of the leaves. Those may be stale (see BPlusTree),
+ * so it follows one only to a leaf whose right-link and high key lead back to where it came from, and descends from
+ * the root to the leaf below that key otherwise.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
  public:
   // you may define your own constructor based on your member variables
   IndexIterator();
-  IndexIterator(int index_in_leaf, Page *page, BufferPoolManager *buffer_pool_manager);
+  /**
+   * @param page the leaf to start on, pinned and read latched, the iterator takes both over
+   * @param key start at the first entry not below key, at the first entry of page if nullptr
+   * @param find_leaf returns the leaf of a key pinned and read latched, nullptr if the tree is empty
+   * @param upper end before the first entry past upper, at the end of the tree if nullptr
+   * @param inclusivity whether entries equal to key and to upper are in the range
+   * @param reverse walk towards smaller keys from the last entry at or below key, or the last entry of page if key is
+   * nullptr; page has to cover key, upper has to be nullptr, and find_leaf returns the leaf of the keys right below a
+   * key instead
+   */
+  IndexIterator(Page *page, const KeyType *key, BufferPoolManager *buffer_pool_manager,
+                const KeyComparator *comparator, std::function<Page *(const KeyType &)> find_leaf,
+                const KeyType *upper = nullptr, ScanInclusivity inclusivity = ScanInclusivity::BOTH,
+                bool reverse = false);
   ~IndexIterator();
 
   bool isEnd();
@@ -34,6 +64,13 @@ class IndexIterator {
 
   IndexIterator &operator++();
 
+  /**
+   * Copy the values of up to n entries, from the current one on, into values and move past them. Entries of one leaf
+   * are copied under a single latch.
+   * @return the number of values copied, less than n only at the end
+   */
+  int NextBatch(ValueType *values, int n);
+
   bool operator==(const IndexIterator &itr) const {
     return index_in_leaf_ == itr.index_in_leaf_ && page_id == itr.page_id;
   }
@@ -41,11 +78,31 @@ class IndexIterator {
   bool operator!=(const IndexIterator &itr) const { return !(*this == itr); }
 
  private:
+  // move to the first entry after key (or at key if inclusive) from page, which is pinned and read latched
+  void Seek(Page *page, const KeyType &key, bool inclusive);
+
+  // move to the last entry before key (or at key if inclusive) from page, which is pinned and read latched
+  void SeekBack(Page *page, const KeyType &key, bool inclusive);
+
+  // Seek or SeekBack, whichever way the iterator goes
+  void Move(Page *page, const KeyType &key, bool inclusive);
+
+  // whether key is past the upper bound of the scan
+  bool PastUpper(const KeyType &key) const;
+
   // add your own private member variables here
   page_id_t page_id{INVALID_PAGE_ID};
   int index_in_leaf_{-1};
+  Page *page_{nullptr};
   B_PLUS_TREE_LEAF_PAGE_TYPE *leaf_page_{nullptr};
+  MappingType item_{};
   BufferPoolManager *buffer_pool_manager_{nullptr};
+  const KeyComparator *comparator_{nullptr};
+  std::function<Page *(const KeyType &)> find_leaf_;
+  bool reverse_{false};
+  bool has_upper_{false};
+  bool upper_inclusive_{true};
+  KeyType upper_{};
 };
 
 }  // namespace bustub
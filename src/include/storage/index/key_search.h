@@ -0,0 +1,52 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// key_search.h
+//
+// Identification: src/include/storage/index/key_search.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "storage/index/generic_key.h"
+
+namespace bustub {
+
+/**
+ * Find the first of size sorted keys that is not below key.
+ * @return its index, size if every key is below key
+ */
+template <typename KeyType, typename KeyComparator>
+int KeyLowerBound(const KeyType *keys, int size, const KeyType &key, const KeyComparator &comparator) {
+  int l = 0;
+  int r = size;
+  while (l < r) {
+    int m = (l + r) >> 1;
+    if (comparator(keys[m], key) < 0) {
+      l = m + 1;
+    } else {
+      r = m;
+    }
+  }
+  return l;
+}
+
+/*
+ * Normalized keys of 8 and 4 bytes order like big-endian integers (see GenericKey). These overloads narrow the range
+ * with a binary search and then compare the key with 4 or 8 keys at a time in AVX2 registers, counting the keys below
+ * it from the comparison mask. Without AVX2 at runtime they are the binary search above.
+ */
+int KeyLowerBound(const GenericKey<8> *keys, int size, const GenericKey<8> &key, const GenericComparator<8> &comparator);
+int KeyLowerBound(const GenericKey<4> *keys, int size, const GenericKey<4> &key, const GenericComparator<4> &comparator);
+
+/** Turn the SIMD search off and on again, to compare the two. It is on by default where the CPU supports it. */
+void SetSimdKeySearch(bool enable);
+
+/** @return whether KeyLowerBound searches with SIMD instructions */
+bool IsSimdKeySearchEnabled();
+
+}  // namespace bustub
@@ -0,0 +1,143 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// var_b_plus_tree.h
+//
+// Identification: src/include/storage/index/var_b_plus_tree.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/rwlatch.h"
+#include "concurrency/transaction.h"
+#include "storage/index/var_index_iterator.h"
+#include "storage/page/var_b_plus_tree_page.h"
+
+namespace bustub {
+
+/**
+ * B+ tree of variable-length keys, for indexes whose keys vary in length like those on VARCHAR columns.
+ *
+ * BPlusTree gives every key the bytes of its KeyType, so an index on strings needs GenericKey<64> and most of every
+ * entry is padding. Here a key takes the bytes of its encoding in slotted pages (see VarBPlusTreePage), and a page
+ * holds as many entries as fit. Separators pushed up from the leaves are cut to the bytes that tell the two leaves
+ * apart.
+ *
+ * (1) A unique tree rejects a key it has. A tree with duplicate keys keeps the RIDs of a key in one leaf entry, in
+ *     order, and moves them to a list of overflow pages (see VarPostingPage) once they take more than
+ *     POSTING_INLINE_SIZE bytes, so that a lookup reads one leaf for all but the hottest keys.
+ * (2) A page splits when an entry does not fit, in halves by bytes. An insert at the end of the last page of a level
+ *     splits off the new entry alone, so that keys inserted in order fill their pages.
+ * (3) A page is freed when it empties, pages that are less than half full are not merged. The root goes away once it
+ *     has a single child.
+ * (4) Writers latch the whole tree, readers share it. Pages have no parent page ids, writers remember the path down.
+ * (5) The tree writes no log records, recovery does not know it. Open attaches to a tree that was shut down cleanly,
+ *     a persistent catalog does not reopen its VarKey indexes but builds them again from their tables.
+ */
+class VarBPlusTree {
+  using LeafPage = VarBPlusTreePage<RID>;
+  using InternalPage = VarBPlusTreePage<page_id_t>;
+
+ public:
+  // the RIDs a leaf entry keeps before they move to overflow pages, in bytes
+  static constexpr size_t POSTING_INLINE_SIZE = PAGE_SIZE / 8;
+
+  // a tree of duplicate keys if unique is false
+  VarBPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, bool unique = true);
+
+  // attach to the tree of this name on disk, see BPlusTree::Open
+  bool Open();
+
+  // Returns true if this B+ tree has no keys and values.
+  bool IsEmpty() const;
+
+  // Insert a key-value pair into this B+ tree, false if the pair (or the key of a unique tree) is there already.
+  bool Insert(const VarKey &key, const RID &value, Transaction *transaction = nullptr);
+
+  // Build an empty tree from entries in key order, false if the tree is not empty. Entries in order only ever split
+  // off the last page of a level, the pages are filled.
+  bool BulkLoad(const std::function<bool(std::pair<VarKey, RID> *)> &next);
+
+  // Remove a key and its values from this B+ tree.
+  void Remove(const VarKey &key, Transaction *transaction = nullptr);
+  // Remove a value of key, and key once it has no value left.
+  void Remove(const VarKey &key, const RID &value, Transaction *transaction = nullptr);
+
+  // return the values associated with a given key
+  bool GetValue(const VarKey &key, std::vector<RID> *result, Transaction *transaction = nullptr);
+
+  // index iterator
+  VarIndexIterator begin();
+  VarIndexIterator Begin(const VarKey &key);
+  VarIndexIterator end();
+
+  /**
+   * Copy the entries of the first leaf that has entries after key (or at it if inclusive) into entries, from the
+   * first one after key on, see VarIndexIterator. entries stays empty past the last key.
+   * @param key nullptr for the first leaf of the tree
+   */
+  void ScanLeaf(const VarKey *key, bool inclusive, std::vector<std::pair<VarKey, RID>> *entries);
+
+ private:
+  // the leaf of key, or the first leaf if key is nullptr, pinned. The internal pages on the way go to path.
+  Page *FindLeafPage(const VarKey *key, std::vector<page_id_t> *path);
+
+  // a new page, pinned, or an out of memory exception
+  Page *AllocatePage(page_id_t *page_id);
+
+  // put an entry into the leaf at index, splitting the leaf if it does not fit
+  void InsertIntoLeaf(LeafPage *leaf, int index, const VarKey &key, const RID *values, int count,
+                      std::vector<page_id_t> *path);
+
+  // add value to the RIDs of the entry at index, false if it is there already
+  bool InsertIntoPosting(LeafPage *leaf, int index, const RID &value, std::vector<page_id_t> *path);
+
+  // split the full node to insert an entry of key and count values at index. Return the new page right of node, and
+  // in separator the key it starts from.
+  template <typename N, typename V>
+  page_id_t Split(N *node, int index, const VarKey &key, const V *values, int count, VarKey *separator);
+
+  void InsertIntoParent(std::vector<page_id_t> *path, page_id_t old_page_id, const VarKey &key,
+                        page_id_t new_page_id);
+
+  // remove the entry at index of the pinned leaf and unpin it, freeing what empties
+  void RemoveFromLeaf(LeafPage *leaf, int index, std::vector<page_id_t> *path);
+
+  // unlink and free the pinned node that emptied, and remove it from its parent
+  template <typename N>
+  void FreePage(N *node, std::vector<page_id_t> *path);
+
+  // an internal root with a single child gives way to it
+  void AdjustRoot();
+
+  void UpdateRootPageId();
+
+  // the overflow pages of a posting list, see VarPostingPage
+  page_id_t CreatePostingList(const std::vector<RID> &values);
+  void ReadPostingList(page_id_t page_id, std::vector<RID> *values);
+  bool InsertIntoPostingList(page_id_t page_id, const RID &value);
+  // the first page changes to INVALID_PAGE_ID when the list empties
+  bool RemoveFromPostingList(page_id_t *page_id, const RID &value);
+  void FreePostingList(page_id_t page_id);
+  // all values of the entry at index
+  void GetValues(const LeafPage *leaf, int index, std::vector<RID> *values);
+
+  // member variable
+  std::string index_name_;
+  page_id_t root_page_id_;
+  BufferPoolManager *buffer_pool_manager_;
+  bool unique_;
+  ReaderWriterLatch latch_;
+};
+
+}  // namespace bustub
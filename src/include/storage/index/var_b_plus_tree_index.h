@@ -0,0 +1,58 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// var_b_plus_tree_index.h
+//
+// Identification: src/include/storage/index/var_b_plus_tree_index.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "recovery/log_manager.h"
+#include "storage/index/index.h"
+#include "storage/index/var_b_plus_tree.h"
+
+namespace bustub {
+
+/**
+ * Index over a VarBPlusTree, for keys whose encodings vary in length or repeat. Catalog::CreateIndex picks it for
+ * VarKey.
+ */
+class VarBPlusTreeIndex : public Index {
+ public:
+  // the tree writes no log records, log_manager is only there to match BPlusTreeIndex
+  VarBPlusTreeIndex(IndexMetadata *metadata, BufferPoolManager *buffer_pool_manager, LogManager *log_manager = nullptr,
+                    bool unique = true);
+
+  // attach to the tree this index left on disk when it was shut down cleanly, see VarBPlusTree::Open
+  bool Open() { return container_.Open(); }
+
+  void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  // build the empty index from entries in key order, see VarBPlusTree::BulkLoad
+  bool BulkLoad(const std::function<bool(std::pair<VarKey, RID> *)> &next) { return container_.BulkLoad(next); }
+
+  void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
+
+  VarIndexIterator GetBeginIterator();
+
+  VarIndexIterator GetBeginIterator(const VarKey &key);
+
+  VarIndexIterator GetEndIterator();
+
+ protected:
+  // container
+  VarBPlusTree container_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,60 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// var_index_iterator.h
+//
+// Identification: src/include/storage/index/var_index_iterator.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+/**
+ * var_index_iterator.h
+ * For range scan of a variable-length key b+ tree
+ */
+#pragma once
+#include <utility>
+#include <vector>
+
+#include "common/rid.h"
+#include "storage/index/var_key.h"
+
+namespace bustub {
+
+class VarBPlusTree;
+
+/**
+ * Walks the entries of a VarBPlusTree in key order. The iterator copies the entries of one leaf at a time and finds
+ * the next leaf by the last key it returned, so it holds no pin or latch between two steps and writers in between
+ * neither make it skip nor repeat entries.
+ */
+class VarIndexIterator {
+ public:
+  // the end iterator
+  VarIndexIterator() = default;
+  /**
+   * @param tree the tree to walk
+   * @param key start at the first entry not below key, at the first entry of the tree if nullptr
+   */
+  VarIndexIterator(VarBPlusTree *tree, const VarKey *key);
+
+  bool isEnd() const;
+
+  const std::pair<VarKey, RID> &operator*() const;
+
+  VarIndexIterator &operator++();
+
+  bool operator==(const VarIndexIterator &itr) const {
+    return isEnd() ? itr.isEnd() : !itr.isEnd() && (*this).entries_[index_].second == (*itr).second;
+  }
+
+  bool operator!=(const VarIndexIterator &itr) const { return !(*this == itr); }
+
+ private:
+  VarBPlusTree *tree_{nullptr};
+  std::vector<std::pair<VarKey, RID>> entries_;
+  size_t index_{0};
+};
+
+}  // namespace bustub
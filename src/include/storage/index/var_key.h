@@ -0,0 +1,105 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// var_key.h
+//
+// Identification: src/include/storage/index/var_key.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+
+#include "storage/index/generic_key.h"
+
+namespace bustub {
+
+/** The longest encoding a VarKey keeps, a longer one is truncated the way GenericKey truncates it. */
+static constexpr size_t VAR_KEY_MAX_SIZE = 256;
+
+/**
+ * Variable-length key for VarBPlusTree: the normalized encoding of GenericKey without the zero bytes it ends with.
+ *
+ * Keys are ordered as bytes and a key that is a prefix of another one is the smaller, which is the order of the zero
+ * padded GenericKeys. A VarKey is held in a buffer of the longest size so that it copies and spills like the fixed
+ * keys do (see ExternalSort), only the pages of the tree store just its bytes.
+ */
+class VarKey {
+ public:
+  inline void SetFromKey(const Tuple &tuple, const Schema *key_schema) {
+    GenericKey<VAR_KEY_MAX_SIZE> key;
+    key.SetFromKey(tuple, key_schema);
+    size_t size = VAR_KEY_MAX_SIZE;
+    while (size > 0 && key.data_[size - 1] == 0) {
+      size--;
+    }
+    SetData(key.data_, size);
+  }
+
+  inline Value ToValue(Schema *schema, uint32_t column_idx) const {
+    GenericKey<VAR_KEY_MAX_SIZE> key;
+    memset(key.data_, 0, VAR_KEY_MAX_SIZE);
+    memcpy(key.data_, data_, size_);
+    return key.ToValue(schema, column_idx);
+  }
+
+  inline void SetData(const char *data, size_t size) {
+    size_ = static_cast<uint16_t>(size);
+    memcpy(data_, data, size);
+  }
+
+  inline const char *GetData() const { return data_; }
+
+  inline size_t GetSize() const { return size_; }
+
+  /**
+   * The shortest key that separates lower < upper: upper cut after the first byte it differs from lower in.
+   * lower < separator <= upper, see GenericKey::Separator.
+   */
+  static VarKey Separator(const VarKey &lower, const VarKey &upper) {
+    size_t size = 0;
+    while (size < lower.size_ && size < upper.size_ && lower.data_[size] == upper.data_[size]) {
+      size++;
+    }
+    VarKey separator;
+    separator.SetData(upper.data_, std::min<size_t>(size + 1, upper.size_));
+    return separator;
+  }
+
+ private:
+  uint16_t size_{0};
+  char data_[VAR_KEY_MAX_SIZE];
+};
+
+/**
+ * Function object returns the order of two VarKeys, used for trees
+ */
+class VarKeyComparator {
+ public:
+  inline int operator()(const VarKey &lhs, const VarKey &rhs) const {
+    return Compare(lhs.GetData(), lhs.GetSize(), rhs.GetData(), rhs.GetSize());
+  }
+
+  /** Compare keys given as bytes, the way the pages of a VarBPlusTree hold them. */
+  static inline int Compare(const char *lhs, size_t lhs_size, const char *rhs, size_t rhs_size) {
+    int order = memcmp(lhs, rhs, std::min(lhs_size, rhs_size));
+    if (order != 0) {
+      return order < 0 ? -1 : 1;
+    }
+    return (lhs_size > rhs_size) - (lhs_size < rhs_size);
+  }
+
+  explicit VarKeyComparator(Schema *key_schema) : key_schema_(key_schema) {}
+
+  Schema *GetKeySchema() const { return key_schema_; }
+
+ private:
+  Schema *key_schema_;
+};
+
+}  // namespace bustub
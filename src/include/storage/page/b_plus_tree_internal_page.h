@@ -11,14 +11,18 @@
 #pragma once
 
 #include <queue>
+#include <type_traits>
+#include <vector>
 
 #include "storage/page/b_plus_tree_page.h"
 
 namespace bustub {
 
 #define B_PLUS_TREE_INTERNAL_PAGE_TYPE BPlusTreeInternalPage<KeyType, ValueType, KeyComparator>
-#define INTERNAL_PAGE_HEADER_SIZE 24
-#define INTERNAL_PAGE_SIZE ((PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE) / (sizeof(MappingType)))
+#define INTERNAL_PAGE_HEADER_SIZE (36 + 2 * sizeof(KeyType))
+#define INTERNAL_SLOT_SIZE (sizeof(page_id_t) + 2 * sizeof(uint16_t))
+// as many entries as fit if every key compresses away, the bytes the keys take end up being the limit
+#define INTERNAL_PAGE_SIZE ((PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE) / INTERNAL_SLOT_SIZE - 1)
 /**
  * Store n indexed keys and n+1 child pointers (page_id) within internal page.
  * Pointer PAGE_ID(i) points to a subtree in which all keys K satisfy:
@@ -28,12 +32,44 @@ namespace bustub {
  * should ignore the first key.
  *
  * Internal page format (keys are stored in increasing order):
- *  --------------------------------------------------------------------------
- * | HEADER | KEY(1)+PAGE_ID(1) | KEY(2)+PAGE_ID(2) | ... | KEY(n)+PAGE_ID(n) |
- *  --------------------------------------------------------------------------
+ *  ------------------------------------------------------------------------------
+ * | HEADER | SLOT(0) | SLOT(1) | ... | SLOT(n) | KEY(0) | KEY(1) | ... | KEY(n) |
+ *  ------------------------------------------------------------------------------
+ *
+ * A slot is the child page id and where its key is among the keys (size in byte, 8 in total):
+ *  ------------------------------------
+ * | PageId (4) | Offset (2) | Size (2) |
+ *  ------------------------------------
+ *
+ * Keys are compressed and variable-length. Every key of the page lies between the fences, so they all share the
+ * prefix the two fences share. It is stored once, as part of LowKey, and a key keeps only the bytes after it. Pages
+ * without both fences, the root and the ones along the edges of the tree, have no prefix: a key they may yet get could
+ * make it shorter and every key longer. The zero bytes a key ends with are dropped from every page, which the
+ * separators made by GenericKey::Separator have many of.
+ * KEY(0) only matters while it moves up after a split and is kept whole. Comparing a key with the stored ones is
+ * then a memcmp of the bytes after the prefix, the order GenericComparator has for normalized keys.
+ *
+ * Header format (size in byte, 36 bytes plus two keys in total):
+ *  ---------------------------------------------------------------------
+ * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
+ *  ---------------------------------------------------------------------
+ *  ----------------------------------------------------------------------------------------------------
+ * | ParentPageId (4) | PageId (4) | NextPageId (4) | Flags (4) | LowKey | HighKey | PrefixSize (4) |
+ *  ----------------------------------------------------------------------------------------------------
+ *
+ * NextPageId, Flags and the fence keys make the B-link tree, see BPlusTreeLeafPage.
+ *
+ * A page is full when it has MaxSize entries or its keys take up the page, whichever comes first. Its used bytes are
+ * kept at most GetSizeLimit(), so that one more entry or a key replaced by a longer one always fits.
+ * An entry whose key has the prefix is inserted, removed or replaced in place. Any other change, and a change of the
+ * fences, rewrites the page from its decoded entries.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeInternalPage : public BPlusTreePage {
+  static_assert(std::is_same_v<KeyType, GenericKey<sizeof(KeyType)>> &&
+                    std::is_same_v<KeyComparator, GenericComparator<sizeof(KeyType)>>,
+                "the keys are compressed and compared as bytes, which only GenericComparator orders them by");
+
  public:
   // must call initialize method after "create" a new node
   void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int max_size = INTERNAL_PAGE_SIZE);
@@ -43,9 +79,33 @@ class BPlusTreeInternalPage : public BPlusTreePage {
   int ValueIndex(const ValueType &value) const;
   ValueType ValueAt(int index) const;
 
+  // B-link right-link and fences, see BPlusTreeLeafPage. Setting a fence recompresses the keys.
+  page_id_t GetNextPageId() const;
+  void SetNextPageId(page_id_t next_page_id);
+  const KeyType *GetLowKey() const;
+  void SetLowKey(const KeyType *low_key);
+  const KeyType *GetHighKey() const;
+  void SetHighKey(const KeyType *high_key);
+  int CompareToFences(const KeyType &key, const KeyComparator &comparator) const;
+  bool IsDeleted() const;
+  void SetDeleted();
+
+  // how full the page is, by entries and by bytes
+  size_t GetUsedSize() const;
+  static size_t GetSizeLimit();
+  static size_t EncodedSize(const MappingType *items, int size, const KeyType *low_key, const KeyType *high_key);
+  bool IsOverflowing() const;
+  bool IsUnderflowing() const;
+  bool IsSafeToInsert() const;
+  bool IsSafeToRemove() const;
+  bool CanSetKeyAt(int index, const KeyType &key) const;
+  bool CanMerge(const BPlusTreeInternalPage *right, const KeyType &middle_key) const;
+  bool CanTakeFrom(const BPlusTreeInternalPage *sibling, const KeyType &middle_key, const KeyType &separator) const;
+
   ValueType Lookup(const KeyType &key, const KeyComparator &comparator) const;
   void InsertAt(int index, const KeyType &new_key, const ValueType &new_value);
   void PopulateNewRoot(const ValueType &old_value, const KeyType &new_key, const ValueType &new_value);
+  void PopulateFrom(const MappingType *items, int size);
   int InsertNodeAfter(const ValueType &old_value, const KeyType &new_key, const ValueType &new_value);
   void Remove(int index);
   ValueType RemoveAndReturnOnlyChild();
@@ -63,9 +123,31 @@ class BPlusTreeInternalPage : public BPlusTreePage {
   void SetParentToMe(page_id_t page_id, BufferPoolManager *buffer_pool_manager);
 
  private:
-  void CopyNFrom(MappingType *items, int size, BufferPoolManager *buffer_pool_manager);
+  struct Slot {
+    ValueType value_;
+    uint16_t offset_;
+    uint16_t size_;
+  };
+
+  // decode every entry, and write the page anew from entries with the current fences
+  std::vector<MappingType> GetEntries() const;
+  void SetEntries(const std::vector<MappingType> &entries);
+  static size_t PrefixSize(const MappingType *items, int size, const KeyType *low_key, const KeyType *high_key);
+  static size_t StoredSize(const KeyType &key, size_t prefix_size);
+  const char *KeyData(int index) const;
+  char *KeyData(int index);
+  bool HasPrefix(const KeyType &key) const;
+  void ResizeKeyAt(int index, size_t stored_size);
+  int CompareSuffix(int index, const char *suffix, size_t suffix_size) const;
+
+  void CopyNFrom(const MappingType *items, int size, BufferPoolManager *buffer_pool_manager);
   void CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager);
   void CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager);
-  MappingType array[0];
+  page_id_t next_page_id_;
+  uint32_t flags_;
+  KeyType low_key_;
+  KeyType high_key_;
+  uint32_t prefix_size_;
+  Slot slots_[0];
 };
 }  // namespace bustub
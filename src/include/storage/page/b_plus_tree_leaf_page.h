@@ -18,7 +18,7 @@
 namespace bustub {
 
 #define B_PLUS_TREE_LEAF_PAGE_TYPE BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>
-#define LEAF_PAGE_HEADER_SIZE 28
+#define LEAF_PAGE_HEADER_SIZE (36 + 2 * sizeof(KeyType))
 #define LEAF_PAGE_SIZE ((PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / sizeof(MappingType))
 
 /**
@@ -26,18 +26,26 @@ namespace bustub {
  * see include/common/rid.h for detailed implementation) together within leaf
  * page. Only support unique key.
  *
- * Leaf page format (keys are stored in order):
- *  ----------------------------------------------------------------------
- * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
- *  ----------------------------------------------------------------------
+ * Leaf page format (keys are stored in order, MaxSize slots for keys and then MaxSize slots for record ids):
+ *  ----------------------------------------------------------------------------------
+ * | HEADER | KEY(1) | KEY(2) | ... | KEY(n) | ... | RID(1) | RID(2) | ... | RID(n) |
+ *  ----------------------------------------------------------------------------------
  *
- *  Header format (size in byte, 28 bytes in total):
+ * The keys are contiguous so that a search reads only keys, several of them per cache line, and small keys can be
+ * compared several at a time, see KeyLowerBound.
+ *
+ *  Header format (size in byte, 36 bytes plus two keys in total):
  *  ---------------------------------------------------------------------
  * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
  *  ---------------------------------------------------------------------
- *  -----------------------------------------------
- * | ParentPageId (4) | PageId (4) | NextPageId (4)
- *  -----------------------------------------------
+ *  ---------------------------------------------------------------------------------------------------
+ * | ParentPageId (4) | PageId (4) | NextPageId (4) | PrePageId (4) | Flags (4) | LowKey | HighKey |
+ *  ---------------------------------------------------------------------------------------------------
+ *
+ * NextPageId is the right-link of the B-link tree, PrePageId links back to the left sibling for reverse scans. The
+ * page holds the keys in [LowKey, HighKey), Flags tell whether the fences are set (a leftmost page has no low key, a
+ * rightmost page no high key), whether the page was merged into its left sibling, and whether it has to stay allocated
+ * after that because a stale left link may point at it.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeLeafPage : public BPlusTreePage {
@@ -50,10 +58,20 @@ class BPlusTreeLeafPage : public BPlusTreePage {
   void SetNextPageId(page_id_t next_page_id);
   page_id_t GetPrePageId() const;
   void SetPrePageId(page_id_t pre_page_id);
+
+  // B-link fences, nullptr is unbounded
+  const KeyType *GetLowKey() const;
+  void SetLowKey(const KeyType *low_key);
+  const KeyType *GetHighKey() const;
+  void SetHighKey(const KeyType *high_key);
+  // -1 if key is below the low key, 1 if it is at or above the high key, 0 if the page covers it
+  int CompareToFences(const KeyType &key, const KeyComparator &comparator) const;
+  bool IsDeleted() const;
+  void SetDeleted();
   KeyType KeyAt(int index) const;
   ValueType ValueAt(int index) const;
   int KeyIndex(const KeyType &key, const KeyComparator &comparator) const;
-  const MappingType &GetItem(int index);
+  MappingType GetItem(int index) const;
 
   // insert and delete methods
   bool checkDupl(const KeyType &key, const KeyComparator &comparator);
@@ -70,11 +88,16 @@ class BPlusTreeLeafPage : public BPlusTreePage {
   void MoveLastToFrontOf(BPlusTreeLeafPage *recipient);
 
  private:
-  void CopyNFrom(MappingType *items, int size);
+  void CopyNFrom(const BPlusTreeLeafPage *page, int index, int size);
   void CopyLastFrom(const MappingType &item);
   void CopyFirstFrom(const MappingType &item);
+  ValueType *Values() { return reinterpret_cast<ValueType *>(keys_ + GetMaxSize()); }
+  const ValueType *Values() const { return reinterpret_cast<const ValueType *>(keys_ + GetMaxSize()); }
   page_id_t next_page_id_;
   page_id_t pre_page_id_;
-  MappingType array[0];
+  uint32_t flags_;
+  KeyType low_key_;
+  KeyType high_key_;
+  KeyType keys_[0];
 };
 }  // namespace bustub
@@ -27,6 +27,11 @@ namespace bustub {
 // define page type enum
 enum class IndexPageType { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE };
 
+// B-link flags of leaf and internal pages: which fence keys bound the page, and whether it was merged away
+static constexpr uint32_t BLINK_LOW_KEY = 1;
+static constexpr uint32_t BLINK_HIGH_KEY = 2;
+static constexpr uint32_t BLINK_DELETED = 4;
+
 /**
  * Both internal and leaf page are inherited from this page.
  *
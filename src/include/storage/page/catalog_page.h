@@ -0,0 +1,70 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// catalog_page.h
+//
+// Identification: src/include/storage/page/catalog_page.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstring>
+#include <vector>
+
+#include "storage/page/page.h"
+
+namespace bustub {
+
+/**
+ * CatalogPage holds the serialized table and index definitions of the Catalog. The catalog pages form a singly linked
+ * list whose first page is recorded in the header page; records are only ever appended, and a record never spans
+ * two pages.
+ *
+ * Format (size in byte):
+ *  ---------------------------------------------------------------------------------------------------------
+ * | PageId (4) | LSN (4) | NextPageId (4) | RecordCount (4) | FreeOffset (4) | Size_1 (4) | Record_1 | ... |
+ *  ---------------------------------------------------------------------------------------------------------
+ */
+class CatalogPage : public Page {
+ public:
+  /** Initialize an empty catalog page. */
+  void Init(page_id_t page_id);
+
+  page_id_t GetNextPageId();
+  void SetNextPageId(page_id_t next_page_id);
+  int GetRecordCount();
+
+  /**
+   * Append a record to this page.
+   * @param record the serialized record
+   * @return false if the page has no room left for it
+   */
+  bool InsertRecord(const std::vector<char> &record);
+
+  /**
+   * Append every record on this page to records.
+   * @param[out] records the records, in insertion order
+   */
+  void GetRecords(std::vector<std::vector<char>> *records);
+
+  /** @return the largest record a catalog page can hold */
+  static constexpr uint32_t MaxRecordSize() { return PAGE_SIZE - SIZE_CATALOG_PAGE_HEADER - sizeof(uint32_t); }
+
+ private:
+  static_assert(sizeof(page_id_t) == 4);
+
+  static constexpr size_t SIZE_CATALOG_PAGE_HEADER = 20;
+  static constexpr size_t OFFSET_NEXT_PAGE_ID = 8;
+  static constexpr size_t OFFSET_RECORD_COUNT = 12;
+  static constexpr size_t OFFSET_FREE_OFFSET = 16;
+
+  uint32_t GetFreeOffset();
+  void SetFreeOffset(uint32_t free_offset);
+  void SetRecordCount(int record_count);
+};
+
+}  // namespace bustub
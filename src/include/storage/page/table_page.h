@@ -40,6 +40,7 @@ namespace bustub {
  *  | TupleCount (4) | Tuple_1 offset (4) | Tuple_1 size (4) | ... |
  *  ----------------------------------------------------------------
  *
+ * Recovery calls the operations without a transaction, which neither locks nor logs even while logging is enabled.
  */
 class TablePage : public Page {
  public:
@@ -83,6 +84,16 @@ class TablePage : public Page {
    */
   bool InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager);
 
+  /**
+   * Insert a tuple into a given slot, e.g. to put back a tuple whose delete is undone or to redo an insert.
+   * @param tuple tuple to insert
+   * @param rid the slot to insert into, which is empty or follows the last slot
+   * @param txn transaction performing the insert, which must hold the exclusive lock on rid
+   * @param log_manager the log manager
+   * @return true if the insert is successful (i.e. the slot is free and there is enough space)
+   */
+  bool InsertTupleAt(const Tuple &tuple, const RID &rid, Transaction *txn, LogManager *log_manager);
+
   /**
    * Mark a tuple as deleted. This does not actually delete the tuple.
    * @param rid rid of the tuple to mark as deleted
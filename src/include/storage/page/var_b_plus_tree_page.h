@@ -0,0 +1,117 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// var_b_plus_tree_page.h
+//
+// Identification: src/include/storage/page/var_b_plus_tree_page.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <vector>
+
+#include "storage/index/var_key.h"
+#include "storage/page/b_plus_tree_page.h"
+
+namespace bustub {
+
+#define VAR_B_PLUS_TREE_PAGE_TYPE VarBPlusTreePage<ValueType>
+
+/**
+ * Slotted page of a VarBPlusTree, a leaf (ValueType RID) or an internal page (ValueType page_id_t).
+ *
+ * Page format (keys are stored in increasing order):
+ *  ----------------------------------------------------------------------------------------
+ * | HEADER | SLOT(0) | SLOT(1) | ... | SLOT(n-1) | FREE SPACE | CELL(k) | ... | CELL(j) |
+ *  ----------------------------------------------------------------------------------------
+ *
+ * A slot is where the cell of its entry starts, how long its key is and how many values it has (size in byte, 6 in
+ * total):
+ *  ----------------------------------------
+ * | Offset (2) | KeySize (2) | Count (2) |
+ *  ----------------------------------------
+ *
+ * A cell is the values of the entry followed by the bytes of the key. Internal pages and the leaves of a unique tree
+ * have one value per entry, a leaf of a tree with duplicate keys keeps the RIDs of a key in one cell, in order. The
+ * top bit of Count marks an entry whose values moved to overflow pages, its one value then refers to them.
+ *
+ * Cells are packed at the end of the page in no particular order, so the free space is the one gap between the slots
+ * and CellsBegin. An entry takes a slot and a cell, a page holds as many entries as their keys leave room for. The
+ * first key of an internal page is empty, like the invalid first key of BPlusTreeInternalPage.
+ *
+ * Header format (size in byte, 36 bytes in total):
+ *  ---------------------------------------------------------------------
+ * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
+ *  ---------------------------------------------------------------------
+ *  ---------------------------------------------------------------------
+ * | ParentPageId (4) | PageId (4) | NextPageId (4) | PrevPageId (4) | CellsBegin (4) |
+ *  ---------------------------------------------------------------------
+ *
+ * Pages of a level are linked both ways, so that a page that empties can be unlinked without a search.
+ */
+template <typename ValueType>
+class VarBPlusTreePage : public BPlusTreePage {
+ public:
+  // must call initialize method after "create" a new node
+  void Init(page_id_t page_id, IndexPageType page_type);
+
+  page_id_t GetNextPageId() const;
+  void SetNextPageId(page_id_t next_page_id);
+  page_id_t GetPrevPageId() const;
+  void SetPrevPageId(page_id_t prev_page_id);
+
+  VarKey KeyAt(int index) const;
+  // the i-th value of the entry at index
+  ValueType ValueAt(int index, int i = 0) const;
+  void SetValueAt(int index, const ValueType &value, int i = 0);
+  // append the values of the entry at index to values
+  void GetValues(int index, std::vector<ValueType> *values) const;
+  int ValueCount(int index) const;
+  bool IsOverflow(int index) const;
+  int ValueIndex(const ValueType &value) const;
+
+  // the first index whose key is not below key, GetSize() if there is none
+  int KeyIndex(const VarKey &key) const;
+  // the child of an internal page that holds key
+  ValueType Lookup(const VarKey &key) const;
+  // the order of the key at index and key
+  int CompareAt(int index, const VarKey &key) const;
+
+  // the bytes an entry takes, and the bytes still free
+  static size_t EntrySize(const VarKey &key, int count = 1);
+  size_t GetFreeSize() const;
+
+  // put an entry at index and return true, false if it does not fit
+  bool InsertAt(int index, const VarKey &key, const ValueType &value);
+  bool InsertAt(int index, const VarKey &key, const ValueType *values, int count, bool overflow = false);
+  void Remove(int index);
+  bool SetKeyAt(int index, const VarKey &key);
+
+  // move the upper half of the entries, by the bytes they take, to the empty recipient
+  void MoveHalfTo(VarBPlusTreePage *recipient);
+
+ private:
+  static constexpr uint16_t OVERFLOW_FLAG = 0x8000;
+
+  struct Slot {
+    uint16_t offset_;
+    uint16_t key_size_;
+    uint16_t count_;
+  };
+
+  const char *CellAt(int index) const;
+  size_t CellSize(int index) const;
+  // put the entry at index of page at index of this page, false if it does not fit
+  bool CopyEntry(int index, const VarBPlusTreePage *page, int from);
+
+  page_id_t next_page_id_;
+  page_id_t prev_page_id_;
+  uint32_t cells_begin_;
+  Slot slots_[0];
+};
+
+}  // namespace bustub
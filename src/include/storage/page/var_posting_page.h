@@ -0,0 +1,57 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// var_posting_page.h
+//
+// Identification: src/include/storage/page/var_posting_page.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "common/config.h"
+#include "common/rid.h"
+
+namespace bustub {
+
+/**
+ * Overflow page of a VarBPlusTree with duplicate keys. The RIDs of a key too hot for its leaf move to a list of these
+ * pages, in order across the list, and the leaf entry keeps RID(first page, number of RIDs) in their place.
+ *
+ * Page format (size in byte):
+ *  -------------------------------------------------------------
+ * | NextPageId (4) | Size (4) | RID(0) (8) | ... | RID(n-1) (8) |
+ *  -------------------------------------------------------------
+ */
+class VarPostingPage {
+ public:
+  void Init();
+
+  page_id_t GetNextPageId() const;
+  void SetNextPageId(page_id_t next_page_id);
+  int GetSize() const;
+  bool IsFull() const;
+  // the first index whose RID is not below rid
+  int ValueIndex(const RID &rid) const;
+  RID ValueAt(int index) const;
+
+  void InsertAt(int index, const RID &rid);
+  void Remove(int index);
+  // move the upper half of the RIDs to the empty recipient
+  void MoveHalfTo(VarPostingPage *recipient);
+
+  // the order of RIDs in posting lists
+  static bool Less(const RID &lhs, const RID &rhs) { return lhs.Get() < rhs.Get(); }
+
+  static constexpr int CAPACITY = (PAGE_SIZE - 2 * sizeof(int32_t)) / sizeof(RID);
+
+ private:
+  page_id_t next_page_id_;
+  int size_;
+  RID rids_[0];
+};
+
+}  // namespace bustub
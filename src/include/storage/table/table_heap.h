@@ -109,6 +109,9 @@ class TableHeap {
   inline page_id_t GetFirstPageId() const { return first_page_id_; }
 
  private:
+  /** Wait until no loser of the last crash holds rid, before latching its page (see LockManager::WaitForRecoveryLock) */
+  void WaitForRecovery(const RID &rid);
+
   BufferPoolManager *buffer_pool_manager_;
   LockManager *lock_manager_;
   LogManager *log_manager_;
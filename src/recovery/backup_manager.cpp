@@ -0,0 +1,166 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// backup_manager.cpp
+//
+// Identification: src/recovery/backup_manager.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "recovery/backup_manager.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/exception.h"
+
+namespace bustub {
+
+void BackupManager::ReadHeader(std::ifstream *in, const std::string &file_name, BackupInfo *info,
+                               uint32_t *log_size) {
+  uint32_t header[6];
+  in->read(reinterpret_cast<char *>(header), sizeof(header));
+  if (in->gcount() != sizeof(header) || header[0] != BACKUP_MAGIC) {
+    throw Exception("not a backup file: " + file_name);
+  }
+  info->since_lsn_ = static_cast<lsn_t>(header[1]);
+  info->start_lsn_ = static_cast<lsn_t>(header[2]);
+  info->end_lsn_ = static_cast<lsn_t>(header[3]);
+  info->page_count_ = static_cast<int>(header[4]);
+  *log_size = header[5];
+}
+
+BackupInfo BackupManager::Backup(const std::string &file_name, lsn_t since_lsn) {
+  BackupInfo info;
+  info.since_lsn_ = since_lsn;
+  // a page on disk misses at most the changes from its recLSN on, and the pages that are clean now only miss the
+  // changes made while they are copied
+  info.start_lsn_ = log_manager_->GetNextLSN();
+  for (const auto &page : buffer_pool_manager_->GetDirtyPageTable()) {
+    info.start_lsn_ = std::min(info.start_lsn_, page.second);
+  }
+  lsn_t oldest_lsn = INVALID_LSN;
+  transaction_manager_->GetActiveTransactionTable(&oldest_lsn);
+  if (oldest_lsn != INVALID_LSN) {
+    info.start_lsn_ = std::min(info.start_lsn_, oldest_lsn);
+  }
+  int log_offset = disk_manager_->FindLogOffset(info.start_lsn_);
+
+  std::ofstream out(file_name, std::ios::binary | std::ios::trunc);
+  if (!out.is_open()) {
+    throw Exception("can't open backup file " + file_name);
+  }
+  out.seekp(BACKUP_HEADER_SIZE);
+  Page page;
+  page_id_t num_pages = disk_manager_->GetNumPages();
+  for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+    disk_manager_->ReadPage(page_id, page.GetData());
+    lsn_t lsn = page.GetLSN();
+    // the header page has no LSN, and a page that was never logged can not tell whether it changed
+    if (since_lsn != INVALID_LSN && page_id != HEADER_PAGE_ID && lsn != INVALID_LSN && lsn < since_lsn) {
+      continue;
+    }
+    out.write(reinterpret_cast<const char *>(&page_id), sizeof(page_id_t));
+    out.write(page.GetData(), PAGE_SIZE);
+    info.page_count_++;
+  }
+
+  // every change a copied page can hold is in the log up to here
+  info.end_lsn_ = log_manager_->GetNextLSN();
+  if (enable_logging) {
+    log_manager_->WaitForFlush(info.end_lsn_ - 1);
+  }
+  int log_end = disk_manager_->GetLogSize();
+  uint32_t log_size = 0;
+  std::vector<char> log_data(PAGE_SIZE * 16);
+  for (int offset = log_offset; offset < log_end;) {
+    int size = std::min(static_cast<int>(log_data.size()), log_end - offset);
+    if (!disk_manager_->ReadLog(log_data.data(), size, offset)) {
+      throw Exception("the log the backup needs was recycled by a checkpoint");
+    }
+    out.write(log_data.data(), size);
+    offset += size;
+    log_size += size;
+  }
+
+  uint32_t header[6] = {BACKUP_MAGIC,
+                        static_cast<uint32_t>(info.since_lsn_),
+                        static_cast<uint32_t>(info.start_lsn_),
+                        static_cast<uint32_t>(info.end_lsn_),
+                        static_cast<uint32_t>(info.page_count_),
+                        log_size};
+  out.seekp(0);
+  out.write(reinterpret_cast<const char *>(header), sizeof(header));
+  out.close();
+  if (out.bad()) {
+    throw Exception("I/O error while writing backup file " + file_name);
+  }
+  return info;
+}
+
+BackupInfo BackupManager::ReadBackupInfo(const std::string &file_name) {
+  std::ifstream in(file_name, std::ios::binary);
+  if (!in.is_open()) {
+    throw Exception("can't open backup file " + file_name);
+  }
+  BackupInfo info;
+  uint32_t log_size;
+  ReadHeader(&in, file_name, &info, &log_size);
+  return info;
+}
+
+BackupInfo BackupManager::Restore(const std::vector<std::string> &file_names, DiskManager *disk_manager) {
+  // check the whole chain before the db file is touched
+  std::vector<BackupInfo> infos;
+  for (const auto &file_name : file_names) {
+    infos.push_back(ReadBackupInfo(file_name));
+    const BackupInfo &info = infos.back();
+    if (infos.size() == 1 && info.since_lsn_ != INVALID_LSN) {
+      throw Exception(file_name + " is an incremental backup, restoring has to start with a full backup");
+    }
+    // pages that changed between the previous backup and since_lsn would be missing
+    if (infos.size() > 1 && (info.since_lsn_ == INVALID_LSN || info.since_lsn_ > infos[infos.size() - 2].start_lsn_)) {
+      throw Exception(file_name + " does not apply on top of the backup before it");
+    }
+  }
+  if (infos.empty()) {
+    throw Exception("nothing to restore");
+  }
+
+  char data[PAGE_SIZE];
+  uint32_t log_size = 0;
+  for (size_t i = 0; i < file_names.size(); i++) {
+    const std::string &file_name = file_names[i];
+    std::ifstream in(file_name, std::ios::binary);
+    BackupInfo info;
+    ReadHeader(&in, file_name, &info, &log_size);
+    for (int i = 0; i < info.page_count_; i++) {
+      page_id_t page_id;
+      in.read(reinterpret_cast<char *>(&page_id), sizeof(page_id_t));
+      in.read(data, PAGE_SIZE);
+      if (in.gcount() != PAGE_SIZE) {
+        throw Exception("backup file " + file_name + " is truncated");
+      }
+      disk_manager->ReservePageIds(page_id + 1);
+      disk_manager->WritePage(page_id, data);
+    }
+
+    // only the log of the last backup is needed, it starts at or before the logs of the others end
+    if (i + 1 == file_names.size() && disk_manager->GetLogSize() == 0 && log_size > 0) {
+      auto log_data = std::make_unique<char[]>(log_size);
+      in.read(log_data.get(), log_size);
+      if (in.gcount() != static_cast<std::streamsize>(log_size)) {
+        throw Exception("backup file " + file_name + " is truncated");
+      }
+      disk_manager->WriteLog(log_data.get(), static_cast<int>(log_size));
+    }
+  }
+  return infos.back();
+}
+
+}  // namespace bustub
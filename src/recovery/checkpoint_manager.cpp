@@ -12,16 +12,132 @@
 
 #include "recovery/checkpoint_manager.h"
 
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <utility>
+#include <vector>
+
 namespace bustub {
 
+CheckpointManager::~CheckpointManager() {
+  {
+    std::scoped_lock<std::mutex> lock(latch_);
+    shutdown_ = true;
+  }
+  cv_.notify_all();
+  if (write_back_thread_.joinable()) {
+    write_back_thread_.join();
+  }
+}
+
 void CheckpointManager::BeginCheckpoint() {
   // Block all the transactions and ensure that both the WAL and all dirty buffer pool pages are persisted to disk,
   // creating a consistent checkpoint. Do NOT allow transactions to resume at the end of this method, resume them
   // in CheckpointManager::EndCheckpoint() instead. This is for grading purposes.
+  transaction_manager_->BlockAllTransactions();
+  // flushing a page flushes the log up to its LSN first
+  buffer_pool_manager_->FlushAllPages();
+  if (enable_logging) {
+    // Blocking waits for every running transaction to finish, so there are no active transactions to record, and
+    // the dirty page table is empty unless someone dirtied a page outside of a transaction.
+    LogRecord begin_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::BEGIN_CHECKPOINT);
+    lsn_t begin_lsn = log_manager_->AppendLogRecord(&begin_record);
+    std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+    for (const auto &page : buffer_pool_manager_->GetDirtyPageTable()) {
+      dirty_pages.emplace_back(page);
+    }
+    lsn_t keep_lsn = OldestRecLSN(dirty_pages, begin_lsn);
+    LogRecord end_record(begin_lsn, {}, std::move(dirty_pages));
+    log_manager_->WaitForFlush(log_manager_->AppendLogRecord(&end_record));
+    log_manager_->SetCheckpoint(begin_lsn, begin_lsn, keep_lsn);
+  }
 }
 
 void CheckpointManager::EndCheckpoint() {
   // Allow transactions to resume, completing the checkpoint.
+  transaction_manager_->ResumeTransactions();
+}
+
+void CheckpointManager::FuzzyCheckpoint() {
+  lsn_t begin_lsn = INVALID_LSN;
+  if (enable_logging) {
+    LogRecord begin_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::BEGIN_CHECKPOINT);
+    begin_lsn = log_manager_->AppendLogRecord(&begin_record);
+  }
+  // Both tables are taken after the BEGIN_CHECKPOINT, whatever changes while they are being taken is logged after it
+  // and analysis merges it in.
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+  for (const auto &page : buffer_pool_manager_->GetDirtyPageTable()) {
+    dirty_pages.emplace_back(page);
+  }
+  std::vector<page_id_t> page_ids;
+  for (const auto &page : dirty_pages) {
+    page_ids.push_back(page.first);
+  }
+  if (enable_logging) {
+    // analysis has to see every record of the running transactions, some may be older than the BEGIN_CHECKPOINT
+    lsn_t oldest_lsn;
+    auto active_txns = transaction_manager_->GetActiveTransactionTable(&oldest_lsn);
+    lsn_t analysis_lsn = oldest_lsn == INVALID_LSN ? begin_lsn : std::min(begin_lsn, oldest_lsn);
+    lsn_t keep_lsn = OldestRecLSN(dirty_pages, analysis_lsn);
+    LogRecord end_record(begin_lsn, std::move(active_txns), std::move(dirty_pages));
+    log_manager_->WaitForFlush(log_manager_->AppendLogRecord(&end_record));
+    log_manager_->SetCheckpoint(begin_lsn, analysis_lsn, keep_lsn);
+  }
+
+  // in page id order, so that the writes are as sequential as the db file allows
+  std::sort(page_ids.begin(), page_ids.end());
+  std::scoped_lock<std::mutex> lock(latch_);
+  write_back_queue_.insert(write_back_queue_.end(), page_ids.begin(), page_ids.end());
+  if (!write_back_thread_.joinable()) {
+    write_back_thread_ = std::thread(&CheckpointManager::WriteBackPages, this);
+  }
+  cv_.notify_all();
+}
+
+lsn_t CheckpointManager::OldestRecLSN(const std::vector<std::pair<page_id_t, lsn_t>> &dirty_pages, lsn_t lsn) {
+  for (const auto &page : dirty_pages) {
+    lsn = std::min(lsn, page.second);
+  }
+  return lsn;
+}
+
+void CheckpointManager::SetWriteRate(size_t pages_per_second) {
+  std::scoped_lock<std::mutex> lock(latch_);
+  write_rate_ = pages_per_second;
+}
+
+void CheckpointManager::WaitForWriteBack() {
+  std::unique_lock<std::mutex> lock(latch_);
+  cv_.wait(lock, [this] { return write_back_queue_.empty() && !writing_; });
+}
+
+void CheckpointManager::WriteBackPages() {
+  std::unique_lock<std::mutex> lock(latch_);
+  auto next_write = std::chrono::steady_clock::now();
+  while (!shutdown_) {
+    if (write_back_queue_.empty()) {
+      cv_.wait(lock, [this] { return shutdown_ || !write_back_queue_.empty(); });
+      // time spent idle does not allow a burst afterwards
+      next_write = std::max(next_write, std::chrono::steady_clock::now());
+      continue;
+    }
+    if (write_rate_ > 0 && cv_.wait_until(lock, next_write, [this] { return shutdown_; })) {
+      break;
+    }
+    page_id_t page_id = write_back_queue_.front();
+    write_back_queue_.pop_front();
+    writing_ = true;
+    lock.unlock();
+    // the page may have been written or evicted since the checkpoint, then there is nothing to do
+    buffer_pool_manager_->WriteBackPage(page_id);
+    lock.lock();
+    writing_ = false;
+    if (write_rate_ > 0) {
+      next_write += std::chrono::microseconds(1000000 / write_rate_);
+    }
+    cv_.notify_all();
+  }
 }
 
 }  // namespace bustub
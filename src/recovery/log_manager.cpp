@@ -22,33 +22,288 @@ namespace bustub {
  *
  * This thread runs forever until system shutdown/StopFlushThread
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread() {
+  if (flush_thread_ != nullptr) {
+    return;
+  }
+  enable_logging = true;
+  flush_thread_ = new std::thread([this] {
+    std::unique_lock<std::mutex> lock(latch_);
+    while (enable_logging) {
+      if (async_commit_pending_) {
+        cv_.wait_for(lock, async_commit_window, [this] { return flush_requested_ || !enable_logging; });
+      } else {
+        cv_.wait_for(lock, log_timeout,
+                     [this] { return flush_requested_ || !enable_logging || async_commit_pending_; });
+        if (async_commit_pending_ && !flush_requested_ && enable_logging) {
+          // an asynchronous commit showed up, start its window
+          continue;
+        }
+      }
+      // everything appended before this point goes out with this flush
+      async_commit_pending_ = false;
+      FlushLogBuffer(&lock);
+    }
+  });
+}
 
 /*
  * Stop and join the flush thread, set enable_logging = false
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  if (flush_thread_ == nullptr) {
+    return;
+  }
+  {
+    std::scoped_lock<std::mutex> lock(latch_);
+    enable_logging = false;
+  }
+  cv_.notify_one();
+  flush_thread_->join();
+  delete flush_thread_;
+  flush_thread_ = nullptr;
+  // write out whatever was appended while the thread was shutting down
+  std::unique_lock<std::mutex> lock(latch_);
+  async_commit_pending_ = false;
+  FlushLogBuffer(&lock);
+}
+
+/*
+ * Seal the buffer, wait for the appenders that already reserved space in it, swap the buffers and write the full one
+ * out. latch_ is released during the write so that waiters can be woken up; flushing_ keeps a second flush from
+ * starting in the meantime.
+ */
+void LogManager::FlushLogBuffer(std::unique_lock<std::mutex> *lock) {
+  flushed_cv_.wait(*lock, [this] { return !flushing_; });
+  flush_requested_ = false;
+  uint64_t state = buffer_state_.load();
+  do {
+    if (OffsetOf(state) == 0) {
+      flushed_cv_.notify_all();
+      return;
+    }
+  } while (!buffer_state_.compare_exchange_weak(state, state | BUFFER_SEALED));
+
+  // nobody can reserve space now, wait until the reserved space is filled
+  int flush_size = OffsetOf(state);
+  while (log_buffer_filled_.load() != flush_size) {
+    std::this_thread::yield();
+  }
+  char *full_buffer = log_buffer_.load();
+  log_buffer_ = flush_buffer_;
+  flush_buffer_ = full_buffer;
+  log_buffer_filled_ = 0;
+  // the last record in the buffer is the one right before the next lsn
+  lsn_t flush_lsn = LsnOf(state) - 1;
+  buffer_state_ = MakeState(LsnOf(state), 0);
+  flushing_ = true;
+  // appenders waiting for room can go on now
+  flushed_cv_.notify_all();
+
+  lock->unlock();
+  IndexSegments(flush_size);
+  disk_manager_->WriteLog(flush_buffer_, flush_size);
+  lock->lock();
+
+  persistent_lsn_ = flush_lsn;
+  flushing_ = false;
+  flushed_cv_.notify_all();
+}
+
+/*
+ * Walking the records is only needed when the write reaches into a segment that does not have a record yet.
+ */
+void LogManager::IndexSegments(int flush_size) {
+  int log_end = disk_manager_->GetLogSize();
+  int segment_size = disk_manager_->GetLogSegmentSize();
+  if (log_end % segment_size != 0 && log_end / segment_size == (log_end + flush_size - 1) / segment_size) {
+    return;
+  }
+  int pos = 0;
+  while (pos < flush_size) {
+    int32_t size;
+    lsn_t lsn;
+    memcpy(&size, flush_buffer_ + pos, sizeof(int32_t));
+    memcpy(&lsn, flush_buffer_ + pos + sizeof(int32_t), sizeof(lsn_t));
+    disk_manager_->IndexLogRecord(lsn, log_end + pos);
+    pos += size;
+  }
+}
+
+void LogManager::SetCheckpoint(lsn_t checkpoint_lsn, lsn_t analysis_lsn, lsn_t keep_lsn) {
+  disk_manager_->SetLogCheckpoint(checkpoint_lsn, analysis_lsn, keep_lsn);
+}
+
+/*
+ * Block until lsn is persistent. Without a flush thread the caller writes the log out itself.
+ */
+void LogManager::WaitForFlush(lsn_t lsn) {
+  std::unique_lock<std::mutex> lock(latch_);
+  // anything else, e.g. a page that was never logged, has nothing to wait for
+  if (lsn == INVALID_LSN || lsn >= GetNextLSN()) {
+    return;
+  }
+  while (persistent_lsn_ < lsn) {
+    if (flush_thread_ == nullptr) {
+      FlushLogBuffer(&lock);
+      continue;
+    }
+    flush_requested_ = true;
+    cv_.notify_one();
+    flushed_cv_.wait(lock);
+  }
+}
+
+/*
+ * Only the first asynchronous commit of a window takes latch_, to wake the flush thread up without missing it.
+ * Without a flush thread nobody would write the commit out within the window, so the caller does it right away.
+ */
+void LogManager::NotifyAsyncCommit() {
+  if (async_commit_pending_) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(latch_);
+  if (flush_thread_ == nullptr) {
+    FlushLogBuffer(&lock);
+    return;
+  }
+  async_commit_pending_ = true;
+  cv_.notify_one();
+}
 
 /*
  * append a log record into log buffer
  * you MUST set the log record's lsn within this method
  * @return: lsn that is assigned to this log record
  *
- *
- * example below
- * // First, serialize the must have fields(20 bytes in total)
- * log_record.lsn_ = next_lsn_++;
- * memcpy(log_buffer_ + offset_, &log_record, 20);
- * int pos = offset_ + 20;
- *
- * if (log_record.log_record_type_ == LogRecordType::INSERT) {
- *    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
- *    pos += sizeof(RID);
- *    // we have provided serialize function for tuple class
- *    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
- *  }
- *
+ * The lsn and the space in the buffer are reserved together with a compare-and-swap, then the record is serialized
+ * without holding any latch. Only when the buffer is full or sealed does the appender block on latch_ until the
+ * flusher has swapped the buffers.
+ */
+lsn_t LogManager::AppendLogRecord(LogRecord *log_record) {
+  int size = log_record->size_;
+  uint64_t state = buffer_state_.load();
+  while (true) {
+    if ((state & BUFFER_SEALED) == 0 && OffsetOf(state) + size <= LOG_BUFFER_SIZE) {
+      if (buffer_state_.compare_exchange_weak(state, MakeState(LsnOf(state) + 1, OffsetOf(state) + size))) {
+        break;
+      }
+      continue;
+    }
+    // slow path, the state only changes back to usable under latch_ so the wakeup can not be missed
+    std::unique_lock<std::mutex> lock(latch_);
+    state = buffer_state_.load();
+    if ((state & BUFFER_SEALED) == 0 && OffsetOf(state) + size <= LOG_BUFFER_SIZE) {
+      continue;
+    }
+    if (flush_thread_ == nullptr) {
+      FlushLogBuffer(&lock);
+    } else {
+      flush_requested_ = true;
+      cv_.notify_one();
+      flushed_cv_.wait(lock);
+    }
+    state = buffer_state_.load();
+  }
+
+  log_record->lsn_ = LsnOf(state);
+  // the buffer can not be swapped before this record is counted in log_buffer_filled_
+  SerializeLogRecord(*log_record, log_buffer_.load() + OffsetOf(state));
+  log_buffer_filled_ += size;
+  return log_record->lsn_;
+}
+
+/*
+ * First the must have fields (20 bytes in total), then the body of the record type, see log_record.h
  */
-lsn_t LogManager::AppendLogRecord(LogRecord *log_record) { return INVALID_LSN; }
+void LogManager::SerializeLogRecord(const LogRecord &log_record, char *dest) {
+  memcpy(dest, &log_record, LogRecord::HEADER_SIZE);
+  int pos = LogRecord::HEADER_SIZE;
+
+  switch (log_record.log_record_type_) {
+    case LogRecordType::INSERT:
+      memcpy(dest + pos, &log_record.insert_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record.insert_tuple_.SerializeTo(dest + pos);
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(dest + pos, &log_record.delete_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record.delete_tuple_.SerializeTo(dest + pos);
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(dest + pos, &log_record.update_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record.old_tuple_.SerializeTo(dest + pos);
+      pos += sizeof(int32_t) + log_record.old_tuple_.GetLength();
+      log_record.new_tuple_.SerializeTo(dest + pos);
+      break;
+    case LogRecordType::DELTAUPDATE: {
+      memcpy(dest + pos, &log_record.update_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      auto delta_size = static_cast<int32_t>(log_record.delta_.size());
+      memcpy(dest + pos, &delta_size, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      memcpy(dest + pos, log_record.delta_.data(), delta_size);
+      break;
+    }
+    case LogRecordType::NEWPAGE:
+      memcpy(dest + pos, &log_record.prev_page_id_, sizeof(page_id_t));
+      pos += sizeof(page_id_t);
+      memcpy(dest + pos, &log_record.page_id_, sizeof(page_id_t));
+      break;
+    case LogRecordType::END_CHECKPOINT: {
+      auto txn_count = static_cast<int32_t>(log_record.active_txns_.size());
+      memcpy(dest + pos, &txn_count, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      for (const auto &txn : log_record.active_txns_) {
+        memcpy(dest + pos, &txn.first, sizeof(txn_id_t));
+        memcpy(dest + pos + sizeof(txn_id_t), &txn.second, sizeof(lsn_t));
+        pos += sizeof(txn_id_t) + sizeof(lsn_t);
+      }
+      auto page_count = static_cast<int32_t>(log_record.dirty_pages_.size());
+      memcpy(dest + pos, &page_count, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      for (const auto &page : log_record.dirty_pages_) {
+        memcpy(dest + pos, &page.first, sizeof(page_id_t));
+        memcpy(dest + pos + sizeof(page_id_t), &page.second, sizeof(lsn_t));
+        pos += sizeof(page_id_t) + sizeof(lsn_t);
+      }
+      break;
+    }
+    case LogRecordType::BTREEINSERT:
+    case LogRecordType::BTREEDELETE: {
+      memcpy(dest + pos, &log_record.page_id_, sizeof(page_id_t));
+      memcpy(dest + pos + 4, &log_record.index_slot_, sizeof(int32_t));
+      memcpy(dest + pos + 8, &log_record.index_offset_, sizeof(int32_t));
+      memcpy(dest + pos + 12, &log_record.index_key_size_, sizeof(int32_t));
+      pos += 4 * sizeof(int32_t);
+      auto name_size = static_cast<int32_t>(log_record.index_name_.size());
+      memcpy(dest + pos, &name_size, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      memcpy(dest + pos, log_record.index_name_.data(), name_size);
+      pos += name_size;
+      auto entry_size = static_cast<int32_t>(log_record.index_data_.size());
+      memcpy(dest + pos, &entry_size, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      memcpy(dest + pos, log_record.index_data_.data(), entry_size);
+      break;
+    }
+    case LogRecordType::BTREEWRITE: {
+      memcpy(dest + pos, &log_record.page_id_, sizeof(page_id_t));
+      memcpy(dest + pos + 4, &log_record.index_offset_, sizeof(int32_t));
+      pos += 2 * sizeof(int32_t);
+      auto data_size = static_cast<int32_t>(log_record.index_data_.size());
+      memcpy(dest + pos, &data_size, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      memcpy(dest + pos, log_record.index_data_.data(), data_size);
+      break;
+    }
+    default:
+      break;
+  }
+}
 
 }  // namespace bustub
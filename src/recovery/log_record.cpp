@@ -0,0 +1,147 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_record.cpp
+//
+// Identification: src/recovery/log_record.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "recovery/log_record.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace bustub {
+
+namespace {
+
+inline void PutUint16(std::vector<char> *out, uint16_t value) {
+  out->insert(out->end(), reinterpret_cast<const char *>(&value), reinterpret_cast<const char *>(&value) + 2);
+}
+
+inline uint16_t GetUint16(const char *data) {
+  uint16_t value;
+  memcpy(&value, data, sizeof(uint16_t));
+  return value;
+}
+
+}  // namespace
+
+/*
+ * Tuples of the same size get one range per run of changed bytes; runs closer than DELTA_RANGE_HEADER_SIZE / 2 bytes
+ * are merged since repeating the bytes in between is cheaper than another range header. Tuples that change size get
+ * a single range between the common prefix and the common suffix.
+ */
+std::vector<char> LogRecord::EncodeDelta(const Tuple &old_tuple, const Tuple &new_tuple) {
+  const char *old_data = old_tuple.GetData();
+  const char *new_data = new_tuple.GetData();
+  uint32_t old_size = old_tuple.GetLength();
+  uint32_t new_size = new_tuple.GetLength();
+  uint32_t common = std::min(old_size, new_size);
+  uint32_t prefix = 0;
+  while (prefix < common && old_data[prefix] == new_data[prefix]) {
+    prefix++;
+  }
+  uint32_t suffix = 0;
+  while (suffix < common - prefix && old_data[old_size - 1 - suffix] == new_data[new_size - 1 - suffix]) {
+    suffix++;
+  }
+
+  // (start, end) of the changed runs, in the coordinates of both tuples since only the last one may change size
+  std::vector<std::pair<uint32_t, uint32_t>> runs;
+  if (old_size != new_size) {
+    runs.emplace_back(prefix, prefix);
+  } else {
+    uint32_t pos = prefix;
+    while (pos < old_size - suffix) {
+      uint32_t start = pos;
+      uint32_t end = pos;
+      // extend the run over small gaps of equal bytes
+      for (uint32_t gap = 0; pos < old_size - suffix && gap <= DELTA_RANGE_HEADER_SIZE / 2; pos++) {
+        if (old_data[pos] != new_data[pos]) {
+          end = pos + 1;
+          gap = 0;
+        } else {
+          gap++;
+        }
+      }
+      runs.emplace_back(start, end);
+      pos = end;
+      while (pos < old_size - suffix && old_data[pos] == new_data[pos]) {
+        pos++;
+      }
+    }
+  }
+
+  std::vector<char> delta;
+  PutUint16(&delta, static_cast<uint16_t>(old_size));
+  PutUint16(&delta, static_cast<uint16_t>(new_size));
+  PutUint16(&delta, static_cast<uint16_t>(runs.size()));
+  uint32_t done = 0;
+  for (const auto &run : runs) {
+    uint32_t old_len = old_size != new_size ? old_size - suffix - run.first : run.second - run.first;
+    uint32_t new_len = old_size != new_size ? new_size - suffix - run.first : run.second - run.first;
+    PutUint16(&delta, static_cast<uint16_t>(run.first - done));
+    PutUint16(&delta, static_cast<uint16_t>(old_len));
+    PutUint16(&delta, static_cast<uint16_t>(new_len));
+    delta.insert(delta.end(), old_data + run.first, old_data + run.first + old_len);
+    delta.insert(delta.end(), new_data + run.first, new_data + run.first + new_len);
+    done = run.first + old_len;
+  }
+  return delta;
+}
+
+bool LogRecord::ApplyDelta(const Tuple &tuple, Tuple *result, bool undo) const {
+  const char *delta = delta_.data();
+  auto delta_size = static_cast<uint32_t>(delta_.size());
+  if (delta_size < DELTA_HEADER_SIZE) {
+    return false;
+  }
+  uint32_t from_size = GetUint16(delta + (undo ? 2 : 0));
+  uint32_t to_size = GetUint16(delta + (undo ? 0 : 2));
+  uint32_t count = GetUint16(delta + 4);
+  if (tuple.GetLength() != from_size) {
+    return false;
+  }
+
+  // the result in the serialized form of a tuple, its size followed by its data
+  std::vector<char> out(sizeof(uint32_t) + to_size);
+  memcpy(out.data(), &to_size, sizeof(uint32_t));
+  char *to = out.data() + sizeof(uint32_t);
+  const char *from = tuple.GetData();
+  uint32_t from_pos = 0;
+  uint32_t to_pos = 0;
+  uint32_t pos = DELTA_HEADER_SIZE;
+  for (uint32_t i = 0; i < count; i++) {
+    if (pos + DELTA_RANGE_HEADER_SIZE > delta_size) {
+      return false;
+    }
+    uint32_t skip = GetUint16(delta + pos);
+    uint32_t old_len = GetUint16(delta + pos + 2);
+    uint32_t new_len = GetUint16(delta + pos + 4);
+    pos += DELTA_RANGE_HEADER_SIZE;
+    uint32_t from_len = undo ? new_len : old_len;
+    uint32_t to_len = undo ? old_len : new_len;
+    if (pos + old_len + new_len > delta_size || from_pos + skip + from_len > from_size ||
+        to_pos + skip + to_len > to_size) {
+      return false;
+    }
+    memcpy(to + to_pos, from + from_pos, skip);
+    memcpy(to + to_pos + skip, delta + pos + (undo ? 0 : old_len), to_len);
+    from_pos += skip + from_len;
+    to_pos += skip + to_len;
+    pos += old_len + new_len;
+  }
+  if (from_size - from_pos != to_size - to_pos) {
+    return false;
+  }
+  memcpy(to + to_pos, from + from_pos, from_size - from_pos);
+  result->DeserializeFrom(out.data());
+  return true;
+}
+
+}  // namespace bustub
@@ -12,15 +12,374 @@
 
 #include "recovery/log_recovery.h"
 
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "concurrency/transaction_manager.h"
+#include "storage/page/b_plus_tree_page.h"
 #include "storage/page/table_page.h"
 
 namespace bustub {
+
+namespace {
+
+/** Number of records handed to a redo worker at once. */
+constexpr size_t REDO_BATCH_SIZE = 1024;
+
+/** A record together with the page it has to be replayed on. */
+struct RedoTask {
+  LogRecord log_record_;
+  page_id_t page_id_;
+};
+
+/** Hands batches of records from the log reader to one redo worker. Bounded so the reader can not run away. */
+class RedoQueue {
+ public:
+  void Push(std::vector<RedoTask> *batch) {
+    if (batch->empty()) {
+      return;
+    }
+    std::unique_lock<std::mutex> lock(latch_);
+    cv_.wait(lock, [this] { return batches_.size() < MAX_BATCHES; });
+    batches_.emplace_back(std::move(*batch));
+    batch->clear();
+    cv_.notify_all();
+  }
+
+  void Close() {
+    std::scoped_lock<std::mutex> lock(latch_);
+    closed_ = true;
+    cv_.notify_all();
+  }
+
+  /** @return false once the queue is closed and drained */
+  bool Pop(std::vector<RedoTask> *batch) {
+    std::unique_lock<std::mutex> lock(latch_);
+    cv_.wait(lock, [this] { return !batches_.empty() || closed_; });
+    if (batches_.empty()) {
+      return false;
+    }
+    *batch = std::move(batches_.front());
+    batches_.pop_front();
+    cv_.notify_all();
+    return true;
+  }
+
+ private:
+  static constexpr size_t MAX_BATCHES = 4;
+  std::mutex latch_;
+  std::condition_variable cv_;
+  std::deque<std::vector<RedoTask>> batches_;
+  bool closed_{false};
+};
+
+}  // namespace
+
 /*
  * deserialize a log record from log buffer
  * @return: true means deserialize succeed, otherwise can't deserialize cause
  * incomplete log record
  */
-bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) { return false; }
+bool LogRecovery::DeserializeLogRecord(const char *data, int size, LogRecord *log_record) {
+  if (size < LogRecord::HEADER_SIZE) {
+    return false;
+  }
+  int32_t record_size;
+  memcpy(&record_size, data, sizeof(int32_t));
+  if (record_size < LogRecord::HEADER_SIZE || record_size > size) {
+    return false;
+  }
+  log_record->size_ = record_size;
+  memcpy(&log_record->lsn_, data + 4, sizeof(lsn_t));
+  memcpy(&log_record->txn_id_, data + 8, sizeof(txn_id_t));
+  memcpy(&log_record->prev_lsn_, data + 12, sizeof(lsn_t));
+  memcpy(&log_record->log_record_type_, data + 16, sizeof(LogRecordType));
+
+  int pos = LogRecord::HEADER_SIZE;
+  // a tuple is stored as its size followed by its data, make sure both are inside the record
+  auto tuple_fits = [&](int at) {
+    int32_t tuple_size;
+    if (at + static_cast<int>(sizeof(int32_t)) > record_size) {
+      return false;
+    }
+    memcpy(&tuple_size, data + at, sizeof(int32_t));
+    return tuple_size >= 0 && at + static_cast<int>(sizeof(int32_t)) + tuple_size <= record_size;
+  };
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      memcpy(&log_record->insert_rid_, data + pos, sizeof(RID));
+      pos += sizeof(RID);
+      if (!tuple_fits(pos)) {
+        return false;
+      }
+      log_record->insert_tuple_.DeserializeFrom(data + pos);
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(&log_record->delete_rid_, data + pos, sizeof(RID));
+      pos += sizeof(RID);
+      if (!tuple_fits(pos)) {
+        return false;
+      }
+      log_record->delete_tuple_.DeserializeFrom(data + pos);
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(&log_record->update_rid_, data + pos, sizeof(RID));
+      pos += sizeof(RID);
+      if (!tuple_fits(pos)) {
+        return false;
+      }
+      log_record->old_tuple_.DeserializeFrom(data + pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      if (!tuple_fits(pos)) {
+        return false;
+      }
+      log_record->new_tuple_.DeserializeFrom(data + pos);
+      break;
+    case LogRecordType::DELTAUPDATE: {
+      memcpy(&log_record->update_rid_, data + pos, sizeof(RID));
+      pos += sizeof(RID);
+      // the delta is stored like a tuple, its size followed by its data
+      if (!tuple_fits(pos)) {
+        return false;
+      }
+      int32_t delta_size;
+      memcpy(&delta_size, data + pos, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      log_record->delta_.assign(data + pos, data + pos + delta_size);
+      break;
+    }
+    case LogRecordType::NEWPAGE:
+      memcpy(&log_record->prev_page_id_, data + pos, sizeof(page_id_t));
+      pos += sizeof(page_id_t);
+      memcpy(&log_record->page_id_, data + pos, sizeof(page_id_t));
+      break;
+    case LogRecordType::END_CHECKPOINT: {
+      int32_t count;
+      for (int table = 0; table < 2; table++) {
+        if (pos + static_cast<int>(sizeof(int32_t)) > record_size) {
+          return false;
+        }
+        memcpy(&count, data + pos, sizeof(int32_t));
+        pos += sizeof(int32_t);
+        if (count < 0 || pos + count * 8 > record_size) {
+          return false;
+        }
+        auto &entries = table == 0 ? log_record->active_txns_ : log_record->dirty_pages_;
+        entries.resize(count);
+        for (auto &entry : entries) {
+          memcpy(&entry.first, data + pos, sizeof(int32_t));
+          memcpy(&entry.second, data + pos + sizeof(int32_t), sizeof(lsn_t));
+          pos += sizeof(int32_t) + sizeof(lsn_t);
+        }
+      }
+      break;
+    }
+    case LogRecordType::BTREEINSERT:
+    case LogRecordType::BTREEDELETE: {
+      if (pos + 4 * static_cast<int>(sizeof(int32_t)) > record_size) {
+        return false;
+      }
+      memcpy(&log_record->page_id_, data + pos, sizeof(page_id_t));
+      memcpy(&log_record->index_slot_, data + pos + 4, sizeof(int32_t));
+      memcpy(&log_record->index_offset_, data + pos + 8, sizeof(int32_t));
+      memcpy(&log_record->index_key_size_, data + pos + 12, sizeof(int32_t));
+      pos += 4 * sizeof(int32_t);
+      // the index name and the entry are stored like tuples
+      int32_t name_size;
+      if (!tuple_fits(pos)) {
+        return false;
+      }
+      memcpy(&name_size, data + pos, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      log_record->index_name_.assign(data + pos, name_size);
+      pos += name_size;
+      int32_t entry_size;
+      if (!tuple_fits(pos)) {
+        return false;
+      }
+      memcpy(&entry_size, data + pos, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      log_record->index_data_.assign(data + pos, data + pos + entry_size);
+      break;
+    }
+    case LogRecordType::BTREEWRITE: {
+      if (pos + 2 * static_cast<int>(sizeof(int32_t)) > record_size) {
+        return false;
+      }
+      memcpy(&log_record->page_id_, data + pos, sizeof(page_id_t));
+      memcpy(&log_record->index_offset_, data + pos + 4, sizeof(int32_t));
+      pos += 2 * sizeof(int32_t);
+      int32_t data_size;
+      if (!tuple_fits(pos)) {
+        return false;
+      }
+      memcpy(&data_size, data + pos, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      log_record->index_data_.assign(data + pos, data + pos + data_size);
+      break;
+    }
+    case LogRecordType::BEGIN:
+    case LogRecordType::BEGIN_CHECKPOINT:
+    case LogRecordType::COMMIT:
+    case LogRecordType::ABORT:
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+void LogRecovery::ScanLog(int offset, const std::function<void(LogRecord *, int)> &visit) {
+  offset_ = offset;
+  int log_size = disk_manager_->GetLogSize();
+  // log_buffer_ holds the log from file offset buffer_start, the first buffered bytes of it are valid
+  int buffer_start = offset;
+  int buffered = 0;
+  while (offset_ < log_size) {
+    int read_size = std::min(REDO_READ_SIZE - buffered, log_size - offset_);
+    if (read_size == 0 || !disk_manager_->ReadLog(log_buffer_ + buffered, read_size, offset_)) {
+      break;
+    }
+    offset_ += read_size;
+    buffered += read_size;
+
+    int pos = 0;
+    LogRecord log_record;
+    while (DeserializeLogRecord(log_buffer_ + pos, buffered - pos, &log_record)) {
+      visit(&log_record, buffer_start + pos);
+      pos += log_record.size_;
+    }
+
+    // keep the incomplete record at the end for the next read
+    memmove(log_buffer_, log_buffer_ + pos, buffered - pos);
+    buffer_start += pos;
+    buffered -= pos;
+  }
+}
+
+/*
+ * analysis phase
+ * Reading starts in the segment of the analysis lsn in the log master record: the last checkpoint, or the first
+ * record of a transaction that was running then if that is older. Without a checkpoint the whole log is read. A fuzzy
+ * checkpoint saves the tables somewhere between its BEGIN_CHECKPOINT and END_CHECKPOINT records while transactions
+ * keep logging, so at the END_CHECKPOINT the saved tables are merged with what was logged since the
+ * BEGIN_CHECKPOINT. A checkpoint that never ended is ignored. The losers began after the analysis lsn, so
+ * lsn_mapping_ has all the records undo needs.
+ */
+void LogRecovery::Analysis() {
+  active_txn_.clear();
+  lsn_mapping_.clear();
+  dirty_page_table_.clear();
+  next_lsn_ = 0;
+  max_page_id_ = INVALID_PAGE_ID;
+
+  // the pages first touched since the last BEGIN_CHECKPOINT and the transactions that finished
+  lsn_t begin_checkpoint_lsn = INVALID_LSN;
+  std::unordered_map<page_id_t, lsn_t> touched_since_begin;
+  std::unordered_set<txn_id_t> ended;
+
+  auto touch = [&](page_id_t page_id, lsn_t lsn) {
+    dirty_page_table_.emplace(page_id, lsn);
+    if (begin_checkpoint_lsn != INVALID_LSN) {
+      touched_since_begin.emplace(page_id, lsn);
+    }
+  };
+
+  int start_offset = disk_manager_->GetLogStart();
+  lsn_t checkpoint_lsn;
+  lsn_t analysis_lsn;
+  if (restore_lsn_ != INVALID_LSN) {
+    start_offset = disk_manager_->FindLogOffset(restore_lsn_);
+  } else if (disk_manager_->GetLogCheckpoint(&checkpoint_lsn, &analysis_lsn)) {
+    start_offset = disk_manager_->FindLogOffset(analysis_lsn);
+  }
+  first_lsn_ = INVALID_LSN;
+
+  ScanLog(start_offset, [&](LogRecord *log_record, int offset) {
+    lsn_t lsn = log_record->lsn_;
+    lsn_mapping_[lsn] = offset;
+    next_lsn_ = std::max(next_lsn_, lsn + 1);
+    next_txn_id_ = std::max(next_txn_id_, log_record->txn_id_ + 1);
+    if (first_lsn_ == INVALID_LSN) {
+      first_lsn_ = lsn;
+    }
+    // the segments written after the last checkpoint are not in the master record's index
+    disk_manager_->IndexLogRecord(lsn, offset);
+    // the restored pages hold everything before restore_lsn_, the segment may start earlier
+    if (lsn < restore_lsn_) {
+      return;
+    }
+
+    switch (log_record->log_record_type_) {
+      case LogRecordType::BEGIN_CHECKPOINT:
+        begin_checkpoint_lsn = lsn;
+        touched_since_begin.clear();
+        return;
+      case LogRecordType::END_CHECKPOINT:
+        if (log_record->prev_lsn_ != begin_checkpoint_lsn) {
+          return;
+        }
+        // the saved table is older than anything read after it was taken, and a transaction can still be in it
+        // after its COMMIT or ABORT record
+        for (const auto &txn : log_record->active_txns_) {
+          if (ended.count(txn.first) == 0) {
+            active_txn_.emplace(txn);
+          }
+          next_txn_id_ = std::max(next_txn_id_, txn.first + 1);
+        }
+        if (restore_lsn_ != INVALID_LSN) {
+          // the restored pages are older than the checkpoint, every page touched since restore_lsn_ stays dirty
+          for (const auto &page : log_record->dirty_pages_) {
+            dirty_page_table_.emplace(page.first, std::max(page.second, restore_lsn_));
+          }
+        } else {
+          dirty_page_table_ = std::unordered_map<page_id_t, lsn_t>(log_record->dirty_pages_.begin(),
+                                                                   log_record->dirty_pages_.end());
+        }
+        for (const auto &page : log_record->dirty_pages_) {
+          // a page created before the checkpoint may not be in the db file yet
+          max_page_id_ = std::max(max_page_id_, page.first);
+        }
+        for (const auto &page : touched_since_begin) {
+          dirty_page_table_.emplace(page);
+        }
+        begin_checkpoint_lsn = INVALID_LSN;
+        return;
+      case LogRecordType::COMMIT:
+      case LogRecordType::ABORT:
+        active_txn_.erase(log_record->txn_id_);
+        ended.insert(log_record->txn_id_);
+        return;
+      default:
+        // b+ tree changes made outside of a transaction have nothing to undo
+        if (log_record->txn_id_ != INVALID_TXN_ID) {
+          active_txn_[log_record->txn_id_] = lsn;
+        }
+        break;
+    }
+
+    // the first record that touches a page after the checkpoint is its recLSN
+    page_id_t page_id = GetRecordPageId(*log_record);
+    if (page_id != INVALID_PAGE_ID) {
+      max_page_id_ = std::max(max_page_id_, page_id);
+      touch(page_id, lsn);
+    }
+    if (log_record->log_record_type_ == LogRecordType::NEWPAGE && log_record->prev_page_id_ != INVALID_PAGE_ID) {
+      touch(log_record->prev_page_id_, lsn);
+    }
+  });
+  analyzed_ = true;
+}
+
+bool LogRecovery::NeedsRedo(const LogRecord &log_record, page_id_t page_id) const {
+  auto it = dirty_page_table_.find(page_id);
+  return it != dirty_page_table_.end() && log_record.lsn_ >= it->second;
+}
 
 /*
  *redo phase on TABLE PAGE level(table/table_page.h)
@@ -28,13 +387,482 @@ bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record)
  *log buffer to reduce unnecessary I/O operations), remember to compare page's
  *LSN with log_record's sequence number, and also build active_txn_ table &
  *lsn_mapping_ table
+ *
+ *Starts at the smallest recLSN of the dirty page table built by Analysis.
  */
-void LogRecovery::Redo() {}
+bool LogRecovery::FindRedoStart(int *redo_offset) {
+  if (dirty_page_table_.empty()) {
+    return false;
+  }
+  lsn_t redo_lsn = next_lsn_;
+  for (const auto &page : dirty_page_table_) {
+    redo_lsn = std::min(redo_lsn, page.second);
+  }
+  if (redo_lsn < first_lsn_) {
+    // the page was dirty before anything analysis read, the segment index knows where its records are
+    *redo_offset = disk_manager_->FindLogOffset(redo_lsn);
+    return true;
+  }
+  // a recLSN taken from the buffer pool may belong to a record that was never written, LSNs are dense otherwise
+  while (redo_lsn < next_lsn_ && lsn_mapping_.count(redo_lsn) == 0) {
+    redo_lsn++;
+  }
+  if (redo_lsn >= next_lsn_) {
+    return false;
+  }
+  *redo_offset = lsn_mapping_[redo_lsn];
+  return true;
+}
+
+void LogRecovery::Redo(size_t num_workers) {
+  if (!analyzed_) {
+    Analysis();
+  }
+  // pages created right before the crash may not be in the db file yet
+  disk_manager_->ReservePageIds(max_page_id_ + 1);
+  int redo_offset;
+  if (!FindRedoStart(&redo_offset)) {
+    return;
+  }
+
+  if (num_workers == 0) {
+    num_workers = std::max(1U, std::thread::hardware_concurrency());
+  }
+  // every worker keeps a page pinned while it applies a record
+  num_workers = std::min(num_workers, std::max<size_t>(1, buffer_pool_manager_->GetUnpinnedFrameCount()));
+  std::vector<RedoQueue> queues(num_workers);
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < num_workers; i++) {
+    workers.emplace_back([this, &queue = queues[i]] {
+      std::vector<RedoTask> batch;
+      while (queue.Pop(&batch)) {
+        for (auto &task : batch) {
+          RedoLogRecord(&task.log_record_, task.page_id_);
+        }
+      }
+    });
+  }
+
+  std::vector<std::vector<RedoTask>> batches(num_workers);
+  auto dispatch = [&](LogRecord *log_record, page_id_t page_id) {
+    if (page_id == INVALID_PAGE_ID || !NeedsRedo(*log_record, page_id)) {
+      return;
+    }
+    auto &batch = batches[page_id % num_workers];
+    batch.push_back(RedoTask{*log_record, page_id});
+    if (batch.size() >= REDO_BATCH_SIZE) {
+      queues[page_id % num_workers].Push(&batch);
+    }
+  };
+  ScanLog(redo_offset, [&](LogRecord *log_record, __attribute__((unused)) int offset) {
+    dispatch(log_record, GetRecordPageId(*log_record));
+    // a new page is also linked into its predecessor, which may belong to another worker
+    if (log_record->log_record_type_ == LogRecordType::NEWPAGE) {
+      dispatch(log_record, log_record->prev_page_id_);
+    }
+  });
+  for (size_t i = 0; i < num_workers; i++) {
+    queues[i].Push(&batches[i]);
+    queues[i].Close();
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
 
 /*
  *undo phase on TABLE PAGE level(table/table_page.h)
  *iterate through active txn map and undo each operation
  */
-void LogRecovery::Undo() {}
+void LogRecovery::Undo() {
+  for (const auto &txn : active_txn_) {
+    LogRecord log_record;
+    for (lsn_t lsn = txn.second; lsn != INVALID_LSN && ReadLogRecord(lsn, &log_record); lsn = log_record.prev_lsn_) {
+      UndoLogRecord(&log_record);
+    }
+  }
+  active_txn_.clear();
+  lsn_mapping_.clear();
+  dirty_page_table_.clear();
+  analyzed_ = false;
+}
+
+bool LogRecovery::ReadLogRecord(lsn_t lsn, LogRecord *log_record) {
+  auto it = lsn_mapping_.find(lsn);
+  if (it == lsn_mapping_.end()) {
+    return false;
+  }
+  int32_t size;
+  disk_manager_->ReadLog(reinterpret_cast<char *>(&size), sizeof(int32_t), it->second);
+  if (size < LogRecord::HEADER_SIZE || size > REDO_READ_SIZE) {
+    return false;
+  }
+  disk_manager_->ReadLog(log_buffer_, size, it->second);
+  return DeserializeLogRecord(log_buffer_, size, log_record);
+}
+
+/*
+ * Instant restart. The redo records are indexed by page and applied by the
+ * buffer pool on the first read of a page, the losers hold their RIDs in the
+ * lock manager until somebody needs them, and a background thread does
+ * whatever is left.
+ */
+void LogRecovery::RecoverOnDemand(TransactionManager *txn_manager, LockManager *lock_manager, LogManager *log_manager) {
+  if (!analyzed_) {
+    Analysis();
+  }
+  disk_manager_->ReservePageIds(max_page_id_ + 1);
+  lock_manager_ = lock_manager;
+  log_manager_ = log_manager;
+  // the new transactions continue the log, and must not take the id of a loser that is still open
+  log_manager_->SetNextLSN(next_lsn_);
+  txn_manager->SetNextTxnId(next_txn_id_);
+
+  int redo_offset;
+  if (FindRedoStart(&redo_offset)) {
+    auto add = [this](LogRecord *log_record, page_id_t page_id) {
+      if (page_id != INVALID_PAGE_ID && NeedsRedo(*log_record, page_id)) {
+        pending_redo_[page_id].push_back(*log_record);
+      }
+    };
+    ScanLog(redo_offset, [&](LogRecord *log_record, __attribute__((unused)) int offset) {
+      add(log_record, GetRecordPageId(*log_record));
+      if (log_record->log_record_type_ == LogRecordType::NEWPAGE) {
+        add(log_record, log_record->prev_page_id_);
+      }
+    });
+  }
+
+  // the losers are read up front, their records may be anywhere in the log
+  for (const auto &txn : active_txn_) {
+    std::vector<LogRecord> &log_records = pending_undo_[txn.first];
+    LogRecord log_record;
+    for (lsn_t lsn = txn.second; lsn != INVALID_LSN && ReadLogRecord(lsn, &log_record); lsn = log_record.prev_lsn_) {
+      RID rid = GetRecordRid(log_record);
+      if (rid.GetPageId() != INVALID_PAGE_ID) {
+        lock_manager_->LockForRecovery(txn.first, rid);
+      }
+      log_records.push_back(log_record);
+    }
+  }
+  active_txn_.clear();
+  lsn_mapping_.clear();
+  dirty_page_table_.clear();
+  analyzed_ = false;
+
+  buffer_pool_manager_->SetPageReadHook([this](Page *page) { return RedoPendingPage(page); });
+  lock_manager_->SetRecoveryUndo([this](txn_id_t txn_id) {
+    std::scoped_lock lock(pending_latch_);
+    requested_undo_.push_back(txn_id);
+  });
+  // undo is logged from now on
+  if (!enable_logging) {
+    log_manager_->RunFlushThread();
+  }
+  finisher_ = std::thread(&LogRecovery::FinishRecovery, this);
+}
+
+void LogRecovery::WaitForRecovery() {
+  if (finisher_.joinable()) {
+    finisher_.join();
+  }
+}
+
+lsn_t LogRecovery::RedoPendingPage(Page *page) {
+  std::vector<LogRecord> log_records;
+  {
+    std::scoped_lock lock(pending_latch_);
+    auto it = pending_redo_.find(page->GetPageId());
+    if (it == pending_redo_.end()) {
+      return INVALID_LSN;
+    }
+    log_records = std::move(it->second);
+    pending_redo_.erase(it);
+  }
+  lsn_t first_lsn = INVALID_LSN;
+  for (auto &log_record : log_records) {
+    if (RedoOnPage(page, &log_record, page->GetPageId()) && first_lsn == INVALID_LSN) {
+      first_lsn = log_record.lsn_;
+    }
+  }
+  return first_lsn;
+}
+
+void LogRecovery::UndoLoser(txn_id_t txn_id) {
+  std::scoped_lock lock(undo_latch_);
+  auto it = pending_undo_.find(txn_id);
+  if (it == pending_undo_.end()) {
+    return;
+  }
+  std::vector<LogRecord> &log_records = it->second;
+  // the loser already holds its RIDs through the recovery locks, the page operations must not lock them again
+  Transaction txn(txn_id);
+  for (const auto &log_record : log_records) {
+    RID rid = GetRecordRid(log_record);
+    if (rid.GetPageId() != INVALID_PAGE_ID) {
+      txn.GetExclusiveLockSet()->insert(rid);
+    }
+  }
+  if (!log_records.empty()) {
+    txn.SetPrevLSN(log_records.front().lsn_);
+  }
+  // pages are redone as they are fetched, so undo always sees them up to date
+  for (auto &log_record : log_records) {
+    UndoLogRecord(&log_record, &txn, log_manager_);
+  }
+  if (enable_logging) {
+    LogRecord abort_record(txn_id, txn.GetPrevLSN(), LogRecordType::ABORT);
+    log_manager_->AppendLogRecord(&abort_record);
+  }
+  pending_undo_.erase(it);
+  lock_manager_->ReleaseRecoveryLocks(txn_id);
+}
+
+void LogRecovery::FinishRecovery() {
+  while (true) {
+    page_id_t page_id;
+    std::vector<txn_id_t> requested;
+    {
+      std::scoped_lock lock(pending_latch_);
+      if (pending_redo_.empty()) {
+        break;
+      }
+      page_id = pending_redo_.begin()->first;
+      requested.swap(requested_undo_);
+    }
+    // losers that new transactions wait for go first
+    for (txn_id_t txn_id : requested) {
+      UndoLoser(txn_id);
+    }
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    if (page == nullptr) {
+      // every frame is pinned by the new transactions right now
+      std::this_thread::yield();
+      continue;
+    }
+    // only a page that was in the buffer pool before recovery started can still be pending here
+    page->WLatch();
+    bool is_dirty = RedoPendingPage(page) != INVALID_LSN;
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, is_dirty);
+  }
+
+  std::vector<txn_id_t> losers;
+  {
+    std::scoped_lock lock(undo_latch_);
+    for (const auto &txn : pending_undo_) {
+      losers.push_back(txn.first);
+    }
+  }
+  for (txn_id_t txn_id : losers) {
+    UndoLoser(txn_id);
+  }
+  buffer_pool_manager_->SetPageReadHook(nullptr);
+  lock_manager_->SetRecoveryUndo(nullptr);
+}
+
+RID LogRecovery::GetRecordRid(const LogRecord &log_record) {
+  switch (log_record.log_record_type_) {
+    case LogRecordType::INSERT:
+      return log_record.insert_rid_;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      return log_record.delete_rid_;
+    case LogRecordType::UPDATE:
+    case LogRecordType::DELTAUPDATE:
+      return log_record.update_rid_;
+    default:
+      return RID();
+  }
+}
+
+page_id_t LogRecovery::GetRecordPageId(const LogRecord &log_record) {
+  switch (log_record.log_record_type_) {
+    case LogRecordType::INSERT:
+      return log_record.insert_rid_.GetPageId();
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      return log_record.delete_rid_.GetPageId();
+    case LogRecordType::UPDATE:
+    case LogRecordType::DELTAUPDATE:
+      return log_record.update_rid_.GetPageId();
+    case LogRecordType::NEWPAGE:
+    case LogRecordType::BTREEINSERT:
+    case LogRecordType::BTREEDELETE:
+    case LogRecordType::BTREEWRITE:
+      return log_record.page_id_;
+    default:
+      return INVALID_PAGE_ID;
+  }
+}
+
+void LogRecovery::RedoLogRecord(LogRecord *log_record, page_id_t page_id) {
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  BUSTUB_ASSERT(page != nullptr, "The buffer pool needs a frame for every redo worker.");
+  bool is_dirty = RedoOnPage(page, log_record, page_id);
+  buffer_pool_manager_->UnpinPage(page_id, is_dirty);
+}
+
+bool LogRecovery::RedoOnPage(Page *page, LogRecord *log_record, page_id_t page_id) {
+  auto *table_page = reinterpret_cast<TablePage *>(page);
+  lsn_t lsn = log_record->lsn_;
+  bool is_dirty = false;
+
+  if (log_record->log_record_type_ == LogRecordType::NEWPAGE && page_id != log_record->page_id_) {
+    // linking the new page into the previous one is idempotent, no need to look at the LSN
+    if (table_page->GetNextPageId() != log_record->page_id_) {
+      table_page->SetNextPageId(log_record->page_id_);
+      is_dirty = true;
+    }
+  } else if (log_record->log_record_type_ == LogRecordType::NEWPAGE) {
+    // the page may have never reached the disk at all
+    if (page->GetLSN() < lsn || table_page->GetTablePageId() != page_id) {
+      table_page->Init(page_id, PAGE_SIZE, log_record->prev_page_id_, nullptr, nullptr);
+      page->SetLSN(lsn);
+      is_dirty = true;
+    }
+  } else if (log_record->log_record_type_ == LogRecordType::BTREEWRITE && page_id == HEADER_PAGE_ID) {
+    // the header page has no LSN, but its writes are images of the whole page and replaying them in log order ends
+    // with the last one
+    ApplyIndexRecord(page, *log_record);
+    is_dirty = true;
+  } else if (page->GetLSN() < lsn) {
+    RID rid;
+    Tuple old_tuple;
+    switch (log_record->log_record_type_) {
+      case LogRecordType::INSERT:
+        table_page->InsertTupleAt(log_record->insert_tuple_, log_record->insert_rid_, nullptr, nullptr);
+        break;
+      case LogRecordType::MARKDELETE:
+        table_page->MarkDelete(log_record->delete_rid_, nullptr, nullptr, nullptr);
+        break;
+      case LogRecordType::APPLYDELETE:
+        table_page->ApplyDelete(log_record->delete_rid_, nullptr, nullptr);
+        break;
+      case LogRecordType::ROLLBACKDELETE:
+        table_page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+        break;
+      case LogRecordType::UPDATE:
+        table_page->UpdateTuple(log_record->new_tuple_, &old_tuple, log_record->update_rid_, nullptr, nullptr,
+                                nullptr);
+        break;
+      case LogRecordType::DELTAUPDATE:
+        ApplyDeltaUpdate(table_page, *log_record, false);
+        break;
+      case LogRecordType::BTREEINSERT:
+      case LogRecordType::BTREEDELETE:
+      case LogRecordType::BTREEWRITE:
+        ApplyIndexRecord(page, *log_record);
+        break;
+      default:
+        break;
+    }
+    page->SetLSN(lsn);
+    is_dirty = true;
+  }
+  return is_dirty;
+}
+
+void LogRecovery::UndoLogRecord(LogRecord *log_record, Transaction *txn, LogManager *log_manager) {
+  if (log_record->log_record_type_ == LogRecordType::BTREEINSERT ||
+      log_record->log_record_type_ == LogRecordType::BTREEDELETE) {
+    // a split or merge may have moved the entry to another page since, only the index can find it
+    auto it = index_undo_.find(log_record->index_name_);
+    if (it != index_undo_.end()) {
+      it->second(log_record);
+    }
+    return;
+  }
+  page_id_t page_id = GetRecordPageId(*log_record);
+  if (page_id == INVALID_PAGE_ID || log_record->log_record_type_ == LogRecordType::NEWPAGE ||
+      log_record->log_record_type_ == LogRecordType::BTREEWRITE) {
+    return;
+  }
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  BUSTUB_ASSERT(page != nullptr, "Undo needs a frame in the buffer pool.");
+  auto *table_page = reinterpret_cast<TablePage *>(page);
+  Tuple old_tuple;
+  // new transactions may use the page meanwhile; txn holds the RIDs it undoes, so no lock manager is needed
+  page->WLatch();
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      table_page->ApplyDelete(log_record->insert_rid_, txn, log_manager);
+      break;
+    case LogRecordType::MARKDELETE:
+      table_page->RollbackDelete(log_record->delete_rid_, txn, log_manager);
+      break;
+    case LogRecordType::APPLYDELETE:
+      // back into its slot, which inserts of other transactions leave alone while the loser holds it
+      table_page->InsertTupleAt(log_record->delete_tuple_, log_record->delete_rid_, txn, log_manager);
+      break;
+    case LogRecordType::ROLLBACKDELETE:
+      table_page->MarkDelete(log_record->delete_rid_, txn, nullptr, log_manager);
+      break;
+    case LogRecordType::UPDATE:
+      table_page->UpdateTuple(log_record->old_tuple_, &old_tuple, log_record->update_rid_, txn, nullptr, log_manager);
+      break;
+    case LogRecordType::DELTAUPDATE:
+      ApplyDeltaUpdate(table_page, *log_record, true, txn, log_manager);
+      break;
+    default:
+      break;
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
+
+void LogRecovery::ApplyDeltaUpdate(TablePage *table_page, const LogRecord &log_record, bool undo, Transaction *txn,
+                                   LogManager *log_manager) {
+  Tuple tuple;
+  Tuple result;
+  Tuple old_tuple;
+  if (table_page->GetTuple(log_record.update_rid_, &tuple, txn, nullptr) &&
+      log_record.ApplyDelta(tuple, &result, undo)) {
+    table_page->UpdateTuple(result, &old_tuple, log_record.update_rid_, txn, nullptr, log_manager);
+  }
+}
+
+void LogRecovery::ApplyIndexRecord(Page *page, const LogRecord &log_record) {
+  char *data = page->GetData();
+  const auto &bytes = log_record.index_data_;
+  auto size = static_cast<int32_t>(bytes.size());
+  int32_t offset = log_record.index_offset_;
+  if (log_record.log_record_type_ == LogRecordType::BTREEWRITE) {
+    if (offset >= 0 && offset + size <= PAGE_SIZE) {
+      memcpy(data + offset, bytes.data(), size);
+    }
+    return;
+  }
+
+  // a leaf has an array of max size keys and then one of max size values, each ends size - slot slots after the
+  // logged one
+  auto *node = reinterpret_cast<BPlusTreePage *>(data);
+  int32_t slot = log_record.index_slot_;
+  int32_t key_size = log_record.index_key_size_;
+  int32_t value_size = size - key_size;
+  int32_t value_offset = offset + (node->GetMaxSize() - slot) * key_size + slot * value_size;
+  int32_t after = node->GetSize() - slot;
+  if (key_size <= 0 || value_size <= 0 || offset < 0 || slot < 0 || after < 0) {
+    return;
+  }
+  bool insert = log_record.log_record_type_ == LogRecordType::BTREEINSERT;
+  if (insert ? value_offset + (after + 1) * value_size > PAGE_SIZE
+             : after == 0 || value_offset + after * value_size > PAGE_SIZE) {
+    return;
+  }
+  auto shift = [data, after, insert](int32_t at, const char *bytes, int32_t width) {
+    if (insert) {
+      memmove(data + at + width, data + at, after * width);
+      memcpy(data + at, bytes, width);
+    } else {
+      memmove(data + at, data + at + width, (after - 1) * width);
+    }
+  };
+  shift(offset, bytes.data(), key_size);
+  shift(value_offset, bytes.data() + key_size, value_size);
+  node->IncreaseSize(insert ? 1 : -1);
+}
 
 }  // namespace bustub
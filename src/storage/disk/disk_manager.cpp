@@ -10,16 +10,22 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <iterator>
 #include <string>
 #include <thread>  // NOLINT
 
 #include "common/exception.h"
 #include "common/logger.h"
 #include "storage/disk/disk_manager.h"
+#include "storage/disk/page_codec.h"
 
 namespace bustub {
 
@@ -29,8 +35,14 @@ static char *buffer_used;
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), next_page_id_(0), num_flushes_(0), num_writes_(0), flush_log_(false), flush_log_f_(nullptr) {
+DiskManager::DiskManager(const std::string &db_file, bool enable_compression)
+    : file_name_(db_file),
+      next_page_id_(0),
+      num_flushes_(0),
+      num_writes_(0),
+      flush_log_(false),
+      flush_log_f_(nullptr),
+      enable_compression_(enable_compression) {
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
@@ -38,19 +50,19 @@ DiskManager::DiskManager(const std::string &db_file)
   }
   log_name_ = file_name_.substr(0, n) + ".log";
 
-  log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app | std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-    if (!log_io_.is_open()) {
-      throw Exception("can't open dblog file");
-    }
+  if (!LoadLogMaster()) {
+    // a new log, whatever segments are around belong to an old one
+    RemoveLogSegments();
+    first_log_segment_ = 0;
+    WriteLogMaster();
+  }
+  // the log ends in the last of the consecutive segments
+  int last_segment = first_log_segment_;
+  while (GetFileSize(LogSegmentName(last_segment + 1)) >= 0) {
+    last_segment++;
   }
+  int last_size = GetFileSize(LogSegmentName(last_segment));
+  log_end_ = last_segment * log_segment_size_ + std::max(last_size, 0);
 
   db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
   // directory or file does not exist
@@ -66,6 +78,28 @@ DiskManager::DiskManager(const std::string &db_file)
     }
   }
   buffer_used = nullptr;
+  if (enable_compression_) {
+    LoadSlots();
+  }
+
+  db_fd_ = open(db_file.c_str(), O_RDWR);
+  int file_size = GetFileSize(file_name_);
+  prealloc_end_ = file_size < 0 ? 0 : static_cast<size_t>(file_size);
+
+  // pick up page allocation where the existing db file left off
+  if (enable_compression_) {
+    for (const auto &slot : page_slots_) {
+      ReservePageIds(slot.first + 1);
+    }
+  } else if (file_size > 0) {
+    ReservePageIds((file_size + PAGE_SIZE - 1) / PAGE_SIZE);
+  }
+}
+
+DiskManager::~DiskManager() {
+  if (db_fd_ >= 0) {
+    close(db_fd_);
+  }
 }
 
 /**
@@ -74,12 +108,22 @@ DiskManager::DiskManager(const std::string &db_file)
 void DiskManager::ShutDown() {
   db_io_.close();
   log_io_.close();
+  log_read_io_.close();
+  if (db_fd_ >= 0) {
+    close(db_fd_);
+    db_fd_ = -1;
+  }
 }
 
 /**
  * Write the contents of the specified page into disk file
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  std::scoped_lock<std::mutex> lock(db_io_latch_);
+  if (enable_compression_) {
+    WriteCompressedPage(page_id, page_data);
+    return;
+  }
   size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
   // set write cursor to offset
   num_writes_ += 1;
@@ -98,6 +142,11 @@ void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
  * Read the contents of the specified page into the given memory area
  */
 void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  std::scoped_lock<std::mutex> lock(db_io_latch_);
+  if (enable_compression_) {
+    ReadCompressedPage(page_id, page_data);
+    return;
+  }
   int offset = page_id * PAGE_SIZE;
   // check if read beyond file length
   if (offset > GetFileSize(file_name_)) {
@@ -122,6 +171,144 @@ void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
   }
 }
 
+/**
+ * Compress the page and write it into its slot, moving it to a bigger slot if it no longer fits
+ */
+void DiskManager::WriteCompressedPage(page_id_t page_id, const char *page_data) {
+  char buf[SLOT_HEADER_SIZE + PAGE_SIZE];
+  size_t data_size = PageCodec::Compress(page_data, PAGE_SIZE, buf + SLOT_HEADER_SIZE, PAGE_SIZE - 1);
+  if (data_size == 0) {
+    // incompressible, store it raw
+    memcpy(buf + SLOT_HEADER_SIZE, page_data, PAGE_SIZE);
+    data_size = PAGE_SIZE;
+  }
+  auto units = static_cast<uint16_t>((SLOT_HEADER_SIZE + data_size + SLOT_UNIT - 1) / SLOT_UNIT);
+
+  PageSlot slot;
+  auto it = page_slots_.find(page_id);
+  if (it != page_slots_.end() && it->second.capacity_ >= units) {
+    slot = it->second;
+  } else {
+    if (it != page_slots_.end()) {
+      free_slots_[it->second.capacity_].push_back(it->second.offset_);
+      live_slot_bytes_ -= it->second.capacity_ * SLOT_UNIT;
+    }
+    slot = AllocateSlot(units);
+    live_slot_bytes_ += slot.capacity_ * SLOT_UNIT;
+  }
+  slot.data_size_ = static_cast<uint16_t>(data_size);
+
+  uint32_t seq = next_slot_seq_++;
+  memcpy(buf, &SLOT_MAGIC, sizeof(uint32_t));
+  memcpy(buf + 4, &page_id, sizeof(page_id_t));
+  memcpy(buf + 8, &seq, sizeof(uint32_t));
+  memcpy(buf + 12, &slot.data_size_, sizeof(uint16_t));
+  memcpy(buf + 14, &slot.capacity_, sizeof(uint16_t));
+
+  num_writes_ += 1;
+  db_io_.seekp(slot.offset_);
+  db_io_.write(buf, SLOT_HEADER_SIZE + data_size);
+  if (db_io_.bad()) {
+    LOG_DEBUG("I/O error while writing");
+    return;
+  }
+  db_io_.flush();
+  page_slots_[page_id] = slot;
+}
+
+/**
+ * Read the slot of the page and decompress it into page_data
+ */
+void DiskManager::ReadCompressedPage(page_id_t page_id, char *page_data) {
+  auto it = page_slots_.find(page_id);
+  if (it == page_slots_.end()) {
+    // never written, same as reading past the end of an uncompressed file
+    LOG_DEBUG("I/O error reading past end of file");
+    memset(page_data, 0, PAGE_SIZE);
+    return;
+  }
+  const PageSlot &slot = it->second;
+  char buf[PAGE_SIZE];
+  db_io_.seekp(slot.offset_ + SLOT_HEADER_SIZE);
+  db_io_.read(buf, slot.data_size_);
+  if (db_io_.bad() || db_io_.gcount() < slot.data_size_) {
+    LOG_DEBUG("I/O error while reading");
+    db_io_.clear();
+    memset(page_data, 0, PAGE_SIZE);
+    return;
+  }
+  if (slot.data_size_ == PAGE_SIZE) {
+    memcpy(page_data, buf, PAGE_SIZE);
+  } else if (!PageCodec::Decompress(buf, slot.data_size_, page_data, PAGE_SIZE)) {
+    LOG_DEBUG("corrupted compressed page");
+    memset(page_data, 0, PAGE_SIZE);
+  }
+}
+
+/**
+ * Take the smallest free slot that is big enough, or carve a new one at the end of the file
+ */
+DiskManager::PageSlot DiskManager::AllocateSlot(uint16_t units) {
+  auto it = free_slots_.lower_bound(units);
+  if (it != free_slots_.end()) {
+    PageSlot slot{it->second.back(), it->first, 0};
+    it->second.pop_back();
+    if (it->second.empty()) {
+      free_slots_.erase(it);
+    }
+    return slot;
+  }
+  PageSlot slot{slot_end_, units, 0};
+  slot_end_ += units * SLOT_UNIT;
+  EnsurePreallocated(slot_end_);
+  return slot;
+}
+
+/**
+ * Walk the slots of the db file to find the live copy of every page
+ */
+void DiskManager::LoadSlots() {
+  int file_size = GetFileSize(file_name_);
+  size_t size = file_size < 0 ? 0 : static_cast<size_t>(file_size);
+  std::unordered_map<page_id_t, uint32_t> seqs;
+  size_t offset = 0;
+  while (offset + SLOT_HEADER_SIZE <= size) {
+    char header[SLOT_HEADER_SIZE];
+    db_io_.seekp(offset);
+    db_io_.read(header, SLOT_HEADER_SIZE);
+    uint32_t magic;
+    page_id_t page_id;
+    uint32_t seq;
+    PageSlot slot{offset, 0, 0};
+    memcpy(&magic, header, sizeof(uint32_t));
+    memcpy(&page_id, header + 4, sizeof(page_id_t));
+    memcpy(&seq, header + 8, sizeof(uint32_t));
+    memcpy(&slot.data_size_, header + 12, sizeof(uint16_t));
+    memcpy(&slot.capacity_, header + 14, sizeof(uint16_t));
+    if (magic != SLOT_MAGIC || slot.capacity_ == 0) {
+      offset += SLOT_UNIT;
+      continue;
+    }
+    offset += slot.capacity_ * SLOT_UNIT;
+    next_slot_seq_ = std::max(next_slot_seq_, seq + 1);
+
+    auto it = page_slots_.find(page_id);
+    if (it != page_slots_.end() && seqs[page_id] > seq) {
+      free_slots_[slot.capacity_].push_back(slot.offset_);
+      continue;
+    }
+    if (it != page_slots_.end()) {
+      free_slots_[it->second.capacity_].push_back(it->second.offset_);
+      live_slot_bytes_ -= it->second.capacity_ * SLOT_UNIT;
+    }
+    page_slots_[page_id] = slot;
+    seqs[page_id] = seq;
+    live_slot_bytes_ += slot.capacity_ * SLOT_UNIT;
+  }
+  db_io_.clear();
+  slot_end_ = std::max(offset, (size + SLOT_UNIT - 1) / SLOT_UNIT * SLOT_UNIT);
+}
+
 /**
  * Write the contents of the log into disk file
  * Only return when sync is done, and only perform sequence write
@@ -142,17 +329,33 @@ void DiskManager::WriteLog(char *log_data, int size) {
     assert(flush_log_f_->wait_for(std::chrono::seconds(10)) == std::future_status::ready);
   }
 
+  std::scoped_lock<std::mutex> lock(log_latch_);
   num_flushes_ += 1;
-  // sequence write
-  log_io_.write(log_data, size);
-
-  // check for I/O error
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while writing log");
-    return;
+  // sequence write, moving on to the next segment whenever one is full
+  int written = 0;
+  while (written < size) {
+    int segment = log_end_ / log_segment_size_;
+    if (segment != log_write_segment_) {
+      log_io_.close();
+      log_io_.clear();
+      log_io_.open(LogSegmentName(segment), std::ios::binary | std::ios::app | std::ios::out);
+      if (!log_io_.is_open()) {
+        throw Exception("can't open log segment");
+      }
+      log_write_segment_ = segment;
+    }
+    int chunk = std::min(size - written, (segment + 1) * log_segment_size_ - log_end_);
+    log_io_.write(log_data + written, chunk);
+    // check for I/O error
+    if (log_io_.bad()) {
+      LOG_DEBUG("I/O error while writing log");
+      return;
+    }
+    // needs to flush to keep disk file in sync
+    log_io_.flush();
+    written += chunk;
+    log_end_ += chunk;
   }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
   flush_log_ = false;
 }
 
@@ -162,33 +365,205 @@ void DiskManager::WriteLog(char *log_data, int size) {
  * @return: false means already reach the end
  */
 bool DiskManager::ReadLog(char *log_data, int size, int offset) {
-  if (offset >= GetFileSize(log_name_)) {
+  std::scoped_lock<std::mutex> lock(log_latch_);
+  if (offset >= log_end_ || offset < first_log_segment_ * log_segment_size_) {
     // LOG_DEBUG("end of log file");
-    // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
     return false;
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
-
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while reading log");
-    return false;
+  int read_count = 0;
+  while (read_count < size && offset < log_end_) {
+    int segment = offset / log_segment_size_;
+    if (segment != log_read_segment_) {
+      log_read_io_.close();
+      log_read_io_.clear();
+      log_read_io_.open(LogSegmentName(segment), std::ios::binary | std::ios::in);
+      log_read_segment_ = segment;
+    }
+    int chunk = std::min({size - read_count, (segment + 1) * log_segment_size_ - offset, log_end_ - offset});
+    log_read_io_.seekg(offset - segment * log_segment_size_);
+    log_read_io_.read(log_data + read_count, chunk);
+    if (log_read_io_.bad()) {
+      LOG_DEBUG("I/O error while reading log");
+      return false;
+    }
+    if (log_read_io_.gcount() < chunk) {
+      log_read_io_.clear();
+      read_count += log_read_io_.gcount();
+      break;
+    }
+    read_count += chunk;
+    offset += chunk;
   }
-  // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
+  // if log ends before reading "size"
   if (read_count < size) {
-    log_io_.clear();
     memset(log_data + read_count, 0, size - read_count);
   }
 
   return true;
 }
 
+/**
+ * Only the first record of every segment is kept. A segment can have none if a record covers all of it.
+ */
+void DiskManager::IndexLogRecord(lsn_t lsn, int offset) {
+  int segment = offset / log_segment_size_;
+  std::scoped_lock<std::mutex> lock(log_latch_);
+  if (segment > last_indexed_segment_) {
+    log_segment_index_[lsn] = offset;
+    last_indexed_segment_ = segment;
+  }
+}
+
+int DiskManager::FindLogOffset(lsn_t lsn) {
+  std::scoped_lock<std::mutex> lock(log_latch_);
+  auto it = log_segment_index_.upper_bound(lsn);
+  if (it != log_segment_index_.begin()) {
+    return std::prev(it)->second;
+  }
+  if (it != log_segment_index_.end()) {
+    return it->second;
+  }
+  return first_log_segment_ * log_segment_size_;
+}
+
+/**
+ * The master record goes out first, so a crash in between leaves some segments behind that nothing refers to. They
+ * are deleted with the next ones.
+ */
+void DiskManager::SetLogCheckpoint(lsn_t checkpoint_lsn, lsn_t analysis_lsn, lsn_t keep_lsn) {
+  std::scoped_lock<std::mutex> lock(log_latch_);
+  checkpoint_lsn_ = checkpoint_lsn;
+  analysis_lsn_ = analysis_lsn;
+  // every segment before the last one that starts with a record at or before keep_lsn is older than keep_lsn
+  int old_first_segment = first_log_segment_;
+  auto keep = log_segment_index_.upper_bound(keep_lsn);
+  if (keep != log_segment_index_.begin()) {
+    keep = std::prev(keep);
+    first_log_segment_ = std::max(first_log_segment_, keep->second / log_segment_size_);
+    log_segment_index_.erase(log_segment_index_.begin(), keep);
+  }
+  WriteLogMaster();
+
+  for (int segment = old_first_segment; segment < first_log_segment_; segment++) {
+    if (segment == log_read_segment_) {
+      log_read_io_.close();
+      log_read_segment_ = -1;
+    }
+    remove(LogSegmentName(segment).c_str());
+  }
+}
+
+bool DiskManager::GetLogCheckpoint(lsn_t *checkpoint_lsn, lsn_t *analysis_lsn) {
+  std::scoped_lock<std::mutex> lock(log_latch_);
+  *checkpoint_lsn = checkpoint_lsn_;
+  *analysis_lsn = analysis_lsn_;
+  return checkpoint_lsn_ != INVALID_LSN;
+}
+
+void DiskManager::SetLogSegmentSize(int segment_size) {
+  std::scoped_lock<std::mutex> lock(log_latch_);
+  if (log_end_ != 0 || segment_size <= 0) {
+    LOG_DEBUG("the log segment size can only change while the log is empty");
+    return;
+  }
+  log_segment_size_ = segment_size;
+  WriteLogMaster();
+}
+
+int DiskManager::GetLogStart() {
+  std::scoped_lock<std::mutex> lock(log_latch_);
+  return first_log_segment_ * log_segment_size_;
+}
+
+int DiskManager::GetNumLogSegments() {
+  std::scoped_lock<std::mutex> lock(log_latch_);
+  if (log_end_ == first_log_segment_ * log_segment_size_) {
+    return 0;
+  }
+  return (log_end_ - 1) / log_segment_size_ - first_log_segment_ + 1;
+}
+
+std::string DiskManager::LogSegmentName(int segment) const { return log_name_ + "." + std::to_string(segment); }
+
+bool DiskManager::LoadLogMaster() {
+  std::ifstream master(log_name_, std::ios::binary | std::ios::in);
+  uint32_t header[6];
+  if (!master.is_open() || !master.read(reinterpret_cast<char *>(header), sizeof(header)) ||
+      header[0] != LOG_MASTER_MAGIC) {
+    return false;
+  }
+  log_segment_size_ = static_cast<int>(header[1]);
+  first_log_segment_ = static_cast<int>(header[2]);
+  checkpoint_lsn_ = static_cast<lsn_t>(header[3]);
+  analysis_lsn_ = static_cast<lsn_t>(header[4]);
+  for (uint32_t i = 0; i < header[5]; i++) {
+    int32_t entry[2];
+    if (!master.read(reinterpret_cast<char *>(entry), sizeof(entry))) {
+      break;
+    }
+    log_segment_index_[entry[0]] = entry[1];
+    last_indexed_segment_ = std::max(last_indexed_segment_, entry[1] / log_segment_size_);
+  }
+  return true;
+}
+
+/**
+ * Written to a temporary file that is then renamed over the old one, so there is always a complete master record.
+ */
+void DiskManager::WriteLogMaster() {
+  std::string tmp_name = log_name_ + ".tmp";
+  std::ofstream master(tmp_name, std::ios::binary | std::ios::trunc | std::ios::out);
+  uint32_t header[6] = {LOG_MASTER_MAGIC,
+                        static_cast<uint32_t>(log_segment_size_),
+                        static_cast<uint32_t>(first_log_segment_),
+                        static_cast<uint32_t>(checkpoint_lsn_),
+                        static_cast<uint32_t>(analysis_lsn_),
+                        static_cast<uint32_t>(log_segment_index_.size())};
+  master.write(reinterpret_cast<const char *>(header), sizeof(header));
+  for (const auto &entry : log_segment_index_) {
+    int32_t data[2] = {entry.first, entry.second};
+    master.write(reinterpret_cast<const char *>(data), sizeof(data));
+  }
+  master.close();
+  if (master.fail() || rename(tmp_name.c_str(), log_name_.c_str()) != 0) {
+    LOG_DEBUG("I/O error while writing the log master record");
+  }
+}
+
+void DiskManager::RemoveLogSegments() {
+  std::filesystem::path log_path(log_name_);
+  std::filesystem::path dir = log_path.has_parent_path() ? log_path.parent_path() : std::filesystem::path(".");
+  std::string prefix = log_path.filename().string() + ".";
+  std::error_code ec;
+  for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+    std::string name = entry.path().filename().string();
+    if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0 &&
+        std::all_of(name.begin() + prefix.size(), name.end(), [](char c) { return isdigit(c) != 0; })) {
+      std::filesystem::remove(entry.path(), ec);
+    }
+  }
+}
+
 /**
  * Allocate new page (operations like create index/table)
  * For now just keep an increasing counter
  */
-page_id_t DiskManager::AllocatePage() { return next_page_id_++; }
+page_id_t DiskManager::AllocatePage() {
+  page_id_t page_id = next_page_id_++;
+  if (!enable_compression_) {
+    EnsurePreallocated(static_cast<size_t>(page_id + 1) * PAGE_SIZE);
+  }
+  return page_id;
+}
+
+/**
+ * Move the allocation counter forward to next_page_id if it is behind
+ */
+void DiskManager::ReservePageIds(page_id_t next_page_id) {
+  page_id_t current = next_page_id_.load();
+  while (current < next_page_id && !next_page_id_.compare_exchange_weak(current, next_page_id)) {
+  }
+}
 
 /**
  * Deallocate page (operations like drop index/table)
@@ -207,6 +582,73 @@ int DiskManager::GetNumFlushes() const { return num_flushes_; }
  */
 int DiskManager::GetNumWrites() const { return num_writes_; }
 
+/**
+ * Returns the compression ratio of the live pages
+ */
+double DiskManager::GetCompressionRatio() const {
+  if (!enable_compression_ || live_slot_bytes_ == 0) {
+    return 1.0;
+  }
+  return static_cast<double>(page_slots_.size() * PAGE_SIZE) / static_cast<double>(live_slot_bytes_);
+}
+
+/**
+ * Change the preallocation chunk size, 0 turns preallocation off
+ */
+void DiskManager::SetPreallocateChunkSize(size_t chunk_size) {
+  std::scoped_lock prealloc_lock{prealloc_latch_};
+  prealloc_chunk_size_ = chunk_size;
+}
+
+/**
+ * Returns how many bytes are reserved past the allocated pages
+ */
+size_t DiskManager::GetPreallocatedHeadroom() {
+  std::scoped_lock prealloc_lock{prealloc_latch_};
+  size_t end = AllocatedEnd();
+  return prealloc_end_ > end ? prealloc_end_ - end : 0;
+}
+
+size_t DiskManager::AllocatedEnd() const {
+  return enable_compression_ ? slot_end_ : static_cast<size_t>(next_page_id_.load()) * PAGE_SIZE;
+}
+
+/**
+ * Reserve the next extent of the db file ahead of time so that growing the file does not allocate blocks one page at
+ * a time. FALLOC_FL_KEEP_SIZE leaves the file size alone, so reads past the written pages behave as before. It is
+ * Linux only, elsewhere the file grows on demand.
+ */
+void DiskManager::EnsurePreallocated(size_t end) {
+  std::scoped_lock prealloc_lock{prealloc_latch_};
+  if (prealloc_chunk_size_ == 0 || db_fd_ < 0 || end + prealloc_chunk_size_ / 4 <= prealloc_end_) {
+    return;
+  }
+#ifdef __linux__
+  size_t start = std::max(prealloc_end_, end);
+  size_t new_end = (start / prealloc_chunk_size_ + 1) * prealloc_chunk_size_;
+  if (fallocate(db_fd_, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(prealloc_end_),
+                static_cast<off_t>(new_end - prealloc_end_)) != 0) {
+    // e.g. the file system does not support it, just grow the file on demand
+    LOG_DEBUG("fallocate failed, disabling preallocation");
+    prealloc_chunk_size_ = 0;
+    return;
+  }
+  prealloc_end_ = new_end;
+#else
+  // posix_fallocate would grow the file and with it the page count read from its size, so there is no preallocation
+  // without FALLOC_FL_KEEP_SIZE and the headroom stays 0
+  prealloc_chunk_size_ = 0;
+#endif
+}
+
+/**
+ * Returns the size of the log file
+ */
+int DiskManager::GetLogSize() {
+  std::scoped_lock<std::mutex> lock(log_latch_);
+  return log_end_;
+}
+
 /**
  * Returns true if the log is currently being flushed
  */
@@ -0,0 +1,173 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_codec.cpp
+//
+// Identification: src/storage/disk/page_codec.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/page_codec.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace bustub {
+
+namespace {
+
+inline uint32_t Load32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline size_t Hash(uint32_t seq, size_t hash_log) { return (seq * 2654435761U) >> (32 - hash_log); }
+
+/** Append the extension bytes of a length whose nibble saturated at 15. */
+inline bool PutLength(size_t len, uint8_t *out, size_t *op, size_t cap) {
+  while (len >= 255) {
+    if (*op >= cap) {
+      return false;
+    }
+    out[(*op)++] = 255;
+    len -= 255;
+  }
+  if (*op >= cap) {
+    return false;
+  }
+  out[(*op)++] = static_cast<uint8_t>(len);
+  return true;
+}
+
+/** Read the extension bytes of a length whose nibble saturated at 15. */
+inline bool GetLength(const uint8_t *in, size_t *ip, size_t in_size, size_t *len) {
+  uint8_t b;
+  do {
+    if (*ip >= in_size) {
+      return false;
+    }
+    b = in[(*ip)++];
+    *len += b;
+  } while (b == 255);
+  return true;
+}
+
+/** Emit one sequence. match_len == 0 means the final, literal-only sequence. */
+bool EmitSequence(const uint8_t *literals, size_t lit_len, size_t offset, size_t match_len, size_t min_match,
+                  uint8_t *out, size_t *op, size_t cap) {
+  if (*op >= cap) {
+    return false;
+  }
+  size_t token_pos = (*op)++;
+  uint8_t lit_nibble = lit_len >= 15 ? 15 : static_cast<uint8_t>(lit_len);
+  size_t match_code = match_len == 0 ? 0 : match_len - min_match;
+  uint8_t match_nibble = match_code >= 15 ? 15 : static_cast<uint8_t>(match_code);
+  out[token_pos] = static_cast<uint8_t>((lit_nibble << 4) | match_nibble);
+  if (lit_nibble == 15 && !PutLength(lit_len - 15, out, op, cap)) {
+    return false;
+  }
+  if (*op + lit_len > cap) {
+    return false;
+  }
+  memcpy(out + *op, literals, lit_len);
+  *op += lit_len;
+  if (match_len == 0) {
+    return true;
+  }
+  if (*op + 2 > cap) {
+    return false;
+  }
+  out[(*op)++] = static_cast<uint8_t>(offset & 0xFF);
+  out[(*op)++] = static_cast<uint8_t>(offset >> 8);
+  return match_nibble != 15 || PutLength(match_code - 15, out, op, cap);
+}
+
+}  // namespace
+
+size_t PageCodec::Compress(const char *src, size_t src_size, char *dst, size_t dst_capacity) {
+  const auto *in = reinterpret_cast<const uint8_t *>(src);
+  auto *out = reinterpret_cast<uint8_t *>(dst);
+  std::vector<int32_t> table(static_cast<size_t>(1) << HASH_LOG, -1);
+  size_t op = 0;
+  size_t anchor = 0;
+  size_t ip = 0;
+
+  while (ip + MIN_MATCH <= src_size) {
+    uint32_t seq = Load32(in + ip);
+    size_t h = Hash(seq, HASH_LOG);
+    int32_t ref = table[h];
+    table[h] = static_cast<int32_t>(ip);
+    if (ref < 0 || ip - static_cast<size_t>(ref) > MAX_OFFSET || Load32(in + ref) != seq) {
+      ip++;
+      continue;
+    }
+    // Extend the match as far as it goes; overlapping matches are how runs get encoded.
+    size_t len = MIN_MATCH;
+    while (ip + len < src_size && in[ref + len] == in[ip + len]) {
+      len++;
+    }
+    if (!EmitSequence(in + anchor, ip - anchor, ip - ref, len, MIN_MATCH, out, &op, dst_capacity)) {
+      return 0;
+    }
+    ip += len;
+    anchor = ip;
+  }
+
+  if (!EmitSequence(in + anchor, src_size - anchor, 0, 0, MIN_MATCH, out, &op, dst_capacity)) {
+    return 0;
+  }
+  return op;
+}
+
+bool PageCodec::Decompress(const char *src, size_t src_size, char *dst, size_t dst_size) {
+  const auto *in = reinterpret_cast<const uint8_t *>(src);
+  auto *out = reinterpret_cast<uint8_t *>(dst);
+  size_t ip = 0;
+  size_t op = 0;
+
+  while (ip < src_size) {
+    uint8_t token = in[ip++];
+    size_t lit_len = token >> 4;
+    if (lit_len == 15 && !GetLength(in, &ip, src_size, &lit_len)) {
+      return false;
+    }
+    if (ip + lit_len > src_size || op + lit_len > dst_size) {
+      return false;
+    }
+    memcpy(out + op, in + ip, lit_len);
+    ip += lit_len;
+    op += lit_len;
+    if (ip == src_size) {
+      // The final sequence has no match part.
+      break;
+    }
+
+    if (ip + 2 > src_size) {
+      return false;
+    }
+    size_t offset = in[ip] | (static_cast<size_t>(in[ip + 1]) << 8);
+    ip += 2;
+    size_t match_len = token & 0x0F;
+    if (match_len == 15 && !GetLength(in, &ip, src_size, &match_len)) {
+      return false;
+    }
+    match_len += MIN_MATCH;
+    if (offset == 0 || offset > op || op + match_len > dst_size) {
+      return false;
+    }
+    // Byte-wise copy on purpose: the source may overlap the destination.
+    const uint8_t *ref = out + op - offset;
+    for (size_t i = 0; i < match_len; i++) {
+      out[op + i] = ref[i];
+    }
+    op += match_len;
+  }
+  return op == dst_size;
+}
+
+}  // namespace bustub
@@ -9,8 +9,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <cassert>
 #include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
 
 #include "common/exception.h"
 #include "common/rid.h"
@@ -20,19 +24,47 @@
 namespace bustub {
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                          int leaf_max_size, int internal_max_size)
+                          int leaf_max_size, int internal_max_size, LogManager *log_manager)
     : index_name_(std::move(name)),
       root_page_id_(INVALID_PAGE_ID),
       buffer_pool_manager_(buffer_pool_manager),
       comparator_(comparator),
       leaf_max_size_(leaf_max_size),
-      internal_max_size_(internal_max_size) {}
+      internal_max_size_(internal_max_size),
+      log_manager_(log_manager) {}
+
+/*
+ * Attach to an existing tree: UpdateRootPageId keeps the root of every tree in
+ * the header page, so reopening only has to read it back from there.
+ * @return : true means an existing, non-empty tree was found
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::Open() {
+  auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  header_page->RLatch();
+  if (!header_page->GetRootId(index_name_, &root_page_id_)) {
+    root_page_id_ = INVALID_PAGE_ID;
+  }
+  header_page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  return !IsEmpty();
+}
 
 /*
  * Helper function to decide whether current b+tree is empty
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::IsEmpty() const { return root_page_id_ == INVALID_PAGE_ID; }
+
+/*
+ * Whether page_id is still the root. Read under root_latch_, since a split or AdjustRoot may be replacing it.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::IsRoot(page_id_t page_id) {
+  std::scoped_lock lock(root_latch_);
+  return page_id == root_page_id_;
+}
+
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
@@ -47,6 +79,9 @@ bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
     return false;
   }
   Page *page = FindLeafPage(key, false, Operation::READ, transaction);
+  if (page == nullptr) {
+    return false;
+  }
   LeafPage *leaf_page = reinterpret_cast<LeafPage *>(page->GetData());
   ValueType value{};
   bool exist;
@@ -57,6 +92,7 @@ bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
   if (transaction != nullptr) {
     UnpinAndUnLatch(Operation::READ, transaction);
   } else {
+    page->RUnlatch();
     buffer_pool_manager_->UnpinPage(leaf_page->GetPageId(), false);
   }
   return exist;
@@ -77,13 +113,14 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transact
   // if(transaction != nullptr) {std::cout<<transaction->GetThreadId()<<" in Insert "<<std::endl;}
   root_latch_.lock();
   if (IsEmpty()) {
-    StartNewTree(key, value);
+    StartNewTree(key, value, transaction);
     root_latch_.unlock();
     return true;
   }
   root_latch_.unlock();
   bool ans = InsertIntoLeaf(key, value, transaction, false);
   UnpinAndUnLatch(Operation::INSERT, transaction);
+  FixStaleLinks();
   // if(transaction != nullptr) {std::cout<<transaction->GetThreadId()<<" out Insert "<<std::endl;}
   return ans;
 }
@@ -94,7 +131,7 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transact
  * tree's root page id and insert entry directly into leaf page.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
+void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value, Transaction *transaction) {
   Page *page = buffer_pool_manager_->NewPage(&root_page_id_);
   // std::cout<<"up startnewtree\n";
   page->WLatch();
@@ -106,7 +143,9 @@ void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
   root_page_id_ = page->GetPageId();
   LeafPage *root_page = reinterpret_cast<LeafPage *>(page->GetData());
   root_page->Init(root_page_id_, root_page_id_, leaf_max_size_);
+  LogPage(root_page);
   root_page->Insert(key, value, comparator_);
+  LogLeafEntry(LogRecordType::BTREEINSERT, root_page, 0, root_page->GetItem(0), transaction);
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(root_page_id_, true);
   UpdateRootPageId(0);
@@ -126,7 +165,10 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
                                     bool notfull) {
   // FindLeafPageInTran(key, false, transaction, notfull);
   Page *leaf_page = FindLeafPage(key, false, Operation::INSERT, transaction);
-  assert(leaf_page != nullptr);
+  if (leaf_page == nullptr) {
+    // a concurrent remove emptied the tree after Insert found it non-empty
+    return Insert(key, value, transaction);
+  }
   LeafPage *leaf = reinterpret_cast<LeafPage *>(leaf_page->GetData());
   if (leaf->GetPageId() == -1 || leaf->GetParentPageId() == -1) {
     std::cout << "warning\n";
@@ -136,12 +178,15 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
   int new_size = leaf->Insert(key, value, comparator_);
   bool inserted = (new_size > old_size);
   if (inserted) {
+    if (IsLogging()) {
+      int index = leaf->KeyIndex(key, comparator_);
+      LogLeafEntry(LogRecordType::BTREEINSERT, leaf, index, leaf->GetItem(index), transaction);
+    }
     if (new_size == leaf_max_size_) {
       // std::cout<<transaction->GetThreadId()<<" split the page"<<std::endl;
       LeafPage *new_leaf_ptr = Split(leaf, transaction);
-      new_leaf_ptr->SetNextPageId(leaf->GetNextPageId());
-      leaf->SetNextPageId(new_leaf_ptr->GetPageId());
-      InsertIntoParent(leaf, new_leaf_ptr->KeyAt(0), new_leaf_ptr, transaction);
+      KeyType separator = *new_leaf_ptr->GetLowKey();
+      InsertIntoParent(leaf, separator, new_leaf_ptr, transaction);
       return true;
     }
   } else {
@@ -181,6 +226,12 @@ N *BPLUSTREE_TYPE::Split(N *node, Transaction *transaction) {
     LeafPage *new_leaf_page = reinterpret_cast<LeafPage *>(page->GetData());
     new_leaf_page->Init(new_page_id, INVALID_PAGE_ID, leaf_max_size_);
     leaf_page->MoveHalfTo(new_leaf_page);
+    // the parent only needs a key between the two halves, the shortest one keeps internal pages small
+    KeyType separator = KeyType::Separator(leaf_page->KeyAt(leaf_page->GetSize() - 1), new_leaf_page->KeyAt(0));
+    LinkSplit(leaf_page, new_leaf_page, separator);
+    new_leaf_page->SetPrePageId(leaf_page->GetPageId());
+    SetPrevLink(new_leaf_page->GetNextPageId(), new_page_id, leaf_page->GetParentPageId(), leaf_page->GetPageId(),
+                transaction);
     // std::cout<<transaction->GetThreadId()<<" out leaf split for page "<<node->GetPageId()<<std::endl;
     return reinterpret_cast<N *>(new_leaf_page);
   }
@@ -188,6 +239,8 @@ N *BPLUSTREE_TYPE::Split(N *node, Transaction *transaction) {
   InternalPage *new_inter_page = reinterpret_cast<InternalPage *>(page->GetData());
   new_inter_page->Init(new_page_id, INVALID_PAGE_ID, internal_max_size_);
   inter_page->MoveHalfTo(new_inter_page, buffer_pool_manager_);
+  LinkSplit(inter_page, new_inter_page, new_inter_page->KeyAt(0));
+  LogChildren(new_inter_page, 0, new_inter_page->GetSize(), transaction);
   // std::cout<<transaction->GetThreadId()<<" out inter split for page "<<node->GetPageId()<<std::endl;
   return reinterpret_cast<N *>(new_inter_page);
 }
@@ -224,6 +277,9 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
     new_root_inter_page->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
     old_node->SetParentPageId(root_page_id_);
     new_node->SetParentPageId(root_page_id_);
+    LogPage(new_root_inter_page);
+    LogPage(old_node);
+    LogPage(new_node);
     if (transaction == nullptr) {
       buffer_pool_manager_->UnpinPage(root_page_id_, true);
       buffer_pool_manager_->UnpinPage(new_node->GetPageId(), true);
@@ -239,21 +295,29 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
   page_id_t parent_page_id = old_node->GetParentPageId();
   InternalPage *parent_page =
       reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(parent_page_id)->GetData());
-  int new_size = parent_page->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId());
+  parent_page->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId());
   new_node->SetParentPageId(parent_page_id);
+  LogPage(old_node);
+  LogPage(new_node);
   if (transaction == nullptr) {
     buffer_pool_manager_->UnpinPage(old_node->GetPageId(), true);
     buffer_pool_manager_->UnpinPage(new_node->GetPageId(), true);
   }
-  if (new_size > parent_page->GetMaxSize()) {
+  if (parent_page->IsOverflowing()) {
     // 处理产生新root节点的问题！
     // std::cout<<"Before Split happened\n";
     // Print();
     InternalPage *new_inter_page = Split(parent_page, transaction);
     // std::cout<<"Split happened\n";
     // Print();
-    InsertIntoParent(parent_page, new_inter_page->KeyAt(0), new_inter_page, transaction);
+    KeyType separator = *new_inter_page->GetLowKey();
+    InsertIntoParent(parent_page, separator, new_inter_page, transaction);
+    if (transaction != nullptr) {
+      // the page set holds its own pin on the parent, drop the one taken above
+      buffer_pool_manager_->UnpinPage(parent_page_id, true);
+    }
   } else {
+    LogPage(parent_page);
     // if (transaction == nullptr) {
     buffer_pool_manager_->UnpinPage(parent_page_id, true);
     // }
@@ -262,6 +326,188 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
   // "<<old_node->GetPageId()<<new_node->GetPageId()<<" to "<<parent_page_id<<std::endl;
 }
 
+/*****************************************************************************
+ * BULK LOADING
+ *****************************************************************************/
+/*
+ * Build the tree bottom-up from entries in ascending key order: pack the leaves left to right, then every internal
+ * level from the first keys and page ids of the level below, until a level has a single page, the root. Pages are
+ * filled to fill_factor of their capacity but never below their min size; the last two leaves share their entries
+ * if the last one would end up too small. A key that repeats is loaded once, like Insert does.
+ * Nobody may use the tree while it is loaded. Every page is logged once it is complete.
+ * @return false if the tree is not empty
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::BulkLoad(const std::function<bool(MappingType *)> &next, double fill_factor) {
+  if (!IsEmpty()) {
+    return false;
+  }
+  auto fill_count = [fill_factor](int capacity, int min_size) {
+    return std::clamp(static_cast<int>(capacity * fill_factor), std::max(min_size, 1), capacity);
+  };
+
+  // first key and page id of every page of the level built last
+  std::vector<std::pair<KeyType, page_id_t>> level;
+  int leaf_fill = fill_count(leaf_max_size_ - 1, leaf_max_size_ / 2);
+  LeafPage *prev_leaf = nullptr;
+  LeafPage *leaf = nullptr;
+  // the leaves still pinned when the load fails
+  auto unpin_leaves = [this, &prev_leaf, &leaf] {
+    for (LeafPage *page : {prev_leaf, leaf}) {
+      if (page != nullptr) {
+        buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+      }
+    }
+  };
+  MappingType entry;
+  while (next(&entry)) {
+    if (leaf != nullptr) {
+      int order = comparator_(entry.first, leaf->KeyAt(leaf->GetSize() - 1));
+      if (order == 0) {
+        continue;
+      }
+      if (order < 0) {
+        unpin_leaves();
+        throw Exception("bulk load input is not sorted");
+      }
+    }
+    if (leaf == nullptr || leaf->GetSize() == leaf_fill) {
+      page_id_t page_id;
+      Page *page = buffer_pool_manager_->NewPage(&page_id);
+      if (page == nullptr) {
+        unpin_leaves();
+        throw Exception(ExceptionType::OUT_OF_MEMORY, "out of memory while bulk loading");
+      }
+      auto *new_leaf = reinterpret_cast<LeafPage *>(page->GetData());
+      new_leaf->Init(page_id, INVALID_PAGE_ID, leaf_max_size_);
+      KeyType separator = entry.first;
+      if (leaf != nullptr) {
+        separator = KeyType::Separator(leaf->KeyAt(leaf->GetSize() - 1), entry.first);
+        leaf->SetNextPageId(page_id);
+        leaf->SetHighKey(&separator);
+        new_leaf->SetLowKey(&separator);
+        new_leaf->SetPrePageId(leaf->GetPageId());
+      }
+      if (prev_leaf != nullptr) {
+        buffer_pool_manager_->UnpinPage(prev_leaf->GetPageId(), true);
+      }
+      prev_leaf = leaf;
+      leaf = new_leaf;
+      level.emplace_back(separator, page_id);
+    }
+    leaf->InsertAt(leaf->GetSize(), entry.first, entry.second);
+  }
+  if (leaf == nullptr) {
+    return true;
+  }
+  if (prev_leaf != nullptr) {
+    if (leaf->GetSize() < leaf->GetMinSize()) {
+      int half = (prev_leaf->GetSize() + leaf->GetSize()) / 2;
+      while (leaf->GetSize() < half) {
+        prev_leaf->MoveLastToFrontOf(leaf);
+      }
+      KeyType separator = KeyType::Separator(prev_leaf->KeyAt(prev_leaf->GetSize() - 1), leaf->KeyAt(0));
+      prev_leaf->SetHighKey(&separator);
+      leaf->SetLowKey(&separator);
+      level.back().first = separator;
+    }
+    buffer_pool_manager_->UnpinPage(prev_leaf->GetPageId(), true);
+  }
+  buffer_pool_manager_->UnpinPage(leaf->GetPageId(), true);
+
+  int internal_fill = fill_count(internal_max_size_, (internal_max_size_ + 1) / 2);
+  auto size_limit = static_cast<double>(InternalPage::GetSizeLimit());
+  auto internal_fill_size = static_cast<size_t>(std::clamp(size_limit * fill_factor, size_limit / 2, size_limit));
+  while (level.size() > 1) {
+    // the bytes of the entries [begin, end) as one page, fenced by the first keys of the pages around it
+    size_t count = level.size();
+    auto page_size = [&level, count](size_t begin, size_t end) {
+      return InternalPage::EncodedSize(&level[begin], static_cast<int>(end - begin),
+                                       begin == 0 ? nullptr : &level[begin].first,
+                                       end == count ? nullptr : &level[end].first);
+    };
+    // keys compress differently, so fill every page as far as internal_fill entries and internal_fill_size bytes go
+    std::vector<size_t> ends;
+    for (size_t begin = 0; begin < count; begin = ends.back()) {
+      size_t low = begin + 1;
+      size_t high = std::min(count, begin + internal_fill);
+      while (low < high) {
+        size_t middle = (low + high + 1) / 2;
+        if (page_size(begin, middle) <= internal_fill_size) {
+          low = middle;
+        } else {
+          high = middle - 1;
+        }
+      }
+      ends.push_back(low);
+    }
+    // a last page that would underflow shares the entries with the one before it
+    if (ends.size() > 1) {
+      size_t last_begin = ends[ends.size() - 2];
+      size_t begin = ends.size() > 2 ? ends[ends.size() - 3] : 0;
+      size_t middle = (begin + count) / 2;
+      if (count - last_begin < static_cast<size_t>((internal_max_size_ + 1) / 2) &&
+          page_size(last_begin, count) < InternalPage::GetSizeLimit() / 2 &&
+          page_size(middle, count) <= internal_fill_size) {
+        ends[ends.size() - 2] = middle;
+      }
+    }
+
+    std::vector<std::pair<KeyType, page_id_t>> upper_level;
+    InternalPage *prev_inter = nullptr;
+    size_t begin = 0;
+    for (size_t end : ends) {
+      page_id_t page_id;
+      Page *page = buffer_pool_manager_->NewPage(&page_id);
+      if (page == nullptr) {
+        if (prev_inter != nullptr) {
+          buffer_pool_manager_->UnpinPage(prev_inter->GetPageId(), true);
+        }
+        throw Exception(ExceptionType::OUT_OF_MEMORY, "out of memory while bulk loading");
+      }
+      auto *inter = reinterpret_cast<InternalPage *>(page->GetData());
+      inter->Init(page_id, INVALID_PAGE_ID, internal_max_size_);
+      if (prev_inter != nullptr) {
+        prev_inter->SetNextPageId(page_id);
+        inter->SetLowKey(&level[begin].first);
+        buffer_pool_manager_->UnpinPage(prev_inter->GetPageId(), true);
+      }
+      // the entries were measured compressed for both fences
+      if (end != count) {
+        inter->SetHighKey(&level[end].first);
+      }
+      inter->PopulateFrom(&level[begin], static_cast<int>(end - begin));
+      for (size_t j = begin; j < end; j++) {
+        FinishBulkPage(level[j].second, page_id);
+      }
+      prev_inter = inter;
+      upper_level.emplace_back(level[begin].first, page_id);
+      begin = end;
+    }
+    buffer_pool_manager_->UnpinPage(prev_inter->GetPageId(), true);
+    level = std::move(upper_level);
+  }
+
+  page_id_t root_page_id = level[0].second;
+  FinishBulkPage(root_page_id, root_page_id);
+  root_latch_.lock();
+  root_page_id_ = root_page_id;
+  root_latch_.unlock();
+  UpdateRootPageId(0);
+  return true;
+}
+
+/*
+ * Give a bulk loaded page its parent, which is itself for the root, and log the complete page.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::FinishBulkPage(page_id_t page_id, page_id_t parent_page_id) {
+  auto *node = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+  node->SetParentPageId(parent_page_id);
+  LogPage(node);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
+
 /*****************************************************************************
  * REMOVE
  *****************************************************************************/
@@ -287,6 +533,9 @@ void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
     // std::cout<<"warning\n";
   }
   int old_size = leaf->GetSize();
+  // the slot and the entry are logged, find them before they are gone
+  int index = IsLogging() ? leaf->KeyIndex(key, comparator_) : -1;
+  MappingType entry = index >= 0 && index < old_size ? leaf->GetItem(index) : MappingType{};
   int new_size = leaf->RemoveAndDeleteRecord(key, comparator_);
   if (old_size == new_size) {
     // printf("BPLUSTREE_TYPE::Remove: delete key not exist\n");
@@ -297,6 +546,7 @@ void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
     }
     return;
   }
+  LogLeafEntry(LogRecordType::BTREEDELETE, leaf, index, entry, transaction);
   // bool page_coalesce_deleted = false;
   if (leaf->GetSize() < leaf->GetMinSize()) {
     // 持有root锁，当前页写锁，可能持有parent写锁
@@ -308,6 +558,7 @@ void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
     }
   }
   UnpinAndUnLatch(Operation::DELETE, transaction);
+  FixStaleLinks();
   // if(transaction != nullptr) {std::cout<<transaction->GetThreadId()<<" out Remove "<<std::endl;}
 }
 
@@ -340,6 +591,10 @@ bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
 
   Page *parent_page = buffer_pool_manager_->FetchPage(parent_id);
   InternalPage *parent_ptr = reinterpret_cast<InternalPage *>(parent_page);
+  if (transaction != nullptr) {
+    // the page set holds its own pin on the parent
+    buffer_pool_manager_->UnpinPage(parent_id, false);
+  }
   int node_index_in_parent = parent_ptr->ValueIndex(node->GetPageId());
   if (parent_id < 0 || node_index_in_parent < 0) {
     // std::cout<<"warning\n";
@@ -351,10 +606,10 @@ bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
     pre_ptr = reinterpret_cast<N *>(pre_page);
     pre_page->WLatch();
     transaction->AddIntoPageSet(pre_page);
-    if (pre_ptr->GetSize() + node->GetSize() >= node->GetMaxSize()) {
+    if (!CanCoalesce(pre_ptr, node, parent_ptr->KeyAt(node_index_in_parent))) {
       // pre_page->WLatch();
       // transaction->AddIntoPageSet(pre_page);
-      Redistribute(pre_ptr, node, 1);
+      Redistribute(pre_ptr, node, 1, transaction);
       return false;
     }
   }
@@ -364,10 +619,10 @@ bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
     next_ptr = reinterpret_cast<N *>(next_page);
     next_page->WLatch();
     transaction->AddIntoPageSet(next_page);
-    if (next_ptr->GetSize() + node->GetSize() >= node->GetMaxSize()) {
+    if (!CanCoalesce(node, next_ptr, parent_ptr->KeyAt(node_index_in_parent + 1))) {
       // next_page->WLatch();
       // transaction->AddIntoPageSet(next_page);
-      Redistribute(next_ptr, node, 0);
+      Redistribute(next_ptr, node, 0, transaction);
       return false;
     }
   }
@@ -386,13 +641,28 @@ bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
     // transaction->AddIntoPageSet(next_page);
     // std::cout<<"Before Coalesce happened\n";
     // Print();
-    Coalesce(&next_ptr, &node, &parent_ptr, node_index_in_parent, transaction, false);
+    // merge the right sibling into node instead, so the leaf chain never points at a deleted page
+    Coalesce(&node, &next_ptr, &parent_ptr, node_index_in_parent + 1, transaction);
     // std::cout<<"Coalesce happened\n";
     // Print();
   }
   return true;
 }
 
+/*
+ * Whether right and the middle key from the parent fit into left, else the two redistribute. Internal pages have to
+ * fit by bytes as well.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::CanCoalesce(LeafPage *left, LeafPage *right, [[maybe_unused]] const KeyType &middle_key) const {
+  return left->GetSize() + right->GetSize() < left->GetMaxSize();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::CanCoalesce(InternalPage *left, InternalPage *right, const KeyType &middle_key) const {
+  return left->GetSize() + right->GetSize() < left->GetMaxSize() && left->CanMerge(right, middle_key);
+}
+
 /*
  * Move all the key & value pairs from one page to its sibling page, and notify
  * buffer pool manager to delete this page. Parent page must be adjusted to
@@ -412,40 +682,64 @@ bool BPLUSTREE_TYPE::Coalesce(N **neighbor_node, N **node,
                               Transaction *transaction, bool ToLeft) {
   // std::cout<<transaction->GetThreadId()<<" in coalesce for page "<<(*node)->GetPageId()<<"
   // "<<(*neighbor_node)->GetPageId()<<" to "<<(*parent)->GetPageId()<<std::endl;
+  // a merged leaf a stale left link may still point at stays allocated, marked deleted, see FixStaleLinks
+  bool linked = true;
   if (ToLeft) {
     if ((*node)->IsLeafPage()) {
       LeafPage *leaf_page = reinterpret_cast<LeafPage *>(*node);
       LeafPage *neighbor_leaf_page = reinterpret_cast<LeafPage *>(*neighbor_node);
       leaf_page->MoveAllTo(neighbor_leaf_page);
       neighbor_leaf_page->SetNextPageId(leaf_page->GetNextPageId());
+      neighbor_leaf_page->SetHighKey(leaf_page->GetHighKey());
+      SetPrevLink(leaf_page->GetNextPageId(), neighbor_leaf_page->GetPageId(), (*parent)->GetPageId(),
+                  leaf_page->GetPageId(), transaction);
+      leaf_page->SetDeleted();
+      linked = RetireLeaf(leaf_page->GetPageId(), INVALID_PAGE_ID);
     } else {
       KeyType middle_key = (*parent)->KeyAt(index);
       InternalPage *inter_page = reinterpret_cast<InternalPage *>(*node);
       InternalPage *neighbor_inter_page = reinterpret_cast<InternalPage *>(*neighbor_node);
+      int old_size = neighbor_inter_page->GetSize();
       (inter_page)->MoveAllTo(neighbor_inter_page, middle_key, buffer_pool_manager_);
+      neighbor_inter_page->SetNextPageId(inter_page->GetNextPageId());
+      neighbor_inter_page->SetHighKey(inter_page->GetHighKey());
+      inter_page->SetDeleted();
+      LogChildren(neighbor_inter_page, old_size, neighbor_inter_page->GetSize(), transaction);
     }
   } else {
     if ((*node)->IsLeafPage()) {
       LeafPage *leaf_page = reinterpret_cast<LeafPage *>(*node);
       LeafPage *neighbor_leaf_page = reinterpret_cast<LeafPage *>(*neighbor_node);
       leaf_page->MoveAllTo(neighbor_leaf_page, false);
+      neighbor_leaf_page->SetLowKey(leaf_page->GetLowKey());
+      neighbor_leaf_page->SetPrePageId(leaf_page->GetPrePageId());
+      leaf_page->SetDeleted();
+      linked = RetireLeaf(leaf_page->GetPageId(), neighbor_leaf_page->GetPageId());
     } else {
       KeyType middle_key =
           (*parent)->KeyAt(index + 1);  // 注意细节，往右合并，拿下来的key是在index+1位置的，是原本对应于兄弟的
       InternalPage *inter_page = reinterpret_cast<InternalPage *>(*node);
       InternalPage *neighbor_inter_page = reinterpret_cast<InternalPage *>(*neighbor_node);
+      int moved = inter_page->GetSize();
       (inter_page)->MoveAllTo(neighbor_inter_page, middle_key, buffer_pool_manager_, false);
+      neighbor_inter_page->SetLowKey(inter_page->GetLowKey());
+      inter_page->SetDeleted();
+      LogChildren(neighbor_inter_page, 0, moved, transaction);
     }
   }
   (*parent)->Remove(index);
+  LogPage(*neighbor_node);
+  LogPage(*parent);
   if (transaction == nullptr) {
     buffer_pool_manager_->UnpinPage((*node)->GetPageId(), true);
     buffer_pool_manager_->UnpinPage((*neighbor_node)->GetPageId(), true);
-    assert(buffer_pool_manager_->DeletePage((*node)->GetPageId()));
-  } else {
+    if (linked) {
+      assert(buffer_pool_manager_->DeletePage((*node)->GetPageId()));
+    }
+  } else if (linked) {
     transaction->AddIntoDeletedPageSet((*node)->GetPageId());
   }
-  if ((*parent)->GetSize() < (*parent)->GetMinSize()) {
+  if ((*parent)->IsUnderflowing()) {
     // std::cout<<transaction->GetThreadId()<<" out coalesce for page
     // "<<(*node)->GetPageId()<<(*neighbor_node)->GetPageId()<<" to "<<(*parent)->GetPageId()<<std::endl;
     return CoalesceOrRedistribute((*parent), transaction);
@@ -462,12 +756,14 @@ bool BPLUSTREE_TYPE::Coalesce(N **neighbor_node, N **node,
  * "node".
  * 即0表示node在左边，否则node在右边。
  * Using template N to represent either internal page or leaf page.
+ * The new key in the parent, or the moved entry of internal pages, may not fit in a page whose keys take most of it.
+ * Nothing moves then and node stays below its min size, which costs space but never a lookup.
  * @param   neighbor_node      sibling page of input "node"
  * @param   node               input from method coalesceOrRedistribute()
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {
+void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index, Transaction *transaction) {
   // printf("entering Redistribute\n");
   // 这两个变量用于告诉父节点，应该修改自己的哪个KV对，修改后的key应该来自sibling page的哪儿
   int new_index;
@@ -490,16 +786,31 @@ void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {
     // leaf在右边时，parent的middle_key是leaf的KeyAt(0)，middle_value是leaf的page_id
     // redistribute后，middle_key = sibling->KeyAt(size_ - 1), middle_value不变
     int middle_idx = parent_page->ValueIndex(child_page_id);
-    KeyType to_parent_key = sibling_page->KeyAt(new_index);
+    KeyType to_parent_key = KeyType::Separator(sibling_page->KeyAt(new_index - 1), sibling_page->KeyAt(new_index));
+    if (!parent_page->CanSetKeyAt(middle_idx, to_parent_key)) {
+      buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), false);
+      if (transaction == nullptr) {
+        buffer_pool_manager_->UnpinPage(node->GetPageId(), false);
+        buffer_pool_manager_->UnpinPage(neighbor_node->GetPageId(), false);
+      }
+      return;
+    }
     parent_page->SetKeyAt(middle_idx, to_parent_key);
+    LogPage(parent_page);
     buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);
     if (index == 0) {
       sibling_page->MoveFirstToEndOf(leaf_page);
+      LinkRedistribute(leaf_page, sibling_page, to_parent_key);
     } else {
       sibling_page->MoveLastToFrontOf(leaf_page);
+      LinkRedistribute(sibling_page, leaf_page, to_parent_key);
+    }
+    LogPage(leaf_page);
+    LogPage(sibling_page);
+    if (transaction == nullptr) {
+      buffer_pool_manager_->UnpinPage(node->GetPageId(), true);
+      buffer_pool_manager_->UnpinPage(neighbor_node->GetPageId(), true);
     }
-    buffer_pool_manager_->UnpinPage(node->GetPageId(), true);
-    buffer_pool_manager_->UnpinPage(neighbor_node->GetPageId(), true);
     return;
   }
   InternalPage *inter_page = reinterpret_cast<InternalPage *>(node);
@@ -509,15 +820,33 @@ void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {
   int middle_idx = parent_page->ValueIndex(child_page_id);
   KeyType middle_key = parent_page->KeyAt(middle_idx);
   KeyType to_parent_key = sibling_page->KeyAt(new_index);
+  if (!parent_page->CanSetKeyAt(middle_idx, to_parent_key) ||
+      !inter_page->CanTakeFrom(sibling_page, middle_key, to_parent_key)) {
+    buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), false);
+    if (transaction == nullptr) {
+      buffer_pool_manager_->UnpinPage(node->GetPageId(), false);
+      buffer_pool_manager_->UnpinPage(neighbor_node->GetPageId(), false);
+    }
+    return;
+  }
   parent_page->SetKeyAt(middle_idx, to_parent_key);
+  LogPage(parent_page);
   buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);
   if (index == 0) {
     sibling_page->MoveFirstToEndOf(inter_page, middle_key, buffer_pool_manager_);
+    LinkRedistribute(inter_page, sibling_page, to_parent_key);
+    LogChildHeader(inter_page->ValueAt(inter_page->GetSize() - 1), transaction);
   } else {
     sibling_page->MoveLastToFrontOf(inter_page, middle_key, buffer_pool_manager_);
+    LinkRedistribute(sibling_page, inter_page, to_parent_key);
+    LogChildHeader(inter_page->ValueAt(0), transaction);
+  }
+  LogPage(inter_page);
+  LogPage(sibling_page);
+  if (transaction == nullptr) {
+    buffer_pool_manager_->UnpinPage(node->GetPageId(), true);
+    buffer_pool_manager_->UnpinPage(neighbor_node->GetPageId(), true);
   }
-  buffer_pool_manager_->UnpinPage(node->GetPageId(), true);
-  buffer_pool_manager_->UnpinPage(neighbor_node->GetPageId(), true);
 }
 /*
  * Update root page if necessary
@@ -535,13 +864,16 @@ INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *node, Transaction *transaction) {
   if (node->IsLeafPage()) {
     if (node->GetSize() == 0) {
+      reinterpret_cast<LeafPage *>(node)->SetDeleted();
       if (transaction == nullptr) {
         buffer_pool_manager_->UnpinPage(node->GetPageId(), true);
         assert(buffer_pool_manager_->DeletePage(node->GetPageId()));
       } else {
         transaction->AddIntoDeletedPageSet(node->GetPageId());
       }
+      root_latch_.lock();
       root_page_id_ = INVALID_PAGE_ID;
+      root_latch_.unlock();
       UpdateRootPageId(false);
       return true;
     }
@@ -555,9 +887,14 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *node, Transaction *transaction) {
       throw std::runtime_error("fetch failed");
     }
     new_root_node->SetParentPageId(new_root_node->GetPageId());
+    reinterpret_cast<InternalPage *>(node)->SetDeleted();
+    // readers fetch the root under root_latch_, the old root stays pinned by them or is gone once they look
+    root_latch_.lock();
     root_page_id_ = new_root_node->GetPageId();
+    root_latch_.unlock();
     UpdateRootPageId();
     buffer_pool_manager_->UnpinPage(new_root_node->GetPageId(), true);
+    LogChildHeader(root_page_id_, transaction);
     if (transaction == nullptr) {
       buffer_pool_manager_->UnpinPage(node->GetPageId(), true);
       assert(buffer_pool_manager_->DeletePage(node->GetPageId()));
@@ -584,7 +921,10 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::begin() {
   }
   KeyType key{};
   Page *page = FindLeafPage(key, true);
-  return INDEXITERATOR_TYPE(0, page, buffer_pool_manager_);
+  if (page == nullptr) {
+    return end();
+  }
+  return INDEXITERATOR_TYPE(page, nullptr, buffer_pool_manager_, &comparator_, MakeLeafFinder());
 }
 
 /*
@@ -598,15 +938,11 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
     return end();
   }
   Page *page = FindLeafPage(key, false);
-  LeafPage *leaf_page = reinterpret_cast<LeafPage *>(page->GetData());
-  int index;
-  index = leaf_page->KeyIndex(key, comparator_);
-  // 如果key超过了所有叶节点的所有key，则返回end()
-  if (index != -1) {
-    return INDEXITERATOR_TYPE(index, page, buffer_pool_manager_);
+  if (page == nullptr) {
+    return end();
   }
-  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
-  return end();
+  // 如果key超过了所有叶节点的所有key，迭代器会沿right-link前进，直到end()
+  return INDEXITERATOR_TYPE(page, &key, buffer_pool_manager_, &comparator_, MakeLeafFinder());
 }
 
 /*
@@ -615,7 +951,66 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::end() { return INDEXITERATOR_TYPE(-1, nullptr, buffer_pool_manager_); }
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::end() { return INDEXITERATOR_TYPE(); }
+
+/*
+ * A range scan: starts like Begin(*lower), or begin() without a lower bound, and the iterator stops at the first entry
+ * past upper instead of walking the leaves to the end of the tree.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Scan(const KeyType *lower, const KeyType *upper, ScanInclusivity inclusivity) {
+  if (IsEmpty()) {
+    return end();
+  }
+  KeyType key{};
+  Page *page = lower == nullptr ? FindLeafPage(key, true) : FindLeafPage(*lower, false);
+  if (page == nullptr) {
+    return end();
+  }
+  return INDEXITERATOR_TYPE(page, lower, buffer_pool_manager_, &comparator_, MakeLeafFinder(), upper, inclusivity);
+}
+
+/*
+ * A reverse iterator from the last entry of the tree.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::rbegin() {
+  Page *page = FindLeafPageBefore(nullptr);
+  if (page == nullptr) {
+    return end();
+  }
+  return INDEXITERATOR_TYPE(page, nullptr, buffer_pool_manager_, &comparator_, MakePrevLeafFinder(), nullptr,
+                            ScanInclusivity::BOTH, true);
+}
+
+/*
+ * A reverse iterator from the last entry at or below key, e.g. for the latest n entries before a point in time.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::RBegin(const KeyType &key) {
+  Page *page = FindLeafPageBLink(key, false);
+  if (page == nullptr) {
+    return end();
+  }
+  return INDEXITERATOR_TYPE(page, &key, buffer_pool_manager_, &comparator_, MakePrevLeafFinder(), nullptr,
+                            ScanInclusivity::BOTH, true);
+}
+
+/*
+ * How an iterator finds its way back when the leaf it is on was merged away: a B-link descent to the leaf of a key.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+std::function<Page *(const KeyType &)> BPLUSTREE_TYPE::MakeLeafFinder() {
+  return [this](const KeyType &key) { return FindLeafPageBLink(key, false); };
+}
+
+/*
+ * How a reverse iterator goes on when the left link of its leaf is stale: a descent to the leaf left of a key.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+std::function<Page *(const KeyType &)> BPLUSTREE_TYPE::MakePrevLeafFinder() {
+  return [this](const KeyType &key) { return FindLeafPageBefore(&key); };
+}
 
 /*****************************************************************************
  * UTILITIES AND DEBUG
@@ -628,6 +1023,19 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::end() { return INDEXITERATOR_TYPE(-1, nullptr
 
 INDEX_TEMPLATE_ARGUMENTS
 Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost, Operation op, Transaction *transaction) {
+  if (op == Operation::READ) {
+    Page *leaf_page = FindLeafPageBLink(key, leftMost);
+    if (leaf_page != nullptr && transaction != nullptr) {
+      transaction->AddIntoPageSet(leaf_page);
+    }
+    return leaf_page;
+  }
+  if (optimistic_latching_ && op != Operation::READ && transaction != nullptr && !leftMost) {
+    Page *leaf_page = FindLeafPageOptimistic(key, op, transaction);
+    if (leaf_page != nullptr) {
+      return leaf_page;
+    }
+  }
   if (transaction != nullptr) {
     // std::cout<<transaction->GetThreadId()<<" in FindleafPage "<<std::endl;
     root_latch_.lock();
@@ -638,25 +1046,22 @@ Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost, Operation
     }
     return nullptr;
   }
+  // pin the root before it can be replaced and deleted
+  Page *cur_page = buffer_pool_manager_->FetchPage(root_page_id_);
   if (transaction != nullptr) {
     root_latch_.unlock();
   }
-  Page *cur_page = buffer_pool_manager_->FetchPage(root_page_id_);
   if (cur_page == nullptr) {
     assert(false);
   }
   if (transaction != nullptr) {
-    if (op == Operation::READ) {
-      cur_page->RLatch();
-    } else {
-      // std::cout<<transaction->GetThreadId()<<" Get latch on page "<<cur_page->GetPageId()<<"\n";
-      cur_page->WLatch();
-    }
+    // std::cout<<transaction->GetThreadId()<<" Get latch on page "<<cur_page->GetPageId()<<"\n";
+    cur_page->WLatch();
     transaction->AddIntoPageSet(cur_page);
   }
 
   // 这里是为了避免根节点即将出现变化时，多线程同时来到，于是让其余线程重来。
-  if (cur_page->GetPageId() != root_page_id_) {
+  if (!IsRoot(cur_page->GetPageId())) {
     if (transaction != nullptr) {
       UnpinAndUnLatch(op, transaction);
     }
@@ -678,18 +1083,13 @@ Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost, Operation
       assert(false);
     }
     if (transaction != nullptr) {
-      if (op == Operation::READ) {
-        child_page->RLatch();
-        UnpinAndUnLatch(op, transaction);
-      } else {
-        // Print();
-        // std::cout<<transaction->GetThreadId()<<" Get latch page "<<child_page_id<<std::endl;
-        child_page->WLatch();
-        // std::cout<<"down while\n";
-      }
+      // Print();
+      // std::cout<<transaction->GetThreadId()<<" Get latch page "<<child_page_id<<std::endl;
+      child_page->WLatch();
+      // std::cout<<"down while\n";
     }
     BPlusTreePage *child_node = reinterpret_cast<BPlusTreePage *>(child_page->GetData());
-    if (op != Operation::READ && transaction != nullptr && IsSafe(child_node, op)) {
+    if (transaction != nullptr && IsSafe(child_node, op)) {
       UnpinAndUnLatch(op, transaction);
     }
     if (transaction == nullptr) {
@@ -707,6 +1107,433 @@ Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost, Operation
   return cur_page;
 }
 
+/*
+ * The B-link descent of readers: hold one read latch at a time and follow the right-link of a page whose high key is
+ * at or below the key, the page split after its parent was read. A page that was merged away or gave keys to its left
+ * sibling meanwhile sends the reader back to the root. Returns the leaf read latched, or nullptr if the tree is empty.
+ * 读者不做latch coupling，任何时刻只持有一个读锁。
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPageBLink(const KeyType &key, bool leftMost) {
+  while (true) {
+    root_latch_.lock();
+    if (IsEmpty()) {
+      root_latch_.unlock();
+      return nullptr;
+    }
+    // pinned under root_latch_, a replaced root is still in the buffer pool and marked deleted
+    Page *cur_page = buffer_pool_manager_->FetchPage(root_page_id_);
+    root_latch_.unlock();
+    assert(cur_page != nullptr);
+    cur_page->RLatch();
+
+    while (true) {
+      auto *cur_node = reinterpret_cast<BPlusTreePage *>(cur_page->GetData());
+      page_id_t next_page_id;
+      int fence;
+      if (cur_node->IsLeafPage()) {
+        auto *leaf = reinterpret_cast<LeafPage *>(cur_node);
+        fence = CheckFences(leaf, key, leftMost);
+        if (fence == 0) {
+          return cur_page;
+        }
+        next_page_id = leaf->GetNextPageId();
+      } else {
+        auto *inter = reinterpret_cast<InternalPage *>(cur_node);
+        fence = CheckFences(inter, key, leftMost);
+        if (fence != 0) {
+          next_page_id = inter->GetNextPageId();
+        } else {
+          next_page_id = leftMost ? inter->ValueAt(0) : inter->Lookup(key, comparator_);
+        }
+      }
+      if (fence < 0) {
+        break;
+      }
+      // pin the next page while the latch keeps it from being merged away
+      Page *next_page = buffer_pool_manager_->FetchPage(next_page_id);
+      assert(next_page != nullptr);
+      cur_page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
+      next_page->RLatch();
+      cur_page = next_page;
+    }
+    cur_page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
+  }
+}
+
+/*
+ * Where key is relative to the fences of a page the B-link descent reached: -1 if the reader has to restart from the
+ * root, 1 if it has to follow the right-link, 0 if the page covers the key. The leftmost path covers only pages
+ * without a low key.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+template <typename N>
+int BPLUSTREE_TYPE::CheckFences(N *node, const KeyType &key, bool leftMost) const {
+  if (node->IsDeleted()) {
+    return -1;
+  }
+  if (leftMost) {
+    return node->GetLowKey() == nullptr ? 0 : -1;
+  }
+  return node->CompareToFences(key, comparator_);
+}
+
+/*
+ * The B-link descent of FindLeafPageBLink for the keys right below key instead of key itself: a page covers them if
+ * its low key is below key and its high key is not. At an internal page the child left of a separator equal to key
+ * holds them.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPageBefore(const KeyType *key) {
+  while (true) {
+    root_latch_.lock();
+    if (IsEmpty()) {
+      root_latch_.unlock();
+      return nullptr;
+    }
+    Page *cur_page = buffer_pool_manager_->FetchPage(root_page_id_);
+    root_latch_.unlock();
+    assert(cur_page != nullptr);
+    cur_page->RLatch();
+
+    while (true) {
+      auto *cur_node = reinterpret_cast<BPlusTreePage *>(cur_page->GetData());
+      page_id_t next_page_id;
+      int fence;
+      if (cur_node->IsLeafPage()) {
+        auto *leaf = reinterpret_cast<LeafPage *>(cur_node);
+        fence = CheckFencesBefore(leaf, key);
+        if (fence == 0) {
+          return cur_page;
+        }
+        next_page_id = leaf->GetNextPageId();
+      } else {
+        auto *inter = reinterpret_cast<InternalPage *>(cur_node);
+        fence = CheckFencesBefore(inter, key);
+        if (fence != 0) {
+          next_page_id = inter->GetNextPageId();
+        } else if (key == nullptr) {
+          next_page_id = inter->ValueAt(inter->GetSize() - 1);
+        } else {
+          next_page_id = inter->Lookup(*key, comparator_);
+          int index = inter->ValueIndex(next_page_id);
+          if (index > 0 && comparator_(inter->KeyAt(index), *key) == 0) {
+            next_page_id = inter->ValueAt(index - 1);
+          }
+        }
+      }
+      if (fence < 0) {
+        break;
+      }
+      Page *next_page = buffer_pool_manager_->FetchPage(next_page_id);
+      assert(next_page != nullptr);
+      cur_page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
+      next_page->RLatch();
+      cur_page = next_page;
+    }
+    cur_page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
+  }
+}
+
+/*
+ * CheckFences for FindLeafPageBefore: -1 to restart, 1 to follow the right-link, 0 if the page holds the keys right
+ * below key. Without a key only the last page of a level covers.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+template <typename N>
+int BPLUSTREE_TYPE::CheckFencesBefore(N *node, const KeyType *key) const {
+  if (node->IsDeleted()) {
+    return -1;
+  }
+  if (key == nullptr) {
+    return node->GetHighKey() == nullptr ? 0 : 1;
+  }
+  if (node->GetLowKey() != nullptr && comparator_(*key, *node->GetLowKey()) <= 0) {
+    return -1;
+  }
+  if (node->GetHighKey() != nullptr && comparator_(*key, *node->GetHighKey()) > 0) {
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * Link a page split into node and new_node: new_node takes the upper part of the range of node, from separator on, and
+ * sits right of it.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+template <typename N>
+void BPLUSTREE_TYPE::LinkSplit(N *node, N *new_node, const KeyType &separator) {
+  new_node->SetLowKey(&separator);
+  new_node->SetHighKey(node->GetHighKey());
+  new_node->SetNextPageId(node->GetNextPageId());
+  node->SetHighKey(&separator);
+  node->SetNextPageId(new_node->GetPageId());
+}
+
+/*
+ * Move the fence between two siblings to the new separator in their parent after a redistribution.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+template <typename N>
+void BPLUSTREE_TYPE::LinkRedistribute(N *left, N *right, const KeyType &separator) {
+  left->SetHighKey(&separator);
+  right->SetLowKey(&separator);
+}
+
+/*
+ * Point the left link of the leaf page_id at prev_page_id, after a split or merge changed the leaf left of it. A leaf
+ * under parent_page_id is latched as usual, the caller holds that parent. Under another parent it is only latched if
+ * free: a merge of that parent into ours latches leftwards while it holds the leaf. If it is busy its link stays
+ * stale, pointing at stale_page_id, the caller's leaf. That is recorded for FixStaleLinks, and until then the page
+ * is not freed once merged away, so that a reader who follows the link finds a leaf of this tree. Not on the path
+ * of the operation, the leaf is logged by itself.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::SetPrevLink(page_id_t page_id, page_id_t prev_page_id, page_id_t parent_page_id,
+                                 page_id_t stale_page_id, Transaction *transaction) {
+  if (page_id == INVALID_PAGE_ID) {
+    return;
+  }
+  bool latch = transaction != nullptr &&
+               std::none_of(transaction->GetPageSet()->begin(), transaction->GetPageSet()->end(),
+                            [page_id](Page *latched) { return latched->GetPageId() == page_id; });
+  bool sibling = false;
+  if (latch && parent_page_id != INVALID_PAGE_ID) {
+    Page *parent_page = buffer_pool_manager_->FetchPage(parent_page_id);
+    sibling = reinterpret_cast<InternalPage *>(parent_page->GetData())->ValueIndex(page_id) >= 0;
+    buffer_pool_manager_->UnpinPage(parent_page_id, false);
+  }
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (latch) {
+    if (sibling) {
+      page->WLatch();
+    } else if (!page->TryWLatch()) {
+      buffer_pool_manager_->UnpinPage(page_id, false);
+      std::scoped_lock lock(stale_latch_);
+      stale_links_.emplace(page_id, stale_page_id);
+      return;
+    }
+  }
+  WritePrevLink(page, prev_page_id);
+  if (latch) {
+    page->WUnlatch();
+  }
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::WritePrevLink(Page *page, page_id_t prev_page_id) {
+  reinterpret_cast<LeafPage *>(page->GetData())->SetPrePageId(prev_page_id);
+  if (IsLogging()) {
+    LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, page->GetPageId(), 0, page->GetData(), sizeof(LeafPage));
+    page->SetLSN(log_manager_->AppendLogRecord(&log_record));
+  }
+}
+
+/*
+ * Point the stale left links SetPrevLink left behind at the leaves left of them now, and free the merged leaves
+ * they kept. Called at the end of an operation, without latches: the left leaf is latched first and the stale one is
+ * only tried, since a merge latches the other way round.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::FixStaleLinks() {
+  while (true) {
+    page_id_t page_id;
+    {
+      std::scoped_lock lock(stale_latch_);
+      if (stale_links_.empty()) {
+        return;
+      }
+      page_id = stale_links_.begin()->first;
+    }
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    assert(page != nullptr);
+    auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    page->RLatch();
+    bool deleted = leaf->IsDeleted();
+    bool first = leaf->GetLowKey() == nullptr;
+    KeyType low_key;
+    if (!first) {
+      low_key = *leaf->GetLowKey();
+    }
+    page->RUnlatch();
+
+    // the leaf left of it: the one with the keys right below its low key, if its right-link still agrees
+    Page *prev_page = nullptr;
+    if (!deleted && !first) {
+      prev_page = FindLeafPageBefore(&low_key);
+      if (prev_page != nullptr && reinterpret_cast<LeafPage *>(prev_page->GetData())->GetNextPageId() != page_id) {
+        prev_page->RUnlatch();
+        buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), false);
+        buffer_pool_manager_->UnpinPage(page_id, false);
+        continue;
+      }
+    }
+    bool latched = !deleted && page->TryWLatch();
+    if (latched && leaf->IsDeleted()) {
+      // merged away meanwhile, its links went with it
+      page->WUnlatch();
+      latched = false;
+    } else if (latched) {
+      WritePrevLink(page, prev_page == nullptr ? INVALID_PAGE_ID : prev_page->GetPageId());
+    }
+
+    std::vector<page_id_t> freed;
+    if (latched || deleted) {
+      // a merged away leaf is never read for its left link
+      std::scoped_lock lock(stale_latch_);
+      freed = DropStaleLinks(page_id);
+    }
+    if (latched) {
+      page->WUnlatch();
+    }
+    if (prev_page != nullptr) {
+      prev_page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), false);
+    }
+    buffer_pool_manager_->UnpinPage(page_id, latched);
+    for (page_id_t freed_page_id : freed) {
+      buffer_pool_manager_->DeletePage(freed_page_id);
+    }
+    if (!latched && !deleted) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+/*
+ * The leaf page_id was merged away. Its stale left links move to heir_page_id, the leaf that took over its left
+ * link, or are dropped if there is none. Returns whether the page can be freed, otherwise a stale link still points
+ * at it and FixStaleLinks frees it.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::RetireLeaf(page_id_t page_id, page_id_t heir_page_id) {
+  std::vector<page_id_t> freed;
+  bool kept;
+  {
+    std::scoped_lock lock(stale_latch_);
+    if (heir_page_id == INVALID_PAGE_ID) {
+      freed = DropStaleLinks(page_id);
+    } else {
+      auto range = stale_links_.equal_range(page_id);
+      std::vector<page_id_t> stale_page_ids;
+      for (auto it = range.first; it != range.second; ++it) {
+        stale_page_ids.push_back(it->second);
+      }
+      stale_links_.erase(page_id);
+      for (page_id_t stale_page_id : stale_page_ids) {
+        stale_links_.emplace(heir_page_id, stale_page_id);
+      }
+    }
+    kept = IsStaleLinked(page_id);
+    if (kept) {
+      stale_pages_.insert(page_id);
+    }
+  }
+  for (page_id_t freed_page_id : freed) {
+    buffer_pool_manager_->DeletePage(freed_page_id);
+  }
+  return !kept;
+}
+
+/*
+ * Requires stale_latch_. Forget the stale left links of page_id and return the kept pages nothing links to anymore.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+std::vector<page_id_t> BPLUSTREE_TYPE::DropStaleLinks(page_id_t page_id) {
+  auto range = stale_links_.equal_range(page_id);
+  std::vector<page_id_t> stale_page_ids;
+  for (auto it = range.first; it != range.second; ++it) {
+    stale_page_ids.push_back(it->second);
+  }
+  stale_links_.erase(page_id);
+  std::vector<page_id_t> freed;
+  for (page_id_t stale_page_id : stale_page_ids) {
+    if (stale_pages_.count(stale_page_id) != 0 && !IsStaleLinked(stale_page_id)) {
+      stale_pages_.erase(stale_page_id);
+      freed.push_back(stale_page_id);
+    }
+  }
+  return freed;
+}
+
+/*
+ * Requires stale_latch_.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::IsStaleLinked(page_id_t page_id) const {
+  return std::any_of(stale_links_.begin(), stale_links_.end(),
+                     [page_id](const auto &link) { return link.second == page_id; });
+}
+
+/*
+ * Descend with read latches, released as soon as the child is latched, and write-latch only the leaf. The leaf is
+ * returned in the page set if the operation can not split or underflow it. Otherwise everything is released and
+ * nullptr returned, the caller restarts with the write latches of FindLeafPage.
+ * 乐观下降：只对叶子加写锁，叶子不安全时返回nullptr，由调用者悲观重来。
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPageOptimistic(const KeyType &key, Operation op, Transaction *transaction) {
+  root_latch_.lock();
+  if (IsEmpty()) {
+    root_latch_.unlock();
+    return nullptr;
+  }
+  Page *cur_page = buffer_pool_manager_->FetchPage(root_page_id_);
+  root_latch_.unlock();
+  assert(cur_page != nullptr);
+  optimistic_count_++;
+
+  cur_page->RLatch();
+  BPlusTreePage *cur_node = reinterpret_cast<BPlusTreePage *>(cur_page->GetData());
+  if (cur_node->IsLeafPage()) {
+    // the root is the leaf, it may have split while it was not latched
+    cur_page->RUnlatch();
+    cur_page->WLatch();
+  }
+  if (!IsRoot(cur_page->GetPageId())) {
+    if (cur_node->IsLeafPage()) {
+      cur_page->WUnlatch();
+    } else {
+      cur_page->RUnlatch();
+    }
+    buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
+    restart_count_++;
+    return nullptr;
+  }
+
+  while (!cur_node->IsLeafPage()) {
+    page_id_t child_page_id = reinterpret_cast<InternalPage *>(cur_node)->Lookup(key, comparator_);
+    Page *child_page = buffer_pool_manager_->FetchPage(child_page_id);
+    assert(child_page != nullptr);
+    child_page->RLatch();
+    BPlusTreePage *child_node = reinterpret_cast<BPlusTreePage *>(child_page->GetData());
+    if (child_node->IsLeafPage()) {
+      // the read latch on the parent keeps the leaf from being split or merged away meanwhile
+      child_page->RUnlatch();
+      child_page->WLatch();
+    }
+    cur_page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
+    cur_page = child_page;
+    cur_node = child_node;
+  }
+
+  if (!IsSafe(cur_node, op)) {
+    cur_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
+    restart_count_++;
+    return nullptr;
+  }
+  transaction->AddIntoPageSet(cur_page);
+  return cur_page;
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UnpinAndUnLatch(Operation op, Transaction *transaction) {
   if (transaction == nullptr) {
@@ -739,15 +1566,13 @@ bool BPLUSTREE_TYPE::IsSafe(BPlusTreePage *node, Operation op) {
       LeafPage *leaf = reinterpret_cast<LeafPage *>(node);
       return (leaf->GetSize() < leaf->GetMaxSize() - 1);
     }
-    InternalPage *inter = reinterpret_cast<InternalPage *>(node);
-    return (inter->GetSize() < inter->GetMaxSize());
+    return reinterpret_cast<InternalPage *>(node)->IsSafeToInsert();
   }
   if (node->IsLeafPage()) {
     LeafPage *leaf = reinterpret_cast<LeafPage *>(node);
     return (leaf->GetSize() > leaf->GetMaxSize() / 2);
   }
-  InternalPage *inter = reinterpret_cast<InternalPage *>(node);
-  return (inter->GetSize() > (inter->GetMaxSize() + 1) / 2);
+  return reinterpret_cast<InternalPage *>(node)->IsSafeToRemove();
 }
 
 /*
@@ -761,15 +1586,129 @@ bool BPLUSTREE_TYPE::IsSafe(BPlusTreePage *node, Operation op) {
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
   HeaderPage *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  header_page->WLatch();
   if (insert_record != 0) {
     header_page->InsertRecord(index_name_, root_page_id_);
-  } else {
-    // update root_page_id in header_page
-    header_page->UpdateRecord(index_name_, root_page_id_);
+  } else if (!header_page->UpdateRecord(index_name_, root_page_id_)) {
+    // update root_page_id in header_page, the first root of the tree has no record yet
+    header_page->InsertRecord(index_name_, root_page_id_);
+  }
+  if (IsLogging()) {
+    // the header page has no LSN that would hold the buffer pool back until the record is flushed, so flush it here
+    LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, HEADER_PAGE_ID, 0, header_page->GetData(), PAGE_SIZE);
+    log_manager_->WaitForFlush(log_manager_->AppendLogRecord(&log_record));
   }
+  header_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
 }
 
+/*****************************************************************************
+ * LOGGING
+ *****************************************************************************/
+/*
+ * Log a leaf insert or delete with its slot, so that redo can repeat it without a comparator. The leaf is latched by
+ * the caller.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LogLeafEntry(LogRecordType type, LeafPage *leaf, int index, const MappingType &entry,
+                                  Transaction *transaction) {
+  if (!IsLogging()) {
+    return;
+  }
+  txn_id_t txn_id = transaction == nullptr ? INVALID_TXN_ID : transaction->GetTransactionId();
+  lsn_t prev_lsn = transaction == nullptr ? INVALID_LSN : transaction->GetPrevLSN();
+  auto offset = static_cast<int32_t>(sizeof(LeafPage) + index * sizeof(KeyType));
+  LogRecord log_record(txn_id, prev_lsn, type, index_name_, leaf->GetPageId(), index, offset, sizeof(KeyType),
+                       reinterpret_cast<const char *>(&entry), sizeof(MappingType));
+  lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
+  if (transaction != nullptr) {
+    transaction->SetPrevLSN(lsn);
+  }
+  leaf->SetLSN(lsn);
+}
+
+/*
+ * Log the used part of a page a split, merge or root change wrote. These records are not part of any transaction:
+ * the structure change stays when the transaction that caused it is rolled back. The page is latched by the caller.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LogPage(BPlusTreePage *node) {
+  if (!IsLogging()) {
+    return;
+  }
+  // a leaf up to its last used value, the unused key slots before the values included so that one record has all
+  size_t size = node->IsLeafPage()
+                    ? sizeof(LeafPage) + node->GetMaxSize() * sizeof(KeyType) + node->GetSize() * sizeof(ValueType)
+                    : reinterpret_cast<InternalPage *>(node)->GetUsedSize();
+  size = std::min<size_t>(size, PAGE_SIZE);
+  LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, node->GetPageId(), 0, reinterpret_cast<const char *>(node),
+                       static_cast<int32_t>(size));
+  node->SetLSN(log_manager_->AppendLogRecord(&log_record));
+}
+
+/*
+ * Log the header of a page that changed its parent page id. Such a child is not latched by this operation unless it
+ * is on its path, so it is latched here to keep its LSN in order with the changes of other threads.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LogChildHeader(page_id_t page_id, Transaction *transaction) {
+  if (!IsLogging()) {
+    return;
+  }
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  bool latch = transaction != nullptr &&
+               std::none_of(transaction->GetPageSet()->begin(), transaction->GetPageSet()->end(),
+                            [page_id](Page *latched) { return latched->GetPageId() == page_id; });
+  if (latch) {
+    page->WLatch();
+  }
+  LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, page_id, 0, page->GetData(), sizeof(BPlusTreePage));
+  page->SetLSN(log_manager_->AppendLogRecord(&log_record));
+  if (latch) {
+    page->WUnlatch();
+  }
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
+
+/*
+ * Log the headers of the children in [begin, end) of an internal page that just adopted them.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LogChildren(InternalPage *node, int begin, int end, Transaction *transaction) {
+  if (!IsLogging()) {
+    return;
+  }
+  for (int i = begin; i < end; i++) {
+    LogChildHeader(node->ValueAt(i), transaction);
+  }
+}
+
+/*
+ * Recovery runs on a single thread and redo may have changed the root since this tree was created, so it is read from
+ * the header page again. Undoing a split or merge is never needed, they are not part of the transaction.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::UndoLogRecord(LogRecord *log_record) {
+  const std::vector<char> &data = log_record->GetIndexData();
+  if (data.size() != sizeof(MappingType)) {
+    return;
+  }
+  MappingType entry;
+  memcpy(reinterpret_cast<char *>(&entry), data.data(), sizeof(MappingType));
+  // recovery redid the root changes on the header page, not on this object
+  Open();
+
+  // Remove and Insert only latch pages with a transaction
+  Transaction transaction(log_record->GetTxnId());
+  if (log_record->GetLogRecordType() == LogRecordType::BTREEINSERT) {
+    if (!IsEmpty()) {
+      Remove(entry.first, &transaction);
+    }
+  } else if (log_record->GetLogRecordType() == LogRecordType::BTREEDELETE) {
+    Insert(entry.first, entry.second, &transaction);
+  }
+}
+
 /*
  * This method is used for test only
  * Read data from file and insert one by one
@@ -0,0 +1,125 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// external_sort.cpp
+//
+// Identification: src/storage/index/external_sort.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/external_sort.h"
+
+#include <algorithm>
+
+#include "common/exception.h"
+#include "common/macros.h"
+#include "common/rid.h"
+#include "storage/index/var_key.h"
+
+namespace bustub {
+
+INDEX_TEMPLATE_ARGUMENTS
+ExternalSort<KeyType, ValueType, KeyComparator>::~ExternalSort() {
+  for (FILE *run : runs_) {
+    fclose(run);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void ExternalSort<KeyType, ValueType, KeyComparator>::Add(const KeyType &key, const ValueType &value) {
+  BUSTUB_ASSERT(!sorted_, "entries can not be added once the sort started");
+  buffer_.emplace_back(key, value);
+  if (buffer_.size() >= run_size_) {
+    SpillRun();
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool ExternalSort<KeyType, ValueType, KeyComparator>::Next(MappingType *entry) {
+  if (!sorted_) {
+    sorted_ = true;
+    if (runs_.empty()) {
+      SortBuffer();
+    } else {
+      if (!buffer_.empty()) {
+        SpillRun();
+      }
+      buffer_.clear();
+      buffer_.shrink_to_fit();
+      for (size_t run = 0; run < runs_.size(); run++) {
+        rewind(runs_[run]);
+        ReadRun(run);
+      }
+    }
+  }
+  if (runs_.empty()) {
+    if (next_ == buffer_.size()) {
+      return false;
+    }
+    *entry = buffer_[next_++];
+    return true;
+  }
+
+  if (heap_.empty()) {
+    return false;
+  }
+  auto greater = [this](const RunHead &a, const RunHead &b) { return HeapLess(b, a); };
+  std::pop_heap(heap_.begin(), heap_.end(), greater);
+  *entry = heap_.back().entry_;
+  size_t run = heap_.back().run_;
+  heap_.pop_back();
+  ReadRun(run);
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void ExternalSort<KeyType, ValueType, KeyComparator>::SortBuffer() {
+  auto less = [this](const MappingType &a, const MappingType &b) { return comparator_(a.first, b.first) < 0; };
+  // input that is already in order, like a table scanned along its key, needs no sort
+  if (!std::is_sorted(buffer_.begin(), buffer_.end(), less)) {
+    std::stable_sort(buffer_.begin(), buffer_.end(), less);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void ExternalSort<KeyType, ValueType, KeyComparator>::SpillRun() {
+  SortBuffer();
+  FILE *run = tmpfile();
+  if (run == nullptr) {
+    throw Exception("can't create a temporary file for an external sort run");
+  }
+  runs_.push_back(run);
+  if (fwrite(buffer_.data(), sizeof(MappingType), buffer_.size(), run) != buffer_.size()) {
+    throw Exception("I/O error while writing an external sort run");
+  }
+  buffer_.clear();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void ExternalSort<KeyType, ValueType, KeyComparator>::ReadRun(size_t run) {
+  RunHead head;
+  if (fread(&head.entry_, sizeof(MappingType), 1, runs_[run]) != 1) {
+    return;
+  }
+  head.run_ = run;
+  heap_.push_back(head);
+  std::push_heap(heap_.begin(), heap_.end(), [this](const RunHead &a, const RunHead &b) { return HeapLess(b, a); });
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool ExternalSort<KeyType, ValueType, KeyComparator>::HeapLess(const RunHead &a, const RunHead &b) const {
+  int order = comparator_(a.entry_.first, b.entry_.first);
+  return order < 0 || (order == 0 && a.run_ < b.run_);
+}
+
+template class ExternalSort<GenericKey<4>, RID, GenericComparator<4>>;
+template class ExternalSort<GenericKey<8>, RID, GenericComparator<8>>;
+template class ExternalSort<GenericKey<16>, RID, GenericComparator<16>>;
+template class ExternalSort<GenericKey<32>, RID, GenericComparator<32>>;
+template class ExternalSort<GenericKey<64>, RID, GenericComparator<64>>;
+template class ExternalSort<VarKey, RID, VarKeyComparator>;
+
+}  // namespace bustub
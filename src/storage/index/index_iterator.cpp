@@ -2,6 +2,7 @@
  * index_iterator.cpp
  */
 #include <cassert>
+#include <utility>
 
 #include "storage/index/index_iterator.h"
 
@@ -15,19 +16,48 @@ INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::IndexIterator() = default;
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::IndexIterator(int index_in_leaf, Page *page, BufferPoolManager *buffer_pool_manager)
-    : index_in_leaf_(index_in_leaf), buffer_pool_manager_(buffer_pool_manager) {
-  if (page != nullptr) {
-    leaf_page_ = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
-    page_id = leaf_page_->GetPageId();
+INDEXITERATOR_TYPE::IndexIterator(Page *page, const KeyType *key, BufferPoolManager *buffer_pool_manager,
+                                  const KeyComparator *comparator, std::function<Page *(const KeyType &)> find_leaf,
+                                  const KeyType *upper, ScanInclusivity inclusivity, bool reverse)
+    : buffer_pool_manager_(buffer_pool_manager),
+      comparator_(comparator),
+      find_leaf_(std::move(find_leaf)),
+      reverse_(reverse),
+      has_upper_(upper != nullptr),
+      upper_inclusive_(inclusivity == ScanInclusivity::BOTH || inclusivity == ScanInclusivity::UPPER) {
+  if (upper != nullptr) {
+    upper_ = *upper;
+  }
+  auto *leaf_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+  if (reverse_) {
+    int size = leaf_page->GetSize();
+    if (key != nullptr) {
+      SeekBack(page, *key, true);
+    } else if (size > 0) {
+      SeekBack(page, leaf_page->KeyAt(size - 1), true);
+    } else if (leaf_page->GetLowKey() != nullptr) {
+      KeyType low_key = *leaf_page->GetLowKey();
+      SeekBack(page, low_key, false);
+    } else {
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    }
+    return;
+  }
+  if (key != nullptr) {
+    Seek(page, *key, inclusivity == ScanInclusivity::BOTH || inclusivity == ScanInclusivity::LOWER);
+  } else if (leaf_page->GetSize() > 0) {
+    Seek(page, leaf_page->KeyAt(0), true);
+  } else {
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
   }
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::~IndexIterator() {
   // maybe i should judge if the page_id is INVALID?
-  if (buffer_pool_manager_ != nullptr && leaf_page_ != nullptr) {
-    // reinterpret_cast<Page *>(leaf_page_)->RUnlatch();
+  if (buffer_pool_manager_ != nullptr && page_ != nullptr) {
     buffer_pool_manager_->UnpinPage(page_id, false);
   }
 }
@@ -36,37 +66,220 @@ INDEX_TEMPLATE_ARGUMENTS
 bool INDEXITERATOR_TYPE::isEnd() { return index_in_leaf_ == -1 && page_id == -1; }
 
 INDEX_TEMPLATE_ARGUMENTS
-const MappingType &INDEXITERATOR_TYPE::operator*() { return leaf_page_->GetItem(index_in_leaf_); }
+const MappingType &INDEXITERATOR_TYPE::operator*() { return item_; }
 
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() {
   if (isEnd()) {
     return *this;
   }
-  index_in_leaf_++;
-  // ++后超出此页
-  if (index_in_leaf_ == leaf_page_->GetSize()) {
-    page_id_t next_page_id = leaf_page_->GetNextPageId();
-    // 若下一页是invalid
-    if (next_page_id == INVALID_PAGE_ID) {
-      // reinterpret_cast<Page *>(leaf_page_)->RUnlatch();
-      buffer_pool_manager_->UnpinPage(page_id, false);
-      leaf_page_ = nullptr;
-      index_in_leaf_ = -1;
-      page_id = -1;
-      return *this;
-    }
-    // reinterpret_cast<Page *>(leaf_page_)->RUnlatch();
-    buffer_pool_manager_->UnpinPage(page_id, false);
-    Page *next_page = buffer_pool_manager_->FetchPage(next_page_id);
-    // next_page->RLatch();
-    leaf_page_ = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(next_page->GetData());
-    index_in_leaf_ = 0;
-    page_id = leaf_page_->GetPageId();
-  }
+  page_->RLatch();
+  KeyType key = item_.first;
+  Move(page_, key, false);
   return *this;
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+int INDEXITERATOR_TYPE::NextBatch(ValueType *values, int n) {
+  int count = 0;
+  while (count < n && !isEnd()) {
+    values[count++] = item_.second;
+    KeyType key = item_.first;
+    page_->RLatch();
+    if (!leaf_page_->IsDeleted()) {
+      // the rest of the leaf in one go, from the entry the iterator is on if it is still there
+      int size = leaf_page_->GetSize();
+      int index = index_in_leaf_;
+      if (index >= size || (*comparator_)(leaf_page_->KeyAt(index), key) != 0) {
+        index = leaf_page_->KeyIndex(key, *comparator_);
+      }
+      if (index < size && (*comparator_)(leaf_page_->KeyAt(index), key) == 0) {
+        if (reverse_) {
+          while (count < n && index > 0) {
+            index--;
+            values[count++] = leaf_page_->ValueAt(index);
+          }
+        } else {
+          while (count < n && index + 1 < size && !PastUpper(leaf_page_->KeyAt(index + 1))) {
+            index++;
+            values[count++] = leaf_page_->ValueAt(index);
+          }
+        }
+        key = leaf_page_->KeyAt(index);
+        index_in_leaf_ = index;
+      }
+    }
+    Move(page_, key, false);
+  }
+  return count;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::Move(Page *page, const KeyType &key, bool inclusive) {
+  if (reverse_) {
+    SeekBack(page, key, inclusive);
+  } else {
+    Seek(page, key, inclusive);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool INDEXITERATOR_TYPE::PastUpper(const KeyType &key) const {
+  if (!has_upper_) {
+    return false;
+  }
+  int cmp = (*comparator_)(key, upper_);
+  return cmp > 0 || (cmp == 0 && !upper_inclusive_);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::Seek(Page *page, const KeyType &key, bool inclusive) {
+  // the smallest key the page must cover, key itself or the high key of the leaf whose right-link led here
+  KeyType low = key;
+  while (true) {
+    auto *leaf_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+    if (leaf_page->IsDeleted() || leaf_page->CompareToFences(low, *comparator_) < 0) {
+      // 此页已被合并到左兄弟，或重分配把low之后的项移进了左兄弟，从根重新找key所在的叶子
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      page = find_leaf_(key);
+      if (page == nullptr) {
+        break;
+      }
+      low = key;
+      continue;
+    }
+    int size = leaf_page->GetSize();
+    int index;
+    if (page == page_ && index_in_leaf_ < size && (*comparator_)(leaf_page->KeyAt(index_in_leaf_), key) == 0) {
+      // nothing moved the entry the iterator is on
+      index = index_in_leaf_;
+    } else {
+      index = leaf_page->KeyIndex(key, *comparator_);
+    }
+    if (!inclusive && index < size && (*comparator_)(leaf_page->KeyAt(index), key) == 0) {
+      index++;
+    }
+    if (index < size && PastUpper(leaf_page->KeyAt(index))) {
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      break;
+    }
+    if (index < size) {
+      page_id_t next_page_id = leaf_page->GetNextPageId();
+      if (page->GetPageId() != page_id && next_page_id != INVALID_PAGE_ID &&
+          (leaf_page->GetHighKey() == nullptr || !PastUpper(*leaf_page->GetHighKey()))) {
+        // a new leaf and the range may go on into the next one
+        buffer_pool_manager_->PrefetchPage(next_page_id);
+      }
+      page_ = page;
+      leaf_page_ = leaf_page;
+      page_id = page->GetPageId();
+      index_in_leaf_ = index;
+      item_ = leaf_page->GetItem(index);
+      page->RUnlatch();
+      return;
+    }
+    // ++后超出此页，沿right-link前进；先pin下一页，持有的读锁使它不会被合并掉
+    page_id_t next_page_id = leaf_page->GetNextPageId();
+    Page *next_page = next_page_id == INVALID_PAGE_ID ? nullptr : buffer_pool_manager_->FetchPage(next_page_id);
+    if (leaf_page->GetHighKey() != nullptr) {
+      low = *leaf_page->GetHighKey();
+    }
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    if (next_page == nullptr) {
+      break;
+    }
+    next_page->RLatch();
+    page = next_page;
+  }
+  page_ = nullptr;
+  leaf_page_ = nullptr;
+  index_in_leaf_ = -1;
+  page_id = INVALID_PAGE_ID;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::SeekBack(Page *page, const KeyType &key, bool inclusive) {
+  // the entries at or above bound are behind the iterator
+  KeyType bound = key;
+  while (true) {
+    auto *leaf_page = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+    const KeyType *high_key = leaf_page->GetHighKey();
+    int high = high_key == nullptr ? -1 : (*comparator_)(bound, *high_key);
+    if (leaf_page->IsDeleted() || high > 0) {
+      // merged away, or entries below bound moved to the right sibling. Only the leaves left of the first one are
+      // searched exclusively, the first one covers key.
+      assert(!inclusive);
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      page = find_leaf_(bound);
+      if (page == nullptr) {
+        break;
+      }
+      continue;
+    }
+    int size = leaf_page->GetSize();
+    int index;
+    if (page == page_ && index_in_leaf_ < size && (*comparator_)(leaf_page->KeyAt(index_in_leaf_), bound) == 0) {
+      index = index_in_leaf_;
+    } else {
+      index = leaf_page->KeyIndex(bound, *comparator_);
+    }
+    if (inclusive && index < size && (*comparator_)(leaf_page->KeyAt(index), bound) == 0) {
+      index++;
+    }
+    index--;
+    page_id_t prev_page_id = leaf_page->GetPrePageId();
+    if (index >= 0) {
+      if (page->GetPageId() != page_id && prev_page_id != INVALID_PAGE_ID) {
+        buffer_pool_manager_->PrefetchPage(prev_page_id);
+      }
+      page_ = page;
+      leaf_page_ = leaf_page;
+      page_id = page->GetPageId();
+      index_in_leaf_ = index;
+      item_ = leaf_page->GetItem(index);
+      page->RUnlatch();
+      return;
+    }
+    if (leaf_page->GetLowKey() == nullptr) {
+      // the first leaf
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      break;
+    }
+    // 此页没有更小的key，沿左链接后退；左链接可能过时，确认左页的右链接与high key都指回此页才采用
+    bound = *leaf_page->GetLowKey();
+    inclusive = false;
+    page_id_t left_page_id = page->GetPageId();
+    Page *prev_page = prev_page_id == INVALID_PAGE_ID ? nullptr : buffer_pool_manager_->FetchPage(prev_page_id);
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(left_page_id, false);
+    if (prev_page != nullptr) {
+      prev_page->RLatch();
+      auto *prev_leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(prev_page->GetData());
+      if (prev_leaf->IsLeafPage() && prev_leaf->GetPageId() == prev_page_id && !prev_leaf->IsDeleted() &&
+          prev_leaf->GetNextPageId() == left_page_id && prev_leaf->GetHighKey() != nullptr &&
+          (*comparator_)(*prev_leaf->GetHighKey(), bound) == 0) {
+        page = prev_page;
+        continue;
+      }
+      prev_page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(prev_page_id, false);
+    }
+    page = find_leaf_(bound);
+    if (page == nullptr) {
+      break;
+    }
+  }
+  page_ = nullptr;
+  leaf_page_ = nullptr;
+  index_in_leaf_ = -1;
+  page_id = INVALID_PAGE_ID;
+}
+
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
 
 template class IndexIterator<GenericKey<8>, RID, GenericComparator<8>>;
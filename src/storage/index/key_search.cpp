@@ -0,0 +1,143 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// key_search.cpp
+//
+// Identification: src/storage/index/key_search.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/key_search.h"
+
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define BUSTUB_SIMD_KEY_SEARCH
+#endif
+
+namespace bustub {
+
+namespace {
+
+// a search narrows the range to this many keys before it compares them with SIMD instructions
+constexpr int SIMD_WINDOW = 32;
+
+std::atomic<bool> simd_enabled{true};
+
+/** The key as a signed integer with the order of the normalized bytes. */
+inline int64_t OrderKey(const GenericKey<8> &key) {
+  uint64_t value;
+  memcpy(&value, key.data_, sizeof(value));
+  return static_cast<int64_t>(__builtin_bswap64(value) ^ (uint64_t{1} << 63));
+}
+
+inline int32_t OrderKey(const GenericKey<4> &key) {
+  uint32_t value;
+  memcpy(&value, key.data_, sizeof(value));
+  return static_cast<int32_t>(__builtin_bswap32(value) ^ (uint32_t{1} << 31));
+}
+
+/** Binary search on the integer order until at most SIMD_WINDOW keys are left, they are in [*l, *r). */
+template <typename KeyType, typename T>
+inline void Narrow(const KeyType *keys, T target, int *l, int *r) {
+  while (*r - *l > SIMD_WINDOW) {
+    int m = (*l + *r) >> 1;
+    if (OrderKey(keys[m]) < target) {
+      *l = m + 1;
+    } else {
+      *r = m;
+    }
+  }
+}
+
+#ifdef BUSTUB_SIMD_KEY_SEARCH
+bool HasAvx2() {
+  static const bool has_avx2 = __builtin_cpu_supports("avx2") != 0;
+  return has_avx2;
+}
+
+__attribute__((target("avx2"))) int LowerBoundAvx2(const GenericKey<8> *keys, int size, int64_t target) {
+  int l = 0;
+  int r = size;
+  Narrow(keys, target, &l, &r);
+  // swap the bytes of every 64-bit lane to little-endian, then flip the sign bit to compare signed
+  const __m256i swap = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                        15, 14, 13, 12, 11, 10, 9, 8);
+  const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+  const __m256i key = _mm256_set1_epi64x(target);
+  int i = l;
+  for (; i + 4 <= r; i += 4) {
+    __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i));
+    lanes = _mm256_xor_si256(_mm256_shuffle_epi8(lanes, swap), sign);
+    // the keys below target are a prefix of the lanes
+    int below = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(key, lanes)));
+    if (below != 0xf) {
+      return i + __builtin_popcount(below);
+    }
+  }
+  while (i < r && OrderKey(keys[i]) < target) {
+    i++;
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) int LowerBoundAvx2(const GenericKey<4> *keys, int size, int32_t target) {
+  int l = 0;
+  int r = size;
+  Narrow(keys, target, &l, &r);
+  const __m256i swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4,
+                                        11, 10, 9, 8, 15, 14, 13, 12);
+  const __m256i sign = _mm256_set1_epi32(INT32_MIN);
+  const __m256i key = _mm256_set1_epi32(target);
+  int i = l;
+  for (; i + 8 <= r; i += 8) {
+    __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i));
+    lanes = _mm256_xor_si256(_mm256_shuffle_epi8(lanes, swap), sign);
+    int below = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(key, lanes)));
+    if (below != 0xff) {
+      return i + __builtin_popcount(below);
+    }
+  }
+  while (i < r && OrderKey(keys[i]) < target) {
+    i++;
+  }
+  return i;
+}
+#endif
+
+}  // namespace
+
+int KeyLowerBound(const GenericKey<8> *keys, int size, const GenericKey<8> &key, const GenericComparator<8> &comparator) {
+#ifdef BUSTUB_SIMD_KEY_SEARCH
+  if (IsSimdKeySearchEnabled()) {
+    return LowerBoundAvx2(keys, size, OrderKey(key));
+  }
+#endif
+  return KeyLowerBound<GenericKey<8>, GenericComparator<8>>(keys, size, key, comparator);
+}
+
+int KeyLowerBound(const GenericKey<4> *keys, int size, const GenericKey<4> &key, const GenericComparator<4> &comparator) {
+#ifdef BUSTUB_SIMD_KEY_SEARCH
+  if (IsSimdKeySearchEnabled()) {
+    return LowerBoundAvx2(keys, size, OrderKey(key));
+  }
+#endif
+  return KeyLowerBound<GenericKey<4>, GenericComparator<4>>(keys, size, key, comparator);
+}
+
+void SetSimdKeySearch(bool enable) { simd_enabled = enable; }
+
+bool IsSimdKeySearchEnabled() {
+#ifdef BUSTUB_SIMD_KEY_SEARCH
+  return simd_enabled && HasAvx2();
+#else
+  return false;
+#endif
+}
+
+}  // namespace bustub
@@ -0,0 +1,565 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// var_b_plus_tree.cpp
+//
+// Identification: src/storage/index/var_b_plus_tree.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/var_b_plus_tree.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "common/exception.h"
+#include "storage/page/header_page.h"
+#include "storage/page/var_posting_page.h"
+
+namespace bustub {
+
+VarBPlusTree::VarBPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, bool unique)
+    : index_name_(std::move(name)),
+      root_page_id_(INVALID_PAGE_ID),
+      buffer_pool_manager_(buffer_pool_manager),
+      unique_(unique) {}
+
+bool VarBPlusTree::Open() {
+  auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  header_page->RLatch();
+  if (!header_page->GetRootId(index_name_, &root_page_id_)) {
+    root_page_id_ = INVALID_PAGE_ID;
+  }
+  header_page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  return !IsEmpty();
+}
+
+bool VarBPlusTree::IsEmpty() const { return root_page_id_ == INVALID_PAGE_ID; }
+
+/*****************************************************************************
+ * SEARCH
+ *****************************************************************************/
+bool VarBPlusTree::GetValue(const VarKey &key, std::vector<RID> *result, Transaction *transaction) {
+  latch_.RLock();
+  if (IsEmpty()) {
+    latch_.RUnlock();
+    return false;
+  }
+  Page *page = FindLeafPage(&key, nullptr);
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int index = leaf->KeyIndex(key);
+  bool found = index < leaf->GetSize() && leaf->CompareAt(index, key) == 0;
+  if (found) {
+    GetValues(leaf, index, result);
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  latch_.RUnlock();
+  return found;
+}
+
+Page *VarBPlusTree::FindLeafPage(const VarKey *key, std::vector<page_id_t> *path) {
+  page_id_t page_id = root_page_id_;
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  while (!node->IsLeafPage()) {
+    auto *internal = reinterpret_cast<InternalPage *>(node);
+    page_id_t child_page_id = key == nullptr ? internal->ValueAt(0) : internal->Lookup(*key);
+    if (path != nullptr) {
+      path->push_back(page_id);
+    }
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_id = child_page_id;
+    page = buffer_pool_manager_->FetchPage(page_id);
+    node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  }
+  return page;
+}
+
+/*****************************************************************************
+ * INSERTION
+ *****************************************************************************/
+bool VarBPlusTree::Insert(const VarKey &key, const RID &value, Transaction *transaction) {
+  latch_.WLock();
+  if (IsEmpty()) {
+    Page *page = AllocatePage(&root_page_id_);
+    auto *root = reinterpret_cast<LeafPage *>(page->GetData());
+    root->Init(root_page_id_, IndexPageType::LEAF_PAGE);
+    root->InsertAt(0, key, value);
+    buffer_pool_manager_->UnpinPage(root_page_id_, true);
+    UpdateRootPageId();
+    latch_.WUnlock();
+    return true;
+  }
+  std::vector<page_id_t> path;
+  Page *page = FindLeafPage(&key, &path);
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int index = leaf->KeyIndex(key);
+  bool inserted = true;
+  if (index == leaf->GetSize() || leaf->CompareAt(index, key) != 0) {
+    InsertIntoLeaf(leaf, index, key, &value, 1, &path);
+  } else if (unique_) {
+    inserted = false;
+  } else {
+    inserted = InsertIntoPosting(leaf, index, value, &path);
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), inserted);
+  latch_.WUnlock();
+  return inserted;
+}
+
+bool VarBPlusTree::BulkLoad(const std::function<bool(std::pair<VarKey, RID> *)> &next) {
+  if (!IsEmpty()) {
+    return false;
+  }
+  std::pair<VarKey, RID> entry;
+  while (next(&entry)) {
+    Insert(entry.first, entry.second);
+  }
+  return true;
+}
+
+Page *VarBPlusTree::AllocatePage(page_id_t *page_id) {
+  Page *page = buffer_pool_manager_->NewPage(page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "out of memory when allocating a b+ tree page");
+  }
+  return page;
+}
+
+void VarBPlusTree::InsertIntoLeaf(LeafPage *leaf, int index, const VarKey &key, const RID *values, int count,
+                                  std::vector<page_id_t> *path) {
+  if (!leaf->InsertAt(index, key, values, count)) {
+    VarKey separator;
+    page_id_t new_page_id = Split(leaf, index, key, values, count, &separator);
+    InsertIntoParent(path, leaf->GetPageId(), separator, new_page_id);
+  }
+}
+
+bool VarBPlusTree::InsertIntoPosting(LeafPage *leaf, int index, const RID &value, std::vector<page_id_t> *path) {
+  if (leaf->IsOverflow(index)) {
+    RID list = leaf->ValueAt(index);
+    if (!InsertIntoPostingList(list.GetPageId(), value)) {
+      return false;
+    }
+    leaf->SetValueAt(index, RID(list.GetPageId(), list.GetSlotNum() + 1));
+    return true;
+  }
+  std::vector<RID> values;
+  leaf->GetValues(index, &values);
+  auto it = std::lower_bound(values.begin(), values.end(), value, VarPostingPage::Less);
+  if (it != values.end() && *it == value) {
+    return false;
+  }
+  values.insert(it, value);
+  VarKey key = leaf->KeyAt(index);
+  leaf->Remove(index);
+  if (values.size() * sizeof(RID) > POSTING_INLINE_SIZE) {
+    // the entry shrinks, it fits where it was
+    RID list(CreatePostingList(values), static_cast<uint32_t>(values.size()));
+    leaf->InsertAt(index, key, &list, 1, true);
+    return true;
+  }
+  InsertIntoLeaf(leaf, index, key, values.data(), static_cast<int>(values.size()), path);
+  return true;
+}
+
+template <typename N, typename V>
+page_id_t VarBPlusTree::Split(N *node, int index, const VarKey &key, const V *values, int count,
+                              VarKey *separator) {
+  page_id_t new_page_id;
+  Page *page = AllocatePage(&new_page_id);
+  auto *new_node = reinterpret_cast<N *>(page->GetData());
+  new_node->Init(new_page_id, node->IsLeafPage() ? IndexPageType::LEAF_PAGE : IndexPageType::INTERNAL_PAGE);
+  if (index == node->GetSize() && node->GetNextPageId() == INVALID_PAGE_ID) {
+    // appending to the level, keep node full
+    new_node->InsertAt(0, key, values, count);
+  } else {
+    node->MoveHalfTo(new_node);
+    if (index <= node->GetSize()) {
+      node->InsertAt(index, key, values, count);
+    } else {
+      new_node->InsertAt(index - node->GetSize(), key, values, count);
+    }
+  }
+  if (node->IsLeafPage()) {
+    *separator = VarKey::Separator(node->KeyAt(node->GetSize() - 1), new_node->KeyAt(0));
+  } else {
+    // the first key moves up, the first key of an internal page is empty
+    *separator = new_node->KeyAt(0);
+    new_node->SetKeyAt(0, VarKey{});
+  }
+
+  new_node->SetNextPageId(node->GetNextPageId());
+  new_node->SetPrevPageId(node->GetPageId());
+  if (node->GetNextPageId() != INVALID_PAGE_ID) {
+    Page *next_page = buffer_pool_manager_->FetchPage(node->GetNextPageId());
+    reinterpret_cast<N *>(next_page->GetData())->SetPrevPageId(new_page_id);
+    buffer_pool_manager_->UnpinPage(next_page->GetPageId(), true);
+  }
+  node->SetNextPageId(new_page_id);
+  buffer_pool_manager_->UnpinPage(new_page_id, true);
+  return new_page_id;
+}
+
+void VarBPlusTree::InsertIntoParent(std::vector<page_id_t> *path, page_id_t old_page_id, const VarKey &key,
+                                    page_id_t new_page_id) {
+  if (path->empty()) {
+    // the root split
+    Page *page = AllocatePage(&root_page_id_);
+    auto *root = reinterpret_cast<InternalPage *>(page->GetData());
+    root->Init(root_page_id_, IndexPageType::INTERNAL_PAGE);
+    root->InsertAt(0, VarKey{}, old_page_id);
+    root->InsertAt(1, key, new_page_id);
+    buffer_pool_manager_->UnpinPage(root_page_id_, true);
+    UpdateRootPageId();
+    return;
+  }
+  page_id_t parent_page_id = path->back();
+  path->pop_back();
+  auto *parent = reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(parent_page_id)->GetData());
+  int index = parent->ValueIndex(old_page_id) + 1;
+  if (!parent->InsertAt(index, key, new_page_id)) {
+    VarKey separator;
+    page_id_t new_parent_page_id = Split(parent, index, key, &new_page_id, 1, &separator);
+    InsertIntoParent(path, parent_page_id, separator, new_parent_page_id);
+  }
+  buffer_pool_manager_->UnpinPage(parent_page_id, true);
+}
+
+/*****************************************************************************
+ * REMOVE
+ *****************************************************************************/
+void VarBPlusTree::Remove(const VarKey &key, Transaction *transaction) {
+  latch_.WLock();
+  if (IsEmpty()) {
+    latch_.WUnlock();
+    return;
+  }
+  std::vector<page_id_t> path;
+  Page *page = FindLeafPage(&key, &path);
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int index = leaf->KeyIndex(key);
+  if (index == leaf->GetSize() || leaf->CompareAt(index, key) != 0) {
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  } else {
+    RemoveFromLeaf(leaf, index, &path);
+  }
+  latch_.WUnlock();
+}
+
+void VarBPlusTree::Remove(const VarKey &key, const RID &value, Transaction *transaction) {
+  latch_.WLock();
+  if (IsEmpty()) {
+    latch_.WUnlock();
+    return;
+  }
+  std::vector<page_id_t> path;
+  Page *page = FindLeafPage(&key, &path);
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int index = leaf->KeyIndex(key);
+  if (index == leaf->GetSize() || leaf->CompareAt(index, key) != 0) {
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    latch_.WUnlock();
+    return;
+  }
+
+  if (leaf->IsOverflow(index)) {
+    RID list = leaf->ValueAt(index);
+    page_id_t first_page_id = list.GetPageId();
+    if (!RemoveFromPostingList(&first_page_id, value)) {
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      latch_.WUnlock();
+      return;
+    }
+    uint32_t count = list.GetSlotNum() - 1;
+    leaf->SetValueAt(index, RID(first_page_id, count));
+    if (count == 0) {
+      RemoveFromLeaf(leaf, index, &path);
+      latch_.WUnlock();
+      return;
+    }
+    if (count * sizeof(RID) <= POSTING_INLINE_SIZE / 2 && count * sizeof(RID) <= leaf->GetFreeSize() + sizeof(RID)) {
+      // cooled down, the values move back into the leaf if they fit there
+      std::vector<RID> values;
+      ReadPostingList(first_page_id, &values);
+      FreePostingList(first_page_id);
+      VarKey entry_key = leaf->KeyAt(index);
+      leaf->Remove(index);
+      leaf->InsertAt(index, entry_key, values.data(), static_cast<int>(values.size()));
+    }
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+    latch_.WUnlock();
+    return;
+  }
+
+  std::vector<RID> values;
+  leaf->GetValues(index, &values);
+  auto it = std::find(values.begin(), values.end(), value);
+  if (it == values.end()) {
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  } else if (values.size() == 1) {
+    RemoveFromLeaf(leaf, index, &path);
+  } else {
+    values.erase(it);
+    VarKey entry_key = leaf->KeyAt(index);
+    leaf->Remove(index);
+    leaf->InsertAt(index, entry_key, values.data(), static_cast<int>(values.size()));
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+  }
+  latch_.WUnlock();
+}
+
+void VarBPlusTree::RemoveFromLeaf(LeafPage *leaf, int index, std::vector<page_id_t> *path) {
+  if (leaf->IsOverflow(index)) {
+    FreePostingList(leaf->ValueAt(index).GetPageId());
+  }
+  leaf->Remove(index);
+  if (leaf->GetSize() > 0) {
+    buffer_pool_manager_->UnpinPage(leaf->GetPageId(), true);
+  } else {
+    FreePage(leaf, path);
+    AdjustRoot();
+  }
+}
+
+template <typename N>
+void VarBPlusTree::FreePage(N *node, std::vector<page_id_t> *path) {
+  page_id_t page_id = node->GetPageId();
+  page_id_t prev_page_id = node->GetPrevPageId();
+  page_id_t next_page_id = node->GetNextPageId();
+  buffer_pool_manager_->UnpinPage(page_id, true);
+  buffer_pool_manager_->DeletePage(page_id);
+  if (path->empty()) {
+    // the root leaf emptied
+    root_page_id_ = INVALID_PAGE_ID;
+    UpdateRootPageId();
+    return;
+  }
+  if (prev_page_id != INVALID_PAGE_ID) {
+    Page *prev_page = buffer_pool_manager_->FetchPage(prev_page_id);
+    reinterpret_cast<N *>(prev_page->GetData())->SetNextPageId(next_page_id);
+    buffer_pool_manager_->UnpinPage(prev_page_id, true);
+  }
+  if (next_page_id != INVALID_PAGE_ID) {
+    Page *next_page = buffer_pool_manager_->FetchPage(next_page_id);
+    reinterpret_cast<N *>(next_page->GetData())->SetPrevPageId(prev_page_id);
+    buffer_pool_manager_->UnpinPage(next_page_id, true);
+  }
+
+  page_id_t parent_page_id = path->back();
+  path->pop_back();
+  auto *parent = reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(parent_page_id)->GetData());
+  int index = parent->ValueIndex(page_id);
+  parent->Remove(index);
+  if (parent->GetSize() == 0) {
+    FreePage(parent, path);
+    return;
+  }
+  if (index == 0) {
+    // the next child takes over the keys below it
+    parent->SetKeyAt(0, VarKey{});
+  }
+  buffer_pool_manager_->UnpinPage(parent_page_id, true);
+}
+
+void VarBPlusTree::AdjustRoot() {
+  while (!IsEmpty()) {
+    Page *page = buffer_pool_manager_->FetchPage(root_page_id_);
+    auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (node->IsLeafPage() || node->GetSize() > 1) {
+      buffer_pool_manager_->UnpinPage(root_page_id_, false);
+      return;
+    }
+    page_id_t child_page_id = reinterpret_cast<InternalPage *>(node)->ValueAt(0);
+    buffer_pool_manager_->UnpinPage(root_page_id_, false);
+    buffer_pool_manager_->DeletePage(root_page_id_);
+    root_page_id_ = child_page_id;
+    UpdateRootPageId();
+  }
+}
+
+/*****************************************************************************
+ * INDEX ITERATOR
+ *****************************************************************************/
+VarIndexIterator VarBPlusTree::begin() { return VarIndexIterator(this, nullptr); }
+
+VarIndexIterator VarBPlusTree::Begin(const VarKey &key) { return VarIndexIterator(this, &key); }
+
+VarIndexIterator VarBPlusTree::end() { return VarIndexIterator(); }
+
+void VarBPlusTree::ScanLeaf(const VarKey *key, bool inclusive, std::vector<std::pair<VarKey, RID>> *entries) {
+  entries->clear();
+  latch_.RLock();
+  if (IsEmpty()) {
+    latch_.RUnlock();
+    return;
+  }
+  Page *page = FindLeafPage(key, nullptr);
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int index = 0;
+  if (key != nullptr) {
+    index = leaf->KeyIndex(*key);
+    if (!inclusive && index < leaf->GetSize() && leaf->CompareAt(index, *key) == 0) {
+      index++;
+    }
+  }
+  if (index == leaf->GetSize() && leaf->GetNextPageId() != INVALID_PAGE_ID) {
+    // leaves do not stay empty, the next one starts above key
+    page_id_t next_page_id = leaf->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    page = buffer_pool_manager_->FetchPage(next_page_id);
+    leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    index = 0;
+  }
+  std::vector<RID> values;
+  for (; index < leaf->GetSize(); index++) {
+    VarKey entry_key = leaf->KeyAt(index);
+    values.clear();
+    GetValues(leaf, index, &values);
+    for (const RID &value : values) {
+      entries->emplace_back(entry_key, value);
+    }
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  latch_.RUnlock();
+}
+
+/*
+ * Update/Insert the root page id of this tree in the header page, see BPlusTree::UpdateRootPageId
+ */
+void VarBPlusTree::UpdateRootPageId() {
+  auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  header_page->WLatch();
+  if (!header_page->UpdateRecord(index_name_, root_page_id_)) {
+    header_page->InsertRecord(index_name_, root_page_id_);
+  }
+  header_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+}
+
+/*****************************************************************************
+ * POSTING LISTS
+ *****************************************************************************/
+void VarBPlusTree::GetValues(const LeafPage *leaf, int index, std::vector<RID> *values) {
+  if (leaf->IsOverflow(index)) {
+    ReadPostingList(leaf->ValueAt(index).GetPageId(), values);
+  } else {
+    leaf->GetValues(index, values);
+  }
+}
+
+page_id_t VarBPlusTree::CreatePostingList(const std::vector<RID> &values) {
+  page_id_t first_page_id;
+  Page *page = AllocatePage(&first_page_id);
+  auto *posting = reinterpret_cast<VarPostingPage *>(page->GetData());
+  posting->Init();
+  for (const RID &value : values) {
+    posting->InsertAt(posting->GetSize(), value);
+  }
+  buffer_pool_manager_->UnpinPage(first_page_id, true);
+  return first_page_id;
+}
+
+void VarBPlusTree::ReadPostingList(page_id_t page_id, std::vector<RID> *values) {
+  while (page_id != INVALID_PAGE_ID) {
+    auto *posting = reinterpret_cast<VarPostingPage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+    for (int i = 0; i < posting->GetSize(); i++) {
+      values->push_back(posting->ValueAt(i));
+    }
+    page_id_t next_page_id = posting->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+}
+
+bool VarBPlusTree::InsertIntoPostingList(page_id_t page_id, const RID &value) {
+  // the first page whose last value is not below value, or the last page
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  auto *posting = reinterpret_cast<VarPostingPage *>(page->GetData());
+  while (posting->GetNextPageId() != INVALID_PAGE_ID &&
+         VarPostingPage::Less(posting->ValueAt(posting->GetSize() - 1), value)) {
+    page_id_t next_page_id = posting->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_id = next_page_id;
+    page = buffer_pool_manager_->FetchPage(page_id);
+    posting = reinterpret_cast<VarPostingPage *>(page->GetData());
+  }
+  int index = posting->ValueIndex(value);
+  if (index < posting->GetSize() && posting->ValueAt(index) == value) {
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    return false;
+  }
+  if (posting->IsFull()) {
+    page_id_t new_page_id;
+    auto *new_posting = reinterpret_cast<VarPostingPage *>(AllocatePage(&new_page_id)->GetData());
+    new_posting->Init();
+    posting->MoveHalfTo(new_posting);
+    new_posting->SetNextPageId(posting->GetNextPageId());
+    posting->SetNextPageId(new_page_id);
+    if (index > posting->GetSize()) {
+      new_posting->InsertAt(index - posting->GetSize(), value);
+    } else {
+      posting->InsertAt(index, value);
+    }
+    buffer_pool_manager_->UnpinPage(new_page_id, true);
+  } else {
+    posting->InsertAt(index, value);
+  }
+  buffer_pool_manager_->UnpinPage(page_id, true);
+  return true;
+}
+
+bool VarBPlusTree::RemoveFromPostingList(page_id_t *page_id, const RID &value) {
+  page_id_t prev_page_id = INVALID_PAGE_ID;
+  page_id_t current_page_id = *page_id;
+  while (current_page_id != INVALID_PAGE_ID) {
+    auto *posting = reinterpret_cast<VarPostingPage *>(buffer_pool_manager_->FetchPage(current_page_id)->GetData());
+    int index = posting->ValueIndex(value);
+    if (index == posting->GetSize()) {
+      page_id_t next_page_id = posting->GetNextPageId();
+      buffer_pool_manager_->UnpinPage(current_page_id, false);
+      prev_page_id = current_page_id;
+      current_page_id = next_page_id;
+      continue;
+    }
+    if (!(posting->ValueAt(index) == value)) {
+      buffer_pool_manager_->UnpinPage(current_page_id, false);
+      return false;
+    }
+    posting->Remove(index);
+    if (posting->GetSize() > 0) {
+      buffer_pool_manager_->UnpinPage(current_page_id, true);
+      return true;
+    }
+    // unlink the page that emptied
+    page_id_t next_page_id = posting->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(current_page_id, true);
+    buffer_pool_manager_->DeletePage(current_page_id);
+    if (prev_page_id == INVALID_PAGE_ID) {
+      *page_id = next_page_id;
+    } else {
+      auto *prev = reinterpret_cast<VarPostingPage *>(buffer_pool_manager_->FetchPage(prev_page_id)->GetData());
+      prev->SetNextPageId(next_page_id);
+      buffer_pool_manager_->UnpinPage(prev_page_id, true);
+    }
+    return true;
+  }
+  return false;
+}
+
+void VarBPlusTree::FreePostingList(page_id_t page_id) {
+  while (page_id != INVALID_PAGE_ID) {
+    auto *posting = reinterpret_cast<VarPostingPage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+    page_id_t next_page_id = posting->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    buffer_pool_manager_->DeletePage(page_id);
+    page_id = next_page_id;
+  }
+}
+
+}  // namespace bustub
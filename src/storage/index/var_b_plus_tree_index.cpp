@@ -0,0 +1,45 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// var_b_plus_tree_index.cpp
+//
+// Identification: src/storage/index/var_b_plus_tree_index.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/var_b_plus_tree_index.h"
+
+namespace bustub {
+
+VarBPlusTreeIndex::VarBPlusTreeIndex(IndexMetadata *metadata, BufferPoolManager *buffer_pool_manager,
+                                     LogManager *log_manager, bool unique)
+    : Index(metadata), container_(metadata->GetName(), buffer_pool_manager, unique) {}
+
+void VarBPlusTreeIndex::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
+  VarKey index_key;
+  index_key.SetFromKey(key, GetKeySchema());
+  container_.Insert(index_key, rid, transaction);
+}
+
+void VarBPlusTreeIndex::DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) {
+  VarKey index_key;
+  index_key.SetFromKey(key, GetKeySchema());
+  container_.Remove(index_key, rid, transaction);
+}
+
+void VarBPlusTreeIndex::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
+  VarKey index_key;
+  index_key.SetFromKey(key, GetKeySchema());
+  container_.GetValue(index_key, result, transaction);
+}
+
+VarIndexIterator VarBPlusTreeIndex::GetBeginIterator() { return container_.begin(); }
+
+VarIndexIterator VarBPlusTreeIndex::GetBeginIterator(const VarKey &key) { return container_.Begin(key); }
+
+VarIndexIterator VarBPlusTreeIndex::GetEndIterator() { return container_.end(); }
+
+}  // namespace bustub
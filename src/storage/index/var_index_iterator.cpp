@@ -0,0 +1,31 @@
+/**
+ * var_index_iterator.cpp
+ */
+#include "storage/index/var_index_iterator.h"
+
+#include "storage/index/var_b_plus_tree.h"
+
+namespace bustub {
+
+VarIndexIterator::VarIndexIterator(VarBPlusTree *tree, const VarKey *key) : tree_(tree) {
+  tree_->ScanLeaf(key, true, &entries_);
+}
+
+bool VarIndexIterator::isEnd() const { return index_ >= entries_.size(); }
+
+const std::pair<VarKey, RID> &VarIndexIterator::operator*() const { return entries_[index_]; }
+
+VarIndexIterator &VarIndexIterator::operator++() {
+  if (isEnd()) {
+    return *this;
+  }
+  if (++index_ == entries_.size()) {
+    // continue after the last key of the copied leaf
+    VarKey key = entries_.back().first;
+    index_ = 0;
+    tree_->ScanLeaf(&key, false, &entries_);
+  }
+  return *this;
+}
+
+}  // namespace bustub
@@ -9,10 +9,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
 #include "common/exception.h"
+#include "common/macros.h"
 #include "storage/page/b_plus_tree_internal_page.h"
 
 namespace bustub {
@@ -31,6 +33,9 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id
   SetPageId(page_id);
   SetParentPageId(parent_id);
   SetMaxSize(max_size);
+  SetNextPageId(INVALID_PAGE_ID);
+  flags_ = 0;
+  prefix_size_ = 0;
 }
 /*
  * Helper method to get/set the key associated with input "index"(a.k.a
@@ -38,13 +43,181 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id
  */
 INDEX_TEMPLATE_ARGUMENTS
 KeyType B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index) const {
-  // replace with your own code
-  KeyType key = array[index].first;
+  // the prefix from the low key, the stored bytes, then the zeros that were dropped
+  KeyType key;
+  auto *data = reinterpret_cast<char *>(&key);
+  size_t prefix_size = index == 0 ? 0 : prefix_size_;
+  size_t stored_size = slots_[index].size_;
+  memcpy(data, &low_key_, prefix_size);
+  memcpy(data + prefix_size, KeyData(index), stored_size);
+  memset(data + prefix_size + stored_size, 0, sizeof(KeyType) - prefix_size - stored_size);
   return key;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) { array[index].first = key; }
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) {
+  if (index != 0 && HasPrefix(key)) {
+    size_t stored_size = StoredSize(key, prefix_size_);
+    ResizeKeyAt(index, stored_size);
+    memcpy(KeyData(index), reinterpret_cast<const char *>(&key) + prefix_size_, stored_size);
+    BUSTUB_ASSERT(GetUsedSize() <= PAGE_SIZE, "internal page entries do not fit");
+    return;
+  }
+  std::vector<MappingType> entries = GetEntries();
+  entries[index].first = key;
+  SetEntries(entries);
+}
+
+/*
+ * Helper methods to get/set the right-link and the fences of the B-link tree
+ */
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetNextPageId() const { return next_page_id_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+
+INDEX_TEMPLATE_ARGUMENTS
+const KeyType *B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetLowKey() const {
+  return (flags_ & BLINK_LOW_KEY) != 0 ? &low_key_ : nullptr;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetLowKey(const KeyType *low_key) {
+  // the prefix of the keys is part of the low key, decode them before it changes
+  std::vector<MappingType> entries = GetEntries();
+  if (low_key == nullptr) {
+    flags_ &= ~BLINK_LOW_KEY;
+  } else {
+    low_key_ = *low_key;
+    flags_ |= BLINK_LOW_KEY;
+  }
+  SetEntries(entries);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+const KeyType *B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetHighKey() const {
+  return (flags_ & BLINK_HIGH_KEY) != 0 ? &high_key_ : nullptr;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetHighKey(const KeyType *high_key) {
+  std::vector<MappingType> entries = GetEntries();
+  if (high_key == nullptr) {
+    flags_ &= ~BLINK_HIGH_KEY;
+  } else {
+    high_key_ = *high_key;
+    flags_ |= BLINK_HIGH_KEY;
+  }
+  SetEntries(entries);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::CompareToFences(const KeyType &key, const KeyComparator &comparator) const {
+  if ((flags_ & BLINK_LOW_KEY) != 0 && comparator(key, low_key_) < 0) {
+    return -1;
+  }
+  if ((flags_ & BLINK_HIGH_KEY) != 0 && comparator(key, high_key_) >= 0) {
+    return 1;
+  }
+  return 0;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::IsDeleted() const { return (flags_ & BLINK_DELETED) != 0; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetDeleted() { flags_ |= BLINK_DELETED; }
+
+/*
+ * Helper methods to tell how full the page is. Entries are variable-length, so a page is full by entries or by the
+ * bytes its keys take. The size limit leaves room for one more entry with a whole key: an insert into a page that is
+ * not overflowing always fits, and the page splits right after it if it is overflowing then.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+size_t B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetUsedSize() const {
+  int size = GetSize();
+  size_t used = sizeof(BPlusTreeInternalPage) + size * sizeof(Slot);
+  return size == 0 ? used : used + slots_[size - 1].offset_ + slots_[size - 1].size_;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+size_t B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetSizeLimit() { return PAGE_SIZE - sizeof(Slot) - sizeof(KeyType); }
+
+/*
+ * The bytes a page with these entries and fences would use, to pack pages without writing them
+ */
+INDEX_TEMPLATE_ARGUMENTS
+size_t B_PLUS_TREE_INTERNAL_PAGE_TYPE::EncodedSize(const MappingType *items, int size, const KeyType *low_key,
+                                                   const KeyType *high_key) {
+  size_t prefix_size = PrefixSize(items, size, low_key, high_key);
+  size_t used = sizeof(BPlusTreeInternalPage) + size * sizeof(Slot);
+  for (int i = 0; i < size; i++) {
+    used += StoredSize(items[i].first, i == 0 ? 0 : prefix_size);
+  }
+  return used;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::IsOverflowing() const {
+  return GetSize() > GetMaxSize() || GetUsedSize() > GetSizeLimit();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::IsUnderflowing() const {
+  return GetSize() < GetMinSize() && GetUsedSize() < GetSizeLimit() / 2;
+}
+
+// whether one more entry can not make the page overflow, or one less make it underflow
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::IsSafeToInsert() const {
+  return GetSize() < GetMaxSize() && GetUsedSize() + sizeof(Slot) + sizeof(KeyType) <= GetSizeLimit();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::IsSafeToRemove() const {
+  return GetSize() > GetMinSize() || GetUsedSize() >= GetSizeLimit() / 2 + sizeof(Slot) + sizeof(KeyType);
+}
+
+/*
+ * Whether a redistribution below can move the key at index to key, a longer key may not fit
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::CanSetKeyAt(int index, const KeyType &key) const {
+  std::vector<MappingType> entries = GetEntries();
+  entries[index].first = key;
+  return EncodedSize(entries.data(), entries.size(), GetLowKey(), GetHighKey()) <= GetSizeLimit();
+}
+
+/*
+ * Whether the right sibling and the middle key from the parent fit into this page. The merged page covers both
+ * ranges, so its prefix is the one of the low key of this page and the high key of right.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::CanMerge(const BPlusTreeInternalPage *right, const KeyType &middle_key) const {
+  std::vector<MappingType> entries = GetEntries();
+  std::vector<MappingType> right_entries = right->GetEntries();
+  right_entries[0].first = middle_key;
+  entries.insert(entries.end(), right_entries.begin(), right_entries.end());
+  return EncodedSize(entries.data(), entries.size(), GetLowKey(), right->GetHighKey()) <= GetSizeLimit();
+}
+
+/*
+ * Whether this page can take one entry from its sibling, the way MoveFirstToEndOf or MoveLastToFrontOf move it, with
+ * the fence between them moved to separator. The range of this page grows, its prefix may get shorter.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::CanTakeFrom(const BPlusTreeInternalPage *sibling, const KeyType &middle_key,
+                                                 const KeyType &separator) const {
+  std::vector<MappingType> entries = GetEntries();
+  if (GetNextPageId() == sibling->GetPageId()) {
+    entries.emplace_back(middle_key, sibling->ValueAt(0));
+    return EncodedSize(entries.data(), entries.size(), GetLowKey(), &separator) <= GetSizeLimit();
+  }
+  entries.front().first = middle_key;
+  entries.emplace(entries.begin(), middle_key, sibling->ValueAt(sibling->GetSize() - 1));
+  return EncodedSize(entries.data(), entries.size(), &separator, GetHighKey()) <= GetSizeLimit();
+}
 
 /*
  * Helper method to find and return array index(or offset), so that its value
@@ -54,7 +227,7 @@ INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueIndex(const ValueType &value) const {
   int size = GetSize();
   for (int i = 0; i < size; ++i) {
-    if (value == array[i].second) {
+    if (value == slots_[i].value_) {
       return i;
     }
   }
@@ -66,7 +239,143 @@ int B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueIndex(const ValueType &value) const {
  * offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const { return array[index].second; }
+ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const { return slots_[index].value_; }
+
+/*****************************************************************************
+ * COMPRESSION
+ *****************************************************************************/
+/*
+ * Decode every entry of the page
+ */
+INDEX_TEMPLATE_ARGUMENTS
+std::vector<MappingType> B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetEntries() const {
+  std::vector<MappingType> entries;
+  entries.reserve(GetSize());
+  for (int i = 0; i < GetSize(); i++) {
+    entries.emplace_back(KeyAt(i), ValueAt(i));
+  }
+  return entries;
+}
+
+/*
+ * Write the page anew from entries, compressed for the current fences
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetEntries(const std::vector<MappingType> &entries) {
+  int size = static_cast<int>(entries.size());
+  size_t prefix_size = PrefixSize(entries.data(), size, GetLowKey(), GetHighKey());
+  char *keys = reinterpret_cast<char *>(slots_ + size);
+  size_t offset = 0;
+  for (int i = 0; i < size; i++) {
+    size_t skip = i == 0 ? 0 : prefix_size;
+    size_t stored_size = StoredSize(entries[i].first, skip);
+    memcpy(keys + offset, reinterpret_cast<const char *>(&entries[i].first) + skip, stored_size);
+    slots_[i].value_ = entries[i].second;
+    slots_[i].offset_ = static_cast<uint16_t>(offset);
+    slots_[i].size_ = static_cast<uint16_t>(stored_size);
+    offset += stored_size;
+  }
+  prefix_size_ = static_cast<uint32_t>(prefix_size);
+  SetSize(size);
+  BUSTUB_ASSERT(GetUsedSize() <= PAGE_SIZE, "internal page entries do not fit");
+}
+
+/*
+ * The prefix the keys after the first share with both fences. Every key that can go between the fences shares it, an
+ * insert never makes it shorter and the keys longer. A page without both fences has none. The keys lie between the
+ * fences and share all of their prefix, but a key that does not is not lost either.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+size_t B_PLUS_TREE_INTERNAL_PAGE_TYPE::PrefixSize(const MappingType *items, int size, const KeyType *low_key,
+                                                  const KeyType *high_key) {
+  if (low_key == nullptr || high_key == nullptr) {
+    return 0;
+  }
+  const auto *low = reinterpret_cast<const char *>(low_key);
+  const auto *high = reinterpret_cast<const char *>(high_key);
+  size_t prefix_size = 0;
+  while (prefix_size < sizeof(KeyType) && low[prefix_size] == high[prefix_size]) {
+    prefix_size++;
+  }
+  for (int i = 1; i < size; i++) {
+    const auto *key = reinterpret_cast<const char *>(&items[i].first);
+    if (memcmp(key, low, prefix_size) != 0) {
+      size_t common = 0;
+      while (key[common] == low[common]) {
+        common++;
+      }
+      prefix_size = common;
+    }
+  }
+  return prefix_size;
+}
+
+/*
+ * The bytes kept of a key: those after the prefix, without the zeros it ends with
+ */
+INDEX_TEMPLATE_ARGUMENTS
+size_t B_PLUS_TREE_INTERNAL_PAGE_TYPE::StoredSize(const KeyType &key, size_t prefix_size) {
+  const auto *data = reinterpret_cast<const char *>(&key);
+  size_t end = sizeof(KeyType);
+  while (end > prefix_size && data[end - 1] == 0) {
+    end--;
+  }
+  return end - prefix_size;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+const char *B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyData(int index) const {
+  return reinterpret_cast<const char *>(slots_ + GetSize()) + slots_[index].offset_;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+char *B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyData(int index) {
+  return reinterpret_cast<char *>(slots_ + GetSize()) + slots_[index].offset_;
+}
+
+/*
+ * Whether a key can be stored in place, without its prefix
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::HasPrefix(const KeyType &key) const {
+  return memcmp(&key, &low_key_, prefix_size_) == 0;
+}
+
+/*
+ * Make room for stored_size bytes of the key at index, moving the keys after it
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::ResizeKeyAt(int index, size_t stored_size) {
+  int size = GetSize();
+  size_t end = slots_[index].offset_ + slots_[index].size_;
+  size_t keys_end = slots_[size - 1].offset_ + slots_[size - 1].size_;
+  char *keys = reinterpret_cast<char *>(slots_ + size);
+  memmove(keys + slots_[index].offset_ + stored_size, keys + end, keys_end - end);
+  int delta = static_cast<int>(stored_size) - slots_[index].size_;
+  slots_[index].size_ = static_cast<uint16_t>(stored_size);
+  for (int i = index + 1; i < size; i++) {
+    slots_[i].offset_ = static_cast<uint16_t>(slots_[i].offset_ + delta);
+  }
+}
+
+/*
+ * Compare the key at index with a key whose prefix is the one of the page, given the bytes after it
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::CompareSuffix(int index, const char *suffix, size_t suffix_size) const {
+  size_t stored_size = slots_[index].size_;
+  int order = memcmp(KeyData(index), suffix, stored_size);
+  if (order != 0) {
+    return order;
+  }
+  // the stored key goes on with zeros
+  for (size_t i = stored_size; i < suffix_size; i++) {
+    if (suffix[i] != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
 
 /*****************************************************************************
  * LOOKUP
@@ -77,44 +386,29 @@ ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const { return arra
  * Start the search from the second key(the first key should always be invalid)
  */
 INDEX_TEMPLATE_ARGUMENTS
-ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key, const KeyComparator &comparator) const {
-  // 若Ki为第一个>=key的k，ki==key则返回pi+1，ki>key则返回pi。
-  // 由于这里的实现方式是使array[0]为invalid，所以ki对应于array[i].first，pi为array[i-1].second（在ki左边）
-  // 先写出key比本节点所有key都大的情况
+ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key,
+                                                 [[maybe_unused]] const KeyComparator &comparator) const {
+  // the keys are compared as bytes, see the page format; the class only takes GenericComparator, which agrees
   int size = GetSize();
   assert(size != 0);
-  if (comparator(key, array[size - 1].first) >= 0) {
-    return array[size - 1].second;
+  const auto *data = reinterpret_cast<const char *>(&key);
+  // a key without the prefix of the page is below or above all of its keys
+  int order = memcmp(data, &low_key_, prefix_size_);
+  if (order != 0) {
+    return order < 0 ? ValueAt(0) : ValueAt(size - 1);
   }
-  // 二分写法
+  // 二分找到第一个大于key的Ki，key属于它左边的指针
   int l = 1;
-  int r = size - 1;
-  int m = (l + r) >> 1;
+  int r = size;
   while (l < r) {
-    m = (l + r + 1) >> 1;
-    int result = comparator(array[m].first, key);
-    if (result == -1) {
-      l = m;
-    } else if (result == 1) {
-      r = m - 1;
-    } else if (result == 0) {
-      return array[m].second;
+    int m = (l + r) >> 1;
+    if (CompareSuffix(m, data + prefix_size_, sizeof(KeyType) - prefix_size_) <= 0) {
+      l = m + 1;
+    } else {
+      r = m;
     }
   }
-  if (comparator(key, array[r].first) == -1) {
-    return array[r - 1].second;
-  }
-  return array[r].second;
-  // // 顺序写法
-  // for (int i = 1; i < size; i++) {
-  //   if (comparator(key, array[i].first) == -1) {
-  //     return array[i - 1].second;
-  //   }
-  //   if (comparator(key, array[i].first) == 0) {
-  //     return array[i].second;
-  //   }
-  // }
-  // return array[size - 1].second;
+  return ValueAt(l - 1);
 }
 
 /* Insert helper function
@@ -122,14 +416,24 @@ ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key, const KeyCo
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertAt(const int index, const KeyType &new_key, const ValueType &new_value) {
-  int size = GetSize();
-  for (int i = size; i > index; --i) {
-    array[i] = array[i - 1];
+  // the first key is kept whole, a new one pushes it to where it is compressed
+  if (index != 0 && HasPrefix(new_key)) {
+    int size = GetSize();
+    size_t keys_size = GetUsedSize() - sizeof(BPlusTreeInternalPage) - size * sizeof(Slot);
+    size_t offset = index < size ? slots_[index].offset_ : keys_size;
+    // one more slot, the keys move up to make room for it
+    memmove(slots_ + size + 1, slots_ + size, keys_size);
+    memmove(slots_ + index + 1, slots_ + index, (size - index) * sizeof(Slot));
+    slots_[index].value_ = new_value;
+    slots_[index].offset_ = static_cast<uint16_t>(offset);
+    slots_[index].size_ = 0;
+    IncreaseSize(1);
+    SetKeyAt(index, new_key);
+    return;
   }
-  array[index] = std::make_pair(new_key, new_value);
-  // std::cout<<"now size: "<<GetSize()<<std::endl;
-  IncreaseSize(1);
-  // std::cout<<"now size: "<<GetSize()<<std::endl;
+  std::vector<MappingType> entries = GetEntries();
+  entries.emplace(entries.begin() + index, new_key, new_value);
+  SetEntries(entries);
 }
 
 // SetParentToMe, for the moved internal page's children
@@ -153,10 +457,15 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetParentToMe(page_id_t page_id, BufferPool
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::PopulateNewRoot(const ValueType &old_value, const KeyType &new_key,
                                                      const ValueType &new_value) {
-  array[0].second = old_value;
-  array[1].first = new_key;
-  array[1].second = new_value;
-  SetSize(2);
+  SetEntries({std::make_pair(KeyType{}, old_value), std::make_pair(new_key, new_value)});
+}
+
+/*
+ * Fill an empty page with entries whose children have it as their parent already, like a bulk load does
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::PopulateFrom(const MappingType *items, int size) {
+  SetEntries(std::vector<MappingType>(items, items + size));
 }
 /*
  * Insert new_key & new_value pair right after the pair with its value ==
@@ -186,13 +495,24 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(BPlusTreeInternalPage *recipient
                                                 BufferPoolManager *buffer_pool_manager) {
   // 书上是将自己的KV复制到内存块T中，再将新的KV对插入到T，再把T的前一半复制回来，后一半复制给新节点。
   // 这里应该是将后一半移动给新节点，暂不知有没有T作为中介。
+  std::vector<MappingType> entries = GetEntries();
   int size = GetSize();
   // 4个移2个，5个移2个。
-  int move_size = size / 2;
-  recipient->CopyNFrom(array + size - move_size, move_size, buffer_pool_manager);
-  // std::cout<<"now size: "<<GetSize()<<std::endl;
-  IncreaseSize(-move_size);
-  // std::cout<<"now size: "<<GetSize()<<std::endl;
+  int keep = size - size / 2;
+  // keys of very different lengths could leave one half over the size limit, move the split point then
+  while (keep > 1 && EncodedSize(entries.data(), keep, GetLowKey(), GetHighKey()) > GetSizeLimit()) {
+    keep--;
+  }
+  while (keep < size - 1 &&
+         EncodedSize(entries.data() + keep, size - keep, GetLowKey(), GetHighKey()) > GetSizeLimit()) {
+    keep++;
+  }
+  // the half was measured compressed, the recipient gets its fences before it
+  recipient->SetLowKey(&entries[keep].first);
+  recipient->SetHighKey(GetHighKey());
+  recipient->CopyNFrom(entries.data() + keep, size - keep, buffer_pool_manager);
+  entries.resize(keep);
+  SetEntries(entries);
 }
 
 /* Copy entries into me, starting from {items} and copy {size} entries.
@@ -200,10 +520,14 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(BPlusTreeInternalPage *recipient
  * So I need to 'adopt' them by changing their parent page id, which needs to be persisted with BufferPoolManger
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(MappingType *items, int size, BufferPoolManager *buffer_pool_manager) {
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(const MappingType *items, int size,
+                                               BufferPoolManager *buffer_pool_manager) {
   // 这里是R节点从L节点拿走后面的move_size个KV对，放到自己的后面。
+  std::vector<MappingType> entries = GetEntries();
+  entries.insert(entries.end(), items, items + size);
+  SetEntries(entries);
   for (int i = 0; i < size; ++i) {
-    CopyLastFrom(items[i], buffer_pool_manager);
+    SetParentToMe(items[i].second, buffer_pool_manager);
   }
 }
 
@@ -217,13 +541,18 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(MappingType *items, int size, Buf
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index) {
-  int size = GetSize();
-  for (int i = index; i < size - 1; ++i) {
-    array[i] = array[i + 1];
+  if (index != 0) {
+    ResizeKeyAt(index, 0);
+    int size = GetSize();
+    size_t keys_size = GetUsedSize() - sizeof(BPlusTreeInternalPage) - size * sizeof(Slot);
+    memmove(slots_ + index, slots_ + index + 1, (size - index - 1) * sizeof(Slot));
+    memmove(slots_ + size - 1, slots_ + size, keys_size);
+    IncreaseSize(-1);
+    return;
   }
-  // std::cout<<"now size: "<<GetSize()<<std::endl;
-  IncreaseSize(-1);
-  // std::cout<<"now size: "<<GetSize()<<std::endl;
+  std::vector<MappingType> entries = GetEntries();
+  entries.erase(entries.begin() + index);
+  SetEntries(entries);
 }
 
 /*
@@ -250,19 +579,22 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
                                                BufferPoolManager *buffer_pool_manager, bool ToEnd) {
   // if里是向右Move，外面是向左Move
+  std::vector<MappingType> entries = GetEntries();
   if (!ToEnd) {
-    recipient->SetKeyAt(0, middle_key);
-    int size = GetSize();
-    for (int i = 0; i < size; ++i) {
-      MoveLastToFrontOf(recipient, array[i].first, buffer_pool_manager);
+    // the recipient's first child gets the middle key, every child moved in front of it keeps its own key
+    std::vector<MappingType> recipient_entries = recipient->GetEntries();
+    recipient_entries[0].first = middle_key;
+    recipient_entries.insert(recipient_entries.begin(), entries.begin(), entries.end());
+    recipient->SetEntries(recipient_entries);
+    for (const auto &entry : entries) {
+      recipient->SetParentToMe(entry.second, buffer_pool_manager);
     }
     SetSize(0);
     return;
   }
-  int recv_data_len = recipient->GetSize();
   // 把this合并到recipient，交接处是原本在这两兄弟父节点的middlekey+原本在this的第一个指针，后面的KV对就顺序排下来了
-  recipient->array[recv_data_len] = std::make_pair(middle_key, array[0].second);
-  recipient->CopyNFrom(array + 1, GetSize() - 1, buffer_pool_manager);
+  entries[0].first = middle_key;
+  recipient->CopyNFrom(entries.data(), GetSize(), buffer_pool_manager);
   SetSize(0);
 }
 
@@ -280,7 +612,7 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(BPlusTreeInternalPage *recipient,
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
                                                       BufferPoolManager *buffer_pool_manager) {
-  recipient->CopyLastFrom(std::make_pair(middle_key, array[0].second), buffer_pool_manager);
+  recipient->CopyLastFrom(std::make_pair(middle_key, ValueAt(0)), buffer_pool_manager);
   Remove(0);
 }
 
@@ -305,7 +637,7 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
                                                        BufferPoolManager *buffer_pool_manager) {
   int size = GetSize();
-  recipient->CopyFirstFrom(std::make_pair(middle_key, array[size - 1].second), buffer_pool_manager);
+  recipient->CopyFirstFrom(std::make_pair(middle_key, ValueAt(size - 1)), buffer_pool_manager);
   Remove(size - 1);
 }
 
@@ -317,8 +649,10 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeInternalPage *re
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {
   SetParentToMe(pair.second, buffer_pool_manager);
-  InsertAt(0, pair.first, pair.second);
-  array[1].first = pair.first;
+  std::vector<MappingType> entries = GetEntries();
+  entries.insert(entries.begin(), pair);
+  entries[1].first = pair.first;
+  SetEntries(entries);
 }
 
 // valuetype for internalNode should be page id_t
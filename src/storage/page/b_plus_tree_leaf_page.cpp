@@ -9,10 +9,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <cstring>
 #include <sstream>
 
 #include "common/exception.h"
 #include "common/rid.h"
+#include "storage/index/key_search.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
 
 namespace bustub {
@@ -35,6 +37,7 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, in
   SetMaxSize(max_size);
   SetNextPageId(INVALID_PAGE_ID);
   SetPrePageId(INVALID_PAGE_ID);
+  flags_ = 0;
 }
 
 /**
@@ -52,36 +55,63 @@ page_id_t B_PLUS_TREE_LEAF_PAGE_TYPE::GetPrePageId() const { return pre_page_id_
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::SetPrePageId(page_id_t pre_page_id) { pre_page_id_ = pre_page_id; }
 
+/*
+ * Helper methods to get/set the fences of the B-link tree
+ */
+INDEX_TEMPLATE_ARGUMENTS
+const KeyType *B_PLUS_TREE_LEAF_PAGE_TYPE::GetLowKey() const {
+  return (flags_ & BLINK_LOW_KEY) != 0 ? &low_key_ : nullptr;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetLowKey(const KeyType *low_key) {
+  if (low_key == nullptr) {
+    flags_ &= ~BLINK_LOW_KEY;
+    return;
+  }
+  low_key_ = *low_key;
+  flags_ |= BLINK_LOW_KEY;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+const KeyType *B_PLUS_TREE_LEAF_PAGE_TYPE::GetHighKey() const {
+  return (flags_ & BLINK_HIGH_KEY) != 0 ? &high_key_ : nullptr;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetHighKey(const KeyType *high_key) {
+  if (high_key == nullptr) {
+    flags_ &= ~BLINK_HIGH_KEY;
+    return;
+  }
+  high_key_ = *high_key;
+  flags_ |= BLINK_HIGH_KEY;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::CompareToFences(const KeyType &key, const KeyComparator &comparator) const {
+  if ((flags_ & BLINK_LOW_KEY) != 0 && comparator(key, low_key_) < 0) {
+    return -1;
+  }
+  if ((flags_ & BLINK_HIGH_KEY) != 0 && comparator(key, high_key_) >= 0) {
+    return 1;
+  }
+  return 0;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::IsDeleted() const { return (flags_ & BLINK_DELETED) != 0; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetDeleted() { flags_ |= BLINK_DELETED; }
+
 /**
- * Helper method to find the first index i so that array[i].first >= key
+ * Helper method to find the first index i so that keys_[i] >= key
  * NOTE: This method is only used when generating index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparator &comparator) const {
-  int size = GetSize();
-  // if(int(key.ToString()) == 3) {
-  //   std::cout<<"searching key "<<key.ToString()<<std::endl;
-  //   std::cout<<"array size: "<<size<<std::endl;
-  //   std::cout<<"last key in array: "<<array[size - 1].first.ToString()<<std::endl;
-  // }
-  if (size == 0 || comparator(array[size - 1].first, key) == -1) {
-    return size;
-  }
-  int l = 0;
-  int r = size - 1;
-  int m = (l + r) >> 1;
-  while (l < r) {
-    m = (l + r) >> 1;
-    int result = comparator(array[m].first, key);
-    if (result == -1) {
-      l = m + 1;
-    } else if (result == 1) {
-      r = m;
-    } else if (result == 0) {
-      return m;
-    }
-  }
-  return l;
+  return KeyLowerBound(keys_, GetSize(), key, comparator);
 }
 
 /*
@@ -89,18 +119,17 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparator
  * array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const { return array[index].first; }
+KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const { return keys_[index]; }
 
 INDEX_TEMPLATE_ARGUMENTS
-ValueType B_PLUS_TREE_LEAF_PAGE_TYPE::ValueAt(int index) const { return array[index].second; }
+ValueType B_PLUS_TREE_LEAF_PAGE_TYPE::ValueAt(int index) const { return Values()[index]; }
 /*
  * Helper method to find and return the key & value pair associated with input
  * "index"(a.k.a array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-const MappingType &B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) {
-  // replace with your own code
-  return array[index];
+MappingType B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) const {
+  return std::make_pair(keys_[index], Values()[index]);
 }
 
 /*****************************************************************************
@@ -115,7 +144,7 @@ bool B_PLUS_TREE_LEAF_PAGE_TYPE::checkDupl(const KeyType &key, const KeyComparat
   }
   int index;
   index = KeyIndex(key, comparator);
-  return (comparator(key, KeyAt(index)) == 0);
+  return index < GetSize() && comparator(key, KeyAt(index)) == 0;
 }
 
 /*
@@ -124,10 +153,11 @@ bool B_PLUS_TREE_LEAF_PAGE_TYPE::checkDupl(const KeyType &key, const KeyComparat
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::InsertAt(int index, const KeyType &key, const ValueType &value) {
   int size = GetSize();
-  for (int i = size; i > index; --i) {
-    array[i] = array[i - 1];
-  }
-  array[index] = std::make_pair(key, value);
+  ValueType *values = Values();
+  memmove(static_cast<void *>(keys_ + index + 1), keys_ + index, (size - index) * sizeof(KeyType));
+  memmove(static_cast<void *>(values + index + 1), values + index, (size - index) * sizeof(ValueType));
+  keys_[index] = key;
+  values[index] = value;
   IncreaseSize(1);
 }
 
@@ -155,18 +185,19 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveHalfTo(BPlusTreeLeafPage *recipient) {
   int size = GetSize();
   int move_size = size / 2;
-  recipient->CopyNFrom(array + size - move_size, move_size);
+  recipient->CopyNFrom(this, size - move_size, move_size);
   IncreaseSize(-move_size);
 }
 
 /*
- * Copy starting from items, and copy {size} number of elements into me.
+ * Copy {size} number of elements of page, starting at index, to the end of my items.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(MappingType *items, int size) {
-  for (int i = 0; i < size; ++i) {
-    CopyLastFrom(items[i]);
-  }
+void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(const BPlusTreeLeafPage *page, int index, int size) {
+  int my_size = GetSize();
+  memcpy(static_cast<void *>(keys_ + my_size), page->keys_ + index, size * sizeof(KeyType));
+  memcpy(static_cast<void *>(Values() + my_size), page->Values() + index, size * sizeof(ValueType));
+  IncreaseSize(size);
 }
 
 /*****************************************************************************
@@ -180,7 +211,8 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(MappingType *items, int size) {
 INDEX_TEMPLATE_ARGUMENTS
 bool B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType *value, const KeyComparator &comparator) const {
   int index = KeyIndex(key, comparator);
-  if (comparator(key, KeyAt(index)) == 0) {
+  // the slots past the size still hold whatever was removed from them
+  if (index < GetSize() && comparator(key, KeyAt(index)) == 0) {
     *value = ValueAt(index);
     return true;
   }
@@ -197,10 +229,9 @@ bool B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType *value, co
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::Remove(int index) {
   int size = GetSize();
-  for (int i = index; i < size - 1; ++i) {
-    array[i] = array[i + 1];
-  }
-  // array[size - 1] = {};
+  ValueType *values = Values();
+  memmove(static_cast<void *>(keys_ + index), keys_ + index + 1, (size - index - 1) * sizeof(KeyType));
+  memmove(static_cast<void *>(values + index), values + index + 1, (size - index - 1) * sizeof(ValueType));
   IncreaseSize(-1);
 }
 
@@ -218,7 +249,7 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(const KeyType &key, const
     return 0;
   }
   int index = KeyIndex(key, comparator);
-  if (comparator(key, array[index].first) != 0 || index >= GetSize()) {
+  if (index >= GetSize() || comparator(key, keys_[index]) != 0) {
     // std::cout<<"remove fault: there's not "<<key.ToString()<<std::endl;
     return GetSize();
   }
@@ -247,7 +278,7 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient, bool To
     SetSize(0);
     return;
   }
-  recipient->CopyNFrom(array, GetSize());
+  recipient->CopyNFrom(this, 0, GetSize());
   recipient->SetNextPageId(next_page_id_);
   SetSize(0);
 }
@@ -260,7 +291,7 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient, bool To
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeLeafPage *recipient) {
-  recipient->CopyLastFrom(array[0]);
+  recipient->CopyLastFrom(GetItem(0));
   Remove(0);
 }
 
@@ -276,7 +307,7 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyLastFrom(const MappingType &item) { InsertA
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeLeafPage *recipient) {
   int size = GetSize();
-  recipient->CopyFirstFrom(array[size - 1]);
+  recipient->CopyFirstFrom(GetItem(size - 1));
   Remove(size - 1);
 }
 
@@ -0,0 +1,67 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// catalog_page.cpp
+//
+// Identification: src/storage/page/catalog_page.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/page/catalog_page.h"
+
+namespace bustub {
+
+void CatalogPage::Init(page_id_t page_id) {
+  memcpy(GetData(), &page_id, sizeof(page_id));
+  SetLSN(INVALID_LSN);
+  SetNextPageId(INVALID_PAGE_ID);
+  SetRecordCount(0);
+  SetFreeOffset(SIZE_CATALOG_PAGE_HEADER);
+}
+
+page_id_t CatalogPage::GetNextPageId() { return *reinterpret_cast<page_id_t *>(GetData() + OFFSET_NEXT_PAGE_ID); }
+
+void CatalogPage::SetNextPageId(page_id_t next_page_id) {
+  memcpy(GetData() + OFFSET_NEXT_PAGE_ID, &next_page_id, sizeof(page_id_t));
+}
+
+int CatalogPage::GetRecordCount() { return *reinterpret_cast<int *>(GetData() + OFFSET_RECORD_COUNT); }
+
+void CatalogPage::SetRecordCount(int record_count) {
+  memcpy(GetData() + OFFSET_RECORD_COUNT, &record_count, sizeof(int));
+}
+
+uint32_t CatalogPage::GetFreeOffset() { return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_FREE_OFFSET); }
+
+void CatalogPage::SetFreeOffset(uint32_t free_offset) {
+  memcpy(GetData() + OFFSET_FREE_OFFSET, &free_offset, sizeof(uint32_t));
+}
+
+bool CatalogPage::InsertRecord(const std::vector<char> &record) {
+  uint32_t free_offset = GetFreeOffset();
+  auto size = static_cast<uint32_t>(record.size());
+  if (free_offset + sizeof(uint32_t) + size > PAGE_SIZE) {
+    return false;
+  }
+  memcpy(GetData() + free_offset, &size, sizeof(uint32_t));
+  memcpy(GetData() + free_offset + sizeof(uint32_t), record.data(), size);
+  SetFreeOffset(free_offset + sizeof(uint32_t) + size);
+  SetRecordCount(GetRecordCount() + 1);
+  return true;
+}
+
+void CatalogPage::GetRecords(std::vector<std::vector<char>> *records) {
+  uint32_t offset = SIZE_CATALOG_PAGE_HEADER;
+  int record_count = GetRecordCount();
+  for (int i = 0; i < record_count; i++) {
+    uint32_t size = *reinterpret_cast<uint32_t *>(GetData() + offset);
+    offset += sizeof(uint32_t);
+    records->emplace_back(GetData() + offset, GetData() + offset + size);
+    offset += size;
+  }
+}
+
+}  // namespace bustub
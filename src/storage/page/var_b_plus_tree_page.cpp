@@ -0,0 +1,242 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// var_b_plus_tree_page.cpp
+//
+// Identification: src/storage/page/var_b_plus_tree_page.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/page/var_b_plus_tree_page.h"
+
+#include <cstring>
+
+#include "common/rid.h"
+
+namespace bustub {
+
+template <typename ValueType>
+void VAR_B_PLUS_TREE_PAGE_TYPE::Init(page_id_t page_id, IndexPageType page_type) {
+  SetPageType(page_type);
+  SetSize(0);
+  SetPageId(page_id);
+  SetParentPageId(INVALID_PAGE_ID);
+  // as many entries as fit with empty keys, the bytes the keys take decide before
+  SetMaxSize(static_cast<int>((PAGE_SIZE - sizeof(VarBPlusTreePage)) / (sizeof(Slot) + sizeof(ValueType))));
+  next_page_id_ = INVALID_PAGE_ID;
+  prev_page_id_ = INVALID_PAGE_ID;
+  cells_begin_ = PAGE_SIZE;
+}
+
+template <typename ValueType>
+page_id_t VAR_B_PLUS_TREE_PAGE_TYPE::GetNextPageId() const {
+  return next_page_id_;
+}
+
+template <typename ValueType>
+void VAR_B_PLUS_TREE_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) {
+  next_page_id_ = next_page_id;
+}
+
+template <typename ValueType>
+page_id_t VAR_B_PLUS_TREE_PAGE_TYPE::GetPrevPageId() const {
+  return prev_page_id_;
+}
+
+template <typename ValueType>
+void VAR_B_PLUS_TREE_PAGE_TYPE::SetPrevPageId(page_id_t prev_page_id) {
+  prev_page_id_ = prev_page_id;
+}
+
+template <typename ValueType>
+const char *VAR_B_PLUS_TREE_PAGE_TYPE::CellAt(int index) const {
+  return reinterpret_cast<const char *>(this) + slots_[index].offset_;
+}
+
+template <typename ValueType>
+size_t VAR_B_PLUS_TREE_PAGE_TYPE::CellSize(int index) const {
+  return ValueCount(index) * sizeof(ValueType) + slots_[index].key_size_;
+}
+
+template <typename ValueType>
+VarKey VAR_B_PLUS_TREE_PAGE_TYPE::KeyAt(int index) const {
+  VarKey key;
+  key.SetData(CellAt(index) + ValueCount(index) * sizeof(ValueType), slots_[index].key_size_);
+  return key;
+}
+
+template <typename ValueType>
+ValueType VAR_B_PLUS_TREE_PAGE_TYPE::ValueAt(int index, int i) const {
+  // cells are packed by bytes, the value may be unaligned
+  ValueType value;
+  memcpy(&value, CellAt(index) + i * sizeof(ValueType), sizeof(ValueType));
+  return value;
+}
+
+template <typename ValueType>
+void VAR_B_PLUS_TREE_PAGE_TYPE::SetValueAt(int index, const ValueType &value, int i) {
+  memcpy(reinterpret_cast<char *>(this) + slots_[index].offset_ + i * sizeof(ValueType), &value, sizeof(ValueType));
+}
+
+template <typename ValueType>
+void VAR_B_PLUS_TREE_PAGE_TYPE::GetValues(int index, std::vector<ValueType> *values) const {
+  size_t size = values->size();
+  values->resize(size + ValueCount(index));
+  memcpy(values->data() + size, CellAt(index), ValueCount(index) * sizeof(ValueType));
+}
+
+template <typename ValueType>
+int VAR_B_PLUS_TREE_PAGE_TYPE::ValueCount(int index) const {
+  return slots_[index].count_ & ~OVERFLOW_FLAG;
+}
+
+template <typename ValueType>
+bool VAR_B_PLUS_TREE_PAGE_TYPE::IsOverflow(int index) const {
+  return (slots_[index].count_ & OVERFLOW_FLAG) != 0;
+}
+
+template <typename ValueType>
+int VAR_B_PLUS_TREE_PAGE_TYPE::ValueIndex(const ValueType &value) const {
+  for (int i = 0; i < GetSize(); i++) {
+    if (ValueAt(i) == value) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+template <typename ValueType>
+int VAR_B_PLUS_TREE_PAGE_TYPE::CompareAt(int index, const VarKey &key) const {
+  return VarKeyComparator::Compare(CellAt(index) + ValueCount(index) * sizeof(ValueType), slots_[index].key_size_,
+                                   key.GetData(), key.GetSize());
+}
+
+template <typename ValueType>
+int VAR_B_PLUS_TREE_PAGE_TYPE::KeyIndex(const VarKey &key) const {
+  int l = 0;
+  int r = GetSize();
+  while (l < r) {
+    int m = (l + r) >> 1;
+    if (CompareAt(m, key) < 0) {
+      l = m + 1;
+    } else {
+      r = m;
+    }
+  }
+  return l;
+}
+
+template <typename ValueType>
+ValueType VAR_B_PLUS_TREE_PAGE_TYPE::Lookup(const VarKey &key) const {
+  // the first key above key, the child left of it holds key. The first key is not compared.
+  int l = 1;
+  int r = GetSize();
+  while (l < r) {
+    int m = (l + r) >> 1;
+    if (CompareAt(m, key) <= 0) {
+      l = m + 1;
+    } else {
+      r = m;
+    }
+  }
+  return ValueAt(l - 1);
+}
+
+template <typename ValueType>
+size_t VAR_B_PLUS_TREE_PAGE_TYPE::EntrySize(const VarKey &key, int count) {
+  return sizeof(Slot) + count * sizeof(ValueType) + key.GetSize();
+}
+
+template <typename ValueType>
+size_t VAR_B_PLUS_TREE_PAGE_TYPE::GetFreeSize() const {
+  return cells_begin_ - sizeof(VarBPlusTreePage) - GetSize() * sizeof(Slot);
+}
+
+template <typename ValueType>
+bool VAR_B_PLUS_TREE_PAGE_TYPE::InsertAt(int index, const VarKey &key, const ValueType &value) {
+  return InsertAt(index, key, &value, 1);
+}
+
+template <typename ValueType>
+bool VAR_B_PLUS_TREE_PAGE_TYPE::InsertAt(int index, const VarKey &key, const ValueType *values, int count,
+                                         bool overflow) {
+  if (EntrySize(key, count) > GetFreeSize()) {
+    return false;
+  }
+  cells_begin_ -= count * sizeof(ValueType) + key.GetSize();
+  char *cell = reinterpret_cast<char *>(this) + cells_begin_;
+  memcpy(cell, values, count * sizeof(ValueType));
+  memcpy(cell + count * sizeof(ValueType), key.GetData(), key.GetSize());
+  memmove(slots_ + index + 1, slots_ + index, (GetSize() - index) * sizeof(Slot));
+  slots_[index].offset_ = static_cast<uint16_t>(cells_begin_);
+  slots_[index].key_size_ = static_cast<uint16_t>(key.GetSize());
+  slots_[index].count_ = static_cast<uint16_t>(count | (overflow ? OVERFLOW_FLAG : 0));
+  IncreaseSize(1);
+  return true;
+}
+
+template <typename ValueType>
+bool VAR_B_PLUS_TREE_PAGE_TYPE::CopyEntry(int index, const VarBPlusTreePage *page, int from) {
+  std::vector<ValueType> values;
+  page->GetValues(from, &values);
+  return InsertAt(index, page->KeyAt(from), values.data(), static_cast<int>(values.size()), page->IsOverflow(from));
+}
+
+template <typename ValueType>
+void VAR_B_PLUS_TREE_PAGE_TYPE::Remove(int index) {
+  // close the gap the cell leaves, the cells below it move up
+  uint32_t offset = slots_[index].offset_;
+  uint32_t cell_size = CellSize(index);
+  char *data = reinterpret_cast<char *>(this);
+  memmove(data + cells_begin_ + cell_size, data + cells_begin_, offset - cells_begin_);
+  cells_begin_ += cell_size;
+  memmove(slots_ + index, slots_ + index + 1, (GetSize() - index - 1) * sizeof(Slot));
+  IncreaseSize(-1);
+  for (int i = 0; i < GetSize(); i++) {
+    if (slots_[i].offset_ < offset) {
+      slots_[i].offset_ = static_cast<uint16_t>(slots_[i].offset_ + cell_size);
+    }
+  }
+}
+
+/*
+ * Replace the key at index and return true, false if the new key does not fit. A shorter key always fits.
+ */
+template <typename ValueType>
+bool VAR_B_PLUS_TREE_PAGE_TYPE::SetKeyAt(int index, const VarKey &key) {
+  if (key.GetSize() > slots_[index].key_size_ + GetFreeSize()) {
+    return false;
+  }
+  std::vector<ValueType> values;
+  GetValues(index, &values);
+  bool overflow = IsOverflow(index);
+  Remove(index);
+  InsertAt(index, key, values.data(), static_cast<int>(values.size()), overflow);
+  return true;
+}
+
+template <typename ValueType>
+void VAR_B_PLUS_TREE_PAGE_TYPE::MoveHalfTo(VarBPlusTreePage *recipient) {
+  size_t used = PAGE_SIZE - sizeof(VarBPlusTreePage) - GetFreeSize();
+  // the first entry that starts in the upper half of the used bytes, this page keeps at least one
+  int split = 1;
+  size_t below = sizeof(Slot) + CellSize(0);
+  while (split < GetSize() - 1 && below < used / 2) {
+    below += sizeof(Slot) + CellSize(split);
+    split++;
+  }
+  for (int i = split; i < GetSize(); i++) {
+    recipient->CopyEntry(recipient->GetSize(), this, i);
+  }
+  while (GetSize() > split) {
+    Remove(GetSize() - 1);
+  }
+}
+
+template class VarBPlusTreePage<RID>;
+template class VarBPlusTreePage<page_id_t>;
+
+}  // namespace bustub
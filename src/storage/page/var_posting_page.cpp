@@ -0,0 +1,57 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// var_posting_page.cpp
+//
+// Identification: src/storage/page/var_posting_page.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/page/var_posting_page.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace bustub {
+
+void VarPostingPage::Init() {
+  next_page_id_ = INVALID_PAGE_ID;
+  size_ = 0;
+}
+
+page_id_t VarPostingPage::GetNextPageId() const { return next_page_id_; }
+
+void VarPostingPage::SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+
+int VarPostingPage::GetSize() const { return size_; }
+
+bool VarPostingPage::IsFull() const { return size_ == CAPACITY; }
+
+int VarPostingPage::ValueIndex(const RID &rid) const {
+  return static_cast<int>(std::lower_bound(rids_, rids_ + size_, rid, Less) - rids_);
+}
+
+RID VarPostingPage::ValueAt(int index) const { return rids_[index]; }
+
+void VarPostingPage::InsertAt(int index, const RID &rid) {
+  memmove(static_cast<void *>(rids_ + index + 1), rids_ + index, (size_ - index) * sizeof(RID));
+  rids_[index] = rid;
+  size_++;
+}
+
+void VarPostingPage::Remove(int index) {
+  memmove(static_cast<void *>(rids_ + index), rids_ + index + 1, (size_ - index - 1) * sizeof(RID));
+  size_--;
+}
+
+void VarPostingPage::MoveHalfTo(VarPostingPage *recipient) {
+  int move_size = size_ / 2;
+  memcpy(static_cast<void *>(recipient->rids_ + recipient->size_), rids_ + size_ - move_size, move_size * sizeof(RID));
+  recipient->size_ += move_size;
+  size_ -= move_size;
+}
+
+}  // namespace bustub
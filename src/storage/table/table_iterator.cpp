@@ -54,12 +54,13 @@ TableIterator &TableIterator::operator++() {
     }
   }
   tuple_->rid_ = next_tuple_rid;
+  // GetTuple latches the page itself, after waiting for the undo of a loser that holds the tuple, which latches it too
+  cur_page->RUnlatch();
 
   if (*this != table_heap_->End()) {
     table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
   }
   // release until copy the tuple
-  cur_page->RUnlatch();
   buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
   return *this;
 }
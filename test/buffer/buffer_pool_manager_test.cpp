@@ -141,4 +141,65 @@ TEST(BufferPoolManagerTest, SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, PrefetchTest) {
+  const std::string db_name = "prefetch_test.db";
+  const size_t buffer_pool_size = 10;
+  // the other tests leave their pages behind if they fail, start from an empty file
+  remove(db_name.c_str());
+  remove("prefetch_test.log");
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  page_id_t page_id_temp;
+  for (int i = 0; i < 20; i++) {
+    Page *page = bpm->NewPage(&page_id_temp);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    bpm->UnpinPage(page_id_temp, true);
+  }
+  bpm->FlushAllPages();
+  delete bpm;
+
+  bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  int reads = 0;
+  bpm->SetPageReadHook([&reads](Page *page) {
+    reads++;
+    return INVALID_LSN;
+  });
+
+  // Scenario: a page read ahead is there for the fetch, which does not read it again.
+  bpm->PrefetchPage(3);
+  bpm->WaitForPrefetch();
+  EXPECT_EQ(1, reads);
+  Page *page = bpm->FetchPage(3);
+  EXPECT_EQ(1, reads);
+  EXPECT_EQ(0, strcmp(page->GetData(), "page 3"));
+
+  // Scenario: a page in the buffer pool is not read again, pinned or not.
+  bpm->PrefetchPage(3);
+  bpm->UnpinPage(3, false);
+  bpm->PrefetchPage(3);
+  bpm->WaitForPrefetch();
+  EXPECT_EQ(1, reads);
+
+  // Scenario: pages read ahead are unpinned, more of them than frames evict the first ones.
+  for (int i = 0; i < 20; i++) {
+    bpm->PrefetchPage(i);
+    bpm->WaitForPrefetch();
+  }
+  EXPECT_EQ(20, reads);
+  page = bpm->FetchPage(19);
+  EXPECT_EQ(20, reads);
+  EXPECT_EQ(0, strcmp(page->GetData(), "page 19"));
+  bpm->UnpinPage(19, false);
+  page = bpm->FetchPage(0);
+  EXPECT_EQ(21, reads);
+  EXPECT_EQ(0, strcmp(page->GetData(), "page 0"));
+  bpm->UnpinPage(0, false);
+
+  delete bpm;
+  delete disk_manager;
+  remove(db_name.c_str());
+  remove("prefetch_test.log");
+}
+
 }  // namespace bustub
@@ -0,0 +1,72 @@
+/**
+ * log_manager_group_commit_bench_test.cpp
+ */
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <iostream>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "concurrency/lock_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+#include "recovery/log_manager.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+namespace {
+
+/** Run empty transactions from num_threads clients and print the commit throughput. */
+void CommitThroughput(DurabilityLevel durability_level, int num_threads, int txns_per_thread) {
+  remove("bench.db");
+  remove("bench.log");
+  DiskManager disk_manager("bench.db");
+  LogManager log_manager(&disk_manager);
+  LockManager lock_manager;
+  TransactionManager txn_manager(&lock_manager, &log_manager);
+  txn_manager.SetDurabilityLevel(durability_level);
+  log_manager.RunFlushThread();
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&txn_manager, txns_per_thread] {
+      for (int j = 0; j < txns_per_thread; j++) {
+        Transaction *txn = txn_manager.Begin();
+        txn_manager.Commit(txn);
+        delete txn;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  double seconds = std::chrono::duration<double>(end - start).count();
+  int commits = num_threads * txns_per_thread;
+  std::cout << (durability_level == DurabilityLevel::SYNC ? "sync, " : "async, ") << num_threads
+            << " threads: " << commits / seconds << " commits/s, "
+            << static_cast<double>(commits) / disk_manager.GetNumFlushes() << " commits per log write" << std::endl;
+
+  log_manager.StopFlushThread();
+  EXPECT_EQ(log_manager.GetPersistentLSN(), 2 * commits - 1);
+  disk_manager.ShutDown();
+  remove("bench.db");
+  remove("bench.log");
+}
+
+}  // namespace
+
+// NOLINTNEXTLINE
+TEST(LogManagerGroupCommitBenchTest, CommitThroughputTest) {
+  for (auto durability_level : {DurabilityLevel::SYNC, DurabilityLevel::ASYNC}) {
+    for (int num_threads : {1, 2, 4, 8, 16}) {
+      CommitThroughput(durability_level, num_threads, 2000);
+    }
+  }
+}
+
+}  // namespace bustub
@@ -0,0 +1,192 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_manager_test.cpp
+//
+// Identification: test/recovery/log_manager_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstring>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "concurrency/lock_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+#include "recovery/log_manager.h"
+#include "recovery/log_record.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+class LogManagerTest : public ::testing::Test {
+ protected:
+  // This function is called before every test.
+  void SetUp() override {
+    remove("test.db");
+    remove("test.log");
+  }
+
+  // This function is called after every test.
+  void TearDown() override {
+    remove("test.db");
+    remove("test.log");
+  };
+};
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, CommitIsPersistentTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  LockManager lock_manager;
+  TransactionManager txn_manager(&lock_manager, &log_manager);
+  // make sure nothing but the commit gets the log out
+  log_timeout = std::chrono::seconds(15);
+  log_manager.RunFlushThread();
+  ASSERT_TRUE(enable_logging);
+
+  Transaction *txn = txn_manager.Begin();
+  EXPECT_EQ(log_manager.GetPersistentLSN(), INVALID_LSN);
+  txn_manager.Commit(txn);
+  // BEGIN and COMMIT
+  EXPECT_EQ(log_manager.GetNextLSN(), 2);
+  EXPECT_EQ(log_manager.GetPersistentLSN(), 1);
+  EXPECT_EQ(txn->GetPrevLSN(), 1);
+  delete txn;
+
+  log_manager.StopFlushThread();
+  EXPECT_FALSE(enable_logging);
+  log_timeout = std::chrono::seconds(1);
+
+  // | size | LSN | transID | prevLSN | LogType |
+  int32_t header[5];
+  ASSERT_TRUE(disk_manager.ReadLog(reinterpret_cast<char *>(header), sizeof(header), 20));
+  EXPECT_EQ(header[0], 20);
+  EXPECT_EQ(header[1], 1);
+  EXPECT_EQ(header[3], 0);
+  EXPECT_EQ(header[4], static_cast<int32_t>(LogRecordType::COMMIT));
+  disk_manager.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, GroupCommitTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  LockManager lock_manager;
+  TransactionManager txn_manager(&lock_manager, &log_manager);
+  log_manager.RunFlushThread();
+
+  const int num_threads = 8;
+  const int txns_per_thread = 100;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&txn_manager] {
+      for (int j = 0; j < txns_per_thread; j++) {
+        Transaction *txn = txn_manager.Begin();
+        txn_manager.Commit(txn);
+        delete txn;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(log_manager.GetPersistentLSN(), 2 * num_threads * txns_per_thread - 1);
+  // every commit waited for its own record, but the commits that arrived during a write shared the next one
+  EXPECT_LT(disk_manager.GetNumFlushes(), num_threads * txns_per_thread / 2);
+  log_manager.StopFlushThread();
+  disk_manager.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, AsyncCommitTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  LockManager lock_manager;
+  TransactionManager txn_manager(&lock_manager, &log_manager);
+  log_timeout = std::chrono::seconds(15);
+  async_commit_window = std::chrono::milliseconds(50);
+  log_manager.RunFlushThread();
+
+  txn_manager.SetDurabilityLevel(DurabilityLevel::ASYNC);
+  Transaction *txn = txn_manager.Begin();
+  EXPECT_EQ(txn->GetDurabilityLevel(), DurabilityLevel::ASYNC);
+  auto start = std::chrono::steady_clock::now();
+  txn_manager.Commit(txn);
+  lsn_t commit_lsn = txn->GetPrevLSN();
+  // the commit does not wait for the flush, but the flush thread does not wait for log_timeout either
+  EXPECT_LT(log_manager.GetPersistentLSN(), commit_lsn);
+  while (log_manager.GetPersistentLSN() < commit_lsn) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  delete txn;
+
+  // a transaction can still ask for a synchronous commit
+  txn = txn_manager.Begin();
+  txn->SetDurabilityLevel(DurabilityLevel::SYNC);
+  txn_manager.Commit(txn);
+  EXPECT_EQ(log_manager.GetPersistentLSN(), txn->GetPrevLSN());
+  delete txn;
+
+  log_manager.StopFlushThread();
+  // without a flush thread the committer writes its record out itself
+  enable_logging = true;
+  txn = txn_manager.Begin();
+  txn_manager.Commit(txn);
+  EXPECT_EQ(log_manager.GetPersistentLSN(), txn->GetPrevLSN());
+  delete txn;
+  enable_logging = false;
+
+  log_timeout = std::chrono::seconds(1);
+  async_commit_window = std::chrono::milliseconds(10);
+  disk_manager.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, ConcurrentAppendTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  log_manager.RunFlushThread();
+
+  // enough records to fill the log buffer several times over
+  const int num_threads = 8;
+  const int records_per_thread = 2 * LOG_BUFFER_SIZE / 20;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&log_manager, i] {
+      lsn_t prev_lsn = INVALID_LSN;
+      for (int j = 0; j < records_per_thread; j++) {
+        LogRecord log_record(i, prev_lsn, LogRecordType::BEGIN);
+        lsn_t lsn = log_manager.AppendLogRecord(&log_record);
+        EXPECT_GT(lsn, prev_lsn);
+        prev_lsn = lsn;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  log_manager.StopFlushThread();
+
+  // every lsn made it to the log exactly once and in order, and each thread's records are chained
+  const int total = num_threads * records_per_thread;
+  EXPECT_EQ(log_manager.GetPersistentLSN(), total - 1);
+  std::vector<lsn_t> last_lsn(num_threads, INVALID_LSN);
+  int32_t header[5];
+  for (int i = 0; i < total; i++) {
+    ASSERT_TRUE(disk_manager.ReadLog(reinterpret_cast<char *>(header), sizeof(header), i * 20));
+    ASSERT_EQ(header[0], 20);
+    ASSERT_EQ(header[1], i);
+    ASSERT_EQ(header[3], last_lsn[header[2]]);
+    last_lsn[header[2]] = header[1];
+  }
+  disk_manager.ShutDown();
+}
+
+}  // namespace bustub
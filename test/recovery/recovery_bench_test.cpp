@@ -0,0 +1,74 @@
+/**
+ * recovery_bench_test.cpp
+ */
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "concurrency/lock_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+#include "logging/common.h"
+#include "recovery/log_manager.h"
+#include "recovery/log_recovery.h"
+#include "storage/table/table_heap.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(RecoveryBenchTest, RedoTimeTest) {
+  const size_t pool_size = 64;
+  remove("bench.db");
+  remove("bench.log");
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  // build a log that nothing but redo has applied to the db file
+  {
+    DiskManager disk_manager("bench.db");
+    LogManager log_manager(&disk_manager);
+    BufferPoolManager bpm(pool_size, &disk_manager, &log_manager);
+    LockManager lock_manager;
+    TransactionManager txn_manager(&lock_manager, &log_manager);
+    log_manager.RunFlushThread();
+    Transaction *txn = txn_manager.Begin();
+    TableHeap table(&bpm, &lock_manager, &log_manager, txn);
+    for (int i = 0; i < 50000; i++) {
+      RID rid;
+      ASSERT_TRUE(table.InsertTuple(ConstructTuple(&schema), &rid, txn));
+    }
+    txn_manager.Commit(txn);
+    delete txn;
+    log_manager.StopFlushThread();
+    disk_manager.ShutDown();
+  }
+  std::filesystem::copy_file("bench.db", "bench_crashed.db", std::filesystem::copy_options::overwrite_existing);
+
+  for (size_t num_workers : {1, 2, 4, 8}) {
+    std::filesystem::copy_file("bench_crashed.db", "bench.db", std::filesystem::copy_options::overwrite_existing);
+    DiskManager disk_manager("bench.db");
+    BufferPoolManager bpm(pool_size, &disk_manager);
+    LogRecovery log_recovery(&disk_manager, &bpm);
+
+    auto start = std::chrono::steady_clock::now();
+    log_recovery.Redo(num_workers);
+    log_recovery.Undo();
+    auto end = std::chrono::steady_clock::now();
+    std::cout << num_workers << " redo workers: " << std::chrono::duration<double, std::milli>(end - start).count()
+              << " ms for " << disk_manager.GetLogSize() / 1024 << " KiB of log" << std::endl;
+    disk_manager.ShutDown();
+  }
+
+  remove("bench.db");
+  remove("bench_crashed.db");
+  remove("bench.log");
+}
+
+}  // namespace bustub
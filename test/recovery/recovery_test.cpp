@@ -10,6 +10,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <chrono>  // NOLINT
 #include <string>
 #include <vector>
 
@@ -20,9 +22,11 @@
 #include "gtest/gtest.h"
 #include "logging/common.h"
 #include "recovery/log_recovery.h"
+#include "storage/index/b_plus_tree.h"
 #include "storage/table/table_heap.h"
 #include "storage/table/table_iterator.h"
 #include "storage/table/tuple.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 
@@ -43,7 +47,7 @@ class RecoveryTest : public ::testing::Test {
 };
 
 // NOLINTNEXTLINE
-TEST_F(RecoveryTest, DISABLED_RedoTest) {
+TEST_F(RecoveryTest, RedoTest) {
   BustubInstance *bustub_instance = new BustubInstance("test.db");
 
   ASSERT_FALSE(enable_logging);
@@ -132,7 +136,7 @@ TEST_F(RecoveryTest, DISABLED_RedoTest) {
 }
 
 // NOLINTNEXTLINE
-TEST_F(RecoveryTest, DISABLED_UndoTest) {
+TEST_F(RecoveryTest, UndoTest) {
   BustubInstance *bustub_instance = new BustubInstance("test.db");
 
   ASSERT_FALSE(enable_logging);
@@ -211,7 +215,623 @@ TEST_F(RecoveryTest, DISABLED_UndoTest) {
 }
 
 // NOLINTNEXTLINE
-TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
+TEST_F(RecoveryTest, ParallelRedoTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  // enough tuples to span many pages, some of which get evicted and some of which only live in the log
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  std::vector<RID> rids;
+  std::vector<Tuple> tuples;
+  for (int i = 0; i < 1000; i++) {
+    RID rid;
+    tuples.push_back(ConstructTuple(&schema));
+    ASSERT_TRUE(test_table->InsertTuple(tuples.back(), &rid, txn));
+    rids.push_back(rid);
+  }
+  // delete and update a few so that every record type gets replayed
+  for (int i = 0; i < 1000; i += 100) {
+    ASSERT_TRUE(test_table->MarkDelete(rids[i], txn));
+    // the pages are full, only shrinking a tuple is sure to fit
+    if (tuples[i + 1].GetLength() <= tuples[i + 2].GetLength()) {
+      ASSERT_TRUE(test_table->UpdateTuple(tuples[i + 1], rids[i + 2], txn));
+      tuples[i + 2] = tuples[i + 1];
+    }
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+
+  // a loser, its insert has to be undone
+  Transaction *loser = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  RID loser_rid;
+  ASSERT_TRUE(test_table->InsertTuple(tuples[0], &loser_rid, loser));
+  bustub_instance->log_manager_->WaitForFlush(loser->GetPrevLSN());
+  delete loser;
+  delete test_table;
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  LogRecovery log_recovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  // more workers than the buffer pool has frames, redo runs as many as it can pin pages for
+  log_recovery.Redo(bustub_instance->buffer_pool_manager_->GetPoolSize() * 4);
+  log_recovery.Undo();
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  for (int i = 0; i < 1000; i++) {
+    Tuple tuple;
+    if (i % 100 == 0) {
+      EXPECT_FALSE(test_table->GetTuple(rids[i], &tuple, txn));
+      continue;
+    }
+    ASSERT_TRUE(test_table->GetTuple(rids[i], &tuple, txn));
+    for (uint32_t col = 0; col < schema.GetColumnCount(); col++) {
+      EXPECT_EQ(tuple.GetValue(&schema, col).CompareEquals(tuples[i].GetValue(&schema, col)), CmpBool::CmpTrue);
+    }
+  }
+  Tuple tuple;
+  EXPECT_FALSE(test_table->GetTuple(loser_rid, &tuple, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+
+  // pages that only existed in the log must not be handed out again
+  page_id_t page_id;
+  Page *page = bustub_instance->buffer_pool_manager_->NewPage(&page_id);
+  ASSERT_NE(page, nullptr);
+  EXPECT_GT(page_id, rids.back().GetPageId());
+  bustub_instance->buffer_pool_manager_->UnpinPage(page_id, false);
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, DeltaUpdateTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Column col1{"a", TypeId::INTEGER};
+  Column col2{"b", TypeId::VARCHAR, 200};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  std::string payload(200, 'x');
+  auto make_tuple = [&](int a) {
+    return Tuple({ValueFactory::GetIntegerValue(a), ValueFactory::GetVarcharValue(payload)}, &schema);
+  };
+  Tuple tuple = make_tuple(0);
+  Tuple committed_tuple = make_tuple(1);
+  Tuple loser_tuple = make_tuple(2);
+
+  // a one-column update of a ~200 byte row
+  LogRecord full_record(0, INVALID_LSN, LogRecordType::UPDATE, RID(), tuple, committed_tuple);
+  LogRecord delta_record(0, INVALID_LSN, LogRecordType::DELTAUPDATE, RID(), tuple, committed_tuple);
+  std::cout << "update log record: " << full_record.GetSize() << " bytes full, " << delta_record.GetSize()
+            << " bytes delta" << std::endl;
+  EXPECT_EQ(delta_record.GetLogRecordType(), LogRecordType::DELTAUPDATE);
+  EXPECT_LT(delta_record.GetSize() * 10, full_record.GetSize());
+  Tuple result;
+  ASSERT_TRUE(delta_record.ApplyDelta(tuple, &result, false));
+  EXPECT_EQ(memcmp(result.GetData(), committed_tuple.GetData(), committed_tuple.GetLength()), 0);
+  ASSERT_TRUE(delta_record.ApplyDelta(committed_tuple, &result, true));
+  EXPECT_EQ(memcmp(result.GetData(), tuple.GetData(), tuple.GetLength()), 0);
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  RID rid;
+  RID loser_rid;
+  ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+  ASSERT_TRUE(test_table->InsertTuple(tuple, &loser_rid, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  bustub_instance->buffer_pool_manager_->FlushAllPages();
+
+  // redo has to apply both deltas to the old images on disk, undo has to take the loser's back
+  txn = bustub_instance->transaction_manager_->Begin();
+  ASSERT_TRUE(test_table->UpdateTuple(committed_tuple, rid, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  Transaction *loser = bustub_instance->transaction_manager_->Begin();
+  ASSERT_TRUE(test_table->UpdateTuple(loser_tuple, loser_rid, loser));
+  bustub_instance->log_manager_->WaitForFlush(loser->GetPrevLSN());
+  delete loser;
+  delete test_table;
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  LogRecovery log_recovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery.Redo();
+  log_recovery.Undo();
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  ASSERT_TRUE(test_table->GetTuple(rid, &result, txn));
+  EXPECT_EQ(result.GetValue(&schema, 0).GetAs<int32_t>(), 1);
+  ASSERT_TRUE(test_table->GetTuple(loser_rid, &result, txn));
+  EXPECT_EQ(result.GetValue(&schema, 0).GetAs<int32_t>(), 0);
+  EXPECT_EQ(result.GetValue(&schema, 1).ToString(), payload);
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, InstantRestartTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Column col1{"a", TypeId::INTEGER};
+  std::vector<Column> cols{col1};
+  Schema schema{cols};
+  auto make_tuple = [&](int a) { return Tuple({ValueFactory::GetIntegerValue(a)}, &schema); };
+
+  // nothing reaches the db file, every page has to be redone
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  std::vector<RID> rids(3);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(test_table->InsertTuple(make_tuple(i), &rids[i], txn));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  Transaction *loser = bustub_instance->transaction_manager_->Begin();
+  ASSERT_TRUE(test_table->UpdateTuple(make_tuple(100), rids[0], loser));
+  ASSERT_TRUE(test_table->MarkDelete(rids[1], loser));
+  RID loser_rid;
+  ASSERT_TRUE(test_table->InsertTuple(make_tuple(200), &loser_rid, loser));
+  bustub_instance->log_manager_->WaitForFlush(loser->GetPrevLSN());
+  delete loser;
+  delete test_table;
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  LogRecovery log_recovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery.RecoverOnDemand(bustub_instance->transaction_manager_, bustub_instance->lock_manager_,
+                               bustub_instance->log_manager_);
+  ASSERT_TRUE(enable_logging);
+
+  // reading the loser's row waits for the loser to be undone
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple result;
+  ASSERT_TRUE(test_table->GetTuple(rids[0], &result, txn));
+  EXPECT_EQ(result.GetValue(&schema, 0).GetAs<int32_t>(), 0);
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  log_recovery.WaitForRecovery();
+  EXPECT_EQ(log_recovery.GetPendingPageCount(), 0);
+  txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(test_table->GetTuple(rids[i], &result, txn));
+    EXPECT_EQ(result.GetValue(&schema, 0).GetAs<int32_t>(), i);
+  }
+  EXPECT_FALSE(test_table->GetTuple(loser_rid, &result, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+
+  // the undo was logged and closed with an ABORT, a second recovery has no loser left
+  bustub_instance = new BustubInstance("test.db");
+  LogRecovery second_recovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  second_recovery.Analysis();
+  EXPECT_TRUE(second_recovery.GetActiveTxnTable().empty());
+  second_recovery.Redo();
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(test_table->GetTuple(rids[i], &result, txn));
+    EXPECT_EQ(result.GetValue(&schema, 0).GetAs<int32_t>(), i);
+  }
+  EXPECT_FALSE(test_table->GetTuple(loser_rid, &result, txn));
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, InstantRestartRollbackTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Column col1{"a", TypeId::INTEGER};
+  std::vector<Column> cols{col1};
+  Schema schema{cols};
+  auto make_tuple = [&](int a) { return Tuple({ValueFactory::GetIntegerValue(a)}, &schema); };
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  std::vector<RID> rids(3);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(test_table->InsertTuple(make_tuple(i), &rids[i], txn));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  // the loser crashed while rolling back its insert, and while committing its delete: both APPLYDELETEs are logged,
+  // the ABORT or COMMIT is not
+  Transaction *loser = bustub_instance->transaction_manager_->Begin();
+  RID loser_rid;
+  ASSERT_TRUE(test_table->InsertTuple(make_tuple(200), &loser_rid, loser));
+  ASSERT_TRUE(test_table->MarkDelete(rids[1], loser));
+  test_table->ApplyDelete(loser_rid, loser);
+  test_table->ApplyDelete(rids[1], loser);
+  bustub_instance->log_manager_->WaitForFlush(loser->GetPrevLSN());
+  delete loser;
+  delete test_table;
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  LogRecovery log_recovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery.RecoverOnDemand(bustub_instance->transaction_manager_, bustub_instance->lock_manager_,
+                               bustub_instance->log_manager_);
+  // the deleted row is put back into its slot before the read gets it, and an insert does not take that slot
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  RID new_rid;
+  ASSERT_TRUE(test_table->InsertTuple(make_tuple(300), &new_rid, txn));
+  EXPECT_FALSE(new_rid == rids[1]);
+  Tuple result;
+  ASSERT_TRUE(test_table->GetTuple(rids[1], &result, txn));
+  EXPECT_EQ(result.GetValue(&schema, 0).GetAs<int32_t>(), 1);
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  log_recovery.WaitForRecovery();
+  auto check = [&] {
+    txn = bustub_instance->transaction_manager_->Begin();
+    std::vector<int32_t> values;
+    for (auto iter = test_table->Begin(txn); iter != test_table->End(); ++iter) {
+      values.push_back(iter->GetValue(&schema, 0).GetAs<int32_t>());
+    }
+    std::sort(values.begin(), values.end());
+    EXPECT_EQ(values, (std::vector<int32_t>{0, 1, 2, 300}));
+    ASSERT_TRUE(test_table->GetTuple(new_rid, &result, txn));
+    EXPECT_EQ(result.GetValue(&schema, 0).GetAs<int32_t>(), 300);
+    bustub_instance->transaction_manager_->Commit(txn);
+    delete txn;
+  };
+  check();
+  delete test_table;
+  delete bustub_instance;
+
+  // the undo is redone into the same slots
+  bustub_instance = new BustubInstance("test.db");
+  LogRecovery second_recovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  second_recovery.Analysis();
+  EXPECT_TRUE(second_recovery.GetActiveTxnTable().empty());
+  second_recovery.Redo();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  check();
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, IndexRecoveryTest) {
+  using Tree = BPlusTree<GenericKey<8>, RID, GenericComparator<8>>;
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  // the tree keeps a few pages pinned after a split or merge, give it a pool of its own
+  auto *bpm = new BufferPoolManager(256, bustub_instance->disk_manager_, bustub_instance->log_manager_);
+  auto *txn_mgr = bustub_instance->transaction_manager_;
+  page_id_t header_page_id;
+  bpm->NewPage(&header_page_id);
+  ASSERT_EQ(header_page_id, HEADER_PAGE_ID);
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+
+  Schema key_schema({Column("a", TypeId::BIGINT)});
+  GenericComparator<8> comparator(&key_schema);
+  auto make_key = [](int64_t k) {
+    GenericKey<8> key;
+    key.SetFromInteger(k);
+    return key;
+  };
+  // small pages, so there are splits, merges and root changes to redo
+  auto *tree = new Tree("foo_pk", bpm, comparator, 16, 16, bustub_instance->log_manager_);
+  Transaction *txn = txn_mgr->Begin();
+  for (int64_t k = 0; k < 1000; k++) {
+    ASSERT_TRUE(tree->Insert(make_key(k), RID(k), txn));
+  }
+  txn_mgr->Commit(txn);
+  delete txn;
+  // part of the tree reaches the disk, the rest only the log
+  bpm->FlushAllPages();
+  txn = txn_mgr->Begin();
+  for (int64_t k = 0; k < 1000; k += 3) {
+    tree->Remove(make_key(k), txn);
+  }
+  txn_mgr->Commit(txn);
+  delete txn;
+
+  Transaction *loser = txn_mgr->Begin();
+  for (int64_t k = 1000; k < 1200; k++) {
+    ASSERT_TRUE(tree->Insert(make_key(k), RID(k), loser));
+  }
+  for (int64_t k = 1; k < 500; k += 3) {
+    tree->Remove(make_key(k), loser);
+  }
+  bustub_instance->log_manager_->WaitForFlush(loser->GetPrevLSN());
+  delete loser;
+  delete tree;
+  delete bpm;
+  delete bustub_instance;
+
+  // the tree is used as recovery left it, nothing is rebuilt
+  bustub_instance = new BustubInstance("test.db");
+  bpm = new BufferPoolManager(256, bustub_instance->disk_manager_, bustub_instance->log_manager_);
+  tree = new Tree("foo_pk", bpm, comparator, 16, 16);
+  LogRecovery log_recovery(bustub_instance->disk_manager_, bpm);
+  log_recovery.RegisterIndex("foo_pk", [tree](LogRecord *log_record) { tree->UndoLogRecord(log_record); });
+  log_recovery.Redo();
+  log_recovery.Undo();
+
+  std::vector<RID> result;
+  for (int64_t k = 0; k < 1200; k++) {
+    bool committed = k < 1000 && k % 3 != 0;
+    result.clear();
+    EXPECT_EQ(tree->GetValue(make_key(k), &result), committed) << "key " << k;
+    if (committed && !result.empty()) {
+      EXPECT_EQ(result[0].GetSlotNum(), k);
+    }
+  }
+  int64_t count = 0;
+  int64_t last = -1;
+  for (auto iter = tree->begin(); !iter.isEnd(); ++iter) {
+    EXPECT_LT(last, (*iter).first.ToString());
+    last = (*iter).first.ToString();
+    count++;
+  }
+  EXPECT_EQ(count, 666);
+
+  delete tree;
+  delete bpm;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, AnalysisTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  Tuple tuple = ConstructTuple(&schema);
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  RID rid;
+  for (int i = 0; i < 500; i++) {
+    ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // everything so far is on disk after the checkpoint
+  bustub_instance->checkpoint_manager_->BeginCheckpoint();
+  bustub_instance->checkpoint_manager_->EndCheckpoint();
+
+  // only the last page of the table changes after the checkpoint
+  txn = bustub_instance->transaction_manager_->Begin();
+  ASSERT_TRUE(test_table->MarkDelete(rid, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  txn_id_t committed_txn_id = txn->GetTransactionId();
+  delete txn;
+  Transaction *loser = bustub_instance->transaction_manager_->Begin();
+  RID loser_rid;
+  ASSERT_TRUE(test_table->InsertTuple(tuple, &loser_rid, loser));
+  bustub_instance->log_manager_->WaitForFlush(loser->GetPrevLSN());
+  txn_id_t loser_txn_id = loser->GetTransactionId();
+  delete loser;
+  delete test_table;
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  LogRecovery log_recovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery.Analysis();
+  const auto &dirty_page_table = log_recovery.GetDirtyPageTable();
+  EXPECT_EQ(dirty_page_table.size(), 1);
+  EXPECT_EQ(dirty_page_table.count(rid.GetPageId()), 1);
+  EXPECT_NE(rid.GetPageId(), first_page_id);
+  const auto &active_txn_table = log_recovery.GetActiveTxnTable();
+  EXPECT_EQ(active_txn_table.size(), 1);
+  EXPECT_EQ(active_txn_table.count(loser_txn_id), 1);
+  EXPECT_EQ(active_txn_table.count(committed_txn_id), 0);
+
+  log_recovery.Redo();
+  log_recovery.Undo();
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple result;
+  EXPECT_FALSE(test_table->GetTuple(rid, &result, txn));
+  EXPECT_FALSE(test_table->GetTuple(loser_rid, &result, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, FuzzyCheckpointTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  Tuple tuple = ConstructTuple(&schema);
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  std::vector<RID> committed_rids(300);
+  for (auto &rid : committed_rids) {
+    ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // a consistent checkpoint would wait for the loser to finish, a fuzzy one does not
+  Transaction *loser = bustub_instance->transaction_manager_->Begin();
+  RID loser_rid;
+  ASSERT_TRUE(test_table->InsertTuple(tuple, &loser_rid, loser));
+  size_t dirty_pages = bustub_instance->buffer_pool_manager_->GetDirtyPageTable().size();
+  ASSERT_GT(dirty_pages, 1);
+  bustub_instance->checkpoint_manager_->SetWriteRate(100);
+  auto start = std::chrono::steady_clock::now();
+  bustub_instance->checkpoint_manager_->FuzzyCheckpoint();
+
+  // transactions keep going while the pages are written back
+  txn = bustub_instance->transaction_manager_->Begin();
+  RID late_rid;
+  ASSERT_TRUE(test_table->InsertTuple(tuple, &late_rid, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  bustub_instance->checkpoint_manager_->WaitForWriteBack();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  // 100 pages per second, the first one goes out right away
+  EXPECT_GE(elapsed, std::chrono::milliseconds(10 * (dirty_pages - 1)));
+  EXPECT_LT(bustub_instance->buffer_pool_manager_->GetDirtyPageTable().size(), dirty_pages);
+
+  bustub_instance->log_manager_->WaitForFlush(loser->GetPrevLSN());
+  txn_id_t loser_txn_id = loser->GetTransactionId();
+  delete loser;
+  delete test_table;
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  LogRecovery log_recovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery.Analysis();
+  const auto &active_txn_table = log_recovery.GetActiveTxnTable();
+  EXPECT_EQ(active_txn_table.size(), 1);
+  EXPECT_EQ(active_txn_table.count(loser_txn_id), 1);
+  log_recovery.Redo();
+  log_recovery.Undo();
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple result;
+  for (const auto &rid : committed_rids) {
+    EXPECT_TRUE(test_table->GetTuple(rid, &result, txn));
+  }
+  EXPECT_TRUE(test_table->GetTuple(late_rid, &result, txn));
+  EXPECT_FALSE(test_table->GetTuple(loser_rid, &result, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, LogSegmentTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->disk_manager_->SetLogSegmentSize(8 * PAGE_SIZE);
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  Tuple tuple = ConstructTuple(&schema);
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  std::vector<RID> committed_rids(2000);
+  for (auto &rid : committed_rids) {
+    txn = bustub_instance->transaction_manager_->Begin();
+    ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+    bustub_instance->transaction_manager_->Commit(txn);
+    delete txn;
+  }
+  // the loser began before the checkpoint, its segment has to stay
+  Transaction *loser = bustub_instance->transaction_manager_->Begin();
+  RID loser_rid;
+  ASSERT_TRUE(test_table->InsertTuple(tuple, &loser_rid, loser));
+  for (int i = 0; i < 500; i++) {
+    txn = bustub_instance->transaction_manager_->Begin();
+    ASSERT_TRUE(test_table->MarkDelete(committed_rids[i], txn));
+    bustub_instance->transaction_manager_->Commit(txn);
+    delete txn;
+  }
+  int num_segments = bustub_instance->disk_manager_->GetNumLogSegments();
+  ASSERT_GT(num_segments, 4);
+
+  bustub_instance->checkpoint_manager_->SetWriteRate(0);
+  bustub_instance->checkpoint_manager_->FuzzyCheckpoint();
+  bustub_instance->checkpoint_manager_->WaitForWriteBack();
+  // the next checkpoint knows the pages are clean
+  bustub_instance->checkpoint_manager_->FuzzyCheckpoint();
+  bustub_instance->checkpoint_manager_->WaitForWriteBack();
+  EXPECT_GT(bustub_instance->disk_manager_->GetLogStart(), 0);
+  EXPECT_LT(bustub_instance->disk_manager_->GetNumLogSegments(), num_segments);
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  ASSERT_TRUE(test_table->MarkDelete(committed_rids[500], txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  txn_id_t loser_txn_id = loser->GetTransactionId();
+  delete loser;
+  delete test_table;
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  LogRecovery log_recovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery.Analysis();
+  const auto &active_txn_table = log_recovery.GetActiveTxnTable();
+  EXPECT_EQ(active_txn_table.size(), 1);
+  EXPECT_EQ(active_txn_table.count(loser_txn_id), 1);
+  log_recovery.Redo();
+  log_recovery.Undo();
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple result;
+  for (size_t i = 0; i < committed_rids.size(); i++) {
+    EXPECT_EQ(test_table->GetTuple(committed_rids[i], &result, txn), i > 500);
+  }
+  EXPECT_FALSE(test_table->GetTuple(loser_rid, &result, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, CheckpointTest) {
   BustubInstance *bustub_instance = new BustubInstance("test.db");
 
   EXPECT_FALSE(enable_logging);
@@ -0,0 +1,212 @@
+/**
+ * b_plus_tree_bulk_load_test.cpp
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager.h"
+#include "common/exception.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/index/external_sort.h"
+
+namespace bustub {
+
+namespace {
+
+using Entry = std::pair<GenericKey<8>, RID>;
+
+Entry MakeEntry(int64_t key) {
+  Entry entry;
+  entry.first.SetFromInteger(key);
+  entry.second = RID(static_cast<int32_t>(key >> 32), static_cast<uint32_t>(key));
+  return entry;
+}
+
+/** Check that the tree holds exactly the keys, in order, and finds every one of them. */
+void CheckKeys(BPlusTree<GenericKey<8>, RID, GenericComparator<8>> *tree, const std::vector<int64_t> &keys) {
+  size_t i = 0;
+  for (auto iter = tree->begin(); iter != tree->end(); ++iter, i++) {
+    ASSERT_LT(i, keys.size());
+    EXPECT_EQ((*iter).second.GetSlotNum(), keys[i]);
+  }
+  EXPECT_EQ(i, keys.size());
+  std::vector<RID> rids;
+  GenericKey<8> index_key;
+  for (int64_t key : keys) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    ASSERT_TRUE(tree->GetValue(index_key, &rids)) << key;
+    EXPECT_EQ(rids[0].GetSlotNum(), key);
+  }
+}
+
+}  // namespace
+
+// NOLINTNEXTLINE
+TEST(BPlusTreeTests, BulkLoadTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManager(50, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+
+  for (int num_keys : {0, 1, 5, 6, 7, 31, 1000}) {
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 6, 5);
+    // even keys, every one of them twice
+    std::vector<Entry> entries;
+    std::vector<int64_t> keys;
+    for (int64_t key = 0; key < num_keys; key++) {
+      entries.push_back(MakeEntry(key * 2));
+      entries.push_back(MakeEntry(key * 2));
+      keys.push_back(key * 2);
+    }
+    ASSERT_TRUE(tree.BulkLoad(entries.begin(), entries.end(), 0.5));
+    EXPECT_EQ(tree.IsEmpty(), num_keys == 0);
+    CheckKeys(&tree, keys);
+    if (num_keys == 0) {
+      continue;
+    }
+    // a loaded tree is not loaded again
+    EXPECT_FALSE(tree.BulkLoad(entries.begin(), entries.end()));
+
+    // the loaded tree splits, merges and redistributes like any other
+    Transaction transaction(0);
+    for (int64_t key = 0; key < num_keys; key++) {
+      Entry entry = MakeEntry(key * 2 + 1);
+      EXPECT_TRUE(tree.Insert(entry.first, entry.second, &transaction));
+    }
+    keys.clear();
+    for (int64_t key = 0; key < num_keys * 2; key++) {
+      if (key % 3 == 0) {
+        tree.Remove(MakeEntry(key).first, &transaction);
+      } else {
+        keys.push_back(key);
+      }
+    }
+    CheckKeys(&tree, keys);
+    for (int64_t key : keys) {
+      tree.Remove(MakeEntry(key).first, &transaction);
+    }
+    EXPECT_TRUE(tree.IsEmpty());
+  }
+
+  // keys out of order are refused and leave no page pinned
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 6, 5);
+  std::vector<Entry> entries;
+  for (int64_t key = 0; key < 100; key++) {
+    entries.push_back(MakeEntry(key == 50 ? 10 : key));
+  }
+  EXPECT_THROW(tree.BulkLoad(entries.begin(), entries.end()), Exception);
+  for (int i = 0; i < 50; i++) {
+    ASSERT_NE(bpm->NewPage(&page_id), nullptr);
+    bpm->UnpinPage(page_id, false);
+  }
+
+  // so does a buffer pool that runs out of frames, here after two leaves
+  std::vector<page_id_t> pinned(48);
+  for (auto &pinned_id : pinned) {
+    ASSERT_NE(bpm->NewPage(&pinned_id), nullptr);
+  }
+  entries.clear();
+  for (int64_t key = 0; key < 100; key++) {
+    entries.push_back(MakeEntry(key));
+  }
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> oom_tree("foo_oom", bpm, comparator, 6, 5);
+  EXPECT_THROW(oom_tree.BulkLoad(entries.begin(), entries.end()), Exception);
+  for (auto pinned_id : pinned) {
+    bpm->UnpinPage(pinned_id, false);
+  }
+  EXPECT_EQ(bpm->GetUnpinnedFrameCount(), 50);
+
+  delete bpm;
+  delete disk_manager;
+  delete key_schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(BPlusTreeTests, BulkLoadFillTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManager(50, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+
+  const int64_t num_keys = 100000;
+  int64_t key = 0;
+  ASSERT_TRUE(tree.BulkLoad([&key](Entry *entry) {
+    if (key == num_keys) {
+      return false;
+    }
+    *entry = MakeEntry(key++);
+    return true;
+  }));
+  std::vector<int64_t> keys(num_keys);
+  for (int64_t i = 0; i < num_keys; i++) {
+    keys[i] = i;
+  }
+  CheckKeys(&tree, keys);
+
+  // the leaves are 90% full, two internal pages under the root hold them
+  using KeyType = GenericKey<8>;
+  using ValueType = RID;
+  int leaf_fill = static_cast<int>((LEAF_PAGE_SIZE - 1) * 0.9);
+  int num_leaves = (num_keys + leaf_fill - 1) / leaf_fill;
+  bpm->NewPage(&page_id);
+  bpm->UnpinPage(page_id, false);
+  EXPECT_EQ(page_id, HEADER_PAGE_ID + num_leaves + 4);
+
+  delete bpm;
+  delete disk_manager;
+  delete key_schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(BPlusTreeTests, ExternalSortTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < 1000; key++) {
+    keys.push_back(key / 2);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+
+  for (size_t run_size : {size_t{100}, size_t{10000}}) {
+    ExternalSort<GenericKey<8>, RID, GenericComparator<8>> sorter(comparator, run_size);
+    for (size_t i = 0; i < keys.size(); i++) {
+      Entry entry = MakeEntry(keys[i]);
+      // the slot remembers the order the entries were added in
+      sorter.Add(entry.first, RID(0, i));
+    }
+    EXPECT_EQ(sorter.GetRunCount(), run_size == 100 ? 10 : 0);
+    Entry entry;
+    uint32_t prev_slot = 0;
+    for (int64_t key = 0; key < 1000; key++) {
+      ASSERT_TRUE(sorter.Next(&entry));
+      EXPECT_EQ(keys[entry.second.GetSlotNum()], key / 2);
+      // entries with equal keys keep their order
+      if (key % 2 == 1) {
+        EXPECT_GT(entry.second.GetSlotNum(), prev_slot);
+      }
+      prev_slot = entry.second.GetSlotNum();
+    }
+    EXPECT_FALSE(sorter.Next(&entry));
+  }
+  delete key_schema;
+}
+
+}  // namespace bustub
@@ -0,0 +1,97 @@
+/**
+ * b_plus_tree_concurrent_bench_test.cpp
+ */
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+
+namespace bustub {
+
+namespace {
+
+/** Insert num_keys shuffled keys from num_threads threads and print the insert throughput and the restarts. */
+void InsertThroughput(bool optimistic, int num_threads, int64_t num_keys) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  remove("bench.db");
+  remove("bench.log");
+  auto *disk_manager = new DiskManager("bench.db");
+  auto *bpm = new BufferPoolManager(1024, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+  tree.SetOptimisticLatching(optimistic);
+
+  std::vector<int64_t> keys(num_keys);
+  for (int64_t key = 0; key < num_keys; key++) {
+    keys[key] = key;
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&tree, &keys, num_threads, i] {
+      Transaction transaction(i);
+      GenericKey<8> index_key;
+      for (size_t j = i; j < keys.size(); j += num_threads) {
+        index_key.SetFromInteger(keys[j]);
+        tree.Insert(index_key, RID(static_cast<int32_t>(keys[j] >> 32), static_cast<uint32_t>(keys[j])),
+                    &transaction);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << (optimistic ? "optimistic, " : "pessimistic, ") << num_threads << " threads: " << num_keys / seconds
+            << " inserts/s, " << tree.GetOptimisticCount() << " optimistic descents, " << tree.GetRestartCount()
+            << " restarts" << std::endl;
+
+  if (optimistic) {
+    EXPECT_GE(tree.GetOptimisticCount(), num_keys - 1);
+    // only the inserts that split a leaf restart
+    EXPECT_LT(tree.GetRestartCount() * 10, tree.GetOptimisticCount());
+  } else {
+    EXPECT_EQ(tree.GetOptimisticCount(), 0);
+  }
+  std::vector<RID> rids;
+  GenericKey<8> index_key;
+  for (int64_t key = 0; key < num_keys; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    ASSERT_TRUE(tree.GetValue(index_key, &rids)) << key;
+    EXPECT_EQ(rids[0].GetSlotNum(), key);
+  }
+
+  delete bpm;
+  delete disk_manager;
+  delete key_schema;
+  remove("bench.db");
+  remove("bench.log");
+}
+
+}  // namespace
+
+// NOLINTNEXTLINE
+TEST(BPlusTreeConcurrentBenchTest, InsertThroughputTest) {
+  for (bool optimistic : {false, true}) {
+    for (int num_threads : {1, 2, 4, 8}) {
+      InsertThroughput(optimistic, num_threads, 200000);
+    }
+  }
+}
+
+}  // namespace bustub
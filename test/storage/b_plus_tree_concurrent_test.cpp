@@ -2,6 +2,7 @@
  * b_plus_tree_test.cpp
  */
 
+#include <atomic>
 #include <chrono>  // NOLINT
 #include <cstdio>
 #include <functional>
@@ -330,4 +331,117 @@ TEST(BPlusTreeConcurrentTest, MixTest) {
   remove("test.log");
 }
 
+TEST(BPlusTreeConcurrentTest, BLinkReaderTest) {
+  // create KeyComparator and index schema
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(256, disk_manager);
+  // small pages split and merge all the time under the readers
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 6, 6);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+  std::vector<int64_t> preserved_keys;
+  std::vector<int64_t> dynamic_keys;
+  for (int64_t key = 1; key <= 2000; key++) {
+    (key % 4 == 0 ? preserved_keys : dynamic_keys).push_back(key);
+  }
+  InsertHelper(&tree, preserved_keys);
+
+  std::atomic<bool> done{false};
+  std::atomic<int> errors{0};
+  // readers without a transaction hold a single latch at a time
+  auto lookup_task = [&] {
+    GenericKey<8> index_key;
+    std::vector<RID> rids;
+    while (!done) {
+      for (auto key : preserved_keys) {
+        rids.clear();
+        index_key.SetFromInteger(key);
+        if (!tree.GetValue(index_key, &rids) || rids.size() != 1 || rids[0].GetSlotNum() != key) {
+          errors++;
+        }
+      }
+    }
+  };
+  auto scan_task = [&] {
+    GenericKey<8> index_key;
+    while (!done) {
+      index_key.SetFromInteger(preserved_keys[0]);
+      auto expected = preserved_keys.begin();
+      int64_t last = 0;
+      for (auto iterator = tree.Begin(index_key); iterator != tree.end(); ++iterator) {
+        int64_t key = (*iterator).first.ToString();
+        if (key <= last) {
+          errors++;
+        }
+        last = key;
+        if (key % 4 == 0) {
+          if (expected == preserved_keys.end() || key != *expected) {
+            errors++;
+          }
+          ++expected;
+        }
+      }
+      if (expected != preserved_keys.end()) {
+        errors++;
+      }
+    }
+  };
+  // left links go stale when a neighbour under another parent is busy, reverse scans check them
+  auto reverse_scan_task = [&] {
+    while (!done) {
+      auto expected = preserved_keys.rbegin();
+      int64_t last = INT64_MAX;
+      for (auto iterator = tree.rbegin(); iterator != tree.end(); ++iterator) {
+        int64_t key = (*iterator).first.ToString();
+        if (key >= last) {
+          errors++;
+        }
+        last = key;
+        if (key % 4 == 0) {
+          if (expected == preserved_keys.rend() || key != *expected) {
+            errors++;
+          }
+          ++expected;
+        }
+      }
+      if (expected != preserved_keys.rend()) {
+        errors++;
+      }
+    }
+  };
+  std::vector<std::thread> readers;
+  readers.emplace_back(lookup_task);
+  readers.emplace_back(scan_task);
+  readers.emplace_back(reverse_scan_task);
+  for (int round = 0; round < 3; round++) {
+    LaunchParallelTest(2, InsertHelper, &tree, dynamic_keys);
+    LaunchParallelTest(2, DeleteHelper, &tree, dynamic_keys);
+  }
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(errors, 0);
+
+  int64_t size = 0;
+  for (auto &pair : tree) {
+    EXPECT_EQ(pair.first.ToString(), preserved_keys[size]);
+    size++;
+  }
+  EXPECT_EQ(size, preserved_keys.size());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
 }  // namespace bustub
@@ -4,6 +4,8 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <random>
+#include <vector>
 
 #include "b_plus_tree_test_util.h"  // NOLINT
 #include "buffer/buffer_pool_manager.h"
@@ -176,4 +178,163 @@ TEST(BPlusTreeTests, DeleteTest2) {
   remove("test.db");
   remove("test.log");
 }
+
+TEST(BPlusTreeTests, ReverseScanTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 8, 8);
+  Transaction transaction(0);
+  GenericKey<8> index_key;
+
+  EXPECT_TRUE(tree.rbegin() == tree.end());
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < 3000; key++) {
+    keys.push_back(key * 2);
+  }
+  std::mt19937 rng(15445);
+  std::shuffle(keys.begin(), keys.end(), rng);
+  for (auto key : keys) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key), &transaction);
+  }
+
+  // every left link is the page whose right-link points back
+  auto check_links = [&] {
+    Page *page = tree.FindLeafPage(index_key, true);
+    page->RUnlatch();
+    page_id_t prev_page_id = INVALID_PAGE_ID;
+    while (page != nullptr) {
+      auto *leaf = reinterpret_cast<BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>> *>(page->GetData());
+      EXPECT_EQ(leaf->GetPrePageId(), prev_page_id);
+      prev_page_id = page->GetPageId();
+      page_id_t next_page_id = leaf->GetNextPageId();
+      bpm->UnpinPage(prev_page_id, false);
+      page = next_page_id == INVALID_PAGE_ID ? nullptr : bpm->FetchPage(next_page_id);
+    }
+  };
+  // the remaining keys from the top, from start down if given
+  auto check_reverse = [&](std::vector<int64_t> expected, const int64_t *start) {
+    std::sort(expected.begin(), expected.end(), std::greater<>());
+    if (start != nullptr) {
+      expected.erase(expected.begin(),
+                     std::find_if(expected.begin(), expected.end(), [start](int64_t key) { return key <= *start; }));
+      index_key.SetFromInteger(*start);
+    }
+    size_t count = 0;
+    for (auto iterator = start == nullptr ? tree.rbegin() : tree.RBegin(index_key); iterator != tree.end();
+         ++iterator, count++) {
+      ASSERT_LT(count, expected.size());
+      EXPECT_EQ((*iterator).second.GetSlotNum(), expected[count]);
+    }
+    EXPECT_EQ(count, expected.size());
+  };
+
+  check_links();
+  check_reverse(keys, nullptr);
+  for (int64_t start : {5998, 4001, 4000, 1, 0, -1, 100000}) {
+    check_reverse(keys, &start);
+  }
+
+  // merges keep the links, and a batch reads down a leaf at a time
+  std::vector<int64_t> removed(keys.begin(), keys.begin() + 2000);
+  std::vector<int64_t> left(keys.begin() + 2000, keys.end());
+  for (auto key : removed) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key, &transaction);
+  }
+  check_links();
+  check_reverse(left, nullptr);
+  int64_t start = 3001;
+  check_reverse(left, &start);
+  std::sort(left.begin(), left.end(), std::greater<>());
+  std::vector<int64_t> batch_keys;
+  RID rids[5];
+  {
+    auto iterator = tree.rbegin();
+    int count;
+    while ((count = iterator.NextBatch(rids, 5)) > 0) {
+      for (int i = 0; i < count; i++) {
+        batch_keys.push_back(rids[i].GetSlotNum());
+      }
+    }
+  }
+  EXPECT_EQ(batch_keys, left);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, SeekAfterRedistributeTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 8, 8);
+  Transaction transaction(0);
+  GenericKey<8> index_key;
+  using LeafPage = BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>>;
+
+  for (int64_t key = 0; key < 1000; key += 10) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key), &transaction);
+  }
+  // the first two leaves, the second filled so that an underflow of the first borrows from it
+  auto leaf_keys = [&](page_id_t leaf_id) {
+    Page *page = bpm->FetchPage(leaf_id);
+    auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    std::vector<int64_t> keys;
+    for (int i = 0; i < leaf->GetSize(); i++) {
+      keys.push_back(leaf->ValueAt(i).GetSlotNum());
+    }
+    bpm->UnpinPage(leaf_id, false);
+    return keys;
+  };
+  Page *page = tree.FindLeafPage(index_key, true);
+  page->RUnlatch();
+  page_id_t first_id = page->GetPageId();
+  page_id_t second_id = reinterpret_cast<LeafPage *>(page->GetData())->GetNextPageId();
+  bpm->UnpinPage(first_id, false);
+  std::vector<int64_t> first_keys = leaf_keys(first_id);
+  for (int64_t key = leaf_keys(second_id).back() + 1; leaf_keys(second_id).size() < 7; key++) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key), &transaction);
+  }
+  std::vector<int64_t> second_keys = leaf_keys(second_id);
+
+  // the iterator stays on the first key of the second leaf while that key and the next move into the first leaf
+  index_key.SetFromInteger(second_keys[0]);
+  {
+    auto iterator = tree.Begin(index_key);
+    EXPECT_EQ((*iterator).second.GetSlotNum(), second_keys[0]);
+    for (size_t i = 0; i < first_keys.size() && leaf_keys(second_id)[0] <= second_keys[1]; i++) {
+      index_key.SetFromInteger(first_keys[i]);
+      tree.Remove(index_key, &transaction);
+    }
+    ASSERT_GT(leaf_keys(second_id)[0], second_keys[1]);
+    ++iterator;
+    ASSERT_FALSE(iterator.isEnd());
+    EXPECT_EQ((*iterator).second.GetSlotNum(), second_keys[1]);
+    ++iterator;
+    ASSERT_FALSE(iterator.isEnd());
+    EXPECT_EQ((*iterator).second.GetSlotNum(), second_keys[2]);
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
 }  // namespace bustub
@@ -4,11 +4,17 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "b_plus_tree_test_util.h"  // NOLINT
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
 #include "storage/index/b_plus_tree.h"
+#include "storage/page/header_page.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 
@@ -139,4 +145,188 @@ TEST(BPlusTreeTests, InsertTest2) {
   remove("test.db");
   remove("test.log");
 }
+TEST(BPlusTreeTests, PrefixCompressionTest) {
+  // long keys that differ in their last bytes only
+  Schema *key_schema = ParseCreateStatement("a varchar(48)");
+  GenericComparator<64> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  BPlusTree<GenericKey<64>, RID, GenericComparator<64>> tree("foo_pk", bpm, comparator);
+  Transaction transaction(0);
+
+  const int num_keys = 40000;
+  std::vector<std::pair<GenericKey<64>, RID>> entries(num_keys);
+  char name[64];
+  for (int i = 0; i < num_keys; i++) {
+    snprintf(name, sizeof(name), "warehouse/eu-central/district-07/order-%08d", i);
+    entries[i].first.SetFromKey(Tuple({ValueFactory::GetVarcharValue(name)}, key_schema), key_schema);
+    entries[i].second = RID(0, i);
+  }
+  // the even keys are loaded, the odd ones inserted
+  std::vector<std::pair<GenericKey<64>, RID>> even;
+  std::vector<int> odd;
+  for (int i = 0; i < num_keys; i++) {
+    if (i % 2 == 0) {
+      even.push_back(entries[i]);
+    } else {
+      odd.push_back(i);
+    }
+  }
+  ASSERT_TRUE(tree.BulkLoad(even.begin(), even.end()));
+
+  // a page between two others has fences, whole keys fit some 60 to it and the compressed ones several times that
+  page_id_t root_id;
+  auto *header_page = reinterpret_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  ASSERT_TRUE(header_page->GetRootId("foo_pk", &root_id));
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+  using InternalPage = BPlusTreeInternalPage<GenericKey<64>, page_id_t, GenericComparator<64>>;
+  auto *root = reinterpret_cast<InternalPage *>(bpm->FetchPage(root_id)->GetData());
+  ASSERT_FALSE(root->IsLeafPage());
+  ASSERT_GE(root->GetSize(), 3);
+  auto *middle = reinterpret_cast<InternalPage *>(bpm->FetchPage(root->ValueAt(1))->GetData());
+  ASSERT_NE(middle->GetLowKey(), nullptr);
+  ASSERT_NE(middle->GetHighKey(), nullptr);
+  EXPECT_GT(middle->GetSize(), 150);
+  bpm->UnpinPage(middle->GetPageId(), false);
+  bpm->UnpinPage(root_id, false);
+
+  // the compressed pages split, merge and redistribute like any other
+  std::shuffle(odd.begin(), odd.end(), std::mt19937(15445));
+  for (int i : odd) {
+    EXPECT_TRUE(tree.Insert(entries[i].first, entries[i].second, &transaction));
+  }
+  for (int i = 0; i < num_keys; i += 3) {
+    tree.Remove(entries[i].first, &transaction);
+  }
+  std::vector<RID> rids;
+  for (int i = 0; i < num_keys; i++) {
+    rids.clear();
+    EXPECT_EQ(tree.GetValue(entries[i].first, &rids), i % 3 != 0) << i;
+  }
+  int count = 0;
+  for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator, count++) {
+    EXPECT_EQ((*iterator).second.GetSlotNum() % 3, count % 2 == 0 ? 1 : 2);
+  }
+  EXPECT_EQ(count, num_keys - (num_keys + 2) / 3);
+
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+TEST(BPlusTreeTests, ScanTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  // far fewer frames than leaves, the leaves a scan reads ahead get evicted again too
+  BufferPoolManager *bpm = new BufferPoolManager(20, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 16, 16);
+  Transaction transaction(0);
+
+  // the even keys from 0 to 9998
+  const int64_t num_keys = 5000;
+  GenericKey<8> index_key;
+  for (int64_t key = 0; key < num_keys; key++) {
+    index_key.SetFromInteger(key * 2);
+    tree.Insert(index_key, RID(0, key * 2), &transaction);
+  }
+
+  auto scan = [&](const int64_t *lower, const int64_t *upper, ScanInclusivity inclusivity) {
+    GenericKey<8> lower_key;
+    GenericKey<8> upper_key;
+    if (lower != nullptr) {
+      lower_key.SetFromInteger(*lower);
+    }
+    if (upper != nullptr) {
+      upper_key.SetFromInteger(*upper);
+    }
+    std::vector<int64_t> keys;
+    for (auto iterator = tree.Scan(lower == nullptr ? nullptr : &lower_key, upper == nullptr ? nullptr : &upper_key,
+                                   inclusivity);
+         iterator != tree.end(); ++iterator) {
+      keys.push_back((*iterator).second.GetSlotNum());
+    }
+    return keys;
+  };
+  auto range = [](int64_t first, int64_t last) {
+    std::vector<int64_t> keys;
+    for (int64_t key = first; key <= last; key += 2) {
+      keys.push_back(key);
+    }
+    return keys;
+  };
+
+  int64_t low = 1000;
+  int64_t high = 3000;
+  EXPECT_EQ(scan(&low, &high, ScanInclusivity::BOTH), range(1000, 3000));
+  EXPECT_EQ(scan(&low, &high, ScanInclusivity::LOWER), range(1000, 2998));
+  EXPECT_EQ(scan(&low, &high, ScanInclusivity::UPPER), range(1002, 3000));
+  EXPECT_EQ(scan(&low, &high, ScanInclusivity::NEITHER), range(1002, 2998));
+  // bounds between the keys
+  int64_t odd_low = 1001;
+  int64_t odd_high = 2999;
+  EXPECT_EQ(scan(&odd_low, &odd_high, ScanInclusivity::BOTH), range(1002, 2998));
+  EXPECT_EQ(scan(&odd_low, &odd_high, ScanInclusivity::NEITHER), range(1002, 2998));
+  // open ends and empty ranges
+  EXPECT_EQ(scan(nullptr, &high, ScanInclusivity::BOTH), range(0, 3000));
+  EXPECT_EQ(scan(&low, nullptr, ScanInclusivity::NEITHER), range(1002, 9998));
+  EXPECT_EQ(scan(nullptr, nullptr, ScanInclusivity::BOTH), range(0, 9998));
+  EXPECT_TRUE(scan(&high, &low, ScanInclusivity::BOTH).empty());
+  EXPECT_TRUE(scan(&low, &low, ScanInclusivity::LOWER).empty());
+  EXPECT_EQ(scan(&low, &low, ScanInclusivity::BOTH), range(1000, 1000));
+  bpm->WaitForPrefetch();
+
+  // batches return the same values as the iterator, and leave it where the next batch goes on
+  GenericKey<8> lower_key;
+  GenericKey<8> upper_key;
+  lower_key.SetFromInteger(low);
+  upper_key.SetFromInteger(high);
+  std::vector<int64_t> keys;
+  RID rids[7];
+  int count;
+  {
+    auto iterator = tree.Scan(&lower_key, &upper_key, ScanInclusivity::UPPER);
+    while ((count = iterator.NextBatch(rids, 7)) > 0) {
+      for (int i = 0; i < count; i++) {
+        keys.push_back(rids[i].GetSlotNum());
+      }
+      if (count < 7) {
+        EXPECT_TRUE(iterator.isEnd());
+      }
+    }
+  }
+  EXPECT_EQ(keys, range(1002, 3000));
+
+  // a batch stops where an entry removed meanwhile was, and goes on after it
+  keys.clear();
+  {
+    auto iterator = tree.Scan(&lower_key, &upper_key, ScanInclusivity::BOTH);
+    for (int64_t key = 1000; key <= 1100; key += 2) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key, &transaction);
+    }
+    while ((count = iterator.NextBatch(rids, 7)) > 0) {
+      for (int i = 0; i < count; i++) {
+        keys.push_back(rids[i].GetSlotNum());
+      }
+    }
+  }
+  std::vector<int64_t> expected = range(1102, 3000);
+  expected.insert(expected.begin(), 1000);
+  EXPECT_EQ(keys, expected);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
 }  // namespace bustub
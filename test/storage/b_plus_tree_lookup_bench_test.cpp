@@ -0,0 +1,77 @@
+/**
+ * b_plus_tree_lookup_bench_test.cpp
+ */
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/index/key_search.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(BPlusTreeLookupBenchTest, PointLookupTest) {
+  const int64_t num_keys = 1000000;
+  const int num_lookups = 2000000;
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  remove("bench.db");
+  remove("bench.log");
+  auto *disk_manager = new DiskManager("bench.db");
+  // every page of the tree stays in the buffer pool
+  auto *bpm = new BufferPoolManager(8192, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+  int64_t next = 0;
+  ASSERT_TRUE(tree.BulkLoad([&next](std::pair<GenericKey<8>, RID> *entry) {
+    if (next == num_keys) {
+      return false;
+    }
+    entry->first.SetFromInteger(next * 2);
+    entry->second = RID(0, static_cast<uint32_t>(next));
+    next++;
+    return true;
+  }));
+
+  std::mt19937_64 gen(15445);
+  std::vector<GenericKey<8>> probes(num_lookups);
+  for (auto &probe : probes) {
+    // half of the keys are not in the tree
+    probe.SetFromInteger(static_cast<int64_t>(gen() % (num_keys * 2)));
+  }
+  for (bool simd : {false, true}) {
+    SetSimdKeySearch(simd);
+    std::vector<RID> rids;
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &probe : probes) {
+      rids.clear();
+      found += tree.GetValue(probe, &rids) ? 1 : 0;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << (IsSimdKeySearchEnabled() ? "SIMD" : "scalar") << " key search: " << num_lookups / seconds
+              << " lookups/s" << std::endl;
+    EXPECT_GT(found, num_lookups / 3);
+    EXPECT_LT(found, num_lookups * 2 / 3);
+  }
+  SetSimdKeySearch(true);
+
+  delete bpm;
+  delete disk_manager;
+  delete key_schema;
+  remove("bench.db");
+  remove("bench.log");
+}
+
+}  // namespace bustub
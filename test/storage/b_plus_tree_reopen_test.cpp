@@ -0,0 +1,80 @@
+/**
+ * b_plus_tree_reopen_test.cpp
+ */
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <iostream>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(BPlusTreeTests, ReopenTest) {
+  const int64_t num_keys = 10000000;
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  remove("reopen_test.db");
+  remove("reopen_test.log");
+
+  auto *disk_manager = new DiskManager("reopen_test.db");
+  auto *bpm = new BufferPoolManager(64, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  ASSERT_EQ(page_id, HEADER_PAGE_ID);
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  auto *tree = new BPlusTree<GenericKey<8>, RID, GenericComparator<8>>("foo_pk", bpm, comparator);
+  auto *transaction = new Transaction(0);
+  GenericKey<8> index_key;
+  for (int64_t key = 0; key < num_keys; key++) {
+    index_key.SetFromInteger(key);
+    tree->Insert(index_key, RID(static_cast<int32_t>(key >> 32), static_cast<uint32_t>(key)), transaction);
+  }
+  delete transaction;
+  bpm->FlushAllPages();
+  delete tree;
+  delete bpm;
+  delete disk_manager;
+
+  // reopening reads the root from the header page, not a single key is inserted again
+  auto start = std::chrono::steady_clock::now();
+  disk_manager = new DiskManager("reopen_test.db");
+  bpm = new BufferPoolManager(64, disk_manager);
+  tree = new BPlusTree<GenericKey<8>, RID, GenericComparator<8>>("foo_pk", bpm, comparator);
+  ASSERT_TRUE(tree->Open());
+  std::vector<RID> rids;
+  index_key.SetFromInteger(num_keys / 2);
+  ASSERT_TRUE(tree->GetValue(index_key, &rids));
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "reopened a tree of " << num_keys << " keys in " << seconds * 1000 << " ms" << std::endl;
+  EXPECT_LT(seconds, 0.1);
+  EXPECT_EQ(rids[0].GetSlotNum(), num_keys / 2);
+
+  for (int64_t key : {int64_t{0}, num_keys / 3, num_keys - 1}) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    ASSERT_TRUE(tree->GetValue(index_key, &rids));
+    EXPECT_EQ(rids[0].GetSlotNum(), key);
+  }
+  rids.clear();
+  index_key.SetFromInteger(num_keys);
+  EXPECT_FALSE(tree->GetValue(index_key, &rids));
+
+  // a tree that was never created stays empty
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> other("bar_pk", bpm, comparator);
+  EXPECT_FALSE(other.Open());
+  EXPECT_TRUE(other.IsEmpty());
+
+  delete tree;
+  delete bpm;
+  delete disk_manager;
+  delete key_schema;
+  remove("reopen_test.db");
+  remove("reopen_test.log");
+}
+
+}  // namespace bustub
@@ -0,0 +1,79 @@
+/**
+ * disk_manager_compression_bench_test.cpp
+ */
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#include "gtest/gtest.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+namespace {
+
+const int BENCH_NUM_PAGES = 2048;
+
+/** Fill a page with tuple-like data where roughly one byte in noise_every is random. */
+void FillPage(char *page, int noise_every, std::mt19937 *gen) {
+  for (int i = 0; i < PAGE_SIZE; i++) {
+    page[i] = static_cast<char>(i % 64);
+    if (noise_every > 0 && (*gen)() % noise_every == 0) {
+      page[i] = static_cast<char>((*gen)());
+    }
+  }
+}
+
+/** Write BENCH_NUM_PAGES pages, then scan them all back. Returns the scan throughput in MB/s. */
+double ScanThroughput(bool enable_compression, int noise_every, double *ratio) {
+  remove("bench.db");
+  remove("bench.log");
+  std::mt19937 gen(15445);
+  char page[PAGE_SIZE];
+  char buf[PAGE_SIZE];
+  double mbps;
+  {
+    DiskManager dm("bench.db", enable_compression);
+    for (page_id_t i = 0; i < BENCH_NUM_PAGES; i++) {
+      FillPage(page, noise_every, &gen);
+      dm.WritePage(i, page);
+    }
+    *ratio = dm.GetCompressionRatio();
+
+    // the scan reads through the OS page cache, so this mostly measures decompression against memcpy
+    auto start = std::chrono::steady_clock::now();
+    for (page_id_t i = 0; i < BENCH_NUM_PAGES; i++) {
+      dm.ReadPage(i, buf);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    mbps = static_cast<double>(BENCH_NUM_PAGES) * PAGE_SIZE / (1 << 20) / seconds;
+    dm.ShutDown();
+  }
+  remove("bench.db");
+  remove("bench.log");
+  return mbps;
+}
+
+}  // namespace
+
+// NOLINTNEXTLINE
+TEST(DiskManagerCompressionBenchTest, ScanThroughputTest) {
+  double ratio;
+  double raw = ScanThroughput(false, 0, &ratio);
+  std::cout << "uncompressed: " << raw << " MB/s" << std::endl;
+
+  // incompressible pages are stored raw and pay for the slot header, so their ratio dips just below 1
+  for (int noise_every : {0, 64, 16, 4, 1}) {
+    double mbps = ScanThroughput(true, noise_every, &ratio);
+    std::cout << "compressed (1/" << noise_every << " noise): " << mbps << " MB/s, ratio " << ratio << std::endl;
+    if (noise_every == 0) {
+      EXPECT_GT(ratio, 1.0);
+    }
+  }
+}
+
+}  // namespace bustub
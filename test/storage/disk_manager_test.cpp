@@ -11,6 +11,9 @@
 //===----------------------------------------------------------------------===//
 
 #include <cstring>
+#include <random>
+#include <string>
+#include <vector>
 
 #include "common/exception.h"
 #include "gtest/gtest.h"
@@ -72,6 +75,143 @@ TEST_F(DiskManagerTest, ReadWriteLogTest) {
   dm.ShutDown();
 }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LogSegmentTest) {
+  const int segment_size = 1024;
+  const int write_size = 300;
+  const int num_writes = 17;
+  std::string db_file("test.db");
+  // WriteLog wants the two log buffers in turns
+  char data[2][write_size];
+  std::vector<char> log(write_size * num_writes);
+  for (size_t i = 0; i < log.size(); i++) {
+    log[i] = static_cast<char>(i * 7);
+  }
+
+  {
+    auto dm = DiskManager(db_file);
+    dm.SetLogSegmentSize(segment_size);
+    // every write is one "record" whose lsn is its number
+    for (int i = 0; i < num_writes; i++) {
+      dm.IndexLogRecord(i, i * write_size);
+      memcpy(data[i % 2], log.data() + i * write_size, write_size);
+      dm.WriteLog(data[i % 2], write_size);
+    }
+    EXPECT_EQ(dm.GetLogSize(), write_size * num_writes);
+    EXPECT_EQ(dm.GetNumLogSegments(), (write_size * num_writes + segment_size - 1) / segment_size);
+
+    // reads cross segment boundaries
+    std::vector<char> buf(log.size());
+    ASSERT_TRUE(dm.ReadLog(buf.data(), buf.size(), 0));
+    EXPECT_EQ(buf, log);
+
+    // the index knows the first record of every segment: 0, 4 (1200), 7 (2100), 11 (3300), 14 (4200)
+    EXPECT_EQ(dm.FindLogOffset(2), 0);
+    EXPECT_EQ(dm.FindLogOffset(4), 4 * write_size);
+    EXPECT_EQ(dm.FindLogOffset(10), 7 * write_size);
+
+    // nothing before record 8 is needed any more: segments 0 and 1 go, segment 2 still has records 7 and 8 in it
+    dm.SetLogCheckpoint(9, 9, 8);
+    EXPECT_EQ(dm.GetLogStart(), 2 * segment_size);
+    EXPECT_FALSE(dm.ReadLog(buf.data(), write_size, 0));
+    EXPECT_EQ(dm.FindLogOffset(2), 7 * write_size);
+    dm.ShutDown();
+  }
+
+  // the master record survives a restart
+  auto dm = DiskManager(db_file);
+  EXPECT_EQ(dm.GetLogSegmentSize(), segment_size);
+  EXPECT_EQ(dm.GetLogSize(), write_size * num_writes);
+  lsn_t checkpoint_lsn;
+  lsn_t analysis_lsn;
+  ASSERT_TRUE(dm.GetLogCheckpoint(&checkpoint_lsn, &analysis_lsn));
+  EXPECT_EQ(checkpoint_lsn, 9);
+  EXPECT_EQ(dm.FindLogOffset(analysis_lsn), 7 * write_size);
+  std::vector<char> buf(write_size);
+  ASSERT_TRUE(dm.ReadLog(buf.data(), write_size, 7 * write_size));
+  EXPECT_EQ(memcmp(buf.data(), log.data() + 7 * write_size, write_size), 0);
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, CompressedReadWritePageTest) {
+  char buf[PAGE_SIZE] = {0};
+  char data[PAGE_SIZE] = {0};
+  char noise[PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  std::mt19937 gen(15445);
+  for (char &c : noise) {
+    c = static_cast<char>(gen());
+  }
+
+  {
+    auto dm = DiskManager(db_file, true);
+    EXPECT_TRUE(dm.IsCompressionEnabled());
+    std::strncpy(data, "A test string.", sizeof(data));
+
+    dm.ReadPage(0, buf);  // tolerate empty read
+
+    dm.WritePage(0, data);
+    dm.ReadPage(0, buf);
+    EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+
+    // an incompressible page is stored raw
+    dm.WritePage(1, noise);
+    dm.ReadPage(1, buf);
+    EXPECT_EQ(std::memcmp(buf, noise, sizeof(buf)), 0);
+
+    // page 0 grows out of its slot and has to move
+    dm.WritePage(0, noise);
+    dm.ReadPage(0, buf);
+    EXPECT_EQ(std::memcmp(buf, noise, sizeof(buf)), 0);
+    dm.WritePage(0, data);
+    dm.WritePage(5, data);
+    EXPECT_GT(dm.GetCompressionRatio(), 1.0);
+    dm.ShutDown();
+  }
+
+  // the slots are found again when the file is reopened
+  auto dm = DiskManager(db_file, true);
+  dm.ReadPage(0, buf);
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  dm.ReadPage(1, buf);
+  EXPECT_EQ(std::memcmp(buf, noise, sizeof(buf)), 0);
+  dm.ReadPage(5, buf);
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, PreallocateTest) {
+  char buf[PAGE_SIZE] = {0};
+  char data[PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+  dm.SetPreallocateChunkSize(16 * PAGE_SIZE);
+  std::strncpy(data, "A test string.", sizeof(data));
+
+  EXPECT_EQ(dm.GetPreallocatedHeadroom(), 0);
+  for (int i = 0; i < 40; i++) {
+    page_id_t page_id = dm.AllocatePage();
+    dm.WritePage(page_id, data);
+    // there is always space reserved ahead of the allocated pages, at most one chunk and a quarter
+    size_t headroom = dm.GetPreallocatedHeadroom();
+#ifdef __linux__
+    EXPECT_GT(headroom, 0);
+#endif
+    EXPECT_LE(headroom, 20 * PAGE_SIZE);
+  }
+
+  // preallocated space does not show up as pages
+  dm.ReadPage(41, buf);
+  char zero[PAGE_SIZE] = {0};
+  EXPECT_EQ(std::memcmp(buf, zero, sizeof(buf)), 0);
+  dm.ReadPage(39, buf);
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+
+  dm.ShutDown();
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
 
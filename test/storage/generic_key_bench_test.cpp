@@ -0,0 +1,109 @@
+/**
+ * generic_key_bench_test.cpp
+ */
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "gtest/gtest.h"
+#include "storage/index/generic_key.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+namespace {
+
+const int BENCH_NUM_KEYS = 500000;
+
+/** A key tuple copied as it is, the way keys were stored before they were normalized. */
+template <size_t KeySize>
+struct RawKey {
+  char data_[KeySize];
+};
+
+/** The comparator of raw keys: deserialize every column of both keys into Values and compare those. */
+template <size_t KeySize>
+class ValueComparator {
+ public:
+  explicit ValueComparator(Schema *key_schema) : key_schema_(key_schema) {}
+
+  int operator()(const RawKey<KeySize> &lhs, const RawKey<KeySize> &rhs) const {
+    for (uint32_t i = 0; i < key_schema_->GetColumnCount(); i++) {
+      const auto &col = key_schema_->GetColumn(i);
+      Value lhs_value = Value::DeserializeFrom(lhs.data_ + col.GetOffset(), col.GetType());
+      Value rhs_value = Value::DeserializeFrom(rhs.data_ + col.GetOffset(), col.GetType());
+      if (lhs_value.CompareLessThan(rhs_value) == CmpBool::CmpTrue) {
+        return -1;
+      }
+      if (lhs_value.CompareGreaterThan(rhs_value) == CmpBool::CmpTrue) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+ private:
+  Schema *key_schema_;
+};
+
+/** Sort the keys, then binary search every one of them. Prints the time both took. */
+template <typename Key, typename Comparator>
+void SortAndSearch(const std::string &name, std::vector<Key> keys, const Comparator &comparator) {
+  auto less = [&comparator](const Key &a, const Key &b) { return comparator(a, b) < 0; };
+  std::vector<Key> probes = keys;
+  auto start = std::chrono::steady_clock::now();
+  std::sort(keys.begin(), keys.end(), less);
+  double sort_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  start = std::chrono::steady_clock::now();
+  size_t found = 0;
+  for (const auto &probe : probes) {
+    found += std::binary_search(keys.begin(), keys.end(), probe, less) ? 1 : 0;
+  }
+  double search_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << name << ": sort " << sort_seconds * 1000 << " ms, " << probes.size() << " lookups "
+            << search_seconds * 1000 << " ms" << std::endl;
+  EXPECT_EQ(found, probes.size());
+}
+
+/** Build the keys of the tuples as raw and as normalized keys, and time every comparator on them. */
+template <size_t KeySize>
+void CompareComparators(const std::string &statement, const std::vector<std::vector<Value>> &rows) {
+  Schema *key_schema = ParseCreateStatement(statement);
+  std::vector<RawKey<KeySize>> raw_keys(rows.size());
+  std::vector<GenericKey<KeySize>> keys(rows.size());
+  for (size_t i = 0; i < rows.size(); i++) {
+    Tuple tuple(rows[i], key_schema);
+    memset(raw_keys[i].data_, 0, KeySize);
+    memcpy(raw_keys[i].data_, tuple.GetData(), tuple.GetLength());
+    keys[i].SetFromKey(tuple, key_schema);
+  }
+  SortAndSearch(statement + ", Value comparator", raw_keys, ValueComparator<KeySize>(key_schema));
+  SortAndSearch(statement + ", normalized comparator", keys, GenericComparator<KeySize>(key_schema));
+  delete key_schema;
+}
+
+}  // namespace
+
+// NOLINTNEXTLINE
+TEST(GenericKeyBenchTest, ComparatorTest) {
+  std::mt19937_64 gen(15445);
+  std::vector<std::vector<Value>> single;
+  std::vector<std::vector<Value>> pairs;
+  for (int i = 0; i < BENCH_NUM_KEYS; i++) {
+    int64_t key = static_cast<int64_t>(gen());
+    single.push_back({ValueFactory::GetBigIntValue(key)});
+    // few distinct first columns, so the second one decides often
+    pairs.push_back({ValueFactory::GetBigIntValue(key % 64), ValueFactory::GetIntegerValue(static_cast<int32_t>(i))});
+  }
+  // a single integer column takes the integer comparator, two columns the memcmp one
+  CompareComparators<8>("a bigint", single);
+  CompareComparators<16>("a bigint,b int", pairs);
+}
+
+}  // namespace bustub
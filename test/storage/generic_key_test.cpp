@@ -0,0 +1,121 @@
+/**
+ * generic_key_test.cpp
+ */
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "gtest/gtest.h"
+#include "storage/index/generic_key.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(GenericKeyTest, NormalizedOrderTest) {
+  Schema *key_schema = ParseCreateStatement("a int,b double,c varchar(8)");
+  GenericComparator<32> comparator(key_schema);
+  std::vector<Value> ints{ValueFactory::GetNullValueByType(TypeId::INTEGER), ValueFactory::GetIntegerValue(-300),
+                          ValueFactory::GetIntegerValue(-1), ValueFactory::GetIntegerValue(0),
+                          ValueFactory::GetIntegerValue(1), ValueFactory::GetIntegerValue(256)};
+  std::vector<Value> decimals{ValueFactory::GetDecimalValue(-1e10), ValueFactory::GetDecimalValue(-2.5),
+                              ValueFactory::GetDecimalValue(0), ValueFactory::GetDecimalValue(0.5),
+                              ValueFactory::GetDecimalValue(3)};
+  std::vector<Value> strings{ValueFactory::GetVarcharValue(""), ValueFactory::GetVarcharValue("a"),
+                             ValueFactory::GetVarcharValue("ab"), ValueFactory::GetVarcharValue("b")};
+
+  // every combination, in order
+  std::vector<GenericKey<32>> keys;
+  for (const auto &a : ints) {
+    for (const auto &b : decimals) {
+      for (const auto &c : strings) {
+        GenericKey<32> key;
+        key.SetFromKey(Tuple({a, b, c}, key_schema), key_schema);
+        // the columns come back out of the key
+        EXPECT_EQ(key.ToValue(key_schema, 0).CompareEquals(a), a.IsNull() ? CmpBool::CmpNull : CmpBool::CmpTrue);
+        EXPECT_EQ(key.ToValue(key_schema, 1).CompareEquals(b), CmpBool::CmpTrue);
+        EXPECT_EQ(key.ToValue(key_schema, 2).CompareEquals(c), CmpBool::CmpTrue);
+        keys.push_back(key);
+      }
+    }
+  }
+  for (size_t i = 0; i + 1 < keys.size(); i++) {
+    EXPECT_EQ(comparator(keys[i], keys[i + 1]), -1) << i;
+    EXPECT_EQ(comparator(keys[i + 1], keys[i]), 1) << i;
+    EXPECT_EQ(comparator(keys[i], keys[i]), 0) << i;
+  }
+  delete key_schema;
+}
+
+// NOLINTNEXTLINE
+TEST(GenericKeyTest, IntegerComparatorTest) {
+  std::vector<int64_t> values{INT32_MIN + 1, -70000, -256, -1, 0, 1, 255, 65536, INT32_MAX};
+  std::mt19937 gen(15445);
+  for (const char *statement : {"a int", "a bigint"}) {
+    Schema *key_schema = ParseCreateStatement(statement);
+    GenericComparator<8> comparator(key_schema);
+    std::vector<GenericKey<8>> keys;
+    for (int64_t value : values) {
+      GenericKey<8> key;
+      Value column = key_schema->GetColumn(0).GetType() == TypeId::INTEGER
+                         ? ValueFactory::GetIntegerValue(static_cast<int32_t>(value))
+                         : ValueFactory::GetBigIntValue(value);
+      key.SetFromKey(Tuple({column}, key_schema), key_schema);
+      keys.push_back(key);
+    }
+    std::vector<GenericKey<8>> sorted = keys;
+    std::shuffle(sorted.begin(), sorted.end(), gen);
+    std::sort(sorted.begin(), sorted.end(),
+              [&comparator](const GenericKey<8> &a, const GenericKey<8> &b) { return comparator(a, b) < 0; });
+    for (size_t i = 0; i < values.size(); i++) {
+      EXPECT_EQ(comparator(sorted[i], keys[i]), 0) << statement << " " << values[i];
+      EXPECT_EQ(sorted[i].ToValue(key_schema, 0).CastAs(TypeId::BIGINT).GetAs<int64_t>(), values[i]);
+    }
+    delete key_schema;
+  }
+
+  // the test keys of a bigint column
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  GenericKey<8> lhs;
+  GenericKey<8> rhs;
+  lhs.SetFromInteger(-5);
+  rhs.SetFromInteger(3);
+  EXPECT_EQ(lhs.ToString(), -5);
+  EXPECT_EQ(comparator(lhs, rhs), -1);
+  rhs.SetFromKey(Tuple({ValueFactory::GetBigIntValue(-5)}, key_schema), key_schema);
+  EXPECT_EQ(comparator(lhs, rhs), 0);
+  delete key_schema;
+}
+
+// NOLINTNEXTLINE
+TEST(GenericKeyTest, SeparatorTest) {
+  Schema *key_schema = ParseCreateStatement("a varchar(16)");
+  GenericComparator<32> comparator(key_schema);
+  std::vector<std::string> strings{"", "a", "apple", "applesauce", "apply", "b", "banana"};
+  std::vector<GenericKey<32>> keys;
+  for (const auto &str : strings) {
+    GenericKey<32> key;
+    key.SetFromKey(Tuple({ValueFactory::GetVarcharValue(str)}, key_schema), key_schema);
+    keys.push_back(key);
+  }
+  for (size_t i = 0; i + 1 < keys.size(); i++) {
+    // lower < separator <= upper, and the separator is no longer than the part of upper that tells them apart
+    GenericKey<32> separator = GenericKey<32>::Separator(keys[i], keys[i + 1]);
+    EXPECT_EQ(comparator(keys[i], separator), -1) << strings[i];
+    EXPECT_LE(comparator(separator, keys[i + 1]), 0) << strings[i];
+    size_t common = 0;
+    while (keys[i].data_[common] == keys[i + 1].data_[common]) {
+      common++;
+    }
+    for (size_t j = common + 1; j < 32; j++) {
+      EXPECT_EQ(separator.data_[j], 0) << strings[i];
+    }
+  }
+  delete key_schema;
+}
+
+}  // namespace bustub
@@ -0,0 +1,62 @@
+/**
+ * key_search_test.cpp
+ */
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "gtest/gtest.h"
+#include "storage/index/key_search.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+namespace {
+
+/** Search sorted arrays of every size up to a page of keys with and without SIMD, for keys in and between them. */
+template <size_t KeySize>
+void CheckLowerBound(const char *statement) {
+  Schema *key_schema = ParseCreateStatement(statement);
+  GenericComparator<KeySize> comparator(key_schema);
+  auto make_key = [key_schema](int64_t value) {
+    GenericKey<KeySize> key;
+    Value column = KeySize == 8 ? ValueFactory::GetBigIntValue(value)
+                                : ValueFactory::GetIntegerValue(static_cast<int32_t>(value));
+    key.SetFromKey(Tuple({column}, key_schema), key_schema);
+    return key;
+  };
+  std::mt19937 gen(15445);
+  for (int size = 0; size <= 300; size++) {
+    // even values around zero, so that odd probes fall between them
+    std::vector<GenericKey<KeySize>> keys;
+    std::vector<int64_t> values;
+    int64_t value = -2 * size - static_cast<int64_t>(gen() % 100) * 2;
+    for (int i = 0; i < size; i++) {
+      values.push_back(value);
+      keys.push_back(make_key(value));
+      value += 2 * (1 + gen() % 3);
+    }
+    for (int64_t probe = (size == 0 ? 0 : values[0]) - 3; probe <= (size == 0 ? 0 : values.back()) + 3; probe++) {
+      auto expected = static_cast<int>(std::lower_bound(values.begin(), values.end(), probe) - values.begin());
+      GenericKey<KeySize> key = make_key(probe);
+      SetSimdKeySearch(true);
+      ASSERT_EQ(KeyLowerBound(keys.data(), size, key, comparator), expected) << size << " " << probe;
+      SetSimdKeySearch(false);
+      ASSERT_EQ(KeyLowerBound(keys.data(), size, key, comparator), expected) << size << " " << probe;
+    }
+  }
+  SetSimdKeySearch(true);
+  delete key_schema;
+}
+
+}  // namespace
+
+// NOLINTNEXTLINE
+TEST(KeySearchTest, LowerBoundTest) {
+  CheckLowerBound<8>("a bigint");
+  CheckLowerBound<4>("a int");
+}
+
+}  // namespace bustub
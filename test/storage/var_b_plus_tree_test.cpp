@@ -0,0 +1,246 @@
+/**
+ * var_b_plus_tree_test.cpp
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/index/var_b_plus_tree.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+namespace {
+
+// distinct strings of 4 to 40 characters
+std::vector<std::string> RandomStrings(int count, std::mt19937 *rng) {
+  std::uniform_int_distribution<int> length(4, 40);
+  std::uniform_int_distribution<int> letter('a', 'z');
+  std::vector<std::string> strings;
+  for (int i = 0; i < count; i++) {
+    std::string str = std::to_string(i);
+    str.resize(std::max<size_t>(str.size(), length(*rng)), '-');
+    for (size_t j = std::to_string(i).size(); j < str.size(); j++) {
+      str[j] = static_cast<char>(letter(*rng));
+    }
+    strings.push_back(str);
+  }
+  return strings;
+}
+
+}  // namespace
+
+TEST(VarBPlusTreeTests, InsertRemoveTest) {
+  Schema *key_schema = ParseCreateStatement("a varchar(48)");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  // a pin the tree leaks runs the small pool out of frames
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  VarBPlusTree tree("foo_pk", bpm);
+  VarKeyComparator comparator(key_schema);
+
+  std::mt19937 rng(15445);
+  const int num_keys = 20000;
+  std::vector<std::string> strings = RandomStrings(num_keys, &rng);
+  std::vector<VarKey> keys(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    keys[i].SetFromKey(Tuple({ValueFactory::GetVarcharValue(strings[i])}, key_schema), key_schema);
+  }
+  std::vector<int> order(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), rng);
+  for (int i : order) {
+    EXPECT_TRUE(tree.Insert(keys[i], RID(0, i)));
+  }
+  EXPECT_FALSE(tree.Insert(keys[7], RID(1, 7)));
+
+  std::vector<RID> rids;
+  for (int i = 0; i < num_keys; i++) {
+    rids.clear();
+    ASSERT_TRUE(tree.GetValue(keys[i], &rids)) << strings[i];
+    EXPECT_EQ(rids[0], RID(0, i));
+  }
+  // the keys come back in the order of their strings
+  std::sort(order.begin(), order.end(), [&](int a, int b) { return strings[a] < strings[b]; });
+  int count = 0;
+  for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator, count++) {
+    ASSERT_EQ((*iterator).second, RID(0, order[count]));
+    EXPECT_EQ(comparator((*iterator).first, keys[order[count]]), 0);
+  }
+  EXPECT_EQ(count, num_keys);
+  auto iterator = tree.Begin(keys[order[num_keys / 2]]);
+  EXPECT_EQ((*iterator).second, RID(0, order[num_keys / 2]));
+
+  // freeing the pages that empty keeps the tree in order
+  std::shuffle(order.begin(), order.end(), rng);
+  for (int i = 0; i < num_keys * 2 / 3; i++) {
+    tree.Remove(keys[order[i]]);
+  }
+  for (int i = 0; i < num_keys; i++) {
+    rids.clear();
+    EXPECT_EQ(tree.GetValue(keys[order[i]], &rids), i >= num_keys * 2 / 3);
+  }
+  count = 0;
+  VarKey last;
+  for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator, count++) {
+    if (count > 0) {
+      EXPECT_EQ(comparator(last, (*iterator).first), -1);
+    }
+    last = (*iterator).first;
+  }
+  EXPECT_EQ(count, num_keys - num_keys * 2 / 3);
+  for (int i = num_keys * 2 / 3; i < num_keys; i++) {
+    tree.Remove(keys[order[i]]);
+  }
+  EXPECT_TRUE(tree.IsEmpty());
+  EXPECT_TRUE(tree.begin() == tree.end());
+
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(VarBPlusTreeTests, DuplicateKeyTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  VarBPlusTree tree("foo_idx", bpm, false);
+
+  // key 0 is hot enough to take several overflow pages, the others have a few RIDs each
+  const int num_keys = 2000;
+  const int num_hot = 3000;
+  std::vector<VarKey> keys(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    keys[i].SetFromKey(Tuple({ValueFactory::GetBigIntValue(i)}, key_schema), key_schema);
+  }
+  std::vector<std::pair<int, RID>> entries;
+  for (int i = 0; i < num_hot; i++) {
+    entries.emplace_back(0, RID(i, i));
+  }
+  for (int i = 1; i < num_keys; i++) {
+    for (int j = 0; j < i % 5 + 1; j++) {
+      entries.emplace_back(i, RID(i, j));
+    }
+  }
+  std::mt19937 rng(15445);
+  std::shuffle(entries.begin(), entries.end(), rng);
+  for (const auto &entry : entries) {
+    EXPECT_TRUE(tree.Insert(keys[entry.first], entry.second));
+  }
+  EXPECT_FALSE(tree.Insert(keys[0], RID(5, 5)));
+  EXPECT_FALSE(tree.Insert(keys[3], RID(3, 2)));
+
+  // every RID of a key comes back from one lookup, in order
+  std::vector<RID> rids;
+  tree.GetValue(keys[0], &rids);
+  ASSERT_EQ(rids.size(), num_hot);
+  for (int i = 0; i < num_hot; i++) {
+    EXPECT_EQ(rids[i], RID(i, i));
+  }
+  for (int i = 1; i < num_keys; i++) {
+    rids.clear();
+    ASSERT_TRUE(tree.GetValue(keys[i], &rids));
+    ASSERT_EQ(rids.size(), i % 5 + 1);
+    EXPECT_EQ(rids.back(), RID(i, i % 5));
+  }
+  int count = 0;
+  for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator, count++) {
+  }
+  EXPECT_EQ(count, entries.size());
+
+  // removing RIDs one at a time shrinks the lists, the hot one back into its leaf
+  std::shuffle(entries.begin(), entries.end(), rng);
+  size_t half = entries.size() / 2;
+  for (size_t i = 0; i < half; i++) {
+    tree.Remove(keys[entries[i].first], entries[i].second);
+  }
+  std::vector<size_t> left(num_keys);
+  for (size_t i = half; i < entries.size(); i++) {
+    left[entries[i].first]++;
+  }
+  for (int i = 0; i < num_keys; i++) {
+    rids.clear();
+    EXPECT_EQ(tree.GetValue(keys[i], &rids), left[i] > 0);
+    EXPECT_EQ(rids.size(), left[i]);
+  }
+  for (size_t i = half; i < entries.size(); i++) {
+    tree.Remove(keys[entries[i].first], entries[i].second);
+  }
+  EXPECT_TRUE(tree.IsEmpty());
+
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(VarBPlusTreeTests, SizeTest) {
+  // the same string keys in a GenericKey<64> tree and in a variable-length one
+  Schema *key_schema = ParseCreateStatement("a varchar(48)");
+  std::mt19937 rng(15445);
+  const int num_keys = 20000;
+  std::vector<std::string> strings = RandomStrings(num_keys, &rng);
+  std::vector<Tuple> tuples;
+  for (const auto &str : strings) {
+    tuples.emplace_back(std::vector<Value>{ValueFactory::GetVarcharValue(str)}, key_schema);
+  }
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  GenericComparator<64> comparator(key_schema);
+  BPlusTree<GenericKey<64>, RID, GenericComparator<64>> tree("foo_pk", bpm, comparator);
+  Transaction transaction(0);
+  for (int i = 0; i < num_keys; i++) {
+    GenericKey<64> key;
+    key.SetFromKey(tuples[i], key_schema);
+    tree.Insert(key, RID(0, i), &transaction);
+  }
+  page_id_t fixed_pages = disk_manager->GetNumPages();
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+
+  disk_manager = new DiskManager("test.db");
+  bpm = new BufferPoolManager(50, disk_manager);
+  bpm->NewPage(&page_id);
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  VarBPlusTree var_tree("foo_pk", bpm);
+  for (int i = 0; i < num_keys; i++) {
+    VarKey key;
+    key.SetFromKey(tuples[i], key_schema);
+    var_tree.Insert(key, RID(0, i));
+  }
+  page_id_t var_pages = disk_manager->GetNumPages();
+
+  // keys of some 23 bytes take 35 with their slot and RID instead of 72, about half the pages
+  EXPECT_LT(var_pages * 3, fixed_pages * 2) << var_pages << " " << fixed_pages;
+
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub